@@ -0,0 +1,28 @@
+# SPDX-License-Identifier: LGPL-3.0-or-other
+# Copyright (C) 2021 Contributors to the SLS Detector Package
+"""
+Example showing how to process the images of an acquisition in Python
+while the acquisition is running
+"""
+import numpy as np
+from slsdet import Detector, FrameReceiver
+
+d = Detector()
+d.frames = 1000
+
+# 32 recycled buffers, the data call back waits if all are in use
+rx = FrameReceiver(d, nbuffers=32)
+rx.start()
+
+total = None
+for image, meta in rx:
+    # image is a view on the buffer, copy it to keep it
+    if total is None:
+        total = np.zeros(image.shape, dtype=np.float64)
+    total += image
+    if meta['frameIndex'] % 100 == 0:
+        print(f"Frame {meta['frameIndex']}, progress {meta['progress']:.1f}%")
+
+# raises if the acquisition failed
+rx.join()
+print(f"Received {rx.received} frames, dropped {rx.dropped}")
@@ -30,9 +30,11 @@ ext_modules = [
         'src/current.cpp',
         'src/enums.cpp',
         'src/detector.cpp',
+        'src/frames.cpp',
         'src/network.cpp',
         'src/pattern.cpp',
-        'src/scan.cpp',],
+        'src/scan.cpp',
+        'src/rawfile.cpp',],
         include_dirs=[
             os.path.join('../libs/pybind11/include'),
             os.path.join(get_conda_path(), 'include'),
@@ -23,4 +23,5 @@ from .enums import *
 IpAddr = _slsdet.IpAddr
 MacAddr = _slsdet.MacAddr
 scanParameters = _slsdet.scanParameters
-currentSrcParameters = _slsdet.currentSrcParameters
\ No newline at end of file
+currentSrcParameters = _slsdet.currentSrcParameters
+FrameReceiver = _slsdet.FrameReceiver
\ No newline at end of file
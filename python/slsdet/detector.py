@@ -365,6 +365,21 @@ class Detector(CppDetectorApi):
     def frames(self, n_frames):
         self.setNumberOfFrames(n_frames)
 
+    @property
+    @element
+    def configcache(self):
+        """Cache frames, triggers, exptime, period, delay, dr and timing in shared memory, so that getting them does not contact the detector. Default is disabled.
+
+        Note
+        -----
+        Sets from other clients are detected within 100 ms.
+        """
+        return self.getConfigCache()
+
+    @configcache.setter
+    def configcache(self, value):
+        ut.set_using_dict(self.setConfigCache, value)
+
     @property
     @element
     def framesl(self):
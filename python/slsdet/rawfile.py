@@ -0,0 +1,52 @@
+# SPDX-License-Identifier: LGPL-3.0-or-other
+# Copyright (C) 2021 Contributors to the SLS Detector Package
+"""
+Random access to the binary files of the receiver through the frame index
+written with slsReceiver --frame_index
+"""
+
+import re
+from pathlib import Path
+
+import _slsdet  #C++ lib
+
+RawFileReader = _slsdet.io.RawFileReader
+
+
+def sub_files(fname):
+    """
+    Return the sub files (_f0, _f1...) of the acquisition that fname
+    belongs to, in order
+    """
+    fname = Path(fname)
+    m = re.match(r'(.*_f)\d+(_\d+\.raw)$', fname.name)
+    if m is None:
+        return [str(fname)]
+    pattern = re.compile(re.escape(m.group(1)) + r'(\d+)' + re.escape(m.group(2)) + '$')
+    files = []
+    for f in fname.parent.iterdir():
+        n = pattern.match(f.name)
+        if n is not None:
+            files.append((int(n.group(1)), str(f)))
+    return [f for _, f in sorted(files)]
+
+
+def open_raw(fname):
+    """Open all sub files of the acquisition as one RawFileReader"""
+    return RawFileReader(sub_files(fname))
+
+
+def complete_frames(reader, batch=256, nthreads=0):
+    """
+    Iterate over the frames with all their packets, yields the frame
+    number and the data without the receiver header. Frames are read
+    in batches, in parallel.
+    """
+    index = reader.index()
+    positions = reader.complete_frames()
+    header = reader.header_size
+    for start in range(0, len(positions), batch):
+        chunk = positions[start:start + batch]
+        data = reader.read_frames(chunk.tolist(), nthreads)
+        for row, i in zip(data, chunk):
+            yield int(index['frameNumber'][i]), row[header:index['size'][i]]
@@ -35,13 +35,14 @@ void init_det(py::module &m) {
              (void (Detector::*)(const std::string &)) & Detector::loadConfig,
              py::arg())
         .def("loadParameters",
-             (void (Detector::*)(const std::string &)) &
+             (void (Detector::*)(const std::string &, bool, bool)) &
                  Detector::loadParameters,
-             py::arg())
+             py::arg(), py::arg() = false, py::arg() = false)
         .def("loadParameters",
-             (void (Detector::*)(const std::vector<std::string> &)) &
+             (void (Detector::*)(const std::vector<std::string> &, bool,
+                                 bool)) &
                  Detector::loadParameters,
-             py::arg())
+             py::arg(), py::arg() = false, py::arg() = false)
         .def("getHostname",
              (Result<std::string>(Detector::*)(sls::Positions) const) &
                  Detector::getHostname,
@@ -55,6 +56,14 @@ void init_det(py::module &m) {
                  Detector::setVirtualDetectorServers,
              py::arg(), py::arg())
         .def("getShmId", (int (Detector::*)() const) & Detector::getShmId)
+        .def("getConfigCache",
+             (Result<bool>(Detector::*)(sls::Positions) const) &
+                 Detector::getConfigCache,
+             py::arg() = Positions{})
+        .def("setConfigCache",
+             (void (Detector::*)(bool, sls::Positions)) &
+                 Detector::setConfigCache,
+             py::arg(), py::arg() = Positions{})
         .def("getPackageVersion",
              (std::string(Detector::*)() const) & Detector::getPackageVersion)
         .def("getClientVersion",
@@ -0,0 +1,405 @@
+// SPDX-License-Identifier: LGPL-3.0-or-other
+// Copyright (C) 2021 Contributors to the SLS Detector Package
+/*
+This file contains the Python bindings for the FrameReceiver, which hands
+the complete images of the data call back to Python as numpy arrays.
+*/
+
+#include <pybind11/chrono.h>
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include "sls/Detector.h"
+#include "sls/detectorData.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace py = pybind11;
+
+namespace {
+
+/** metadata of a frame, exposed to Python as a numpy structured array */
+struct frameMetadata {
+    uint64_t frameIndex;
+    int64_t subFrameIndex;
+    uint64_t fileIndex;
+    double progress;
+    int32_t nx;
+    int32_t ny;
+    int32_t dynamicRange;
+    int32_t databytes;
+    bool completeImage;
+    char fileName[256];
+};
+
+/**
+ * Fixed number of frame buffers shared between the data call back and the
+ * numpy arrays handed to Python. A buffer goes back to the free list when
+ * the last array using it is garbage collected, so that the pool can
+ * outlive the receiver.
+ */
+class FramePool {
+  public:
+    explicit FramePool(size_t nbuffers)
+        : buffers(nbuffers), metadata(nbuffers) {
+        for (size_t i = 0; i < nbuffers; ++i) {
+            freeSlots.push_back(i);
+        }
+    }
+
+    size_t size() const { return buffers.size(); }
+
+    void release(size_t slot) {
+        std::lock_guard<std::mutex> lock(mtx);
+        freeSlots.push_back(slot);
+        cv.notify_all();
+    }
+
+    std::vector<std::vector<char>> buffers;
+    std::vector<frameMetadata> metadata;
+    std::vector<size_t> freeSlots;
+    std::deque<size_t> readySlots;
+    std::mutex mtx;
+    std::condition_variable cv;
+};
+
+/** keeps a pool buffer alive while numpy arrays point to it */
+struct frameLease {
+    std::shared_ptr<FramePool> pool;
+    size_t slot;
+};
+
+class FrameReceiver {
+  public:
+    FrameReceiver(sls::Detector &detector, size_t nbuffers, bool blocking)
+        : det(detector), block(blocking) {
+        if (nbuffers == 0) {
+            throw std::runtime_error("Number of buffers must be at least 1");
+        }
+        pool = std::make_shared<FramePool>(nbuffers);
+        det.registerDataCallback(&GetDataCallBack, this);
+    }
+
+    ~FrameReceiver() {
+        {
+            std::lock_guard<std::mutex> lock(pool->mtx);
+            closing = true;
+            pool->cv.notify_all();
+        }
+        if (acquireThread.joinable()) {
+            acquireThread.join();
+        }
+        det.registerDataCallback(nullptr, nullptr);
+        // frames never popped go back to the pool
+        std::lock_guard<std::mutex> lock(pool->mtx);
+        for (auto slot : pool->readySlots) {
+            pool->freeSlots.push_back(slot);
+        }
+        pool->readySlots.clear();
+    }
+
+    /** runs the acquisition in a background thread */
+    void start() {
+        if (acquireThread.joinable()) {
+            if (!isFinished()) {
+                throw std::runtime_error("Acquisition already running");
+            }
+            acquireThread.join();
+        }
+        {
+            std::lock_guard<std::mutex> lock(pool->mtx);
+            // frames of a previous acquisition not popped are discarded
+            for (auto slot : pool->readySlots) {
+                pool->freeSlots.push_back(slot);
+            }
+            pool->readySlots.clear();
+            running = true;
+            finished = false;
+            error.clear();
+            nReceived = 0;
+            nDropped = 0;
+        }
+        acquireThread = std::thread(&FrameReceiver::AcquireThread, this);
+    }
+
+    /** waits for the end of the acquisition started with start() */
+    void join() {
+        if (acquireThread.joinable()) {
+            py::gil_scoped_release release;
+            acquireThread.join();
+        }
+        std::lock_guard<std::mutex> lock(pool->mtx);
+        if (!error.empty()) {
+            std::string mess = error;
+            error.clear();
+            throw std::runtime_error(mess);
+        }
+    }
+
+    /**
+     * returns the next frame as a tuple of image and metadata, or None at
+     * the end of the acquisition or after the timeout
+     */
+    py::object pop(double timeout) {
+        auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::duration<double>(timeout));
+        size_t slot = 0;
+        while (true) {
+            bool found = false, done = false;
+            {
+                py::gil_scoped_release release;
+                std::unique_lock<std::mutex> lock(pool->mtx);
+                // short waits, so that Ctrl+C is handled while blocking
+                auto until = std::chrono::steady_clock::now() +
+                             std::chrono::milliseconds(100);
+                if (timeout >= 0 && deadline < until) {
+                    until = deadline;
+                }
+                pool->cv.wait_until(lock, until, [this] {
+                    return !pool->readySlots.empty() || finished || closing;
+                });
+                if (!pool->readySlots.empty()) {
+                    slot = pool->readySlots.front();
+                    pool->readySlots.pop_front();
+                    found = true;
+                } else if (finished || closing) {
+                    done = true;
+                }
+            }
+            if (found) {
+                return MakeFrame(slot);
+            }
+            if (done) {
+                return py::none();
+            }
+            if (PyErr_CheckSignals() != 0) {
+                throw py::error_already_set();
+            }
+            if (timeout >= 0 && std::chrono::steady_clock::now() >= deadline) {
+                return py::none();
+            }
+        }
+    }
+
+    py::object next() {
+        py::object frame = pop(-1);
+        if (frame.is_none()) {
+            throw py::stop_iteration();
+        }
+        return frame;
+    }
+
+    bool isFinished() {
+        std::lock_guard<std::mutex> lock(pool->mtx);
+        return finished;
+    }
+
+    size_t getNumberOfBuffers() const { return pool->size(); }
+
+    size_t getNumberOfPendingFrames() {
+        std::lock_guard<std::mutex> lock(pool->mtx);
+        return pool->readySlots.size();
+    }
+
+    uint64_t getNumberOfReceivedFrames() {
+        std::lock_guard<std::mutex> lock(pool->mtx);
+        return nReceived;
+    }
+
+    uint64_t getNumberOfDroppedFrames() {
+        std::lock_guard<std::mutex> lock(pool->mtx);
+        return nDropped;
+    }
+
+  private:
+    static void GetDataCallBack(detectorData *data, uint64_t frameIndex,
+                                uint32_t subFrameIndex, void *this_pointer) {
+        static_cast<FrameReceiver *>(this_pointer)
+            ->GetData(data, frameIndex, subFrameIndex);
+    }
+
+    /** copies the frame into a free buffer, called without the GIL */
+    void GetData(detectorData *data, uint64_t frameIndex,
+                 uint32_t subFrameIndex) {
+        size_t slot = 0;
+        {
+            std::unique_lock<std::mutex> lock(pool->mtx);
+            ++nReceived;
+            // only wait for Python if it can run, i.e. acquire was started
+            // from start() and does not hold the GIL
+            if (block && running) {
+                pool->cv.wait(lock, [this] {
+                    return !pool->freeSlots.empty() || closing;
+                });
+            }
+            if (pool->freeSlots.empty()) {
+                ++nDropped;
+                return;
+            }
+            slot = pool->freeSlots.back();
+            pool->freeSlots.pop_back();
+        }
+
+        // buffers keep their capacity, no allocation after the first frames
+        auto &buffer = pool->buffers[slot];
+        buffer.resize(data->databytes);
+        memcpy(buffer.data(), data->data, data->databytes);
+
+        frameMetadata &meta = pool->metadata[slot];
+        meta.frameIndex = frameIndex;
+        meta.subFrameIndex = static_cast<int32_t>(subFrameIndex);
+        meta.fileIndex = data->fileIndex;
+        meta.progress = data->progressIndex;
+        meta.nx = data->nx;
+        meta.ny = data->ny;
+        meta.dynamicRange = data->dynamicRange;
+        meta.databytes = data->databytes;
+        meta.completeImage = data->completeImage;
+        strncpy(meta.fileName, data->fileName.c_str(),
+                sizeof(meta.fileName) - 1);
+        meta.fileName[sizeof(meta.fileName) - 1] = '\0';
+
+        std::lock_guard<std::mutex> lock(pool->mtx);
+        pool->readySlots.push_back(slot);
+        pool->cv.notify_all();
+    }
+
+    void AcquireThread() {
+        std::string mess;
+        try {
+            det.acquire();
+        } catch (const std::exception &e) {
+            mess = e.what();
+        }
+        std::lock_guard<std::mutex> lock(pool->mtx);
+        error = mess;
+        running = false;
+        finished = true;
+        pool->cv.notify_all();
+    }
+
+    /** numpy arrays of image and metadata sharing one lease of the buffer */
+    py::object MakeFrame(size_t slot) {
+        auto lease = new frameLease{pool, slot};
+        py::capsule base(lease, [](void *p) {
+            auto l = static_cast<frameLease *>(p);
+            l->pool->release(l->slot);
+            delete l;
+        });
+
+        const frameMetadata &meta = pool->metadata[slot];
+        char *ptr = pool->buffers[slot].data();
+        py::array image;
+        ssize_t npixels = static_cast<ssize_t>(meta.nx) * meta.ny;
+        switch (meta.dynamicRange) {
+        case 8:
+            image = MakeImage<uint8_t>(ptr, meta, npixels, base);
+            break;
+        case 16:
+            image = MakeImage<uint16_t>(ptr, meta, npixels, base);
+            break;
+        case 32:
+            image = MakeImage<uint32_t>(ptr, meta, npixels, base);
+            break;
+        default:
+            // packed pixels (eiger 4 bit): raw bytes
+            image = py::array_t<uint8_t>({static_cast<ssize_t>(meta.databytes)},
+                                         {static_cast<ssize_t>(1)},
+                                         reinterpret_cast<uint8_t *>(ptr),
+                                         base);
+            break;
+        }
+        py::array_t<frameMetadata> metadata(
+            std::vector<ssize_t>{}, std::vector<ssize_t>{}, &meta, base);
+        return py::make_tuple(image, metadata);
+    }
+
+    template <typename T>
+    static py::array MakeImage(char *ptr, const frameMetadata &meta,
+                               ssize_t npixels, py::handle base) {
+        T *data = reinterpret_cast<T *>(ptr);
+        if (npixels * static_cast<ssize_t>(sizeof(T)) != meta.databytes) {
+            // e.g. incomplete shape information, flat view of the data
+            ssize_t n = meta.databytes / static_cast<ssize_t>(sizeof(T));
+            return py::array_t<T>({n}, {static_cast<ssize_t>(sizeof(T))},
+                                  data, base);
+        }
+        if (meta.ny <= 1) {
+            return py::array_t<T>({static_cast<ssize_t>(meta.nx)},
+                                  {static_cast<ssize_t>(sizeof(T))}, data,
+                                  base);
+        }
+        return py::array_t<T>(
+            {static_cast<ssize_t>(meta.ny), static_cast<ssize_t>(meta.nx)},
+            {static_cast<ssize_t>(meta.nx * sizeof(T)),
+             static_cast<ssize_t>(sizeof(T))},
+            data, base);
+    }
+
+    sls::Detector &det;
+    bool block;
+    std::shared_ptr<FramePool> pool;
+    std::thread acquireThread;
+    // protected by pool->mtx
+    bool running{false};
+    bool finished{false};
+    bool closing{false};
+    std::string error;
+    uint64_t nReceived{0};
+    uint64_t nDropped{0};
+};
+
+} // namespace
+
+void init_frames(py::module &m) {
+    PYBIND11_NUMPY_DTYPE(frameMetadata, frameIndex, subFrameIndex, fileIndex,
+                         progress, nx, ny, dynamicRange, databytes,
+                         completeImage, fileName);
+
+    py::class_<FrameReceiver>(m, "FrameReceiver", R"pbdoc(
+        Receives the complete images of the detector (data call back) as
+        numpy arrays.
+
+        The images are copied once into a fixed pool of buffers and handed to
+        Python without a further copy. A buffer is reused when the arrays
+        pointing to it are garbage collected, copy the image to keep it
+        longer than the processing of the frame. The metadata of the frame
+        is a numpy structured array.
+
+        Use start() to run the acquisition in a background thread and iterate
+        over the frames until the end of the acquisition. With blocking the
+        data call back waits for a free buffer, otherwise the frames arriving
+        while all buffers are in use are dropped and counted. Frames of an
+        acquisition not started with start() are never waited for.
+    )pbdoc")
+        .def(py::init<sls::Detector &, size_t, bool>(), py::arg("detector"),
+             py::arg("nbuffers") = 16, py::arg("blocking") = true,
+             py::keep_alive<1, 2>())
+        .def("start", &FrameReceiver::start,
+             "Start the acquisition in a background thread")
+        .def("join", &FrameReceiver::join,
+             "Wait for the end of the acquisition, raises if it failed")
+        .def("pop", &FrameReceiver::pop, py::arg("timeout") = -1.0,
+             "Next (image, metadata) or None at the end of the acquisition "
+             "or after timeout seconds (negative: no timeout)")
+        .def("__iter__", [](FrameReceiver &r) -> FrameReceiver & { return r; })
+        .def("__next__", &FrameReceiver::next)
+        .def_property_readonly("finished", &FrameReceiver::isFinished)
+        .def_property_readonly("nbuffers", &FrameReceiver::getNumberOfBuffers)
+        .def_property_readonly("pending",
+                               &FrameReceiver::getNumberOfPendingFrames)
+        .def_property_readonly("received",
+                               &FrameReceiver::getNumberOfReceivedFrames)
+        .def_property_readonly("dropped",
+                               &FrameReceiver::getNumberOfDroppedFrames);
+}
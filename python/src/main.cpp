@@ -19,10 +19,12 @@ namespace py = pybind11;
 void init_enums(py::module &);
 void init_experimental(py::module &);
 void init_det(py::module &);
+void init_frames(py::module &);
 void init_network(py::module &);
 void init_pattern(py::module &);
 void init_scan(py::module &);
 void init_source(py::module &);
+void init_raw_file(py::module &);
 PYBIND11_MODULE(_slsdet, m) {
     m.doc() = R"pbdoc(
         C/C++ API
@@ -36,6 +38,7 @@ PYBIND11_MODULE(_slsdet, m) {
 
     init_enums(m);
     init_det(m);
+    init_frames(m);
     init_network(m);
     init_pattern(m);
     init_scan(m);
@@ -44,6 +47,13 @@ PYBIND11_MODULE(_slsdet, m) {
 
     py::module io = m.def_submodule("io", "Submodule for io");
     io.def("read_my302_file", &read_my302_file, "some");
+    io.def("decode_my302_file", &decode_my302_file,
+           "Decodes the given bits of all frames in a Mythen3 CTB file, "
+           "returns an array [frame, bit, counter]",
+           py::arg("fname"), py::arg("bits"), py::arg("offset") = 8,
+           py::arg("dr") = 24, py::arg("ncounters") = 32 * 3,
+           py::arg("header") = 0, py::arg("nthreads") = 0);
+    init_raw_file(io);
 
 #ifdef VERSION_INFO
     m.attr("__version__") = VERSION_INFO;
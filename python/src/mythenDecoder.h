@@ -0,0 +1,206 @@
+// SPDX-License-Identifier: LGPL-3.0-or-other
+// Copyright (C) 2021 Contributors to the SLS Detector Package
+#pragma once
+/*
+Decoding of Mythen3 raw files recorded with the CTB, without pybind11 so that
+it can be used (and tested) on its own.
+
+Every counter is sent as dr consecutive 64 bit samples, bit i of the counter
+value being the selected bit of sample i. A file is byte_offset bytes
+followed by frames of header bytes and ncounters * dr samples. The file is
+memory mapped and the frames are split over threads, each thread writing its
+frames straight into the output [frame][bit][counter].
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/** Read only memory mapping of a whole file, unmapped on destruction */
+class MappedFile {
+    const char *data_{nullptr};
+    size_t size_{0};
+
+  public:
+    explicit MappedFile(const std::string &fname) {
+        int fd = open(fname.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("File not found: " + fname);
+        }
+        struct stat st {};
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            throw std::runtime_error("Could not stat file: " + fname);
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_ != 0) {
+            void *p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                close(fd);
+                throw std::runtime_error("Could not map file: " + fname);
+            }
+            madvise(p, size_, MADV_SEQUENTIAL);
+            data_ = static_cast<const char *>(p);
+        }
+        // the mapping stays valid after closing
+        close(fd);
+    }
+    ~MappedFile() {
+        if (data_ != nullptr) {
+            munmap(const_cast<char *>(data_), size_);
+        }
+    }
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const char *data() const { return data_; }
+    size_t size() const { return size_; }
+};
+
+/**
+ * In place transpose of a 64x64 bit matrix, afterwards bit i of a[j] is what
+ * was bit j of a[i]. Six rounds of swapping blocks of half the size.
+ */
+inline void TransposeBits(uint64_t *a) {
+    uint64_t m = 0x00000000FFFFFFFFULL;
+    for (int j = 32; j != 0; j >>= 1, m ^= m << j) {
+        for (int k = 0; k < 64; k = ((k | j) + 1) & ~j) {
+            uint64_t t = ((a[k] >> j) ^ a[k | j]) & m;
+            a[k | j] ^= t;
+            a[k] ^= t << j;
+        }
+    }
+}
+
+/** Layout of the raw file, all sizes in bytes except for dr and ncounters */
+struct Mythen3CtbLayout {
+    size_t byte_offset{8};
+    size_t header{0};
+    int dr{24};
+    int ncounters{32 * 3};
+
+    size_t frameSize() const {
+        return header + sizeof(uint64_t) * dr * static_cast<size_t>(ncounters);
+    }
+};
+
+/**
+ * Decodes one frame of samples into out[bit][counter]. Few bits are shifted
+ * out of the samples one by one, for many bits a transpose of the dr samples
+ * gives all 64 bits of the counter at once.
+ */
+inline void DecodeFrame(const char *samples, const Mythen3CtbLayout &layout,
+                        const std::vector<int> &bits, uint32_t *out) {
+    const int dr = layout.dr;
+    const int ncounters = layout.ncounters;
+    const int nbits = static_cast<int>(bits.size());
+    // a transpose is 6 * 32 operations, shifting dr per bit
+    const bool transpose = nbits * dr > 6 * 32;
+    const uint64_t valueMask =
+        dr == 64 ? ~uint64_t(0) : (uint64_t(1) << dr) - 1;
+
+    uint64_t block[64];
+    for (int c = 0; c != ncounters; ++c) {
+        // samples are not aligned for odd headers
+        std::memcpy(block, samples + sizeof(uint64_t) * dr * c,
+                    sizeof(uint64_t) * dr);
+        if (transpose) {
+            std::fill(block + dr, block + 64, 0);
+            TransposeBits(block);
+            for (int b = 0; b != nbits; ++b) {
+                out[b * ncounters + c] =
+                    static_cast<uint32_t>(block[bits[b]] & valueMask);
+            }
+        } else {
+            for (int b = 0; b != nbits; ++b) {
+                const int bit = bits[b];
+                uint64_t value = 0;
+                for (int i = 0; i != dr; ++i) {
+                    value |= ((block[i] >> bit) & 1) << i;
+                }
+                out[b * ncounters + c] = static_cast<uint32_t>(value);
+            }
+        }
+    }
+}
+
+/**
+ * Number of complete frames in a file of size bytes, throws if the layout
+ * or the bits cannot be decoded
+ */
+inline size_t NumFrames(size_t size, const Mythen3CtbLayout &layout,
+                        const std::vector<int> &bits) {
+    if (layout.dr < 1 || layout.dr > 32) {
+        throw std::runtime_error("Dynamic range must be between 1 and 32");
+    }
+    if (layout.ncounters < 1) {
+        throw std::runtime_error("Number of counters must be positive");
+    }
+    if (bits.empty()) {
+        throw std::runtime_error("No bits to decode");
+    }
+    for (auto bit : bits) {
+        if (bit < 0 || bit > 63) {
+            throw std::runtime_error("Bit index " + std::to_string(bit) +
+                                     " is out of range [0, 63]");
+        }
+    }
+    if (size < layout.byte_offset) {
+        return 0;
+    }
+    return (size - layout.byte_offset) / layout.frameSize();
+}
+
+/**
+ * Decodes nframes frames of data (starting at the file offset) into
+ * out[frame][bit][counter], using nthreads threads (0 for one per core)
+ */
+inline void DecodeFrames(const char *data, size_t nframes,
+                         const Mythen3CtbLayout &layout,
+                         const std::vector<int> &bits, uint32_t *out,
+                         int nthreads = 0) {
+    if (nframes == 0) {
+        return;
+    }
+    if (nthreads <= 0) {
+        nthreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    nthreads = static_cast<int>(
+        std::min(nframes, static_cast<size_t>(nthreads)));
+    const size_t frameSize = layout.frameSize();
+    const size_t outSize = bits.size() * layout.ncounters;
+    const char *first = data + layout.byte_offset;
+
+    auto decodeRange = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i != end; ++i) {
+            DecodeFrame(first + i * frameSize + layout.header, layout, bits,
+                        out + i * outSize);
+        }
+    };
+    // contiguous ranges, so each thread reads the file sequentially
+    std::vector<std::thread> threads;
+    const size_t step = nframes / nthreads;
+    const size_t rest = nframes % nthreads;
+    size_t begin = 0;
+    for (int t = 0; t != nthreads; ++t) {
+        size_t end = begin + step + (static_cast<size_t>(t) < rest ? 1 : 0);
+        if (t == nthreads - 1) {
+            decodeRange(begin, end);
+        } else {
+            threads.emplace_back(decodeRange, begin, end);
+        }
+        begin = end;
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+}
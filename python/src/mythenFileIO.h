@@ -9,6 +9,8 @@
 #include <iostream>
 #include <vector>
 
+#include "mythenDecoder.h"
+
 #include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
@@ -85,3 +87,40 @@ py::array_t<uint64_t> read_my302_file(const std::string &fname, int offset = 8,
     auto data = ExtractBits<17, 6>(ReadFile(fname, offset, dr));
     return py::array(data.size(), data.data());
 }
+
+/**
+ * Decodes all frames of a Mythen3 CTB file for any set of bits, returns a
+ * numpy array [frame][bit][counter]
+ */
+py::array_t<uint32_t> decode_my302_file(const std::string &fname,
+                                        const std::vector<int> &bits,
+                                        int offset = 8, int dr = 24,
+                                        int ncounters = 32 * 3, int header = 0,
+                                        int nthreads = 0) {
+    if (offset < 0 || header < 0) {
+        throw std::runtime_error("Offset and header size cannot be negative");
+    }
+    Mythen3CtbLayout layout;
+    layout.byte_offset = offset;
+    layout.header = header;
+    layout.dr = dr;
+    layout.ncounters = ncounters;
+
+    MappedFile file(fname);
+    auto nframes = NumFrames(file.size(), layout, bits);
+    auto rest = file.size() - std::min(file.size(), layout.byte_offset) -
+                nframes * layout.frameSize();
+    if (rest != 0) {
+        std::cout << "WARNING: " << rest
+                  << " bytes at the end of the file are not a complete frame"
+                  << '\n';
+    }
+    py::array_t<uint32_t> result(std::vector<size_t>{
+        nframes, bits.size(), static_cast<size_t>(ncounters)});
+    auto out = result.mutable_data();
+    {
+        py::gil_scoped_release release;
+        DecodeFrames(file.data(), nframes, layout, bits, out, nthreads);
+    }
+    return result;
+}
@@ -0,0 +1,104 @@
+// SPDX-License-Identifier: LGPL-3.0-or-other
+// Copyright (C) 2021 Contributors to the SLS Detector Package
+/*
+This file contains the Python bindings for the RawFileReader, random access
+to the binary files of the receiver through their frame index.
+*/
+
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include "sls/RawFileIndex.h"
+#include "sls/sls_detector_defs.h"
+
+#include <string>
+#include <vector>
+
+namespace py = pybind11;
+
+void init_raw_file(py::module &m) {
+    using sls::FrameIndexEntry;
+    using sls::RawFileReader;
+    PYBIND11_NUMPY_DTYPE(FrameIndexEntry, frameNumber, offset, timestamp,
+                         packets, size);
+
+    py::class_<RawFileReader>(
+        m, "RawFileReader",
+        "Random access to the frames of the raw files (_f0, _f1...) of one "
+        "port, through the frame index written by slsReceiver --frame_index. "
+        "Frames are records of the receiver header and the data.")
+        .def(py::init<const std::vector<std::string> &>(), py::arg("files"))
+        .def("__len__", &RawFileReader::NumFrames)
+        .def_property_readonly("packets_per_frame",
+                               &RawFileReader::PacketsPerFrame)
+        .def_property_readonly("max_frame_size",
+                               &RawFileReader::MaxFrameSize)
+        .def_property_readonly(
+            "header_size",
+            [](const RawFileReader &) {
+                return sizeof(slsDetectorDefs::sls_receiver_header);
+            })
+        .def("index",
+             [](const RawFileReader &r) {
+                 py::array_t<FrameIndexEntry> result(r.NumFrames());
+                 auto out = result.mutable_data();
+                 for (size_t i = 0; i < r.NumFrames(); ++i) {
+                     out[i] = r.Entry(i);
+                 }
+                 return result;
+             },
+             "Index entries of all frames as a structured array")
+        .def("find", &RawFileReader::Find, py::arg("frame_number"),
+             "Position of the frame, -1 if it is not in the files")
+        .def("complete_frames",
+             [](const RawFileReader &r) {
+                 auto positions = r.CompleteFrames();
+                 return py::array_t<size_t>(positions.size(),
+                                            positions.data());
+             },
+             "Positions of the frames with all their packets")
+        .def("read",
+             [](const RawFileReader &r, size_t i) {
+                 py::array_t<uint8_t> result(r.Entry(i).size);
+                 auto out = reinterpret_cast<char *>(result.mutable_data());
+                 {
+                     py::gil_scoped_release release;
+                     r.Read(i, out);
+                 }
+                 return result;
+             },
+             py::arg("position"), "Record of the frame at the position")
+        .def("read_range",
+             [](const RawFileReader &r, size_t first, size_t count,
+                int nthreads) {
+                 const size_t stride = r.MaxFrameSize();
+                 py::array_t<uint8_t> result(
+                     std::vector<size_t>{count, stride});
+                 auto out = reinterpret_cast<char *>(result.mutable_data());
+                 {
+                     py::gil_scoped_release release;
+                     r.ReadRange(first, count, out, stride, nthreads);
+                 }
+                 return result;
+             },
+             py::arg("first"), py::arg("count"), py::arg("nthreads") = 0,
+             "Records of count frames from first as [frame, byte], read in "
+             "parallel")
+        .def("read_frames",
+             [](const RawFileReader &r, const std::vector<size_t> &positions,
+                int nthreads) {
+                 const size_t stride = r.MaxFrameSize();
+                 py::array_t<uint8_t> result(
+                     std::vector<size_t>{positions.size(), stride});
+                 auto out = reinterpret_cast<char *>(result.mutable_data());
+                 {
+                     py::gil_scoped_release release;
+                     r.ReadFrames(positions, out, stride, nthreads);
+                 }
+                 return result;
+             },
+             py::arg("positions"), py::arg("nthreads") = 0,
+             "Records of the frames at the positions as [frame, byte], read "
+             "in parallel");
+}
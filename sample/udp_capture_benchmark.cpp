@@ -0,0 +1,143 @@
+// SPDX-License-Identifier: LGPL-3.0-or-other
+// Copyright (C) 2021 Contributors to the SLS Detector Package
+/*
+Compares the receiving cost of the UDP socket and of the packet ring
+(AF_PACKET TPACKET_V3) backends. A thread sends numbered packets to the port,
+the main thread receives them with either backend and reports the rate, the
+loss, the system calls and the cpu time of the receiving thread per packet.
+The packet ring needs CAP_NET_RAW.
+
+usage: udp_capture_benchmark [interface] [packet size] [packets] [port]
+       defaults: lo 8240 1000000 50001
+*/
+#include "sls/PacketRingRxSocket.h"
+#include "sls/UdpRxSocket.h"
+#include "sls/network_utils.h"
+#include "sls/sls_detector_exceptions.h"
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <netinet/in.h>
+#include <string>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+struct Result {
+    uint64_t received{0};
+    double seconds{0};
+    double cpuSeconds{0};
+    uint64_t syscalls{0};
+};
+
+double ThreadCpuTime() {
+    rusage usage{};
+    getrusage(RUSAGE_THREAD, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+}
+
+void Send(const std::string &ip, int port, ssize_t packetSize,
+          uint64_t numPackets, std::atomic<bool> &done) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_pton(AF_INET, ip.c_str(), &addr.sin_addr);
+    int size = 64 * 1024 * 1024;
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+    std::vector<char> packet(packetSize, 0);
+    // not connected, the port unreachable replies of the packet ring run are
+    // not reported to the sender
+    for (uint64_t i = 0; i != numPackets; ++i) {
+        memcpy(packet.data(), &i, sizeof(i));
+        sendto(fd, packet.data(), packet.size(), 0,
+               reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+    }
+    close(fd);
+    done = true;
+}
+
+template <typename Socket>
+Result Receive(Socket &s, const std::string &ip, int port, ssize_t packetSize,
+               uint64_t numPackets) {
+    Result r;
+    std::vector<char> buffer(packetSize);
+    std::atomic<bool> done{false};
+    auto start = std::chrono::steady_clock::now();
+    double cpuStart = ThreadCpuTime();
+    std::thread sender(Send, ip, port, packetSize, numPackets,
+                       std::ref(done));
+
+    // stops some time after the sender, the rest is lost
+    std::thread stopper([&]() {
+        while (!done) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        s.Shutdown();
+    });
+    while (r.received != numPackets &&
+           s.ReceiveDataOnly(buffer.data()) == packetSize) {
+        ++r.received;
+    }
+    r.cpuSeconds = ThreadCpuTime() - cpuStart;
+    r.seconds = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+    r.syscalls = s.getNumberOfSyscalls();
+    done = true;
+    sender.join();
+    s.Shutdown();
+    stopper.join();
+    return r;
+}
+
+void Print(const char *name, const Result &r, uint64_t numPackets) {
+    printf("%-12s received %10llu lost %10llu  %8.3f Mpkt/s  "
+           "%8.1f ns cpu/pkt  %6.3f syscalls/pkt\n",
+           name, static_cast<unsigned long long>(r.received),
+           static_cast<unsigned long long>(numPackets - r.received),
+           r.received / r.seconds * 1e-6,
+           r.received ? r.cpuSeconds / r.received * 1e9 : 0.,
+           r.received ? static_cast<double>(r.syscalls) / r.received : 0.);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    std::string interface = argc > 1 ? argv[1] : "lo";
+    ssize_t packetSize = argc > 2 ? atoi(argv[2]) : 8240;
+    uint64_t numPackets = argc > 3 ? strtoull(argv[3], nullptr, 10) : 1000000;
+    int port = argc > 4 ? atoi(argv[4]) : 50001;
+    constexpr int bufferSize = 256 * 1024 * 1024;
+
+    try {
+        std::string ip = sls::InterfaceNameToIp(interface).str();
+        printf("%s (%s) port %d, %llu packets of %zd bytes\n",
+               interface.c_str(), ip.c_str(), port,
+               static_cast<unsigned long long>(numPackets), packetSize);
+        {
+            sls::UdpRxSocket s(port, packetSize, ip.c_str(), bufferSize);
+            Print("udp socket",
+                  Receive(s, ip, port, packetSize, numPackets), numPackets);
+        }
+        {
+            sls::PacketRingRxSocket s(port, packetSize, interface, bufferSize);
+            Print("packet ring",
+                  Receive(s, ip, port, packetSize, numPackets), numPackets);
+        }
+    } catch (const sls::RuntimeError &e) {
+        fprintf(stderr, "%s\n", e.what());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
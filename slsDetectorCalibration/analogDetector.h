@@ -5,6 +5,7 @@
 
 //#include <mutex>
 
+#include "clusterFile.h"
 #include "commonModeSubtractionNew.h"
 #include "ghostSummation.h"
 #include "pedestalSubtraction.h"
@@ -799,6 +800,18 @@ template <class dataType> class analogDetector {
        \returns pointer to image data
     */
     virtual int *getImage() { return image; };
+
+    /**
+      replaces the image array, e.g. to take out the counts accumulated so far
+      while the processing goes on with an other array
+       \param img image array of nx*ny pixels, owned by the caller
+       \returns previous image array
+    */
+    virtual int *swapImage(int *img) {
+        int *old = image;
+        image = img;
+        return old;
+    };
     /**
     write 32bit tiff file containing the pedestals RMS
      \param imgname file name to be written
@@ -1346,6 +1359,9 @@ template <class dataType> class analogDetector {
     }
 
     virtual double setNSigma(double n) { return 0; };
+    /** sets the columnar cluster file to write the clusters to, used instead
+        of the file pointer if not NULL */
+    virtual clusterFile *setClusterFile(clusterFile *cf) { return NULL; };
     virtual void setEnergyRange(double emi, double ema) { ; };
 
   protected:
@@ -0,0 +1,447 @@
+// SPDX-License-Identifier: LGPL-3.0-or-other
+// Copyright (C) 2021 Contributors to the SLS Detector Package
+#ifndef CLUSTERFILE_H
+#define CLUSTERFILE_H
+
+#include "single_photon_hit.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <vector>
+
+/**
+   Columnar cluster file.
+
+   The clusters of many frames are buffered and written as one block, column
+   after column:
+     block header {magic, number of frames, number of clusters}
+     frame numbers, clusters per frame                  (int32)
+     x, y of the clusters                               (int16)
+     cluster data, dx*dy per cluster                    (int16 or int32)
+   The file starts with {magic, version, dx, dy, bytes per data value} and
+   ends with an index of the blocks (offset, first and last frame, number of
+   frames and clusters) followed by {index offset, number of blocks, magic},
+   so that a frame can be found without reading the whole file.
+
+   Frames can be added concurrently by several threads: they are stored in the
+   order they arrive, the index keeps the frame range of every block.
+*/
+class clusterFile {
+
+  public:
+    /** block as listed in the index at the end of the file */
+    struct blockIndex {
+        int64_t offset;
+        int32_t firstFrame;
+        int32_t lastFrame;
+        int32_t nFrames;
+        int32_t nClusters;
+    };
+
+    /**
+       Constructor
+       \param bs clusters buffered before a block is written
+    */
+    clusterFile(int bs = 65536)
+        : blockSize(bs), f(NULL), writing(0), dx(3), dy(3),
+          dataSize(sizeof(int32_t)), iblock(-1), icl(0), ifr(0) {
+        pthread_mutex_init(&fm, NULL);
+    };
+
+    virtual ~clusterFile() {
+        close();
+        pthread_mutex_destroy(&fm);
+    };
+
+    /**
+       checks if the file is a columnar cluster file
+       \param fname file name
+       \returns 1 if it is, 0 if not (e.g. old cluster file)
+    */
+    static int isClusterFile(const char *fname) {
+        FILE *ff = fopen(fname, "r");
+        if (ff == NULL)
+            return 0;
+        uint32_t magic = 0;
+        int ret = fread(&magic, sizeof(magic), 1, ff) == 1 &&
+                  magic == FILE_MAGIC;
+        fclose(ff);
+        return ret;
+    };
+
+    /**
+       opens the file for writing
+       \param fname file name
+       \param nx cluster size in x
+       \param ny cluster size in y
+       \param ds bytes per data value, 2 (saturated to int16) or 4
+       \returns 1 if the file could be opened, else 0
+    */
+    int openWrite(const char *fname, int nx = 3, int ny = 3,
+                  int ds = sizeof(int32_t)) {
+        close();
+        if (ds != sizeof(int16_t) && ds != sizeof(int32_t)) {
+            std::cout << "Cluster data can only be 2 or 4 bytes" << std::endl;
+            return 0;
+        }
+        f = fopen(fname, "w");
+        if (f == NULL) {
+            std::cout << "Could not open " << fname << " for writing"
+                      << std::endl;
+            return 0;
+        }
+        dx = nx;
+        dy = ny;
+        dataSize = ds;
+        int32_t hdr[5] = {(int32_t)FILE_MAGIC, VERSION, dx, dy, dataSize};
+        if (fwrite(hdr, sizeof(int32_t), 5, f) != 5) {
+            std::cout << "Could not write to " << fname << std::endl;
+            fclose(f);
+            f = NULL;
+            return 0;
+        }
+        writing = 1;
+        index.clear();
+        return 1;
+    };
+
+    /**
+       opens the file for reading, reads the header and the index
+       \param fname file name
+       \returns 1 if the file could be opened, else 0
+    */
+    int openRead(const char *fname) {
+        close();
+        f = fopen(fname, "r");
+        if (f == NULL) {
+            std::cout << "Could not open " << fname << " for reading"
+                      << std::endl;
+            return 0;
+        }
+        int32_t hdr[5];
+        int64_t indexOffset = 0;
+        int32_t trailer[2];
+        int ok = fread(hdr, sizeof(int32_t), 5, f) == 5 &&
+                 hdr[0] == (int32_t)FILE_MAGIC && hdr[1] == VERSION;
+        ok = ok && fseeko(f, -(off_t)(sizeof(indexOffset) + sizeof(trailer)),
+                          SEEK_END) == 0;
+        ok = ok && fread(&indexOffset, sizeof(indexOffset), 1, f) == 1 &&
+             fread(trailer, sizeof(int32_t), 2, f) == 2 &&
+             trailer[1] == (int32_t)INDEX_MAGIC;
+        if (ok) {
+            index.resize(trailer[0]);
+            ok = fseeko(f, indexOffset, SEEK_SET) == 0 &&
+                 fread(index.data(), sizeof(blockIndex), index.size(), f) ==
+                     index.size();
+        }
+        if (!ok) {
+            std::cout << fname << " is not a (complete) cluster file"
+                      << std::endl;
+            fclose(f);
+            f = NULL;
+            index.clear();
+            return 0;
+        }
+        dx = hdr[2];
+        dy = hdr[3];
+        dataSize = hdr[4];
+        iblock = -1;
+        icl = 0;
+        ifr = 0;
+        return 1;
+    };
+
+    /**
+       flushes the last block and writes the index (writing), closes the file
+    */
+    void close() {
+        if (f == NULL)
+            return;
+        if (writing) {
+            pthread_mutex_lock(&fm);
+            flushBlock();
+            int64_t indexOffset = ftello(f);
+            int32_t trailer[2] = {(int32_t)index.size(),
+                                  (int32_t)INDEX_MAGIC};
+            if (fwrite(index.data(), sizeof(blockIndex), index.size(), f) !=
+                    index.size() ||
+                fwrite(&indexOffset, sizeof(indexOffset), 1, f) != 1 ||
+                fwrite(trailer, sizeof(int32_t), 2, f) != 2)
+                std::cout << "Could not write cluster file index" << std::endl;
+            writing = 0;
+            pthread_mutex_unlock(&fm);
+        }
+        fclose(f);
+        f = NULL;
+        clearColumns();
+    };
+
+    /**
+       adds the clusters of a frame, thread safe
+       \param fn frame number
+       \param cl array of clusters
+       \param nph number of clusters
+    */
+    void writeFrame(int fn, single_photon_hit *cl, int nph) {
+        if (!writing)
+            return;
+        pthread_mutex_lock(&fm);
+        frames.push_back(fn);
+        nphs.push_back(nph);
+        const int n = dx * dy;
+        for (int i = 0; i < nph; i++) {
+            xs.push_back(cl[i].x);
+            ys.push_back(cl[i].y);
+            const int *d = cl[i].data;
+            if (dataSize == sizeof(int16_t)) {
+                for (int j = 0; j < n; j++)
+                    data16.push_back(
+                        (int16_t)std::max(-32768, std::min(32767, d[j])));
+            } else {
+                data32.insert(data32.end(), d, d + n);
+            }
+        }
+        if ((int)xs.size() >= blockSize)
+            flushBlock();
+        pthread_mutex_unlock(&fm);
+    };
+
+    /**
+       reads the next clusters in file order
+       \param cl array of clusters to fill (iframe, x, y and data)
+       \param n size of the array
+       \returns number of clusters read, 0 at the end of the file
+    */
+    int readClusters(single_photon_hit *cl, int n) {
+        int nr = 0;
+        while (nr < n) {
+            if (iblock < 0 || icl >= (int)xs.size()) {
+                if (iblock + 1 >= (int)index.size() || !loadBlock(iblock + 1))
+                    break;
+                continue;
+            }
+            while (icl >= frameStart[ifr + 1])
+                ifr++;
+            fillCluster(cl[nr++], icl++, frames[ifr]);
+        }
+        return nr;
+    };
+
+    /**
+       reads the clusters of one frame. Reading in file order continues from
+       the block of that frame
+       \param fn frame number
+       \param cl array of clusters to fill
+       \param n size of the array
+       \returns number of clusters of the frame (at most n), -1 if the frame
+       is not in the file
+    */
+    int readFrame(int fn, single_photon_hit *cl, int n) {
+        for (int ib = 0; ib < (int)index.size(); ib++) {
+            if (fn < index[ib].firstFrame || fn > index[ib].lastFrame)
+                continue;
+            if (ib != iblock && !loadBlock(ib))
+                return -1;
+            for (size_t i = 0; i < frames.size(); i++) {
+                if (frames[i] != fn)
+                    continue;
+                int nr = std::min(n, nphs[i]);
+                for (int j = 0; j < nr; j++)
+                    fillCluster(cl[j], frameStart[i] + j, fn);
+                return nr;
+            }
+        }
+        return -1;
+    };
+
+    /**
+       converts an old cluster file (frame number and number of clusters,
+       then x, y and data of every cluster)
+       \param oldname old cluster file
+       \param newname columnar cluster file to be written
+       \param nx cluster size in x
+       \param ny cluster size in y
+       \param ds bytes per data value of the new file
+       \returns number of clusters converted, -1 if a file could not be opened
+    */
+    static long long convert(const char *oldname, const char *newname,
+                             int nx = 3, int ny = 3,
+                             int ds = sizeof(int32_t)) {
+        FILE *in = fopen(oldname, "r");
+        if (in == NULL) {
+            std::cout << "Could not open " << oldname << " for reading"
+                      << std::endl;
+            return -1;
+        }
+        clusterFile out;
+        if (!out.openWrite(newname, nx, ny, ds)) {
+            fclose(in);
+            return -1;
+        }
+        long long ntot = 0;
+        int nmax = 0;
+        single_photon_hit *cl = NULL;
+        int32_t fh[2];
+        while (fread(fh, sizeof(int32_t), 2, in) == 2) {
+            if (fh[1] > nmax) {
+                delete[] cl;
+                nmax = fh[1];
+                cl = new single_photon_hit[nmax];
+                for (int i = 0; i < nmax; i++)
+                    cl[i].set_cluster_size(nx, ny);
+            }
+            int nph = 0;
+            while (nph < fh[1] && cl[nph].read(in))
+                nph++;
+            out.writeFrame(fh[0], cl, nph);
+            ntot += nph;
+            if (nph < fh[1]) {
+                std::cout << oldname << " is truncated" << std::endl;
+                break;
+            }
+        }
+        delete[] cl;
+        fclose(in);
+        out.close();
+        return ntot;
+    };
+
+    int isOpen() const { return f != NULL; };
+    int getClusterSizeX() const { return dx; };
+    int getClusterSizeY() const { return dy; };
+    const std::vector<blockIndex> &getIndex() const { return index; };
+
+  private:
+    static const uint32_t FILE_MAGIC = 0x534c4343;  // "CCLS"
+    static const uint32_t BLOCK_MAGIC = 0x4b4c4243; // "CBLK"
+    static const uint32_t INDEX_MAGIC = 0x58444943; // "CIDX"
+    static const int32_t VERSION = 1;
+
+    /** writes the buffered frames as one block, mutex locked */
+    void flushBlock() {
+        if (frames.empty())
+            return;
+        blockIndex b;
+        b.offset = ftello(f);
+        b.firstFrame = *std::min_element(frames.begin(), frames.end());
+        b.lastFrame = *std::max_element(frames.begin(), frames.end());
+        b.nFrames = frames.size();
+        b.nClusters = xs.size();
+        int32_t hdr[3] = {(int32_t)BLOCK_MAGIC, b.nFrames, b.nClusters};
+        size_t ndata = (size_t)b.nClusters * dx * dy;
+        if (fwrite(hdr, sizeof(int32_t), 3, f) != 3 ||
+            fwrite(frames.data(), sizeof(int32_t), b.nFrames, f) !=
+                (size_t)b.nFrames ||
+            fwrite(nphs.data(), sizeof(int32_t), b.nFrames, f) !=
+                (size_t)b.nFrames ||
+            fwrite(xs.data(), sizeof(int16_t), b.nClusters, f) !=
+                (size_t)b.nClusters ||
+            fwrite(ys.data(), sizeof(int16_t), b.nClusters, f) !=
+                (size_t)b.nClusters ||
+            (dataSize == sizeof(int16_t)
+                 ? fwrite(data16.data(), sizeof(int16_t), ndata, f)
+                 : fwrite(data32.data(), sizeof(int32_t), ndata, f)) != ndata)
+            std::cout << "Could not write cluster block" << std::endl;
+        index.push_back(b);
+        clearColumns();
+    };
+
+    /** reads a block into the columns */
+    int loadBlock(int ib) {
+        const blockIndex &b = index[ib];
+        int32_t hdr[3];
+        if (fseeko(f, b.offset, SEEK_SET) != 0 ||
+            fread(hdr, sizeof(int32_t), 3, f) != 3 ||
+            hdr[0] != (int32_t)BLOCK_MAGIC || hdr[1] != b.nFrames ||
+            hdr[2] != b.nClusters) {
+            std::cout << "Bad cluster block " << ib << std::endl;
+            return 0;
+        }
+        size_t ndata = (size_t)b.nClusters * dx * dy;
+        frames.resize(b.nFrames);
+        nphs.resize(b.nFrames);
+        xs.resize(b.nClusters);
+        ys.resize(b.nClusters);
+        data16.resize(dataSize == sizeof(int16_t) ? ndata : 0);
+        data32.resize(dataSize == sizeof(int16_t) ? 0 : ndata);
+        if (fread(frames.data(), sizeof(int32_t), b.nFrames, f) !=
+                (size_t)b.nFrames ||
+            fread(nphs.data(), sizeof(int32_t), b.nFrames, f) !=
+                (size_t)b.nFrames ||
+            fread(xs.data(), sizeof(int16_t), b.nClusters, f) !=
+                (size_t)b.nClusters ||
+            fread(ys.data(), sizeof(int16_t), b.nClusters, f) !=
+                (size_t)b.nClusters ||
+            (dataSize == sizeof(int16_t)
+                 ? fread(data16.data(), sizeof(int16_t), ndata, f)
+                 : fread(data32.data(), sizeof(int32_t), ndata, f)) != ndata) {
+            std::cout << "Could not read cluster block " << ib << std::endl;
+            return 0;
+        }
+        frameStart.resize(b.nFrames + 1);
+        frameStart[0] = 0;
+        for (int i = 0; i < b.nFrames; i++)
+            frameStart[i + 1] = frameStart[i] + nphs[i];
+        iblock = ib;
+        icl = 0;
+        ifr = 0;
+        return 1;
+    };
+
+    void fillCluster(single_photon_hit &h, int i, int fn) {
+        int nx, ny;
+        h.get_cluster_size(nx, ny);
+        if (nx != dx || ny != dy)
+            h.set_cluster_size(dx, dy);
+        h.iframe = fn;
+        h.x = xs[i];
+        h.y = ys[i];
+        const int n = dx * dy;
+        if (dataSize == sizeof(int16_t)) {
+            const int16_t *d = data16.data() + (size_t)i * n;
+            std::copy(d, d + n, h.data);
+        } else {
+            const int32_t *d = data32.data() + (size_t)i * n;
+            std::copy(d, d + n, h.data);
+        }
+    };
+
+    void clearColumns() {
+        frames.clear();
+        nphs.clear();
+        xs.clear();
+        ys.clear();
+        data16.clear();
+        data32.clear();
+        frameStart.clear();
+        iblock = -1;
+    };
+
+    const int blockSize;
+    FILE *f;
+    int writing;
+    int dx, dy;
+    int dataSize;
+    pthread_mutex_t fm;
+
+    std::vector<blockIndex> index;
+    /** columns of the block being written or read */
+    std::vector<int32_t> frames;
+    std::vector<int32_t> nphs;
+    std::vector<int16_t> xs;
+    std::vector<int16_t> ys;
+    std::vector<int16_t> data16;
+    std::vector<int32_t> data32;
+    /** index of the first cluster of every frame of the block read */
+    std::vector<int> frameStart;
+    int iblock; /**< block read */
+    int icl;    /**< next cluster of the block */
+    int ifr;    /**< frame of the next cluster */
+};
+
+#endif
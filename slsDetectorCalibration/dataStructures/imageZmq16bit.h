@@ -27,6 +27,7 @@ class imageZmq16bit : public slsDetectorData<uint16_t> {
                 is++;
             }
         }
+        setDenseDecoding(0x3fff);
     };
 
     virtual double getValue(char *data, int ix, int iy = 0) {
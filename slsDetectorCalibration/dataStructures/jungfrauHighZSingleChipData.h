@@ -53,6 +53,8 @@ class jungfrauHighZSingleChipData : public slsDetectorData<uint16_t> {
             }
         }
 
+        // gain bits above the 14 bits of the adc
+        setDenseDecoding(0x3fff, 14);
         iframe = 0;
         //  cout << "data struct created" << endl;
     };
@@ -71,6 +73,10 @@ class jungfrauHighZSingleChipData : public slsDetectorData<uint16_t> {
         return val;
     };
 
+    virtual int getGain(char *data, int ix, int iy = 0) {
+        return getChannel(data, ix, iy) >> 14;
+    };
+
     /* virtual void calcGhost(char *data, int ix, int iy) { */
     /*   double val=0; */
     /*   ghost[iy][ix]=0; */
@@ -171,17 +177,17 @@ class jungfrauHighZSingleChipData : public slsDetectorData<uint16_t> {
     /*       return NULL; */
     /*     }; */
 
-    virtual char *readNextFrame(ifstream &filebin) {
+    virtual char *readNextFrame(std::ifstream &filebin) {
         int ff = -1, np = -1;
         return readNextFrame(filebin, ff, np);
     };
 
-    virtual char *readNextFrame(ifstream &filebin, int &ff) {
+    virtual char *readNextFrame(std::ifstream &filebin, int &ff) {
         int np = -1;
         return readNextFrame(filebin, ff, np);
     };
 
-    virtual char *readNextFrame(ifstream &filebin, int &ff, int &np) {
+    virtual char *readNextFrame(std::ifstream &filebin, int &ff, int &np) {
         char *data = new char[dataSize];
         char *d = readNextFrame(filebin, ff, np, data);
         if (d == NULL) {
@@ -191,7 +197,7 @@ class jungfrauHighZSingleChipData : public slsDetectorData<uint16_t> {
         return data;
     }
 
-    virtual char *readNextFrame(ifstream &filebin, int &ff, int &np,
+    virtual char *readNextFrame(std::ifstream &filebin, int &ff, int &np,
                                 char *data) {
         char *retval = 0;
         int nd;
@@ -0,0 +1,56 @@
+// SPDX-License-Identifier: LGPL-3.0-or-other
+// Copyright (C) 2021 Contributors to the SLS Detector Package
+#ifndef JUNGFRAUZMQDATA_H
+#define JUNGFRAUZMQDATA_H
+#include "slsDetectorData.h"
+
+class jungfrauZmqData : public slsDetectorData<uint16_t> {
+
+  private:
+    const int offset;
+
+  public:
+    /**
+       Implements the slsDetectorData structure for a Jungfrau module image
+       as streamed by the slsReceiver (1024x512 pixels, row by row, gain bits
+       above the 14 bits of the adc)
+       \param oo offset of the image in the buffer (frame index written in
+       front of the image by the zmq process)
+    */
+    jungfrauZmqData(int oo = sizeof(int))
+        : slsDetectorData<uint16_t>(1024, 512, 1024 * 512 * 2 + oo),
+          offset(oo) {
+
+        for (int iy = 0; iy < 512; iy++) {
+            for (int ix = 0; ix < 1024; ix++) {
+                dataMap[iy][ix] = offset + (1024 * iy + ix) * 2;
+            }
+        }
+        setDenseDecoding(0x3fff, 14);
+    };
+
+    virtual double getValue(char *data, int ix, int iy = 0) {
+        return getChannel(data, ix, iy) & 0x3fff;
+    };
+
+    virtual int getGain(char *data, int ix, int iy = 0) {
+        return getChannel(data, ix, iy) >> 14;
+    };
+
+    /** the frame index written in front of the image */
+    int getFrameNumber(char *buff) { return *((int *)buff); };
+
+    int getPacketNumber(char *buff) { return 0; };
+
+    virtual char *readNextFrame(std::ifstream &filebin) { return NULL; };
+
+    virtual char *findNextFrame(char *data, int &ndata, int dsize) {
+        if (dsize < dataSize)
+            ndata = dsize;
+        else
+            ndata = dataSize;
+        return data;
+    };
+};
+
+#endif
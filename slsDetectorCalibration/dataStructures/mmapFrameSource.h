@@ -0,0 +1,256 @@
+// SPDX-License-Identifier: LGPL-3.0-or-other
+// Copyright (C) 2021 Contributors to the SLS Detector Package
+#ifndef MMAPFRAMESOURCE_H
+#define MMAPFRAMESOURCE_H
+
+#include "sls/sls_detector_defs.h"
+
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <condition_variable>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <mutex>
+#include <pthread.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+/**
+   Frame source for the binary (.raw) files written by the slsReceiver.
+
+   All the subfiles (_f0_, _f1_ ...) of an acquisition are memory mapped and
+   the frames (sls_receiver_header + data) are returned as pointers into the
+   mapping, i.e. without any copy. A prefetch thread keeps a window of the
+   files ahead of the reading position in the page cache, so that the
+   processing does not wait for the disk.
+
+   The returned pointers stay valid until the source is closed: frames can be
+   pushed as they are to the multithreaded detectors with pushBorrowedData,
+   provided that all the threads are done before calling close().
+*/
+class mmapFrameSource {
+
+    using header = sls::defs::sls_receiver_header;
+
+  public:
+    /**
+       Constructor
+       \param ra size of the readahead window in bytes
+    */
+    mmapFrameSource(size_t ra = 256 * 1024 * 1024)
+        : readahead(ra), totalSize(0), ifile(0), offset(0), readPos(0),
+          wakePos(SIZE_MAX), stop(1) {
+        pageSize = sysconf(_SC_PAGESIZE);
+    };
+
+    virtual ~mmapFrameSource() { close(); };
+
+    /**
+       Maps the file and all the following subfiles of the same acquisition
+       (the subfile index is the number following "_f" in the file name) and
+       starts the prefetch thread
+       \param fname name of the first file to be read
+       \returns number of files mapped (0 if the file could not be opened)
+    */
+    int open(const char *fname) {
+        close();
+        std::string fn(fname);
+        size_t pos = subFileIndexPosition(fn);
+        int isub = 0;
+        if (pos != std::string::npos)
+            isub = atoi(fn.c_str() + pos);
+        while (mapFile(fn.c_str())) {
+            if (pos == std::string::npos)
+                break;
+            ++isub;
+            size_t end = fn.find('_', pos);
+            fn = fn.substr(0, pos) + std::to_string(isub) + fn.substr(end);
+        }
+        if (files.size()) {
+            stop = 0;
+            if (pthread_create(&prefetchThread, NULL, prefetchData, this)) {
+                std::cout << "Could not start prefetch thread" << std::endl;
+                stop = 1;
+            }
+        }
+        return files.size();
+    };
+
+    /**
+       Stops the prefetch thread and unmaps all the files. All the pointers
+       returned by nextFrame become invalid
+    */
+    void close() {
+        if (!stop) {
+            {
+                std::lock_guard<std::mutex> lock(prefetchMutex);
+                stop = 1;
+            }
+            prefetchCondition.notify_one();
+            pthread_join(prefetchThread, NULL);
+        }
+        for (size_t i = 0; i < files.size(); ++i)
+            munmap(files[i].ptr, files[i].size);
+        files.clear();
+        totalSize = 0;
+        ifile = 0;
+        offset = 0;
+        readPos = 0;
+        wakePos = SIZE_MAX;
+    };
+
+    int isOpen() { return files.size() > 0; };
+
+    int getNumberOfFiles() { return files.size(); };
+
+    /** total size of the mapped files in bytes */
+    size_t getTotalSize() { return totalSize; };
+
+    /**
+       Returns the next frame of the acquisition
+       \param fsize size of the frame (header included)
+       \param ff frame number (output)
+       \param np number of packets caught (output)
+       \returns pointer to the frame inside the mapping or NULL at the end of
+       the acquisition
+    */
+    char *nextFrame(int fsize, int &ff, int &np) {
+        np = 0;
+        while (ifile < files.size()) {
+            if (offset + fsize <= files[ifile].size) {
+                char *data = files[ifile].ptr + offset;
+                offset += fsize;
+                advance(fsize);
+                ff = ((header *)data)->detHeader.frameNumber;
+                np = ((header *)data)->detHeader.packetNumber;
+                return data;
+            }
+            // skip the truncated end of the file if any
+            advance(files[ifile].size - offset);
+            ++ifile;
+            offset = 0;
+        }
+        return NULL;
+    };
+
+  private:
+    struct mappedFile {
+        char *ptr;
+        size_t size;
+        size_t start; /**< position of the file in the acquisition */
+    };
+
+    /** position of the subfile index in the file name or npos */
+    static size_t subFileIndexPosition(const std::string &fn) {
+        size_t slash = fn.rfind('/');
+        size_t pos = fn.rfind("_f");
+        while (pos != std::string::npos &&
+               (slash == std::string::npos || pos > slash)) {
+            size_t end = pos + 2;
+            while (end < fn.size() && isdigit(fn[end]))
+                ++end;
+            if (end > pos + 2 && end < fn.size() && fn[end] == '_')
+                return pos + 2;
+            if (pos == 0)
+                break;
+            pos = fn.rfind("_f", pos - 1);
+        }
+        return std::string::npos;
+    };
+
+    int mapFile(const char *fname) {
+        int fd = ::open(fname, O_RDONLY);
+        if (fd < 0)
+            return 0;
+        struct stat st;
+        if (fstat(fd, &st) < 0 || st.st_size == 0) {
+            ::close(fd);
+            return 0;
+        }
+        // private writable mapping: decoders may modify the frame in place
+        // without touching the file
+        void *p = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                       fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) {
+            std::cout << "Could not map file " << fname << ": "
+                      << strerror(errno) << std::endl;
+            return 0;
+        }
+        madvise(p, st.st_size, MADV_SEQUENTIAL);
+        mappedFile mf;
+        mf.ptr = (char *)p;
+        mf.size = st.st_size;
+        mf.start = totalSize;
+        files.push_back(mf);
+        totalSize += st.st_size;
+        return 1;
+    };
+
+    /** moves the reading position, wakes the prefetch thread once it has
+     * room in its window */
+    void advance(size_t n) {
+        if ((readPos += n) >= wakePos) {
+            std::lock_guard<std::mutex> lock(prefetchMutex);
+            prefetchCondition.notify_one();
+        }
+    };
+
+    static void *prefetchData(void *ptr) {
+        return ((mmapFrameSource *)ptr)->prefetchData();
+    };
+
+    /** keeps the window of size readahead after the reading position in the
+     * page cache */
+    void *prefetchData() {
+        const size_t chunk = 4 * 1024 * 1024;
+        size_t pos = 0, ifl = 0;
+        volatile char sink = 0;
+        while (!stop && pos < totalSize) {
+            if (pos >= readPos + readahead) {
+                std::unique_lock<std::mutex> lock(prefetchMutex);
+                wakePos = pos - readahead + 1;
+                prefetchCondition.wait(lock, [&] {
+                    return stop || pos < readPos + readahead;
+                });
+                wakePos = SIZE_MAX;
+                continue;
+            }
+            while (pos >= files[ifl].start + files[ifl].size)
+                ++ifl;
+            size_t off = pos - files[ifl].start;
+            size_t len = files[ifl].size - off;
+            if (len > chunk)
+                len = chunk;
+            madvise(files[ifl].ptr + off, len, MADV_WILLNEED);
+            // fault the pages in, madvise only starts the reading
+            for (size_t ip = 0; ip < len; ip += pageSize)
+                sink = files[ifl].ptr[off + ip];
+            pos += len;
+        }
+        (void)sink;
+        return NULL;
+    };
+
+    std::vector<mappedFile> files;
+    size_t pageSize;
+    size_t readahead;
+    size_t totalSize;
+    size_t ifile;  /**< file currently read */
+    size_t offset; /**< reading position in the current file */
+    std::atomic<size_t> readPos; /**< reading position in the acquisition */
+    std::atomic<size_t> wakePos; /**< readPos at which the prefetch thread
+                                    waiting for room must be woken up */
+    std::atomic<int> stop;
+    std::mutex prefetchMutex;
+    std::condition_variable prefetchCondition;
+    pthread_t prefetchThread;
+};
+
+#endif
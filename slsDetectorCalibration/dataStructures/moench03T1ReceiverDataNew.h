@@ -111,6 +111,7 @@ class moench03T1ReceiverDataNew : public slsDetectorData<uint16_t> {
             }
         }
 
+        setDenseDecoding(0x3fff);
         iframe = 0;
         //  cout << "data struct created" << endl;
     };
@@ -100,7 +100,8 @@ class moench04CtbZmq10GbData : public slsDetectorData<uint16_t> {
                 }
             }
 
-
+            // the gain is in the digital samples
+            setDenseDecoding(0xffff);
             iframe = 0;
             //  cout << "data struct created" << endl;
       }
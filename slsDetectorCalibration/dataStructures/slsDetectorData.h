@@ -3,8 +3,10 @@
 #ifndef SLSDETECTORDATA_H
 #define SLSDETECTORDATA_H
 
+#include <cstdint>
 #include <fstream>
 #include <iostream>
+#include <vector>
 
 template <class dataType> class slsDetectorData {
 
@@ -23,6 +25,14 @@ template <class dataType> class slsDetectorData {
     int *ymap;
     dataType **orderedData;
     int isOrdered;
+    int *flatMap; /**< dataMap row major, in units of dataType, for the dense
+                     decoding */
+    dataType *flatMask;        /**< dataMask row major, NULL if no inversion */
+    std::vector<int> unmapped; /**< pixels out of the data */
+    int contiguous; /**< 1 if the pixels are stored row major in the data */
+    int denseDecoding;  /**< 1 if getValue is getChannel & valueMask */
+    dataType valueMask; /**< bits of the value */
+    int gainShift; /**< position of the gain bits, 0 if getGain is used */
 
   public:
     /**
@@ -57,6 +67,18 @@ template <class dataType> class slsDetectorData {
         return (double)getChannel(data, ix, iy);
     };
 
+    /**
+       Decodes the whole frame into a dense row major image. If the data
+       structure declared its value bits (setDenseDecoding), it is one gather
+       pass driven by the flat index table, otherwise getValue is called for
+       every pixel. \param data pointer to the dataset (including headers
+       etc) \param image array of nx*ny values as getValue (without the
+       conversion to double), image[iy*nx+ix] \param gain if not NULL, array
+       of nx*ny gains as getGain
+    */
+    virtual void decodeFrame(char *data, dataType *image,
+                             uint8_t *gain = NULL);
+
     virtual int getFrameNumber(char *buff) = 0;
     
     /**
@@ -80,6 +102,7 @@ template <class dataType> class slsDetectorData {
 
 
 
+
     //END Virtual functions
 
     /**
@@ -134,6 +157,23 @@ template <class dataType> class slsDetectorData {
 
     void newFrame() { isOrdered = 0; };
 
+  protected:
+    /**
+       Enables the dense decoding for data structures in which getValue is
+       the channel (with inversion) masked by vmask. To be called once the
+       data map and mask are defined. \param vmask bits of the value \param
+       gshift position of the gain bits in the channel, 0 if the gain is not
+       in the channel (getGain is used)
+    */
+    void setDenseDecoding(dataType vmask, int gshift = 0);
+
+  private:
+    void buildFlatMap();
+    template <bool cont, bool inv, bool withGain>
+    void gatherFrame(const dataType *src, dataType *image, uint8_t *gain);
+
+  public:
+
     /**
        Returns the value of the selected channel for the given dataset. Virtual
        function, can be overloaded. \param data pointer to the dataset
@@ -149,7 +189,9 @@ template <typename dataType>
 slsDetectorData<dataType>::slsDetectorData(int npx, int npy, int dsize,
                                            int **dMap, dataType **dMask,
                                            int **dROI)
-    : nx(npx), ny(npy), dataSize(dsize), orderedData(NULL), isOrdered(0) {
+    : nx(npx), ny(npy), dataSize(dsize), orderedData(NULL), isOrdered(0),
+      flatMap(NULL), flatMask(NULL), contiguous(0), denseDecoding(0),
+      valueMask(0), gainShift(0) {
 
     int el = dsize / sizeof(dataType);
     xmap = new int[el];
@@ -191,6 +233,8 @@ template <typename dataType> slsDetectorData<dataType>::~slsDetectorData() {
     delete[] orderedData;
     delete[] xmap;
     delete[] ymap;
+    delete[] flatMap;
+    delete[] flatMask;
 }
 
 template <typename dataType>
@@ -224,6 +268,8 @@ void slsDetectorData<dataType>::setDataMap(int **dMap) {
             ymap[ip] = iy;
         }
     }
+    if (denseDecoding)
+        buildFlatMap();
 
     // cout << "nx:" <<nx << " ny:" << ny << endl;
 }
@@ -241,6 +287,8 @@ void slsDetectorData<dataType>::setDataMask(dataType **dMask) {
             for (int ix = 0; ix < nx; ix++)
                 dataMask[iy][ix] = 0;
     }
+    if (denseDecoding)
+        buildFlatMap();
 }
 
 template <typename dataType>
@@ -344,4 +392,111 @@ dataType slsDetectorData<dataType>::getChannel(char *data, int ix, int iy) {
     return d ^ m;
 };
 
+template <typename dataType>
+void slsDetectorData<dataType>::setDenseDecoding(dataType vmask, int gshift) {
+    valueMask = vmask;
+    gainShift = gshift;
+    denseDecoding = 1;
+    buildFlatMap();
+}
+
+template <typename dataType> void slsDetectorData<dataType>::buildFlatMap() {
+    delete[] flatMap;
+    delete[] flatMask;
+    flatMap = new int[nx * ny];
+    flatMask = NULL;
+    unmapped.clear();
+    contiguous = 1;
+    for (int iy = 0; iy < ny; iy++) {
+        for (int ix = 0; ix < nx; ix++) {
+            int ip = iy * nx + ix;
+            int off = dataMap[iy][ix];
+            if (off < 0 || off >= dataSize) {
+                unmapped.push_back(ip);
+                flatMap[ip] = 0;
+                contiguous = 0;
+                continue;
+            }
+            if (off % sizeof(dataType)) {
+                // the gather needs aligned channels
+                denseDecoding = 0;
+                return;
+            }
+            flatMap[ip] = off / sizeof(dataType);
+            if (flatMap[ip] != flatMap[0] + ip)
+                contiguous = 0;
+            if (dataMask[iy][ix] != 0 && flatMask == NULL) {
+                flatMask = new dataType[nx * ny];
+                for (int i = 0; i < nx * ny; i++)
+                    flatMask[i] = dataMask[i / nx][i % nx];
+            }
+        }
+    }
+}
+
+template <typename dataType>
+template <bool cont, bool inv, bool withGain>
+void slsDetectorData<dataType>::gatherFrame(const dataType *src,
+                                            dataType *image, uint8_t *gain) {
+    const int n = nx * ny;
+    const int *map = flatMap;
+    const dataType *mask = flatMask;
+    const dataType vmask = valueMask;
+    const int gshift = gainShift;
+    if (cont)
+        src += map[0];
+    for (int i = 0; i < n; i++) {
+        dataType v = cont ? src[i] : src[map[i]];
+        if (inv)
+            v ^= mask[i];
+        image[i] = v & vmask;
+        if (withGain)
+            gain[i] = v >> gshift;
+    }
+}
+
+template <typename dataType>
+void slsDetectorData<dataType>::decodeFrame(char *data, dataType *image,
+                                            uint8_t *gain) {
+    if (!denseDecoding) {
+        for (int iy = 0; iy < ny; iy++)
+            for (int ix = 0; ix < nx; ix++) {
+                image[iy * nx + ix] = (dataType)getValue(data, ix, iy);
+                if (gain)
+                    gain[iy * nx + ix] = getGain(data, ix, iy);
+            }
+        return;
+    }
+
+    const dataType *src = (const dataType *)data;
+    uint8_t *g = gainShift ? gain : NULL;
+    if (contiguous) {
+        if (flatMask)
+            g ? gatherFrame<true, true, true>(src, image, g)
+              : gatherFrame<true, true, false>(src, image, g);
+        else
+            g ? gatherFrame<true, false, true>(src, image, g)
+              : gatherFrame<true, false, false>(src, image, g);
+    } else {
+        if (flatMask)
+            g ? gatherFrame<false, true, true>(src, image, g)
+              : gatherFrame<false, true, false>(src, image, g);
+        else
+            g ? gatherFrame<false, false, true>(src, image, g)
+              : gatherFrame<false, false, false>(src, image, g);
+    }
+    for (size_t i = 0; i < unmapped.size(); i++) {
+        int ip = unmapped[i];
+        dataType v = flatMask ? flatMask[ip] : 0;
+        image[ip] = v & valueMask;
+        if (g)
+            g[ip] = v >> gainShift;
+    }
+    if (gain && !g) {
+        for (int iy = 0; iy < ny; iy++)
+            for (int ix = 0; ix < nx; ix++)
+                gain[iy * nx + ix] = getGain(data, ix, iy);
+    }
+}
+
 #endif
@@ -0,0 +1,542 @@
+// SPDX-License-Identifier: LGPL-3.0-or-other
+// Copyright (C) 2021 Contributors to the SLS Detector Package
+#ifndef FUSEDPHOTONDETECTOR_H
+#define FUSEDPHOTONDETECTOR_H
+
+#include "moench03CommonMode.h"
+#include "singlePhotonDetector.h"
+
+#include <algorithm>
+#include <vector>
+
+/**
+   Policies of the fusedPhotonDetector. They replace the virtual calls of
+   slsDetectorData, commonModeSubtraction, ghostSummation and
+   pedestalSubtraction in the per pixel loops.
+*/
+
+/** decodes a row of the frame through slsDetectorData::getValue, once per
+ * pixel and frame */
+template <class dataType> class dataDecoder {
+  public:
+    dataDecoder(slsDetectorData<dataType> *d) : det(d){};
+    void decodeFrame(char *data) { (void)data; };
+    void decodeRow(char *data, int iy, int x0, int x1, double *row) {
+        for (int ix = x0; ix < x1; ++ix)
+            row[ix] = det->getValue(data, ix, iy);
+    };
+
+  private:
+    slsDetectorData<dataType> *det;
+};
+
+/** decodes the whole frame at once with slsDetectorData::decodeFrame */
+template <class dataType> class denseDecoder {
+  public:
+    denseDecoder(slsDetectorData<dataType> *d) : det(d), nx(0), ny(0) {
+        det->getDetectorSize(nx, ny);
+        image.resize(nx * ny);
+    };
+    void decodeFrame(char *data) { det->decodeFrame(data, &image[0]); };
+    void decodeRow(char *data, int iy, int x0, int x1, double *row) {
+        (void)data;
+        const dataType *img = &image[iy * nx];
+        for (int ix = x0; ix < x1; ++ix)
+            row[ix] = img[ix];
+    };
+
+  private:
+    slsDetectorData<dataType> *det;
+    int nx, ny;
+    std::vector<dataType> image;
+};
+
+/** no common mode correction */
+class noCommonMode {
+  public:
+    noCommonMode(commonModeSubtraction *cs, int nx, int ny) {
+        (void)cs;
+        (void)nx;
+        (void)ny;
+    };
+    void newFrame(commonModeSubtraction *cs) { (void)cs; };
+    bool active() const { return false; };
+    bool inRow(int iy) const {
+        (void)iy;
+        return false;
+    };
+    void add(double val, int ix, int iy) {
+        (void)val;
+        (void)ix;
+        (void)iy;
+    };
+    void finish(){};
+    double get(int ix, int iy) const {
+        (void)ix;
+        (void)iy;
+        return 0;
+    };
+};
+
+/** any commonModeSubtraction of the detector, through its virtual functions */
+class commonModeAdapter {
+  public:
+    commonModeAdapter(commonModeSubtraction *cs, int nx, int ny) : cmSub(cs) {
+        (void)nx;
+        (void)ny;
+    };
+    /** the detector already reset it in newFrame */
+    void newFrame(commonModeSubtraction *cs) { cmSub = cs; };
+    bool active() const { return cmSub != NULL; };
+    bool inRow(int iy) const {
+        (void)iy;
+        return true;
+    };
+    void add(double val, int ix, int iy) {
+        cmSub->addToCommonMode(val, ix, iy);
+    };
+    void finish(){};
+    double get(int ix, int iy) const { return cmSub->getCommonMode(ix, iy); };
+
+  private:
+    commonModeSubtraction *cmSub;
+};
+
+/** moench03CommonMode inline: one region per column and half module, using
+ * only the first and last rows */
+class moench03ColumnCommonMode {
+  public:
+    moench03ColumnCommonMode(commonModeSubtraction *cs, int nx, int ny)
+        : rows(20) {
+        (void)nx;
+        (void)ny;
+        commonModeSubtractionColumn *c =
+            dynamic_cast<commonModeSubtractionColumn *>(cs);
+        if (c)
+            rows = c->getRows();
+        newFrame(cs);
+    };
+    void newFrame(commonModeSubtraction *cs) {
+        (void)cs;
+        std::fill(sum, sum + NROI, 0.);
+        std::fill(n, n + NROI, 0);
+        std::fill(mean, mean + NROI, 0.);
+    };
+    bool active() const { return true; };
+    bool inRow(int iy) const {
+        return iy < rows || (iy > 399 - rows && iy < 400);
+    };
+    void add(double val, int ix, int iy) {
+        if (ix < 400) {
+            sum[ix + (iy / 200) * 400] += val;
+            n[ix + (iy / 200) * 400]++;
+        }
+    };
+    void finish() {
+        for (int i = 0; i < NROI; i++)
+            mean[i] = n[i] > 0 ? sum[i] / n[i] : 0;
+    };
+    double get(int ix, int iy) const {
+        if (ix < 400 && iy < 400)
+            return mean[ix + (iy / 200) * 400];
+        return 0;
+    };
+
+  private:
+    static const int NROI = 800;
+    int rows;
+    double sum[NROI];
+    int n[NROI];
+    double mean[NROI];
+};
+
+/** no ghost correction */
+class noGhost {
+  public:
+    /** ghost values are known only after the whole frame was added */
+    static const bool wholeFrame = false;
+    noGhost(ghostSummation<uint16_t> *gs, int nx, int ny) {
+        (void)gs;
+        (void)nx;
+        (void)ny;
+    };
+    void newFrame(){};
+    void add(double val, int ix, int iy) {
+        (void)val;
+        (void)ix;
+        (void)iy;
+    };
+    void finish(char *data) { (void)data; };
+    double get(int ix, int iy) const {
+        (void)ix;
+        (void)iy;
+        return 0;
+    };
+};
+
+/** any ghostSummation of the detector, calculated from the raw data */
+class ghostAdapter {
+  public:
+    static const bool wholeFrame = true;
+    ghostAdapter(ghostSummation<uint16_t> *gs, int nx, int ny) : ghSum(gs) {
+        (void)nx;
+        (void)ny;
+    };
+    void newFrame(){};
+    void add(double val, int ix, int iy) {
+        (void)val;
+        (void)ix;
+        (void)iy;
+    };
+    void finish(char *data) {
+        if (ghSum)
+            ghSum->calcGhost(data);
+    };
+    double get(int ix, int iy) const {
+        return ghSum ? ghSum->getGhost(ix, iy) : 0;
+    };
+
+  private:
+    ghostSummation<uint16_t> *ghSum;
+};
+
+/** moench03GhostSummation inline, accumulated while decoding: the crosstalk
+ * times the sum of the 16 supercolumns of both halves */
+class moench03Ghost {
+  public:
+    static const bool wholeFrame = true;
+    moench03Ghost(ghostSummation<uint16_t> *gs, int nx, int ny)
+        : xtalk(gs ? gs->getXTalk() : 0.0004) {
+        (void)nx;
+        (void)ny;
+        newFrame();
+    };
+    void newFrame() { std::fill(ghost, ghost + 200 * 25, 0.); };
+    void add(double val, int ix, int iy) {
+        if (ix < 400 && iy < 400)
+            ghost[(iy < 200 ? iy : 399 - iy) * 25 + ix % 25] += val;
+    };
+    void finish(char *data) {
+        (void)data;
+        for (int i = 0; i < 200 * 25; i++)
+            ghost[i] *= xtalk;
+    };
+    double get(int ix, int iy) const {
+        if (iy >= 0 && iy < 200)
+            return ghost[iy * 25 + (ix % 25)];
+        if (iy < 400)
+            return ghost[(399 - iy) * 25 + (ix % 25)];
+        return 0;
+    };
+
+  private:
+    double xtalk;
+    double ghost[200 * 25];
+};
+
+/** pedestalSubtraction moving average, without the virtual calls */
+class movingAveragePedestal {
+  public:
+    static double mean(pedestalSubtraction &s) {
+        return s.pedestalSubtraction::getPedestal();
+    };
+    static double rms(pedestalSubtraction &s) {
+        return s.pedestalSubtraction::getPedestalRMS();
+    };
+    static int n(pedestalSubtraction &s) {
+        return s.pedestalSubtraction::getNumpedestals();
+    };
+    /** pedestal frames */
+    static void add(pedestalSubtraction &s, double val) {
+        s.pedestalSubtraction::addToPedestal(val);
+    };
+    /** pixels without photons in the data frames */
+    static void track(pedestalSubtraction &s, double val) { add(s, val); };
+};
+
+/** pedestal from the pedestal frames only, not tracked in the data frames */
+class fixedPedestal : public movingAveragePedestal {
+  public:
+    static void track(pedestalSubtraction &s, double val) {
+        (void)s;
+        (void)val;
+    };
+};
+
+/**
+   singlePhotonDetector in which the data of a frame are decoded once and
+   corrected and clustered in one pass over blocks of rows.
+
+   The decoder, common mode, ghost and pedestal models are template policies
+   (see above). A frame takes:
+   - one pass decoding the raw data, accumulating the ghost (and the common
+     mode, if it does not depend on the ghost);
+   - the common mode accumulation on the decoded rows in the common mode
+     regions, if it depends on the ghost;
+   - one pass over blocks of rows subtracting pedestal and common mode,
+     adding the ghost and dividing by the gain, while the clusters are
+     searched in the rows above the block whose neighbourhood is complete.
+
+   Only the clustering (no threshold set) is fused, the rest is left to
+   singlePhotonDetector. Events are classified as in
+   singlePhotonDetector::getClusters, the clusters written keep the whole
+   neighbourhood of the pixel.
+*/
+template <class decoder, class commonMode, class ghost,
+          class pedestal = movingAveragePedestal>
+class fusedPhotonDetector : public singlePhotonDetector {
+
+  public:
+    /** same parameters as singlePhotonDetector */
+    fusedPhotonDetector(slsDetectorData<uint16_t> *d, int csize = 3,
+                        double nsigma = 5, int sign = 1,
+                        commonModeSubtraction *cm = NULL, int nped = 1000,
+                        int nd = 100, int nnx = -1, int nny = -1,
+                        double *gm = NULL, ghostSummation<uint16_t> *gs = NULL)
+        : singlePhotonDetector(d, csize, nsigma, sign, cm, nped, nd, nnx, nny,
+                               gm, gs),
+          dec(d), cmMode(cm, nx, ny), ghMode(gs, nx, ny) {
+        init();
+    };
+
+    fusedPhotonDetector(fusedPhotonDetector *orig)
+        : singlePhotonDetector(orig), dec(orig->dec), cmMode(cmSub, nx, ny),
+          ghMode(ghSum, nx, ny) {
+        init();
+    };
+
+    virtual ~fusedPhotonDetector() {
+        delete[] raw;
+        delete[] corr;
+    };
+
+    virtual fusedPhotonDetector *Clone() {
+        return new fusedPhotonDetector(this);
+    };
+
+    using singlePhotonDetector::addToPedestal;
+
+    /** adds the frame to the pedestals (the common mode is not subtracted,
+     * as in analogDetector) */
+    virtual void addToPedestal(char *data, int cm = 0) {
+        (void)cm;
+        decodeFrame(data, false);
+        for (int iy = ymin; iy < ymax; ++iy)
+            for (int ix = xmin; ix < xmax; ++ix)
+                if (det->isGood(ix, iy))
+                    pedestal::add(stat[iy][ix], raw[iy * nx + ix] +
+                                                    ghMode.get(ix, iy));
+    };
+
+    virtual int *getNPhotons(char *data, int *nph = NULL) {
+        if (thr > 0)
+            return singlePhotonDetector::getNPhotons(data, nph);
+        if (nph == NULL)
+            nph = image;
+        if (iframe < nDark) {
+            addToPedestal(data);
+            return nph;
+        }
+        decodeFrame(data, true);
+
+        int dx = clusterSize / 2, dy = clusterSizeY / 2;
+        int x0 = std::max(0, xmin - dx), x1 = std::min(nx, xmax + dx);
+        int y0 = std::max(0, ymin - dy), y1 = std::min(ny, ymax + dy);
+        int next = ymin;
+        int ncl = 0;
+        for (int iy0 = y0; iy0 < y1; iy0 += blockRows) {
+            int iy1 = std::min(iy0 + blockRows, y1);
+            for (int iy = iy0; iy < iy1; ++iy)
+                correctRow(iy, x0, x1);
+            int last = iy1 == y1 ? ymax : std::min(ymax, iy1 - dy);
+            for (; next < last; ++next)
+                findClusters(next, nph, ncl);
+        }
+
+        nphFrame = ncl;
+        nphTot += ncl;
+        writeClusters(det->getFrameNumber(data));
+        return nph;
+    };
+
+    /** pedestal, common mode, ghost and gain corrected values of the last
+     * frame (in the region of interest and the cluster size around it) */
+    double *getCorrectedFrame() { return corr; };
+
+  private:
+    void init() {
+        raw = new double[nx * ny];
+        corr = new double[nx * ny];
+        std::fill(raw, raw + nx * ny, 0.);
+        std::fill(corr, corr + nx * ny, 0.);
+        // a block of rows stays in cache between the two passes
+        blockRows = std::max(1, 16384 / std::max(1, nx));
+    };
+
+    /** decodes (the region of interest of) the frame in raw, with data sign */
+    void decodeFrame(char *data, bool withCommonMode) {
+        analogDetector<uint16_t>::newFrame();
+        ghMode.newFrame();
+        cmMode.newFrame(cmSub);
+        bool cm = withCommonMode && cmMode.active();
+
+        int dx = clusterSize / 2, dy = clusterSizeY / 2;
+        int x0 = 0, x1 = nx, y0 = 0, y1 = ny;
+        if (!ghost::wholeFrame) {
+            x0 = std::max(0, xmin - dx);
+            x1 = std::min(nx, xmax + dx);
+            y0 = std::max(0, ymin - dy);
+            y1 = std::min(ny, ymax + dy);
+        }
+        dec.decodeFrame(data);
+        for (int iy = y0; iy < y1; ++iy) {
+            double *row = raw + iy * nx;
+            dec.decodeRow(data, iy, x0, x1, row);
+            for (int ix = x0; ix < x1; ++ix) {
+                ghMode.add(row[ix], ix, iy);
+                row[ix] *= dataSign;
+            }
+            if (cm && !ghost::wholeFrame && iy >= ymin && iy < ymax &&
+                cmMode.inRow(iy))
+                addToCommonMode(iy);
+        }
+        ghMode.finish(data);
+        if (cm && ghost::wholeFrame) {
+            for (int iy = ymin; iy < ymax; ++iy)
+                if (cmMode.inRow(iy))
+                    addToCommonMode(iy);
+        }
+        cmMode.finish();
+    };
+
+    void addToCommonMode(int iy) {
+        for (int ix = xmin; ix < xmax; ++ix) {
+            if (det->isGood(ix, iy) == 0)
+                continue;
+            pedestalSubtraction &s = stat[iy][ix];
+            if (pedestal::n(s) > 0)
+                cmMode.add(raw[iy * nx + ix] - pedestal::mean(s) +
+                               ghMode.get(ix, iy),
+                           ix, iy);
+        }
+    };
+
+    void correctRow(int iy, int x0, int x1) {
+        const double *r = raw + iy * nx;
+        double *c = corr + iy * nx;
+        bool cm = cmMode.active();
+        for (int ix = x0; ix < x1; ++ix) {
+            double g = 1.;
+            if (gmap) {
+                g = gmap[iy * nx + ix];
+                if (g == 0)
+                    g = -1.;
+            }
+            double p = pedestal::mean(stat[iy][ix]);
+            if (cm)
+                p += cmMode.get(ix, iy);
+            c[ix] = (r[ix] - p + ghMode.get(ix, iy)) / g;
+        }
+    };
+
+    /** same event classification as singlePhotonDetector::getClusters,
+     * which sums only the pixels at or after the pixel (ir, ic >= 0) */
+    void findClusters(int iy, int *nph, int &ncl) {
+        const int dx = clusterSize / 2, dy = clusterSizeY / 2;
+        for (int ix = xmin; ix < xmax; ++ix) {
+            if (det->isGood(ix, iy) == 0)
+                continue;
+            double max = 0, tl = 0, tr = 0, bl = 0, br = 0;
+            tot = 0;
+            quadTot = 0;
+            quad = UNDEFINED_QUADRANT;
+            eventType ee = PEDESTAL;
+            double rms = pedestal::rms(stat[iy][ix]);
+            double v0 = corr[iy * nx + ix];
+
+            for (int ir = 0; ir <= dy; ir++) {
+                if (iy + ir >= ny)
+                    continue;
+                const double *c = corr + (iy + ir) * nx;
+                for (int ic = 0; ic <= dx; ic++) {
+                    if (ix + ic >= nx)
+                        continue;
+                    double v = c[ix + ic];
+                    tot += v;
+                    if (ir <= 0 && ic <= 0)
+                        bl += v;
+                    if (ir <= 0 && ic >= 0)
+                        br += v;
+                    if (ir >= 0 && ic <= 0)
+                        tl += v;
+                    if (ir >= 0 && ic >= 0)
+                        tr += v;
+                    if (v > max)
+                        max = v;
+                }
+            }
+
+            if (v0 < -nSigma * rms)
+                continue;
+            if (max > nSigma * rms) {
+                ee = PHOTON;
+                if (v0 < max)
+                    continue;
+            } else if (tot > c3 * nSigma * rms) {
+                ee = PHOTON;
+            }
+#ifndef WRITE_QUAD
+            else {
+#endif
+                quad = BOTTOM_RIGHT;
+                quadTot = br;
+                if (bl >= quadTot) {
+                    quad = BOTTOM_LEFT;
+                    quadTot = bl;
+                }
+                if (tl >= quadTot) {
+                    quad = TOP_LEFT;
+                    quadTot = tl;
+                }
+                if (tr >= quadTot) {
+                    quad = TOP_RIGHT;
+                    quadTot = tr;
+                }
+                if (quadTot > c2 * nSigma * rms)
+                    ee = PHOTON;
+#ifndef WRITE_QUAD
+            }
+#endif
+            if (ee == PHOTON && v0 == max) {
+                single_photon_hit *cl = clusters + ncl;
+                cl->tot = tot;
+                cl->x = ix;
+                cl->y = iy;
+                cl->quad = quad;
+                cl->quadTot = quadTot;
+                for (int ir = -dy; ir <= dy; ir++)
+                    for (int ic = -dx; ic <= dx; ic++)
+                        if (iy + ir >= 0 && iy + ir < ny && ix + ic >= 0 &&
+                            ix + ic < nx)
+                            cl->set_data(corr[(iy + ir) * nx + ix + ic], ic,
+                                         ir);
+                if ((eMin <= 0 || tot >= eMin) && (eMax <= 0 || tot <= eMax)) {
+                    ncl++;
+                    nph[iy * nx + ix]++;
+                }
+            } else if (ee == PEDESTAL) {
+                pedestal::track(stat[iy][ix],
+                                raw[iy * nx + ix] + ghMode.get(ix, iy));
+            }
+        }
+    };
+
+    decoder dec;
+    commonMode cmMode;
+    ghost ghMode;
+    double *raw;  /**< decoded frame, with data sign */
+    double *corr; /**< corrected frame */
+    int blockRows;
+};
+
+#endif
@@ -4,7 +4,9 @@
 #define GHOSTSUMMATION_H
 
 #include "slsDetectorData.h"
+#include <algorithm>
 #include <cmath>
+#include <vector>
 
 template <class dataType> class ghostSummation {
 
@@ -60,4 +62,143 @@ template <class dataType> class ghostSummation {
     int nx, ny;
 };
 
+/**
+   Crosstalk between supercolumns read out in parallel: the ghost of a pixel
+   is the sum of the pixels at the same position in the other supercolumns
+   (and in the mirrored row, for the two halves read out together) times the
+   crosstalk. The frame is decoded once (slsDetectorData::decodeFrame), the
+   supercolumns are summed row by row and the ghost of the supercolumn
+   position is the sum times the crosstalk. A crosstalk matrix can be set for
+   detectors in which the coupling depends on the supercolumns.
+*/
+template <class dataType>
+class supercolumnGhostSummation : public ghostSummation<dataType> {
+
+  public:
+    /** constructor
+        \param d detector data structure
+        \param xt crosstalk
+        \param scw supercolumn width
+        \param nsc number of supercolumns
+        \param mr rows iy and mr-1-iy are read out together, 0 if none
+    */
+    supercolumnGhostSummation(slsDetectorData<dataType> *d, double xt,
+                              int scw, int nsc, int mr = 0)
+        : ghostSummation<dataType>(d, xt), scWidth(scw), nSC(nsc),
+          mirrorRows(mr) {
+        init();
+    };
+
+    supercolumnGhostSummation(supercolumnGhostSummation *orig)
+        : ghostSummation<dataType>(orig), scWidth(orig->scWidth),
+          nSC(orig->nSC), mirrorRows(orig->mirrorRows),
+          matrix(orig->matrix) {
+        init();
+    };
+
+    virtual supercolumnGhostSummation *Clone() {
+        return new supercolumnGhostSummation(this);
+    };
+
+    /** sets the crosstalk matrix
+        \param m nsc*nsc coefficients, m[is*nsc+js] is the crosstalk of
+        supercolumn js on supercolumn is. NULL uses the crosstalk for all
+    */
+    void setCrosstalkMatrix(const double *m) {
+        if (m)
+            matrix.assign(m, m + nSC * nSC);
+        else
+            matrix.clear();
+    };
+
+    using ghostSummation<dataType>::calcGhost;
+
+    virtual void calcGhost(char *data) {
+        det->decodeFrame(data, &image[0]);
+        calcGhost(&image[0]);
+    };
+
+    /** calculates the ghost from the dense image
+        \param img nx*ny image as from slsDetectorData::decodeFrame
+    */
+    virtual void calcGhost(const dataType *img) {
+        int nr = mirrorRows ? mirrorRows / 2 : ny;
+        double *s = &sums[0];
+        for (int iy = 0; iy < std::min(nr, ny); iy++) {
+            int iy1 = mirrorRows ? mirrorRows - 1 - iy : -1;
+            // sum of both rows, per supercolumn
+            std::fill(s, s + nSC * scWidth, 0.);
+            addRow(img + iy * nx, s);
+            if (iy1 >= 0 && iy1 < ny)
+                addRow(img + iy1 * nx, s);
+
+            double *g = ghost + iy * nx;
+            if (matrix.empty()) {
+                std::fill(g, g + scWidth, 0.);
+                for (int isc = 0; isc < nSC; isc++)
+                    for (int k = 0; k < scWidth; k++)
+                        g[k] += s[isc * scWidth + k];
+                for (int k = 0; k < scWidth; k++)
+                    g[k] *= xtalk;
+            } else {
+                int nc = std::min(nSC * scWidth, nx);
+                std::fill(g, g + nc, 0.);
+                for (int isc = 0; isc < nSC; isc++) {
+                    int kmax = std::min(scWidth, nc - isc * scWidth);
+                    double *gsc = g + isc * scWidth;
+                    for (int jsc = 0; jsc < nSC; jsc++) {
+                        double m = matrix[isc * nSC + jsc];
+                        const double *ssc = s + jsc * scWidth;
+                        for (int k = 0; k < kmax; k++)
+                            gsc[k] += m * ssc[k];
+                    }
+                }
+                if (iy1 >= 0 && iy1 < ny)
+                    std::copy(g, g + nc, ghost + iy1 * nx);
+            }
+        }
+    };
+
+    virtual double getGhost(int ix, int iy) {
+        if (ix < 0 || ix >= nx || iy < 0 || iy >= ny)
+            return 0;
+        if (matrix.empty()) {
+            if (mirrorRows && iy >= mirrorRows / 2)
+                iy = mirrorRows - 1 - iy;
+            if (iy < 0)
+                return 0;
+            ix = ix % scWidth;
+        }
+        return ghost[iy * nx + ix];
+    };
+
+  protected:
+    using ghostSummation<dataType>::xtalk;
+    using ghostSummation<dataType>::det;
+    using ghostSummation<dataType>::ghost;
+    using ghostSummation<dataType>::nx;
+    using ghostSummation<dataType>::ny;
+
+    int scWidth;    /**< supercolumn width */
+    int nSC;        /**< number of supercolumns */
+    int mirrorRows; /**< rows iy and mirrorRows-1-iy are read together */
+    std::vector<double> matrix; /**< crosstalk matrix, empty if uniform */
+
+  private:
+    void init() {
+        image.resize(nx * ny);
+        sums.resize(nSC * scWidth);
+        std::fill(ghost, ghost + nx * ny, 0.);
+    };
+
+    void addRow(const dataType *row, double *s) {
+        int n = std::min(nSC * scWidth, nx);
+        for (int i = 0; i < n; i++)
+            s[i] += row[i];
+    };
+
+    std::vector<dataType> image; /**< decoded frame */
+    std::vector<double> sums;    /**< supercolumn sums of a row */
+};
+
 #endif
@@ -133,7 +133,7 @@ class eta2InterpolationBase : public virtual etaInterpolationBase {
             cc[0][0] = cl[xoff + 3 * yoff];
             cc[1][0] = cl[xoff + 3 * (yoff + 1)];
             cc[0][1] = cl[xoff + 1 + 3 * yoff];
-            cc[1][1] = cl[xoff + 1 + 3 * (xoff + 1)];
+            cc[1][1] = cl[xoff + 1 + 3 * (yoff + 1)];
             calcEta(totquad, cc, etax, etay);
         }
         return getInterpolatedPosition(x, y, etax, etay, quad, int_x, int_y);
@@ -204,6 +204,41 @@ class eta2InterpolationBase : public virtual etaInterpolationBase {
         int_y = ((double)y) + ypos_eta + 0.5;
     }
 
+    /** batched version of getInterpolatedPosition(x, y, etax, etay, corner,
+       int_x, int_y) reading the compiled interpolation table. Out of range eta
+       are silently clamped to the table edges
+    */
+    virtual void getInterpolatedPositions(int nph, single_photon_hit *cl,
+                                          double *etax, double *etay,
+                                          int *quad, double *int_x,
+                                          double *int_y) {
+        if (hhxy == NULL || (nSubPixelsX <= 2 && nSubPixelsY <= 2)) {
+            slsInterpolation::getInterpolatedPositions(nph, cl, etax, etay,
+                                                       quad, int_x, int_y);
+            return;
+        }
+        // offsets indexed by quadrant (TOP_LEFT, TOP_RIGHT, BOTTOM_LEFT,
+        // BOTTOM_RIGHT)
+        const double offX[4] = {-1., 0., -1., 0.};
+        const double offY[4] = {0., 0., -1., -1.};
+        double dX, dY, xpos_eta, ypos_eta;
+        int ex, ey;
+        const float *hh;
+        for (int ih = 0; ih < nph; ih++) {
+            ex = (etax[ih] - etamin) / etastepX;
+            ey = (etay[ih] - etamin) / etastepY;
+            ex = ex < 0 ? 0 : (ex >= nbetaX ? nbetaX - 1 : ex);
+            ey = ey < 0 ? 0 : (ey >= nbetaY ? nbetaY - 1 : ey);
+            dX = (quad[ih] >= 0 && quad[ih] < 4) ? offX[quad[ih]] : 0.;
+            dY = (quad[ih] >= 0 && quad[ih] < 4) ? offY[quad[ih]] : 0.;
+            hh = hhxy + 2 * (ey * nbetaX + ex);
+            xpos_eta = ((double)hh[0]) + dX;
+            ypos_eta = ((double)hh[1]) + dY;
+            int_x[ih] = ((double)cl[ih].x) + xpos_eta + 0.5;
+            int_y[ih] = ((double)cl[ih].y) + ypos_eta + 0.5;
+        }
+    }
+
     virtual int addToFlatField(double totquad, int quad, int *cl, double &etax,
                                double &etay) {
         double cc[2][2];
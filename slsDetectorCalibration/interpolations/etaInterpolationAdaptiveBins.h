@@ -269,6 +269,7 @@ class etaInterpolationAdaptiveBins : public etaInterpolationPosXY {
         debugSaveAll(iint);
 #endif
 
+        compileInterpolationTable();
         return;
     }
 };
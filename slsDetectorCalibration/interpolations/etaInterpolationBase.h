@@ -13,14 +13,16 @@
 #include "sls/tiffIO.h"
 #include <cmath>
 
+#define ETA_TABLE_MAGIC 0x41544531 /**< "1ETA", compiled interpolation table */
+
 class etaInterpolationBase : public slsInterpolation {
 
   public:
     etaInterpolationBase(int nx = 400, int ny = 400, int ns = 25, int nsy = 25,
                          int nb = -1, int nby = -1, double emin = 1,
                          double emax = 0)
-        : slsInterpolation(nx, ny, ns, nsy), hhx(NULL), hhy(NULL), heta(NULL),
-          nbetaX(nb), nbetaY(nby), etamin(emin), etamax(emax) {
+        : slsInterpolation(nx, ny, ns, nsy), hhx(NULL), hhy(NULL), hhxy(NULL),
+          heta(NULL), nbetaX(nb), nbetaY(nby), etamin(emin), etamax(emax) {
         // cout << "eb " << nb << " " << emin << " " << emax << endl;
         // cout << nb << " " << etamin << " " << etamax << endl;
         if (nbetaX <= 0) {
@@ -62,6 +64,11 @@ class etaInterpolationBase : public slsInterpolation {
         memcpy(hhx, orig->hhx, nbetaX * nbetaY * sizeof(float));
         hhy = new float[nbetaX * nbetaY];
         memcpy(hhy, orig->hhy, nbetaX * nbetaY * sizeof(float));
+        hhxy = NULL;
+        if (orig->hhxy) {
+            hhxy = new float[2 * nbetaX * nbetaY];
+            memcpy(hhxy, orig->hhxy, 2 * nbetaX * nbetaY * sizeof(float));
+        }
         hintcorr = new int[nSubPixelsX * nSubPixelsY * nPixelsX * nPixelsY];
     };
 
@@ -96,6 +103,8 @@ class etaInterpolationBase : public slsInterpolation {
             rangeMax = etamax;
             etastepX = (etamax - etamin) / nbetaX;
             etastepY = (etamax - etamin) / nbetaY;
+            delete[] hhxy;
+            hhxy = NULL;
         }
         return heta;
     };
@@ -162,6 +171,8 @@ class etaInterpolationBase : public slsInterpolation {
             heta = new int[nbetaX * nbetaY];
             hhx = new float[nbetaX * nbetaY];
             hhy = new float[nbetaX * nbetaY];
+            delete[] hhxy;
+            hhxy = NULL;
 
             for (int ix = 0; ix < nbetaX; ix++) {
                 for (int iy = 0; iy < nbetaY; iy++) {
@@ -183,6 +194,102 @@ class etaInterpolationBase : public slsInterpolation {
         // hhy->Scale((double)nSubPixels);
         return hhy;
     };
+
+    /** builds the compiled interpolation table, i.e. hhx and hhy interleaved
+       per eta bin so that a lookup reads a single cache line. Called at the
+       end of prepareInterpolation, NULL until then \returns the table
+       (2*nbetaX*nbetaY floats)
+    */
+    float *compileInterpolationTable() {
+        delete[] hhxy;
+        hhxy = new float[2 * nbetaX * nbetaY];
+        for (int ib = 0; ib < nbetaX * nbetaY; ib++) {
+            hhxy[2 * ib] = hhx[ib];
+            hhxy[2 * ib + 1] = hhy[ib];
+        }
+        return hhxy;
+    };
+
+    float *getInterpolationTable() { return hhxy; };
+
+    /** writes the eta distribution and the compiled interpolation table to
+       a binary file, so that the interpolation can be reloaded without
+       calling prepareInterpolation again \param fname file name \returns 1
+       if ok, 0 otherwise
+    */
+    int writeInterpolationTable(const char *fname) {
+        if (hhxy == NULL) {
+            cout << "Interpolation table not compiled, call "
+                    "prepareInterpolation first"
+                 << endl;
+            return 0;
+        }
+        FILE *f = fopen(fname, "wb");
+        if (f == NULL) {
+            cout << "Could not open interpolation table " << fname << endl;
+            return 0;
+        }
+        int32_t hdr[5] = {ETA_TABLE_MAGIC, nbetaX, nbetaY, nSubPixelsX,
+                          nSubPixelsY};
+        double range[2] = {etamin, etamax};
+        int ok = fwrite(hdr, sizeof(int32_t), 5, f) == 5 &&
+                 fwrite(range, sizeof(double), 2, f) == 2 &&
+                 fwrite(heta, sizeof(int), nbetaX * nbetaY, f) ==
+                     (size_t)(nbetaX * nbetaY) &&
+                 fwrite(hhxy, sizeof(float), 2 * nbetaX * nbetaY, f) ==
+                     (size_t)(2 * nbetaX * nbetaY);
+        fclose(f);
+        return ok;
+    };
+
+    /** reads a file written by writeInterpolationTable. The number of
+       subpixels must match the one of this interpolation \param fname file
+       name \returns 1 if ok, 0 otherwise (e.g. not a table file)
+    */
+    int readInterpolationTable(const char *fname) {
+        FILE *f = fopen(fname, "rb");
+        if (f == NULL)
+            return 0;
+        int32_t hdr[5];
+        double range[2];
+        if (fread(hdr, sizeof(int32_t), 5, f) != 5 ||
+            hdr[0] != ETA_TABLE_MAGIC ||
+            fread(range, sizeof(double), 2, f) != 2) {
+            fclose(f);
+            return 0;
+        }
+        if (hdr[3] != nSubPixelsX || hdr[4] != nSubPixelsY) {
+            cout << "Interpolation table " << fname << " has " << hdr[3]
+                 << "x" << hdr[4] << " subpixels instead of " << nSubPixelsX
+                 << "x" << nSubPixelsY << endl;
+            fclose(f);
+            return 0;
+        }
+        int nb = hdr[1] * hdr[2];
+        int *h = new int[nb];
+        float *hxy = new float[2 * nb];
+        if (fread(h, sizeof(int), nb, f) != (size_t)nb ||
+            fread(hxy, sizeof(float), 2 * nb, f) != (size_t)(2 * nb)) {
+            cout << "Could not read interpolation table " << fname << endl;
+            delete[] h;
+            delete[] hxy;
+            fclose(f);
+            return 0;
+        }
+        fclose(f);
+
+        setEta(h, hdr[1], hdr[2], range[0], range[1]);
+        delete[] hhx;
+        delete[] hhy;
+        hhx = new float[nb];
+        hhy = new float[nb];
+        for (int ib = 0; ib < nb; ib++) {
+            hhx[ib] = hxy[2 * ib];
+            hhy[ib] = hxy[2 * ib + 1];
+        }
+        hhxy = hxy;
+        return 1;
+    };
     virtual int addToFlatFieldDistribution(double etax, double etay) {
 #ifdef MYROOT1
         heta->Fill(etax, etay);
@@ -375,6 +482,7 @@ class etaInterpolationBase : public slsInterpolation {
 
     float *hhx;
     float *hhy;
+    float *hhxy; /**< compiled interpolation table, hhx and hhy interleaved */
     int *heta;
     int nbetaX, nbetaY;
     double etamin, etamax, etastepX, etastepY;
@@ -165,6 +165,7 @@ class etaInterpolationPosXY : public virtual etaInterpolationBase {
         delete[] hix;
         delete[] hiy;
 
+        compileInterpolationTable();
         return;
     }
 };
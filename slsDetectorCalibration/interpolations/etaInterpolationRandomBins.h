@@ -392,6 +392,7 @@ class etaInterpolationRandomBins : public etaInterpolationPosXY {
         /*   WriteToTiff(etah, tit, etabins, etabins); */
         /*   delete [] etah; */
         /* #endif */
+        compileInterpolationTable();
         return;
     }
 };
@@ -20,10 +20,18 @@ enum quadrant {
 #endif
 #include <memory.h>
 
+#ifndef SINGLE_PHOTON_HIT_H
+#include "single_photon_hit.h"
+#endif
+
 #include <iostream>
 #include <stdio.h>
 using namespace std;
 
+#ifndef ETA_BATCH
+#define ETA_BATCH 64 /**< number of clusters processed together by the batched eta calculation */
+#endif
+
 //#ifdef MYROOT1
 //: public TObject
 //#endif
@@ -148,6 +156,21 @@ class slsInterpolation {
                                          double *cluster, double &etax,
                                          double &etay) = 0;
 
+    /** return positions inside the pixels for a batch of photons (e.g. all
+       the photons of a frame or a block of a cluster file) \param nph number
+       of clusters \param cl array of clusters \param etax, etay, quad eta
+       and quadrant of each cluster as returned by the batched calcEta
+       \param int_x, int_y interpolated positions (output, nph elements)
+    */
+    virtual void getInterpolatedPositions(int nph, single_photon_hit *cl,
+                                          double *etax, double *etay,
+                                          int *quad, double *int_x,
+                                          double *int_y) {
+        for (int ih = 0; ih < nph; ih++)
+            getInterpolatedPosition(cl[ih].x, cl[ih].y, etax[ih], etay[ih],
+                                    quad[ih], int_x[ih], int_y[ih]);
+    };
+
     // return position inside the pixel for the given photon
     virtual void clearInterpolatedImage() {
 
@@ -389,6 +412,67 @@ class slsInterpolation {
         return corner;
     }
 
+    /** eta of a batch of 3x3 clusters, same results as calcEta for each
+       cluster. The clusters are first copied to a structure of arrays, then
+       the quadrant sums and the eta are computed in a simple loop over the
+       batch; the quadrant is still selected with comparisons as in calcQuad
+       \param nph number of clusters
+       \param cl array of clusters \param etax, etay, sum, totquad, quad
+       output arrays of nph elements (eta is 0 for empty clusters)
+    */
+    static void calcEta(int nph, single_photon_hit *cl, double *etax,
+                        double *etay, double *sum, double *totquad,
+                        int *quad) {
+        double c[9][ETA_BATCH];
+        for (int i0 = 0; i0 < nph; i0 += ETA_BATCH) {
+            int nb = nph - i0;
+            if (nb > ETA_BATCH)
+                nb = ETA_BATCH;
+            for (int ib = 0; ib < nb; ib++) {
+                int *d = cl[i0 + ib].get_cluster();
+                for (int ic = 0; ic < 9; ic++)
+                    c[ic][ib] = d[ic];
+            }
+            double *ex = etax + i0, *ey = etay + i0, *s = sum + i0,
+                   *tq = totquad + i0;
+            int *q = quad + i0;
+            for (int ib = 0; ib < nb; ib++) {
+                double bl = c[0][ib] + c[1][ib] + c[3][ib] + c[4][ib];
+                double tl = c[3][ib] + c[4][ib] + c[6][ib] + c[7][ib];
+                double br = c[1][ib] + c[2][ib] + c[4][ib] + c[5][ib];
+                double tr = c[4][ib] + c[5][ib] + c[7][ib] + c[8][ib];
+                // top row and right column of the selected 2x2 quadrant
+                double tot = bl, t = c[3][ib] + c[4][ib],
+                       r = c[1][ib] + c[4][ib];
+                int corner = BOTTOM_LEFT;
+                if (tl >= tot) {
+                    tot = tl;
+                    t = c[6][ib] + c[7][ib];
+                    r = c[4][ib] + c[7][ib];
+                    corner = TOP_LEFT;
+                }
+                if (br >= tot) {
+                    tot = br;
+                    t = c[4][ib] + c[5][ib];
+                    r = c[2][ib] + c[5][ib];
+                    corner = BOTTOM_RIGHT;
+                }
+                if (tr >= tot) {
+                    tot = tr;
+                    t = c[7][ib] + c[8][ib];
+                    r = c[5][ib] + c[8][ib];
+                    corner = TOP_RIGHT;
+                }
+                s[ib] = c[0][ib] + c[1][ib] + c[2][ib] + c[3][ib] + c[4][ib] +
+                        c[5][ib] + c[6][ib] + c[7][ib] + c[8][ib];
+                tq[ib] = tot;
+                q[ib] = corner;
+                ex[ib] = tot > 0 ? r / tot : 0;
+                ey[ib] = tot > 0 ? t / tot : 0;
+            }
+        }
+    }
+
     static int calcEtaL(double totquad, int corner, double sDum[2][2],
                         double &etax, double &etay) {
         double t, r, toth, totv;
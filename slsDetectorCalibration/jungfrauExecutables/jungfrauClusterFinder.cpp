@@ -7,7 +7,11 @@
 #include "jungfrauHighZSingleChipData.h"
 
 #include "multiThreadedAnalogDetector.h"
+#ifdef GAINSWITCH
+#include "jungfrauPhotonDetector.h"
+#else
 #include "singlePhotonDetector.h"
+#endif
 
 #include <fstream>
 #include <map>
@@ -21,6 +25,9 @@ int main(int argc, char *argv[]) {
 
     if (argc < 6) {
         cout << "Usage is " << argv[0] << "indir outdir fname runmin runmax "
+#ifdef GAINSWITCH
+             << "[gainmapG0 gainmapG1 gainmapG2] "
+#endif
              << endl;
         return 1;
     }
@@ -45,8 +52,18 @@ int main(int argc, char *argv[]) {
     cout << "nx " << nx << " ny " << ny << endl;
 
     // moench03T1ZmqData *decoder=new  moench03T1ZmqData();
+#ifdef GAINSWITCH
+    jungfrauPhotonDetector *filter =
+        new jungfrauPhotonDetector(decoder, csize, nsigma, nped, 200);
+    // gain maps in ADU/keV, nominal gains if not given
+    for (int ig = 0; ig < 3 && 6 + ig < argc; ig++) {
+        if (filter->readGainMap(ig, argv[6 + ig]))
+            cout << "Could not read gain map " << argv[6 + ig] << endl;
+    }
+#else
     singlePhotonDetector *filter =
         new singlePhotonDetector(decoder, csize, nsigma, 1, 0, nped, 200);
+#endif
     //  char tit[10000];
     cout << "filter " << endl;
 
@@ -9,6 +9,10 @@
 
 #include "sls/ZmqSocket.h"
 #include "sls/sls_detector_defs.h"
+#ifdef GAINSWITCH
+#include "jungfrauPhotonDetector.h"
+#include "jungfrauZmqData.h"
+#else
 #ifndef RECT
 #ifndef MOENCH04
 #include "moench03T1ZmqDataNew.h"
@@ -21,6 +25,7 @@
 #ifdef RECT
 #include "moench03T1ZmqDataNewRect.h"
 #endif
+#endif
 #include "moench03CommonMode.h"
 #include "moench03GhostSummation.h"
 #include "sls/tiffIO.h"
@@ -71,9 +76,16 @@ int main(int argc, char *argv[]) {
     int nSubPixelsY = 2;
     // help
     if (argc < 3) {
+#ifdef GAINSWITCH
+        cprintf(RED, "Help: ./trial [receive socket ip] [receive starting port "
+                     "number] [send_socket ip] [send starting port number] "
+                     "[nthreads] [nsubpix] [gainmapG0] [gainmapG1] "
+                     "[gainmapG2]\n");
+#else
         cprintf(RED, "Help: ./trial [receive socket ip] [receive starting port "
                      "number] [send_socket ip] [send starting port number] "
                      "[nthreads] [nsubpix] [gainmap]  [etafile]\n");
+#endif
         return EXIT_FAILURE;
     }
 
@@ -132,17 +144,23 @@ int main(int argc, char *argv[]) {
     }
 
     char *etafname = NULL;
+#ifndef GAINSWITCH
     if (argc > 8) {
         etafname = argv[8];
         cout << "Eta file name is: " << etafname << endl;
     }
+#endif
 
     // slsDetectorData *det=new moench03T1ZmqDataNew();
+#ifdef GAINSWITCH
+    jungfrauZmqData *det = new jungfrauZmqData();
+#else
 #ifndef MOENCH04
     moench03T1ZmqDataNew *det = new moench03T1ZmqDataNew();
 #endif
 #ifdef MOENCH04
     moench04CtbZmq10GbData *det = new moench04CtbZmq10GbData();
+#endif
 #endif
     cout << endl << " det" << endl;
     int npx, npy;
@@ -172,6 +190,7 @@ int main(int argc, char *argv[]) {
     double *gmap = NULL;
 
     uint32_t nnnx, nnny;
+#ifndef GAINSWITCH
     if (gainfname) {
         gm = ReadFromTiff(gainfname, nnny, nnnx);
         if (gm && nnnx == (uint)npx && nnny == (uint)npy) {
@@ -183,9 +202,23 @@ int main(int argc, char *argv[]) {
         } else
             cout << "Could not open gain map " << gainfname << endl;
     }
+#endif
 
     // analogDetector<uint16_t> *filter=new
     // analogDetector<uint16_t>(det,1,NULL,1000);
+#ifdef GAINSWITCH
+    // gain switching photon finder, energies in keV
+    jungfrauPhotonDetector *filter =
+        new jungfrauPhotonDetector(det, 3, nSigma, 1000, 100);
+    // gain maps in ADU/keV, nominal gains if not given
+    for (int ig = 0; ig < 3 && 7 + ig < argc; ig++) {
+        if (filter->readGainMap(ig, argv[7 + ig]))
+            cout << "Could not open gain map " << argv[7 + ig] << endl;
+    }
+
+    multiThreadedCountingDetector *mt =
+        new multiThreadedCountingDetector(filter, nthreads, fifosize);
+#else
 #ifndef INTERP
     singlePhotonDetector *filter = new singlePhotonDetector(
         det, 3, nSigma, 1, cm, 1000, 100, -1, -1, gainmap, gs);
@@ -207,6 +240,7 @@ int main(int argc, char *argv[]) {
         det, interp, nSigma, 1, cm, 1000, 10, -1, -1, gainmap, gs);
     multiThreadedInterpolatingDetector *mt =
         new multiThreadedInterpolatingDetector(filter, nthreads, fifosize);
+#endif
 #endif
 
     char *buff;
@@ -610,7 +644,7 @@ int main(int argc, char *argv[]) {
             continue; // continue to not get out
         }
 
-        //#ifdef NEWZMQ
+#ifdef NEWZMQ
         if (newFrame) {
             begin = std::chrono::steady_clock::now();
 
@@ -765,7 +799,7 @@ document["completeImage"].GetUint(); zHeader.completeImage
                     cprintf(MAGENTA, "Resetting flatfield\n");
                     fMode = eFlat;
                 }
-                //#endif
+#endif
                 else {
                     fMode = eFrame;
                     // isPedestal=0;
@@ -0,0 +1,645 @@
+// SPDX-License-Identifier: LGPL-3.0-or-other
+// Copyright (C) 2021 Contributors to the SLS Detector Package
+#ifndef JUNGFRAUPHOTONDETECTOR_H
+#define JUNGFRAUPHOTONDETECTOR_H
+
+#include "singlePhotonDetector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+/**
+   Photon finder for the Jungfrau gain switching detectors.
+
+   The frame is decoded once into ADC values and gain bits
+   (slsDetectorData::decodeFrame), then a single pass over the pixels
+   selects pedestal and gain of the pixel's gain stage without branches,
+   converts to keV and tracks the pedestal of that gain stage if the pixel is
+   below threshold. The clusters are found on the converted image: a
+   vectorized pass over each row keeps the cluster maxima above threshold,
+   only those are classified pixel by pixel.
+
+   Pedestals, their variances and the inverse gains are kept per gain stage
+   as flat float arrays, the number of pedestal samples as 16 bit. Rows of
+   G0 pixels with nped samples only touch the G0 pedestal, variance and
+   inverse gain, not the sample counts nor the G1 and G2 arrays. G1 and G2
+   pedestals can only be taken from dark frames with forced gain switching
+   (pedestal frame mode or the dark frames at the beginning of the data
+   set), every pixel adds to the pedestal of the gain it is in.
+
+   The cluster file stores integers, so the pixel values of the clusters are
+   written in eV. Cluster totals, energy range and threshold are in keV.
+   Common mode and ghost corrections are not applied.
+
+   A full module (1024x512) runs at about 480 frames/s per thread at 2 GHz
+   with AVX2 (4 ns per pixel, 580 frames/s with AVX-512, 350 frames/s with
+   SSE2), not 2 kHz: use the multiThreadedCountingDetector with several
+   threads for higher rates. Compile with -fno-trapping-math, otherwise gcc
+   vectorizes the pedestal update only with AVX-512.
+*/
+class jungfrauPhotonDetector : public singlePhotonDetector {
+
+  public:
+    /** gain stages, gain bits 00, 01 and 11 */
+    static const int NGAINS = 3;
+
+    /**
+       Constructor
+       \param d detector data structure, the gain bits must be returned by
+       getGain
+       \param csize cluster size (should be an odd number). Defaults to 3
+       \param nsigma number of rms to discriminate from the noise. Defaults
+       to 5
+       \param nped number of samples for pedestal averaging
+       \param nd number of dark frames to average as pedestals without photon
+       discrimination at the beginning of the measurement
+    */
+    jungfrauPhotonDetector(slsDetectorData<uint16_t> *d, int csize = 3,
+                           double nsigma = 5, int nped = 1000, int nd = 100)
+        : singlePhotonDetector(d, csize, nsigma, 1, NULL, nped, nd),
+          nPed(std::min(std::max(nped, 1), 65535)) {
+        init();
+        // to be replaced by the calibration
+        for (int ig = 0; ig < NGAINS; ++ig)
+            std::fill(invGain[ig].begin(), invGain[ig].end(),
+                      static_cast<float>(1. / nominalGain(ig)));
+        maskBadPixels();
+    };
+
+    /** copy constructor, the pedestals and gains of orig are copied */
+    jungfrauPhotonDetector(jungfrauPhotonDetector *orig)
+        : singlePhotonDetector(orig), nPed(orig->nPed) {
+        init();
+        for (int ig = 0; ig < NGAINS; ++ig) {
+            ped[ig] = orig->ped[ig];
+            var[ig] = orig->var[ig];
+            npedSamples[ig] = orig->npedSamples[ig];
+            invGain[ig] = orig->invGain[ig];
+        }
+        saturated = orig->saturated;
+    };
+
+    virtual jungfrauPhotonDetector *Clone() {
+        return new jungfrauPhotonDetector(this);
+    };
+
+    virtual void newDataSet() {
+        singlePhotonDetector::newDataSet();
+        for (int ig = 0; ig < NGAINS; ++ig) {
+            std::fill(ped[ig].begin(), ped[ig].end(), 0.f);
+            std::fill(var[ig].begin(), var[ig].end(), 0.f);
+            std::fill(npedSamples[ig].begin(), npedSamples[ig].end(), 0);
+        }
+        std::fill(saturated.begin(), saturated.end(), 0);
+    };
+
+    /**
+       sets the gain map of a gain stage
+       \param ig gain stage (0, 1 or 2)
+       \param gm gain of each pixel in ADU/keV (negative for G1 and G2),
+       pixels with gain 0 are masked
+       \returns 0 on success, 1 for a wrong gain stage
+    */
+    int setGainMap(int ig, const double *gm) {
+        if (ig < 0 || ig >= NGAINS || gm == NULL)
+            return 1;
+        for (int i = 0; i < nx * ny; ++i)
+            invGain[ig][i] = gm[i] == 0 ? 0.f : static_cast<float>(1. / gm[i]);
+        maskBadPixels();
+        return 0;
+    };
+
+    /**
+       reads the gain map of a gain stage from a 32 bit tiff file of the size
+       of the detector
+       \param ig gain stage (0, 1 or 2)
+       \param imgname complete name of the file containing the gain map
+       \returns 0 on success, 1 if the file could not be read or has the
+       wrong size
+    */
+    int readGainMap(int ig, const char *imgname) {
+        uint32_t nnx, nny;
+        float *gm = ReadFromTiff(imgname, nny, nnx);
+        if (gm == NULL)
+            return 1;
+        int ret = 1;
+        if (nnx == (uint32_t)nx && nny == (uint32_t)ny) {
+            std::vector<double> g(gm, gm + nx * ny);
+            ret = setGainMap(ig, &g[0]);
+        }
+        delete[] gm;
+        return ret;
+    };
+
+    /**
+       sets the pedestal of a gain stage
+       \param ig gain stage (0, 1 or 2)
+       \param p pedestal of each pixel in ADU
+       \param rms pedestal rms of each pixel in ADU, unchanged if NULL
+       \param m number of samples the pedestal is made of, nped if negative
+       \returns 0 on success, 1 for a wrong gain stage
+    */
+    int setGainPedestal(int ig, const double *p, const double *rms = NULL,
+                        int m = -1) {
+        if (ig < 0 || ig >= NGAINS || p == NULL)
+            return 1;
+        if (m < 0)
+            m = nPed;
+        for (int i = 0; i < nx * ny; ++i) {
+            ped[ig][i] = static_cast<float>(p[i]);
+            if (rms)
+                var[ig][i] = static_cast<float>(rms[i] * rms[i]);
+            npedSamples[ig][i] = static_cast<uint16_t>(std::min(m, nPed));
+        }
+        if (ig == 0)
+            std::fill(saturated.begin(), saturated.end(), 0);
+        return 0;
+    };
+
+    /**
+       gets the pedestal of a gain stage
+       \param ig gain stage (0, 1 or 2)
+       \param p array of nx*ny to fill, allocated if NULL
+       \param rms array of nx*ny to fill with the pedestal rms, if not NULL
+       \returns p, NULL for a wrong gain stage
+    */
+    double *getGainPedestal(int ig, double *p, double *rms = NULL) {
+        if (ig < 0 || ig >= NGAINS)
+            return NULL;
+        if (p == NULL)
+            p = new double[nx * ny];
+        for (int i = 0; i < nx * ny; ++i) {
+            p[i] = ped[ig][i];
+            if (rms)
+                rms[i] = std::sqrt(var[ig][i]);
+        }
+        return p;
+    };
+
+    /** G0 pedestal, for writePedestals and the multi threaded detectors */
+    virtual double *getPedestal(double *p) { return getGainPedestal(0, p); };
+
+    virtual double *getPedestalRMS(double *rms = NULL) {
+        if (rms == NULL)
+            rms = new double[nx * ny];
+        for (int i = 0; i < nx * ny; ++i)
+            rms[i] = std::sqrt(var[0][i]);
+        return rms;
+    };
+
+    virtual void setPedestal(double *p, double *rms = NULL, int m = -1) {
+        setGainPedestal(0, p, rms, m);
+    };
+
+    using singlePhotonDetector::addToPedestal;
+    using singlePhotonDetector::getPedestal;
+    using singlePhotonDetector::getPedestalRMS;
+    using singlePhotonDetector::setPedestal;
+
+    /** adds all pixels of the frame to the pedestal of their gain stage */
+    virtual void addToPedestal(char *data, int cm = 0) {
+        (void)cm;
+        analogDetector<uint16_t>::newFrame();
+        decode(data);
+        convert<false>(0, ny);
+    };
+
+    /**
+       converts the frame to keV and finds the clusters
+       \param data pointer to the data
+       \param nph image where the photons are added. If NULL, the internal
+       image is used
+       \returns pointer to the image
+    */
+    virtual int *getNPhotons(char *data, int *nph = NULL) {
+        if (nph == NULL)
+            nph = image;
+        if (iframe < nDark) {
+            addToPedestal(data);
+            return nph;
+        }
+        analogDetector<uint16_t>::newFrame();
+        decode(data);
+        // blocks of rows, so that the energies are still in cache when the
+        // clusters are searched (lagging by half the cluster size)
+        const int dy = clusterSizeY / 2;
+        int next = ymin;
+        int ncl = 0;
+        for (int iy0 = 0; iy0 < ny; iy0 += blockRows) {
+            int iy1 = std::min(iy0 + blockRows, ny);
+            convert<true>(iy0, iy1);
+            int last = iy1 == ny ? ymax : std::min(ymax, iy1 - dy);
+            for (; next < last; ++next)
+                findClusters(next, nph, ncl);
+        }
+        nphFrame = ncl;
+        nphTot += ncl;
+        writeClusters(det->getFrameNumber(data));
+        return nph;
+    };
+
+    /** in analog mode the energies are added to the image in eV */
+    virtual void processData(char *data, int *val = NULL) {
+        if (fMode == ePedestal) {
+            addToPedestal(data);
+        } else if (dMode == eAnalog) {
+            if (val == NULL)
+                val = image;
+            analogDetector<uint16_t>::newFrame();
+            decode(data);
+            convert<true>(0, ny);
+            for (int iy = ymin; iy < ymax; ++iy)
+                for (int ix = xmin; ix < xmax; ++ix)
+                    val[iy * nx + ix] +=
+                        static_cast<int>(1000.f * energy[iy * nx + ix]);
+        } else {
+            getNPhotons(data, val);
+        }
+        iframe++;
+    };
+
+    /** energies in keV of the last frame */
+    float *getEnergyFrame() { return &energy[0]; };
+
+    /** gain stage (0, 1 or 2) of each pixel in the last frame */
+    int getGainStage(int ix, int iy) {
+        return gainStage(gainBits[iy * nx + ix]);
+    };
+
+  private:
+    /** nominal gains in ADU/keV */
+    static double nominalGain(int ig) {
+        return ig == 0 ? 40. : (ig == 1 ? -1.5 : -0.1);
+    };
+
+    /** 00 -> G0, 01 -> G1, 11 -> G2 (and 10 -> G1) */
+    static int gainStage(int bits) { return (bits & 1) + ((bits >> 1) & 1); };
+
+    void init() {
+        const size_t n = nx * ny;
+        adc.assign(n, 0);
+        gainBits.assign(n, 0);
+        energy.assign(n, 0.f);
+        candidate.assign(n, 0);
+        saturated.assign(ny, 0);
+        blockRows = std::max(1, 16384 / std::max(1, nx));
+        for (int ig = 0; ig < NGAINS; ++ig) {
+            ped[ig].assign(n, 0.f);
+            var[ig].assign(n, 0.f);
+            npedSamples[ig].assign(n, 0);
+            invGain[ig].assign(n, 0.f);
+        }
+    };
+
+    /** bad pixels get a zero inverse gain, i.e. never have any energy */
+    void maskBadPixels() {
+        for (int iy = 0; iy < ny; ++iy)
+            for (int ix = 0; ix < nx; ++ix)
+                if (det->isGood(ix, iy) == 0)
+                    for (int ig = 0; ig < NGAINS; ++ig)
+                        invGain[ig][iy * nx + ix] = 0.f;
+    };
+
+    void decode(char *data) { det->decodeFrame(data, &adc[0], &gainBits[0]); };
+
+    /**
+       converts rows of the frame to keV and updates the pedestals
+       \param threshold if false every pixel is added to the pedestal (dark
+       frames), otherwise only pixels below threshold and the photon
+       candidates are marked
+       \param iy0 first row
+       \param iy1 last row (excluded)
+    */
+    template <bool threshold> void convert(int iy0, int iy1) {
+        // pedestal if |E| < nsigma * rms, or below the fixed threshold
+        const float k2 = thr > 0 ? 0.f : static_cast<float>(nSigma * nSigma);
+        const float t2 = thr > 0 ? static_cast<float>(thr * thr) : 0.f;
+        // a photon maximum is at least the cluster (or quadrant) threshold
+        // shared over its pixels
+        const float pre = static_cast<float>(std::min(
+            1., std::min(c3 / (clusterSize * clusterSizeY),
+                         c2 / ((clusterSize / 2 + 1) *
+                               (clusterSizeY / 2 + 1)))));
+        const float nmax = static_cast<float>(nPed);
+        // chunks without switched pixels do not touch the G1 and G2 arrays,
+        // nor the number of samples of the G0 pedestals once it reached nped
+        const int chunk = 256;
+        for (int iy = iy0; iy < iy1; ++iy) {
+            const bool sat = threshold && saturated[iy];
+            for (int i = iy * nx; i < (iy + 1) * nx; i += chunk) {
+                const int n = std::min(chunk, (iy + 1) * nx - i);
+                uint8_t bits = 0;
+                for (int j = i; j < i + n; ++j)
+                    bits |= gainBits[j];
+                if (sat && bits == 0)
+                    convertG0(n, 1.f / nmax, k2, t2, pre * pre, &adc[i],
+                              &ped[0][i], &var[0][i], &invGain[0][i],
+                              &energy[i], &candidate[i]);
+                else if (threshold && bits == 0)
+                    convertPixels<threshold, false>(
+                        n, nmax, k2, t2, pre * pre, &adc[i], &gainBits[i],
+                        &ped[0][i], &ped[1][i], &ped[2][i], &var[0][i],
+                        &var[1][i], &var[2][i], &npedSamples[0][i],
+                        &npedSamples[1][i], &npedSamples[2][i],
+                        &invGain[0][i], &invGain[1][i], &invGain[2][i],
+                        &energy[i], &candidate[i]);
+                else
+                    convertPixels<threshold, true>(
+                        n, nmax, k2, t2, pre * pre, &adc[i], &gainBits[i],
+                        &ped[0][i], &ped[1][i], &ped[2][i], &var[0][i],
+                        &var[1][i], &var[2][i], &npedSamples[0][i],
+                        &npedSamples[1][i], &npedSamples[2][i],
+                        &invGain[0][i], &invGain[1][i], &invGain[2][i],
+                        &energy[i], &candidate[i]);
+            }
+            if (!sat)
+                saturated[iy] =
+                    *std::min_element(&npedSamples[0][iy * nx],
+                                      &npedSamples[0][iy * nx] + nx) == nPed;
+        }
+    };
+
+    /**
+       the pixel loop of convert, without branches and with non aliased
+       arrays so that it is vectorized (not inlined, gcc drops the restrict
+       of inlined parameters)
+       \param switched false if all pixels are in G0
+    */
+    template <bool threshold, bool switched>
+    __attribute__((noinline)) static void
+    convertPixels(const int n, const float nmax, const float k2,
+                  const float t2, const float pre2,
+                  const uint16_t *__restrict x, const uint8_t *__restrict gb,
+                  float *__restrict p0, float *__restrict p1,
+                  float *__restrict p2, float *__restrict v0,
+                  float *__restrict v1, float *__restrict v2,
+                  uint16_t *__restrict n0, uint16_t *__restrict n1,
+                  uint16_t *__restrict n2, const float *__restrict i0,
+                  const float *__restrict i1, const float *__restrict i2,
+                  float *__restrict e, uint8_t *__restrict cand) {
+        for (int i = 0; i < n; ++i) {
+            const int g = switched ? gainStage(gb[i]) : 0;
+            const bool is0 = g == 0, is1 = g == 1, is2 = g == 2;
+            // all gain stages are loaded, the selects become blends
+            const float pa = p0[i];
+            const float pb = switched ? p1[i] : 0.f;
+            const float pc = switched ? p2[i] : 0.f;
+            const float va = v0[i];
+            const float p = is0 ? pa : (is1 ? pb : pc);
+            const float ig =
+                switched ? (is0 ? i0[i] : (is1 ? i1[i] : i2[i])) : i0[i];
+
+            const float d = static_cast<float>(x[i]) - p;
+            const float en = d * ig;
+            e[i] = en;
+
+            // moving average and variance as in pedestalSubtraction
+            if (threshold) {
+                // a pixel switched to G1 or G2 is never below threshold (so
+                // only the G0 arrays are written) and always a candidate
+                const float noise2 = is0 ? k2 * va * ig * ig + t2 : 0.f;
+                const float na = n0[i];
+                const bool add = is0 & (na > 0) & (en * en < noise2);
+                cand[i] = (en > 0) & (en * en > pre2 * noise2);
+                const float a =
+                    add ? 1.f / (std::min(na, nmax - 1) + 1) : 0.f;
+                p0[i] = pa + a * d;
+                v0[i] = (1.f - a) * (va + a * d * d);
+                n0[i] = static_cast<uint16_t>(
+                    std::min(na + (add ? 1.f : 0.f), nmax));
+            } else {
+                const float vb = v1[i], vc = v2[i];
+                const float v = is0 ? va : (is1 ? vb : vc);
+                const float na = n0[i], nb = n1[i], nc = n2[i];
+                const float np = is0 ? na : (is1 ? nb : nc);
+                const float a = 1.f / (std::min(np, nmax - 1) + 1);
+                const float pn = p + a * d;
+                const float vn = (1.f - a) * (v + a * d * d);
+                const float nn = std::min(np + 1, nmax);
+                p0[i] = is0 ? pn : pa;
+                p1[i] = is1 ? pn : pb;
+                p2[i] = is2 ? pn : pc;
+                v0[i] = is0 ? vn : va;
+                v1[i] = is1 ? vn : vb;
+                v2[i] = is2 ? vn : vc;
+                n0[i] = static_cast<uint16_t>(is0 ? nn : na);
+                n1[i] = static_cast<uint16_t>(is1 ? nn : nb);
+                n2[i] = static_cast<uint16_t>(is2 ? nn : nc);
+            }
+        }
+    };
+
+    /**
+       convertPixels for pixels in G0 with nped samples in their pedestal:
+       only the G0 pedestal, variance and gain are read
+       \param a weight of a new sample in the moving average (1 / nped)
+    */
+    __attribute__((noinline)) static void
+    convertG0(const int n, const float a, const float k2, const float t2,
+              const float pre2, const uint16_t *__restrict x,
+              float *__restrict p0, float *__restrict v0,
+              const float *__restrict i0, float *__restrict e,
+              uint8_t *__restrict cand) {
+        for (int i = 0; i < n; ++i) {
+            const float p = p0[i], v = v0[i], ig = i0[i];
+            const float d = static_cast<float>(x[i]) - p;
+            const float en = d * ig;
+            e[i] = en;
+            const float noise2 = k2 * v * ig * ig + t2;
+            cand[i] = (en > 0) & (en * en > pre2 * noise2);
+            const float w = en * en < noise2 ? a : 0.f;
+            p0[i] = p + w * d;
+            v0[i] = (1.f - w) * (v + w * d * d);
+        }
+    };
+
+    /** noise of the pixel in keV in the gain stage of the last frame */
+    double noise(int i) {
+        const int g = gainStage(gainBits[i]);
+        return std::sqrt(var[g][i]) * std::fabs(invGain[g][i]);
+    };
+
+    /** no pixel of the cluster around ix, iy has a larger energy */
+    bool isMaximum(int ix, int iy) {
+        const int dx = clusterSize / 2, dy = clusterSizeY / 2;
+        const int c0 = std::max(-dx, -ix), c1 = std::min(dx, nx - 1 - ix);
+        const float *e = &energy[iy * nx + ix];
+        const float v0 = *e;
+        for (int ir = std::max(-dy, -iy); ir <= std::min(dy, ny - 1 - iy);
+             ir++)
+            for (int ic = c0; ic <= c1; ic++)
+                if (e[ir * nx + ic] > v0)
+                    return false;
+        return true;
+    };
+
+    /**
+       clears the candidates of a row which are not a maximum or not a
+       photon for sure, for all the pixels of the row at once so that it is
+       vectorized. Only the 3x3 and 5x5 clusters and not the pixels at the
+       border, where the cluster is cut, which stay candidates
+    */
+    void rejectNoise(int iy) {
+        const int dx = clusterSize / 2, dy = clusterSizeY / 2;
+        if (iy < dy || iy >= ny - dy)
+            return;
+        const int x0 = std::max(xmin, dx), x1 = std::min(xmax, nx - dx);
+        if (x1 <= x0)
+            return;
+        const int i = iy * nx + x0;
+        // 0.1% margin for the rounding of the sums in float
+        const float k2 = thr > 0 ? 0.f : static_cast<float>(nSigma * nSigma);
+        const float t2 = thr > 0 ? static_cast<float>(thr * thr) : 0.f;
+        const float m = 0.998f;
+        const float m2 = static_cast<float>(m * c2 * c2);
+        const float m3 = static_cast<float>(m * c3 * c3);
+        if (dx == 1 && dy == 1)
+            keepPhotons<1, 1>(x1 - x0, nx, k2, t2, m, m2, m3, &energy[i],
+                              &var[0][i], &invGain[0][i], &gainBits[i],
+                              &candidate[i]);
+        else if (dx == 2 && dy == 2)
+            keepPhotons<2, 2>(x1 - x0, nx, k2, t2, m, m2, m3, &energy[i],
+                              &var[0][i], &invGain[0][i], &gainBits[i],
+                              &candidate[i]);
+    };
+
+    /**
+       the pixel loop of rejectNoise, on squares. Pixels switched to G1 or
+       G2 are kept if they are a maximum, their noise is in an other gain
+       stage
+       \param m1 margin for the pixel, m2 and m3 including c2 and c3 squared
+    */
+    template <int DX, int DY>
+    __attribute__((noinline)) static void
+    keepPhotons(const int n, const int nx, const float k2, const float t2,
+                const float m1, const float m2, const float m3,
+                const float *__restrict e, const float *__restrict v,
+                const float *__restrict ig, const uint8_t *__restrict gb,
+                uint8_t *__restrict cand) {
+        for (int i = 0; i < n; ++i) {
+            const float v0 = e[i];
+            float top = v0, tot = 0, bl = 0, br = 0, tl = 0, tr = 0;
+            // column by column, lower and upper half of the cluster
+#pragma GCC unroll 8
+            for (int ic = -DX; ic <= DX; ic++) {
+                const float *c = e + i + ic;
+                float low = c[0], high = c[0];
+                top = std::max(top, c[0]);
+#pragma GCC unroll 8
+                for (int ir = 1; ir <= DY; ir++) {
+                    low += c[-ir * nx];
+                    high += c[ir * nx];
+                    top = std::max(top, std::max(c[-ir * nx], c[ir * nx]));
+                }
+                tot += low + high - c[0];
+                bl += ic <= 0 ? low : 0.f;
+                tl += ic <= 0 ? high : 0.f;
+                br += ic >= 0 ? low : 0.f;
+                tr += ic >= 0 ? high : 0.f;
+            }
+            const bool maximum = !(top > v0);
+            const float q = std::max(std::max(bl, br), std::max(tl, tr));
+            const float noise2 = k2 * v[i] * ig[i] * ig[i] + t2;
+            // x > c * t, with t = sqrt(noise2)
+            const bool photon = ((v0 > 0) & (v0 * v0 > m1 * noise2)) |
+                                ((tot > 0) & (tot * tot > m3 * noise2)) |
+                                ((q > 0) & (q * q > m2 * noise2));
+            cand[i] &= maximum & (photon | (gb[i] != 0));
+        }
+    };
+
+    /** same event classification as singlePhotonDetector, on the energies
+     * of the candidates only */
+    void findClusters(int iy, int *nph, int &ncl) {
+        const int dx = clusterSize / 2, dy = clusterSizeY / 2;
+        rejectNoise(iy);
+        const uint8_t *cand = &candidate[iy * nx];
+        for (int ix = xmin; ix < xmax; ++ix) {
+            // skip 8 pixels without candidates at once
+            uint64_t word;
+            if (ix + 8 <= xmax &&
+                (std::memcpy(&word, cand + ix, 8), word == 0)) {
+                ix += 7;
+                continue;
+            }
+            if (cand[ix] == 0 || !isMaximum(ix, iy))
+                continue;
+            const double v0 = energy[iy * nx + ix];
+            const double t = thr > 0 ? static_cast<double>(thr)
+                                     : nSigma * noise(iy * nx + ix);
+            double tl = 0, tr = 0, bl = 0, br = 0;
+            tot = 0;
+            for (int ir = -dy; ir <= dy; ir++) {
+                if (iy + ir < 0 || iy + ir >= ny)
+                    continue;
+                const float *e = &energy[(iy + ir) * nx];
+                for (int ic = -dx; ic <= dx; ic++) {
+                    if (ix + ic < 0 || ix + ic >= nx)
+                        continue;
+                    double v = e[ix + ic];
+                    tot += v;
+                    if (ir <= 0 && ic <= 0)
+                        bl += v;
+                    if (ir <= 0 && ic >= 0)
+                        br += v;
+                    if (ir >= 0 && ic <= 0)
+                        tl += v;
+                    if (ir >= 0 && ic >= 0)
+                        tr += v;
+                }
+            }
+            quad = BOTTOM_RIGHT;
+            quadTot = br;
+            if (bl >= quadTot) {
+                quad = BOTTOM_LEFT;
+                quadTot = bl;
+            }
+            if (tl >= quadTot) {
+                quad = TOP_LEFT;
+                quadTot = tl;
+            }
+            if (tr >= quadTot) {
+                quad = TOP_RIGHT;
+                quadTot = tr;
+            }
+            if (v0 <= t && tot <= c3 * t && quadTot <= c2 * t)
+                continue;
+            if ((eMin > 0 && tot < eMin) || (eMax > 0 && tot > eMax))
+                continue;
+
+            single_photon_hit *cl = clusters + ncl;
+            cl->tot = tot;
+            cl->x = ix;
+            cl->y = iy;
+            cl->quad = quad;
+            cl->quadTot = quadTot;
+            for (int ir = -dy; ir <= dy; ir++)
+                for (int ic = -dx; ic <= dx; ic++)
+                    if (iy + ir >= 0 && iy + ir < ny && ix + ic >= 0 &&
+                        ix + ic < nx)
+                        cl->set_data(1000. * energy[(iy + ir) * nx + ix + ic],
+                                     ic, ir);
+                    else
+                        cl->set_data(0, ic, ir);
+            ncl++;
+            nph[iy * nx + ix]++;
+        }
+    };
+
+    int nPed;
+    std::vector<uint16_t> adc;    /**< decoded ADC values */
+    std::vector<uint8_t> gainBits; /**< decoded gain bits */
+    std::vector<float> energy;     /**< converted frame in keV */
+    std::vector<uint8_t> candidate; /**< possible photon maxima */
+    std::vector<float> ped[NGAINS];
+    std::vector<float> var[NGAINS];
+    std::vector<uint16_t> npedSamples[NGAINS]; /**< at most 65535 */
+    /** rows of which all G0 pedestals have nped samples */
+    std::vector<uint8_t> saturated;
+    std::vector<float> invGain[NGAINS]; /**< keV/ADU, 0 for masked pixels */
+    int blockRows;
+};
+
+#endif
@@ -40,6 +40,8 @@ class commonModeSubtractionColumn : public commonModeSubtraction {
         return new commonModeSubtractionColumn(this->rows);
     }
 
+    int getRows() { return rows; };
+
   private:
     int rows;
 };
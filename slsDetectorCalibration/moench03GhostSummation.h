@@ -5,32 +5,27 @@
 
 #include "ghostSummation.h"
 
-class moench03GhostSummation : public ghostSummation<uint16_t> {
+class moench03GhostSummation : public supercolumnGhostSummation<uint16_t> {
 
-    /** @short virtual calss to handle ghosting*/
+    /** @short ghosting of the 16 supercolumns of 25 pixels, the two halves
+     * being read out together */
 
   public:
     /** constructor
         \param xt crosstalk
     */
     moench03GhostSummation(slsDetectorData<uint16_t> *d, double xt = 0.0004)
-        : ghostSummation<uint16_t>(d, xt) {}
-
-    virtual void calcGhost(char *data) {
-        for (int iy = 0; iy < 200; iy++) {
-            for (int ix = 0; ix < 25; ix++) {
-                calcGhost(data, ix, iy);
-            }
-        }
-    };
+        : supercolumnGhostSummation<uint16_t>(d, xt, 25, 16, 400) {}
 
     moench03GhostSummation(moench03GhostSummation *orig)
-        : ghostSummation(orig) {}
+        : supercolumnGhostSummation<uint16_t>(orig) {}
 
     virtual moench03GhostSummation *Clone() {
         return new moench03GhostSummation(this);
     }
 
+    using supercolumnGhostSummation<uint16_t>::calcGhost;
+
     virtual double calcGhost(char *data, int x, int y = 0) {
         int ix = x % 25;
         int iy = y;
@@ -51,14 +46,6 @@ class moench03GhostSummation : public ghostSummation<uint16_t> {
         // endl;
         return ghost[iy * nx + ix];
     };
-
-    virtual double getGhost(int ix, int iy) {
-        if (iy >= 0 && iy < 200)
-            return ghost[iy * nx + (ix % 25)];
-        if (iy < 400)
-            return ghost[(399 - iy) * nx + (ix % 25)];
-        return 0;
-    };
 };
 
 #endif
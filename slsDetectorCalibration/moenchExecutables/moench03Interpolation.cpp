@@ -2,6 +2,7 @@
 // Copyright (C) 2021 Contributors to the SLS Detector Package
 
 #include "sls/ansi.h"
+#include <chrono>
 #include <iostream>
 
 //#include "moench03T1ZmqData.h"
@@ -14,6 +15,7 @@
 
 #ifndef DOUBLE_SPH
 #include "single_photon_hit.h"
+#include "clusterFile.h"
 #endif
 
 //#include "etaInterpolationPosXY.h"
@@ -27,6 +29,15 @@ using namespace std;
 #define MAX_ITERATIONS (nSubPixels * 100)
 
 #define XTALK
+#define NBATCH 4096 /**< clusters read and interpolated together */
+
+/** reads up to n clusters from the file, returns the number of clusters read */
+template <class sph> int readClusters(FILE *f, sph *cl, int n) {
+    int ic = 0;
+    while (ic < n && cl[ic].read(f))
+        ic++;
+    return ic;
+}
 
 int main(int argc, char *argv[]) {
 
@@ -74,9 +85,14 @@ int main(int argc, char *argv[]) {
     double etamin = -1, etamax = 2;
     // double etamin=-0.1, etamax=1.1;
     //   double eta3min = -2, eta3max = 2;
-    double sum, totquad;
+    double *sum = new double[NBATCH];
+    double *totquad = new double[NBATCH];
+    double *etax = new double[NBATCH];
+    double *etay = new double[NBATCH];
+    int *quad = new int[NBATCH];
+#ifdef DOUBLE_SPH
     double sDum[2][2];
-    double etax, etay;
+#endif
     // double eta3x, eta3y, int3_x, int3_y, noint_x, noint_y;
    
     int ix, iy, isx, isy;
@@ -85,15 +101,24 @@ int main(int argc, char *argv[]) {
     int nph = 0, totph = 0;
     //badph = 0, 
     FILE *f = NULL;
+    int columnar = 0;
+    int nb, ih;
 
 #ifdef DOUBLE_SPH
-    single_photon_hit_double cl(3, 3);
+    single_photon_hit_double *cl = new single_photon_hit_double[NBATCH];
 #endif
 
 #ifndef DOUBLE_SPH
-    single_photon_hit cl(3, 3);
+    clusterFile cfile;
+    single_photon_hit *cl = new single_photon_hit[NBATCH];
 #endif
 
+    // benchmark of the eta calculation and interpolation
+    long long nhits = 0;
+    std::chrono::steady_clock::time_point t0,
+        tstart = std::chrono::steady_clock::now();
+    std::chrono::duration<double> tinterp(0);
+
     //int f0 = -1;
     //  int nSubPixels = nsubpix;
 #ifndef NOINTERPOLATION
@@ -108,16 +133,20 @@ int main(int argc, char *argv[]) {
 #endif
 
 #ifndef FF
-    int quad; 
+    double *int_x = new double[NBATCH];
+    double *int_y = new double[NBATCH];
 #ifndef NOINTERPOLATION
     char fname[10000];
     int ok;
-    double int_x, int_y;
     int *img;
-    cout << "read ff " << argv[2] << endl;
     sprintf(fname, "%s", argv[2]);
-    interp->readFlatField(fname);
-    interp->prepareInterpolation(ok); //, MAX_ITERATIONS);
+    if (interp->readInterpolationTable(fname)) {
+        cout << "read interpolation table " << argv[2] << endl;
+    } else {
+        cout << "read ff " << argv[2] << endl;
+        interp->readFlatField(fname);
+        interp->prepareInterpolation(ok); //, MAX_ITERATIONS);
+    }
 #endif
     // return 0;
 #endif
@@ -148,90 +177,95 @@ int main(int argc, char *argv[]) {
         sprintf(outfname, argv[3], irun);
 #endif
 
-        f = fopen(infname, "r");
+        // columnar cluster files are read in blocks
+#ifndef DOUBLE_SPH
+        columnar = clusterFile::isClusterFile(infname);
+#endif
+        f = columnar ? NULL : fopen(infname, "r");
+#ifdef DOUBLE_SPH
         if (f) {
+#endif
+#ifndef DOUBLE_SPH
+        if (f || (columnar && cfile.openRead(infname))) {
+#endif
             cout << infname << endl;
             nframes = 0;
             //f0 = -1;
 
-            while (cl.read(f)) {
-                totph++;
-                if (lastframe != cl.iframe) {
-                    lastframe = cl.iframe;
-                    // cout << cl.iframe << endl;
-                    // f0=cl.iframe;
-                    // if (nframes == 0)
-                    //     f0 = lastframe;
-                    nframes++;
-                }
-                // quad=interp->calcQuad(cl.get_cluster(), sum, totquad, sDum);
+#ifdef DOUBLE_SPH
+            // double clusters are interpolated one by one
+            while ((nb = readClusters(f, cl, NBATCH)) > 0) {
+                t0 = std::chrono::steady_clock::now();
+                for (ih = 0; ih < nb; ih++) {
+                    quad[ih] = interp->calcEta(cl[ih].get_cluster(), etax[ih],
+                                               etay[ih], sum[ih], totquad[ih],
+                                               sDum);
 #ifndef FF
-                quad = interp->calcEta(cl.get_cluster(), etax, etay, sum,
-                                       totquad, sDum);
+                    interp->getInterpolatedPosition(cl[ih].x, cl[ih].y,
+                                                    etax[ih], etay[ih],
+                                                    quad[ih], int_x[ih],
+                                                    int_y[ih]);
 #endif
-#ifdef FF
-                interp->calcEta(cl.get_cluster(), etax, etay, sum,
-                                       totquad, sDum);
-#endif
-
-      if (sum > cmin && totquad / sum > 0.8 && totquad / sum < 1.2 &&
-                    sum < cmax) {
-                    nph++;
-                    //  if (sum>200 && sum<580) {
-                    //  interp->getInterpolatedPosition(cl.x,cl.y,
-                    //  totquad,quad,cl.get_cluster(),int_x, int_y);
-// #ifdef SOLEIL
-// 	    if (cl.x>210 && cl.x<240 && cl.y>210 && cl.y<240) {
-// #endif
+                }
+#endif
+#ifndef DOUBLE_SPH
+            while ((nb = columnar ? cfile.readClusters(cl, NBATCH)
+                                  : readClusters(f, cl, NBATCH)) > 0) {
+                t0 = std::chrono::steady_clock::now();
+                interp->calcEta(nb, cl, etax, etay, sum, totquad, quad);
 #ifndef FF
-                    // interp->getInterpolatedPosition(cl.x,cl.y,
-                    // cl.get_cluster(),int_x, int_y);
-                    interp->getInterpolatedPosition(cl.x, cl.y, etax, etay,
-                                                    quad, int_x, int_y);
-                    // cout <<"**************"<< endl;
-                    // cout << cl.x << " " << cl.y << " " << sum << endl;
-                    // cl.print();
-                    // cout << int_x << " " << int_y << endl;
-                    // cout <<"**************"<< endl;
-                    //  if (etax!=0 && etay!=0 && etax!=1 && etay!=1)
-                    interp->addToImage(int_x, int_y);
-                    if (int_x < 0 || int_y < 0 || int_x > 400 || int_y > 400) {
-                        cout << "**************" << endl;
-                        cout << cl.x << " " << cl.y << " " << sum << endl;
-                        cl.print();
-                        cout << int_x << " " << int_y << endl;
-                        cout << "**************" << endl;
+                interp->getInterpolatedPositions(nb, cl, etax, etay, quad,
+                                                 int_x, int_y);
+#endif
+#endif
+                tinterp += std::chrono::steady_clock::now() - t0;
+                nhits += nb;
+
+                for (ih = 0; ih < nb; ih++) {
+                    totph++;
+                    if (lastframe != cl[ih].iframe) {
+                        lastframe = cl[ih].iframe;
+                        nframes++;
                     }
+
+                    if (sum[ih] > cmin && totquad[ih] / sum[ih] > 0.8 &&
+                        totquad[ih] / sum[ih] < 1.2 && sum[ih] < cmax) {
+                        nph++;
+#ifndef FF
+                        interp->addToImage(int_x[ih], int_y[ih]);
+                        if (int_x[ih] < 0 || int_y[ih] < 0 || int_x[ih] > 400 ||
+                            int_y[ih] > 400) {
+                            cout << "**************" << endl;
+                            cout << cl[ih].x << " " << cl[ih].y << " "
+                                 << sum[ih] << endl;
+                            cl[ih].print();
+                            cout << int_x[ih] << " " << int_y[ih] << endl;
+                            cout << "**************" << endl;
+                        }
 #endif
 #ifdef FF
-                    //	interp->addToFlatField(cl.get_cluster(), etax, etay);
-                    // #ifdef UCL
-                    // 	    if (cl.x>50)
-                    // #endif
-                    // 	    if (etax!=0 && etay!=0 && etax!=1 && etay!=1)
-                    interp->addToFlatFieldDistribution(etax, etay);
-                    //  if (etax==0 || etay==0) cout << cl.x << " " << cl.y <<
-                    //  endl;
-
-#endif
-                    // #ifdef SOLEIL
-                    // 	    }
-                    // #endif
-
-                    if (nph % 1000000 == 0)
-                        cout << nph << endl;
-                    if (nph % 10000000 == 0) {
+                        interp->addToFlatFieldDistribution(etax[ih], etay[ih]);
+#endif
+
+                        if (nph % 1000000 == 0)
+                            cout << nph << endl;
+                        if (nph % 10000000 == 0) {
 #ifndef FF
-                        interp->writeInterpolatedImage(outfname);
+                            interp->writeInterpolatedImage(outfname);
 #endif
 #ifdef FF
-                        interp->writeFlatField(outfname);
+                            interp->writeFlatField(outfname);
 #endif
+                        }
                     }
                 }
             }
 
-            fclose(f);
+            if (f)
+                fclose(f);
+#ifndef DOUBLE_SPH
+            cfile.close();
+#endif
 #ifdef FF
             interp->writeFlatField(outfname);
 #endif
@@ -271,5 +305,24 @@ int main(int argc, char *argv[]) {
 #endif
 
     cout << "Filled " << nph << " (/" << totph << ") " << endl;
+
+    double ttot = std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - tstart)
+                      .count();
+    if (tinterp.count() > 0 && ttot > 0)
+        cout << "Interpolated " << nhits << " hits in " << tinterp.count()
+             << " s: " << nhits / tinterp.count() << " hits/s/core ("
+             << nhits / ttot << " hits/s including I/O)" << endl;
+
+    delete[] cl;
+    delete[] sum;
+    delete[] totquad;
+    delete[] etax;
+    delete[] etay;
+    delete[] quad;
+#ifndef FF
+    delete[] int_x;
+    delete[] int_y;
+#endif
     return 0;
 }
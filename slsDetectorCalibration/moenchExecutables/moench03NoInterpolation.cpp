@@ -2,6 +2,7 @@
 // Copyright (C) 2021 Contributors to the SLS Detector Package
 
 #include "sls/ansi.h"
+#include <chrono>
 #include <iostream>
 
 #include "single_photon_hit.h"
@@ -43,6 +44,11 @@ int main(int argc, char *argv[]) {
     FILE *f = NULL;
 
     single_photon_hit cl(3, 3);
+
+    // benchmark of the cluster processing, file reading included
+    long long nhits = 0;
+    std::chrono::steady_clock::time_point tstart =
+        std::chrono::steady_clock::now();
     // etaInterpolationPosXY *interp=new etaInterpolationPosXY(NC, NR, nsubpix,
     // etabins, etamin, etamax);
     noInterpolation *interp = new noInterpolation(NC, NR, nsubpix);
@@ -77,6 +83,7 @@ int main(int argc, char *argv[]) {
 
         if (f) {
             while (cl.read(f)) {
+                nhits++;
                 quad = interp->calcQuad(cl.get_cluster(), sum, totquad, sDum);
                 if (sum > 200 && sum < 580) {
                     interp->getInterpolatedPosition(cl.x, cl.y, totquad, quad,
@@ -169,6 +176,13 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    double ttot = std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - tstart)
+                      .count();
+    if (ttot > 0)
+        cout << "Processed " << nhits << " hits in " << ttot
+             << " s: " << nhits / ttot << " hits/s/core" << endl;
+
     sprintf(outfname, argv[3], 11111);
     WriteToTiff(totimg, outfname, NC * nsubpix, NR * nsubpix);
 
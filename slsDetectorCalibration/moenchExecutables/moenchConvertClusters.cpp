@@ -0,0 +1,31 @@
+// SPDX-License-Identifier: LGPL-3.0-or-other
+// Copyright (C) 2021 Contributors to the SLS Detector Package
+#include "clusterFile.h"
+
+#include <cstdlib>
+#include <iostream>
+
+using namespace std;
+
+/** converts cluster files written frame by frame to columnar cluster files */
+int main(int argc, char *argv[]) {
+
+    if (argc < 3) {
+        cout << "Usage is " << argv[0]
+             << " infile outfile [csize] [bytes per value (2 or 4)]" << endl;
+        return 1;
+    }
+    int csize = 3;
+    int ds = 4;
+    if (argc > 3)
+        csize = atoi(argv[3]);
+    if (argc > 4)
+        ds = atoi(argv[4]);
+
+    long long nph = clusterFile::convert(argv[1], argv[2], csize, csize, ds);
+    if (nph < 0)
+        return 1;
+    cout << "Converted " << nph << " clusters from " << argv[1] << " to "
+         << argv[2] << endl;
+    return 0;
+}
@@ -29,6 +29,10 @@
 #include "moench03CommonMode.h"
 #include "moench03GhostSummation.h"
 #include "singlePhotonDetector.h"
+#include "mmapFrameSource.h"
+#ifdef FUSED
+#include "fusedPhotonDetector.h"
+#endif
 
 #include <fstream>
 #include <map>
@@ -91,7 +95,9 @@ int main(int argc, char *argv[]) {
     int ff, np, fnum;
     // cout << " data size is " << dsize;
 
-    ifstream filebin;
+    // raw files are memory mapped, frames are pushed to the threads without
+    // copying them
+    mmapFrameSource filebin;
     char *indir = argv[1];
     char *outdir = argv[2];
     char *fformat = argv[3];
@@ -147,6 +153,10 @@ int main(int argc, char *argv[]) {
     std::time_t end_time;
 
     FILE *of = NULL;
+#ifdef CLUSTERFILE
+    // columnar cluster file, written in blocks with a frame index
+    clusterFile cfile;
+#endif
     cout << "input directory is " << indir << endl;
     cout << "output directory is " << outdir << endl;
     cout << "input file is " << fformat << endl;
@@ -168,8 +178,21 @@ int main(int argc, char *argv[]) {
     gs = new moench03GhostSummation(decoder, xt_ghost);
 #endif
 
+#ifdef FUSED
+#ifdef CORR
+    singlePhotonDetector *filter =
+        new fusedPhotonDetector<denseDecoder<uint16_t>,
+                                moench03ColumnCommonMode, moench03Ghost>(
+            decoder, csize, nsigma, 1, cm, nped, 200, -1, -1, gainmap, gs);
+#else
+    singlePhotonDetector *filter =
+        new fusedPhotonDetector<denseDecoder<uint16_t>, noCommonMode, noGhost>(
+            decoder, csize, nsigma, 1, cm, nped, 200, -1, -1, gainmap, NULL);
+#endif
+#else
     singlePhotonDetector *filter = new singlePhotonDetector(
         decoder, csize, nsigma, 1, cm, nped, 200, -1, -1, gainmap, gs);
+#endif
 
     if (gainfname) {
 
@@ -194,7 +217,7 @@ int main(int argc, char *argv[]) {
     std::time(&end_time);
     cout << std::ctime(&end_time) << endl;
 
-    char *buff;
+    char *frame;
 
     // multiThreadedAnalogDetector *mt=new
     // multiThreadedAnalogDetector(filter,nthreads,fifosize);
@@ -219,8 +242,11 @@ int main(int argc, char *argv[]) {
     //#endif
     //  }
 
+    // images are written in the background while the next file is processed
+    ImageWriter writer;
+    mt->setImageWriter(&writer);
+
     mt->StartThreads();
-    mt->popFree(buff);
 
     //  cout << "mt " << endl;
 
@@ -241,18 +267,18 @@ int main(int argc, char *argv[]) {
 
             mt->setFrameMode(ePedestal);
             // sprintf(fn,fformat,irun);
-            filebin.open((const char *)(fname), ios::in | ios::binary);
+            filebin.open((const char *)(fname));
             //      //open file
-            if (filebin.is_open()) {
+            if (filebin.isOpen()) {
                 ff = -1;
-                while (decoder->readNextFrame(filebin, ff, np, buff)) {
+                while ((frame = filebin.nextFrame(decoder->getDataSize(), ff, np))) {
 		  fnum=ff;
 		  if (fnum % 100 == 1)
-		    cout << "**" << ifr << " " << fnum << " " << decoder->getValue(buff,20,20) << endl;
+		    cout << "**" << ifr << " " << fnum << " " << decoder->getValue(frame,20,20) << endl;
                     if (np == 40) {
-                        mt->pushData(buff);
+                        // the frame points to the mapped file
+                        mt->pushBorrowedData(frame);
                         mt->nextThread();
-                        mt->popFree(buff);
                         ifr++;
                         if (ifr % 100 == 0)
 			  cout << "++" << ifr << " " << ff << " " << np << endl;
@@ -260,10 +286,10 @@ int main(int argc, char *argv[]) {
 		      cout << "--" << ifr << " " << ff << " " << np << endl;
                     ff = -1;
                 }
-                filebin.close();
                 while (mt->isBusy()) {
                     ;
                 }
+                filebin.close();
 
             } else
                 cout << "Could not open pedestal file " << fname
@@ -306,11 +332,21 @@ int main(int argc, char *argv[]) {
         std::time(&end_time);
         cout << std::ctime(&end_time) << endl;
         //  cout <<  fname << " " << outfname << " " << imgfname <<  endl;
-        filebin.open((const char *)(fname), ios::in | ios::binary);
+        filebin.open((const char *)(fname));
         //      //open file
         ifile = 0;
-        if (filebin.is_open()) {
+        if (filebin.isOpen()) {
             if (thr <= 0 && cf != 0) { // cluster finder
+#ifdef CLUSTERFILE
+                if (!cfile.isOpen()) {
+                    if (cfile.openWrite(cfname, csize, csize)) {
+                        mt->setClusterFile(&cfile);
+                    } else {
+                        mt->setClusterFile(NULL);
+                        return 1;
+                    }
+                }
+#else
                 if (of == NULL) {
                     of = fopen(cfname, "w");
                     if (of) {
@@ -323,20 +359,19 @@ int main(int argc, char *argv[]) {
                         return 1;
                     }
                 }
+#endif
             }
             //     //while read frame
             ff = -1;
             ifr = 0;
-            while (decoder->readNextFrame(filebin, ff, np, buff)) {
+            while ((frame = filebin.nextFrame(decoder->getDataSize(), ff, np))) {
 	      fnum=ff;
                 if (np == 40) {
 		  if (ff % 100 == 0)
-		    cout << "**" << ifr << " " << fnum << " " << decoder->getValue(buff,20,20) << endl;
+		    cout << "**" << ifr << " " << fnum << " " << decoder->getValue(frame,20,20) << endl;
                     //         //push
-                    mt->pushData(buff);
-                    // 	//         //pop
+                    mt->pushBorrowedData(frame);
                     mt->nextThread();
-                    mt->popFree(buff);
 
                     ifr++;
                     if (ifr % 100 == 0)
@@ -360,10 +395,10 @@ int main(int argc, char *argv[]) {
                 ff = -1;
             }
             cout << "--" << endl;
-            filebin.close();
             while (mt->isBusy()) {
                 ;
             }
+            filebin.close();
             if (nframes >= 0) {
                 if (nframes ==1) {
                     sprintf(ffname, "%s/%s_f%05d.tiff", outdir, fformat, fnum);
@@ -383,6 +418,10 @@ int main(int argc, char *argv[]) {
                     of = NULL;
                     mt->setFilePointer(NULL);
                 }
+#ifdef CLUSTERFILE
+                mt->setClusterFile(NULL);
+                cfile.close();
+#endif
             }
             std::time(&end_time);
             cout << std::ctime(&end_time) << endl;
@@ -395,6 +434,10 @@ int main(int argc, char *argv[]) {
         cout << "Writing tiff to " << imgfname << " " << thr1 << endl;
         mt->writeImage(imgfname, thr1);
     }
+#ifdef CLUSTERFILE
+    mt->setClusterFile(NULL);
+    cfile.close();
+#endif
 
     return 0;
 }
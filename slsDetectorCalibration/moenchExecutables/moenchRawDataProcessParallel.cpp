@@ -0,0 +1,377 @@
+// SPDX-License-Identifier: LGPL-3.0-or-other
+// Copyright (C) 2021 Contributors to the SLS Detector Package
+
+/*
+  Offline processing of many acquisitions in parallel: every worker thread
+  takes the next run, processes all its frames with its own copy of the
+  detector and writes the image (and clusters) of the run. The images of all
+  the runs are summed into a merged image at the end.
+  Moench03 frames are corrected for common mode and supercolumn ghosts before
+  the photons are counted; moench04 has a different readout and is processed
+  without these corrections.
+*/
+
+#include <iostream>
+
+#define RAWDATA
+
+#define C_GHOST 0.0004
+
+#define CM_ROWS 50
+
+#ifndef MOENCH04
+#include "moench03T1ReceiverDataNew.h"
+#endif
+
+#ifdef MOENCH04
+#include "moench04CtbZmq10GbData.h"
+#endif
+
+#include "mmapFrameSource.h"
+#include "moench03CommonMode.h"
+#include "moench03GhostSummation.h"
+#include "singlePhotonDetector.h"
+
+#include <atomic>
+#include <chrono>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+#define NPACKETS 40
+
+#ifndef MOENCH04
+typedef moench03T1ReceiverDataNew decoderType;
+#endif
+#ifdef MOENCH04
+typedef moench04CtbZmq10GbData decoderType;
+#endif
+
+/** runs to be processed and counters shared by the workers */
+struct processingJob {
+    decoderType *decoder;
+    singlePhotonDetector *seed; /**< detector holding the pedestal seed */
+    char *indir;
+    char *outdir;
+    char *fformat;
+    int runmax;
+    int cf;          /**< 1 if clusters are written to file */
+    int ownPedestal; /**< 1 if every run starts a new pedestal */
+    int nped;        /**< pedestal frames at the beginning of a run */
+    int nx, ny;
+    std::atomic<int> nextRun;
+    std::atomic<int> runsDone;
+    std::atomic<long long> framesDone;
+    std::atomic<long long> bytesDone;
+    pthread_mutex_t mergeMutex;
+    double *merged; /**< sum of the images of all the runs */
+};
+
+void *processRuns(void *ptr) {
+    processingJob *job = (processingJob *)ptr;
+    char ffname[10000], fname[10000], imgfname[10000], cfname[10000];
+    int ff, np, irun;
+    char *frame;
+    int nn = job->nx * job->ny;
+    float *gm = new float[nn];
+    double *partial = new double[nn];
+    for (int i = 0; i < nn; i++)
+        partial[i] = 0;
+    mmapFrameSource filebin;
+    // the cluster file of a run is written only by its worker
+    pthread_mutex_t fileMutex;
+    pthread_mutex_init(&fileMutex, NULL);
+
+    while ((irun = job->nextRun++) <= job->runmax) {
+        sprintf(ffname, "%s/%s.raw", job->indir, job->fformat);
+        sprintf(fname, (const char *)ffname, irun);
+        sprintf(ffname, "%s/%s.tiff", job->outdir, job->fformat);
+        sprintf(imgfname, (const char *)ffname, irun);
+        sprintf(ffname, "%s/%s.clust", job->outdir, job->fformat);
+        sprintf(cfname, (const char *)ffname, irun);
+
+        if (filebin.open(fname) == 0) {
+            cout << "Could not open " << fname << " for reading " << endl;
+            job->runsDone++;
+            continue;
+        }
+
+        // every run starts from the pedestal seed
+        singlePhotonDetector *det = job->seed->Clone();
+        det->setDetectorMode(job->seed->getDetectorMode());
+        det->setThreshold(job->seed->getThreshold());
+        det->setMutex(&fileMutex);
+        det->clearImage();
+        if (job->ownPedestal) {
+            det->newDataSet();
+            det->setFrameMode(ePedestal);
+        } else
+            det->setFrameMode(eFrame);
+
+        FILE *of = NULL;
+        if (job->cf) {
+            of = fopen(cfname, "w");
+            if (of == NULL)
+                cout << "Could not open " << cfname << " for writing " << endl;
+            det->setFilePointer(of);
+        }
+
+        int ifr = 0;
+        while ((frame = filebin.nextFrame(job->decoder->getDataSize(), ff, np))) {
+            if (np == NPACKETS) {
+                if (job->ownPedestal && ifr == job->nped)
+                    det->setFrameMode(eFrame);
+                det->processData(frame);
+                ifr++;
+                job->framesDone++;
+            }
+        }
+        job->bytesDone += filebin.getTotalSize();
+        filebin.close();
+
+        int *img = det->getImage();
+        for (int i = 0; i < nn; i++) {
+            gm[i] = img[i] < 0 ? 0 : img[i];
+            partial[i] += gm[i];
+        }
+        WriteToTiff(gm, imgfname, job->nx, job->ny);
+        if (of)
+            fclose(of);
+        delete det;
+        job->runsDone++;
+    }
+
+    pthread_mutex_lock(&job->mergeMutex);
+    for (int i = 0; i < nn; i++)
+        job->merged[i] += partial[i];
+    pthread_mutex_unlock(&job->mergeMutex);
+    pthread_mutex_destroy(&fileMutex);
+    delete[] partial;
+    delete[] gm;
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+
+    if (argc < 6) {
+        cout << "Usage is " << argv[0]
+             << " indir outdir fname(no extension) runmin runmax [nworkers] "
+                "[pedfile (raw or tiff, 0 for none)] [threshold] "
+                "[xmin xmax ymin ymax] [gainmap]"
+             << endl;
+        cout << "nworkers <=0 means one worker per core" << endl;
+        cout << "without pedestal file every run starts a new pedestal from "
+                "its first frames, otherwise every run starts from the "
+                "pedestal of the file"
+             << endl;
+        cout << "threshold <0 means analog; threshold=0 means cluster finder; "
+                "threshold>0 means photon counting"
+             << endl;
+        return 1;
+    }
+
+    int csize = 3;
+    int nsigma = 5;
+    int nped = 10000;
+
+#ifndef MOENCH04
+    decoderType *decoder = new moench03T1ReceiverDataNew();
+    cout << "MOENCH03!" << endl;
+#endif
+#ifdef MOENCH04
+    decoderType *decoder = new moench04CtbZmq10GbData();
+    cout << "MOENCH04!" << endl;
+#endif
+
+    int nx = 400, ny = 400;
+    decoder->getDetectorSize(nx, ny);
+
+    processingJob job;
+    job.decoder = decoder;
+    job.indir = argv[1];
+    job.outdir = argv[2];
+    job.fformat = argv[3];
+    job.nextRun = atoi(argv[4]);
+    job.runmax = atoi(argv[5]);
+
+    int nworkers = 0;
+    if (argc >= 7)
+        nworkers = atoi(argv[6]);
+    if (nworkers <= 0)
+        nworkers = sysconf(_SC_NPROCESSORS_ONLN);
+
+    char *pedfile = NULL;
+    if (argc >= 8 && strcmp(argv[7], "0"))
+        pedfile = argv[7];
+
+    double thr = 0;
+    if (argc >= 9)
+        thr = atof(argv[8]);
+
+    int xmin = 0, xmax = nx, ymin = 0, ymax = ny;
+    if (argc >= 13) {
+        xmin = atoi(argv[9]);
+        xmax = atoi(argv[10]);
+        ymin = atoi(argv[11]);
+        ymax = atoi(argv[12]);
+    }
+
+    char *gainfname = NULL;
+    if (argc > 13) {
+        gainfname = argv[13];
+        cout << "Gain map file name is: " << gainfname << endl;
+    }
+
+    cout << "input directory is " << job.indir << endl;
+    cout << "output directory is " << job.outdir << endl;
+    cout << "input file is " << job.fformat << endl;
+    cout << "runs " << job.nextRun << " to " << job.runmax << endl;
+    cout << "workers " << nworkers << endl;
+
+    moench03CommonMode *cm = NULL;
+    moench03GhostSummation *gs = NULL;
+#ifndef MOENCH04
+    cout << "Applying common mode  " << CM_ROWS << endl;
+    cm = new moench03CommonMode(CM_ROWS);
+
+    cout << "Applying ghost corrections " << C_GHOST << endl;
+    gs = new moench03GhostSummation(decoder, C_GHOST);
+#endif
+
+    // every worker clones the filter with its own common mode and ghosts
+    singlePhotonDetector *filter = new singlePhotonDetector(
+        decoder, csize, nsigma, 1, cm, nped, 200, -1, -1, NULL, gs);
+
+    if (gainfname) {
+        if (filter->readGainMap(gainfname))
+            cout << "using gain map " << gainfname << endl;
+        else
+            cout << "Could not open gain map " << gainfname << endl;
+    }
+
+    filter->newDataSet();
+    job.cf = 0;
+    if (thr >= 0) {
+        filter->setDetectorMode(ePhotonCounting);
+        cout << "Counting!" << endl;
+        if (thr > 0) {
+            cout << "threshold is " << thr << endl;
+            filter->setThreshold(thr);
+        } else
+            job.cf = 1;
+    } else {
+        filter->setDetectorMode(eAnalog);
+        cout << "Analog!" << endl;
+    }
+    filter->setROI(xmin, xmax, ymin, ymax);
+
+    // pedestal seed
+    job.ownPedestal = 1;
+    job.nped = nped;
+    if (pedfile) {
+        char imgfname[10000];
+        sprintf(imgfname, "%s/pedestals.tiff", job.outdir);
+        if (string(pedfile).find(".tif") == std::string::npos) {
+            mmapFrameSource filebin;
+            int ff, np, ifr = 0;
+            char *frame;
+            if (filebin.open(pedfile)) {
+                filter->setFrameMode(ePedestal);
+                while ((frame = filebin.nextFrame(decoder->getDataSize(), ff, np))) {
+                    if (np == NPACKETS) {
+                        filter->processData(frame);
+                        ifr++;
+                    }
+                }
+                filebin.close();
+                cout << "Pedestal from " << ifr << " frames of " << pedfile
+                     << endl;
+                job.ownPedestal = 0;
+            } else
+                cout << "Could not open pedestal file " << pedfile
+                     << " for reading " << endl;
+        } else {
+            uint32_t nnx, nny;
+            float *pp = ReadFromTiff(pedfile, nny, nnx);
+            if (pp && (int)nnx == nx && (int)nny == ny) {
+                double *ped = new double[nx * ny];
+                for (int i = 0; i < nx * ny; i++)
+                    ped[i] = pp[i];
+                delete[] pp;
+                filter->setPedestal(ped);
+                delete[] ped;
+                cout << "Pedestal set from tiff file " << pedfile << endl;
+                job.ownPedestal = 0;
+            } else
+                cout << "Could not open pedestal tiff file " << pedfile
+                     << " for reading " << endl;
+        }
+        if (job.ownPedestal == 0)
+            filter->writePedestals(imgfname);
+    }
+    if (job.ownPedestal)
+        cout << "Every run starts a new pedestal from its first " << nped
+             << " frames" << endl;
+    job.seed = filter;
+
+    job.nx = nx;
+    job.ny = ny;
+    job.merged = new double[nx * ny];
+    for (int i = 0; i < nx * ny; i++)
+        job.merged[i] = 0;
+    job.runsDone = 0;
+    job.framesDone = 0;
+    job.bytesDone = 0;
+    pthread_mutex_init(&job.mergeMutex, NULL);
+    int nruns = job.runmax - job.nextRun + 1;
+
+    std::chrono::steady_clock::time_point tstart =
+        std::chrono::steady_clock::now();
+    std::vector<pthread_t> workers(nworkers);
+    for (int i = 0; i < nworkers; i++)
+        pthread_create(&workers[i], NULL, processRuns, &job);
+
+    // progress and throughput report
+    long long lastFrames = 0;
+    while (job.runsDone < nruns) {
+        sleep(1);
+        long long frames = job.framesDone;
+        double t = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - tstart)
+                       .count();
+        cout << "Runs " << job.runsDone << "/" << nruns << " frames " << frames
+             << " (" << frames - lastFrames << " frames/s, "
+             << frames / t << " frames/s average, "
+             << job.bytesDone / t / 1024 / 1024 << " MB/s)" << endl;
+        lastFrames = frames;
+    }
+    for (int i = 0; i < nworkers; i++)
+        pthread_join(workers[i], NULL);
+
+    double t = std::chrono::duration<double>(
+                   std::chrono::steady_clock::now() - tstart)
+                   .count();
+    cout << "Processed " << nruns << " runs, " << job.framesDone
+         << " complete frames in " << t << " s: " << job.framesDone / t
+         << " frames/s, " << job.framesDone / t / nworkers
+         << " frames/s/worker" << endl;
+
+    char fname[10000];
+    sprintf(fname, "%s/%s_merged.tiff", job.outdir, job.fformat);
+    float *gm = new float[nx * ny];
+    for (int i = 0; i < nx * ny; i++)
+        gm[i] = job.merged[i];
+    // the run number in the file name format is replaced by the first run
+    char imgfname[10000];
+    sprintf(imgfname, (const char *)fname, atoi(argv[4]));
+    cout << "Writing merged image to " << imgfname << endl;
+    WriteToTiff(gm, imgfname, nx, ny);
+    delete[] gm;
+    pthread_mutex_destroy(&job.mergeMutex);
+    return 0;
+}
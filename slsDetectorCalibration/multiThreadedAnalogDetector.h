@@ -14,12 +14,15 @@
 //#include <deque>
 //#include <list>
 //#include <queue>
+#include <atomic>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <pthread.h>
 
 #include "analogDetector.h"
 #include "circularFifo.h"
+#include "sls/ImageWriter.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -34,6 +37,7 @@ class threadedAnalogDetector {
         det = d;
         fifoFree = new CircularFifo<char>(fs);
         fifoData = new CircularFifo<char>(fs);
+        fifoBorrowed = new CircularFifo<char>(fs);
         // mem==NULL;
         /* mem=(char*)calloc(fs, det->getDataSize()); */
         /* if (mem) */
@@ -58,6 +62,13 @@ class threadedAnalogDetector {
         stop = 1;
         fMode = eFrame;
         ff = NULL;
+        ownImage = NULL;
+        swapImages[0] = NULL;
+        swapImages[1] = NULL;
+        swapSize = 0;
+        iswap = 0;
+        partialImage = NULL;
+        swapRequest = 0;
     }
 
     virtual int setFrameMode(int fm) {
@@ -98,8 +109,88 @@ class threadedAnalogDetector {
 
     virtual ~threadedAnalogDetector() {
         StopThread();
+        if (ownImage) {
+            // the detector deletes its image, give it back its own array
+            memcpy(ownImage, det->analogDetector<uint16_t>::getImage(),
+                   swapSize * sizeof(int));
+            det->swapImage(ownImage);
+            free(swapImages[0]);
+            free(swapImages[1]);
+        }
         delete fifoFree;
         delete fifoData;
+        delete fifoBorrowed;
+    }
+
+    /** true if the counts are in the image array of the detector, which
+       can be swapped out. Not when interpolating (getImage is the
+       interpolated image) or when the image is not of the detector size */
+    virtual bool canSwapImage() {
+        int nx, ny, nnx, nny, ns, nsy;
+        det->getDetectorSize(nx, ny);
+        return det->getImageSize(nnx, nny, ns, nsy) == nx * ny &&
+               det->getImage() == det->analogDetector<uint16_t>::getImage();
+    }
+
+    /** asks the thread to swap the image of the detector for a zeroed one
+       between two frames and returns at once. The processing never waits,
+       the swapped out image is collected with getPartialImage.
+        \returns false if the image cannot be swapped (see canSwapImage)
+    */
+    virtual bool requestPartialImage() {
+        if (!canSwapImage())
+            return false;
+        if (ownImage == NULL) {
+            int nnx, nny, ns, nsy;
+            swapSize = det->getImageSize(nnx, nny, ns, nsy);
+            // cache aligned so that the threads never share a line
+            for (int i = 0; i < 2; i++) {
+                void *p = NULL;
+                if (posix_memalign(&p, 64, swapSize * sizeof(int)) != 0)
+                    p = NULL;
+                swapImages[i] = (int *)p;
+            }
+            if (swapImages[0] == NULL || swapImages[1] == NULL) {
+                cout << "Could not allocate partial images" << endl;
+                free(swapImages[0]);
+                free(swapImages[1]);
+                swapImages[0] = NULL;
+                swapImages[1] = NULL;
+                return false;
+            }
+            memset(swapImages[0], 0, swapSize * sizeof(int));
+            memset(swapImages[1], 0, swapSize * sizeof(int));
+            // the array of the detector, not the virtual getImage
+            ownImage = det->analogDetector<uint16_t>::getImage();
+        }
+        swapRequest.store(1, std::memory_order_release);
+        return true;
+    }
+
+    /** waits for the swap asked by requestPartialImage
+        \returns the counts since the previous swap (the whole image the
+       first time), to be handed back with releasePartialImage, or NULL
+    */
+    virtual int *getPartialImage() {
+        if (ownImage == NULL)
+            return NULL;
+        while (swapRequest.load(std::memory_order_acquire)) {
+            if (stop) {
+                // no thread to do it
+                swapImage();
+                break;
+            }
+            usleep(10);
+        }
+        return partialImage;
+    }
+
+    /** zeroes the partial image, which is swapped in by the next request */
+    virtual void releasePartialImage() {
+        if (partialImage) {
+            memset(partialImage, 0, swapSize * sizeof(int));
+            partialImage = NULL;
+        }
     }
 
     /** Returns true if the thread was successfully started, false if there was
@@ -121,6 +212,13 @@ class threadedAnalogDetector {
 
     virtual bool popFree(char *&ptr) { return fifoFree->pop(ptr); }
 
+    /** pushes a frame owned by the caller (e.g. mapped from a file), which
+       is not recycled in the free buffers. Blocks while fs frames are in
+       flight; the frame must stay valid until isBusy returns 0 */
+    virtual bool pushBorrowedData(char *ptr) {
+        return fifoBorrowed->push(ptr);
+    }
+
     // virtual int isBusy() {if (fifoData->isEmpty() && busy==0) return 0;
     // return 1;}
 
@@ -128,7 +226,7 @@ class threadedAnalogDetector {
         if (busy == 0) {
             usleep(100);
             if (busy == 0) {
-                if (fifoData->isEmpty()) {
+                if (fifoData->isEmpty() && fifoBorrowed->isEmpty()) {
                     usleep(100);
                     return 0;
                 }
@@ -172,6 +270,9 @@ class threadedAnalogDetector {
     FILE *getFilePointer() { return det->getFilePointer(); };
 
     virtual double setNSigma(double n) { return det->setNSigma(n); };
+    virtual clusterFile *setClusterFile(clusterFile *cf) {
+        return det->setClusterFile(cf);
+    };
     virtual void setEnergyRange(double emi, double ema) {
         det->setEnergyRange(emi, ema);
     };
@@ -255,10 +356,24 @@ class threadedAnalogDetector {
     pthread_t _thread;
     CircularFifo<char> *fifoFree;
     CircularFifo<char> *fifoData;
+    CircularFifo<char> *fifoBorrowed; /**< frames not owned by the fifo */
     int stop;
     int busy;
     char *data;
     int *ff;
+    int *ownImage;      /**< image array of the detector, parked */
+    int *swapImages[2]; /**< cache aligned arrays swapped in turn */
+    int swapSize;       /**< number of pixels of the swapped arrays */
+    int iswap;          /**< next array to swap in */
+    int *partialImage;  /**< array swapped out on the last request */
+    std::atomic<int> swapRequest;
+
+    /** swaps the next zeroed array into the detector, only between frames */
+    void swapImage() {
+        partialImage = det->swapImage(swapImages[iswap]);
+        iswap = 1 - iswap;
+        swapRequest.store(0, std::memory_order_release);
+    }
 
     static void *processData(void *ptr) {
         threadedAnalogDetector *This = ((threadedAnalogDetector *)ptr);
@@ -268,9 +383,11 @@ class threadedAnalogDetector {
     void *processData() {
         //  busy=1;
         while (!stop) {
-            if (fifoData->isEmpty()) {
+            if (swapRequest.load(std::memory_order_acquire))
+                swapImage();
+            if (fifoData->isEmpty() && fifoBorrowed->isEmpty()) {
                 usleep(100);
-                if (fifoData->isEmpty()) {
+                if (fifoData->isEmpty() && fifoBorrowed->isEmpty()) {
                     busy = 0;
                 } else
                     busy = 1;
@@ -278,9 +395,12 @@ class threadedAnalogDetector {
                 busy = 1;
 
             if (busy == 1) {
-                fifoData->pop(data); // blocking!
-                det->processData(data);
-                fifoFree->push(data);
+                if (fifoData->pop(data, true)) {
+                    det->processData(data);
+                    fifoFree->push(data);
+                } else if (fifoBorrowed->pop(data, true)) {
+                    det->processData(data);
+                }
                 // busy=0;
             }
         }
@@ -309,8 +429,13 @@ class multiThreadedAnalogDetector {
         }
 
         image = NULL;
+        imageSize = 0;
+        partialTotal = 0;
         ff = NULL;
         ped = NULL;
+        rms = NULL;
+        pedPart = NULL;
+        writer = NULL;
         cout << "Ithread is " << ithread << endl;
     }
 
@@ -320,7 +445,10 @@ class multiThreadedAnalogDetector {
             delete dets[i];
         /* for (int i=1; i<nThreads; i++)  */
         /*   delete dd[i]; */
-        // delete [] image;
+        delete[] image;
+        delete[] ped;
+        delete[] rms;
+        delete[] pedPart;
     }
 
     virtual int setFrameMode(int fm) {
@@ -351,45 +479,66 @@ class multiThreadedAnalogDetector {
     virtual void newDataSet() {
         for (int i = 0; i < nThreads; i++)
             dets[i]->newDataSet();
+        if (image)
+            memset(image, 0, imageSize * sizeof(int));
     };
 
+    /** image summed over the threads. Each call takes the counts of every
+       thread since the previous call and adds them to the total, the threads
+       go on processing meanwhile. When interpolating or if the image is not
+       of the detector size, the whole images of the threads are summed.
+        \returns total image, owned and reused by the detector
+    */
     virtual int *getImage(int &nnx, int &nny, int &ns, int &nsy) {
-        int *img;
-        // int nnx, nny, ns;
-        // int nnx, nny, ns;
         int nn = dets[0]->getImageSize(nnx, nny, ns, nsy);
-        if (image) {
+        if (imageSize != nn) {
             delete[] image;
-            image = NULL;
+            image = new int[nn];
+            imageSize = nn;
+            memset(image, 0, nn * sizeof(int));
         }
-        image = new int[nn];
-        // int nn=dets[0]->getImageSize(nnx, nny, ns);
-        // for (i=0; i<nn; i++) image[i]=0;
-
+        if (!dets[0]->canSwapImage()) {
+            for (int ii = 0; ii < nThreads; ii++) {
+                int *img = dets[ii]->getImage();
+                for (int i = 0; i < nn; i++) {
+                    if (ii == 0)
+                        image[i] = img[i];
+                    else
+                        image[i] += img[i];
+                }
+            }
+            partialTotal = 0;
+            return image;
+        }
+        // the total restarts after whole images
+        if (!partialTotal)
+            memset(image, 0, nn * sizeof(int));
+        partialTotal = 1;
+        // all threads swap at once, then their partial images are merged
+        for (int ii = 0; ii < nThreads; ii++)
+            dets[ii]->requestPartialImage();
         for (int ii = 0; ii < nThreads; ii++) {
-            // cout << ii << " " << nn << " " << nnx << " " << nny << " " << ns
-            // << endl;
-            img = dets[ii]->getImage();
-            for (int i = 0; i < nn; i++) {
-                if (ii == 0)
-                    //	  if (img[i]>0)
-                    image[i] = img[i];
-                // else
-                //  image[i]=0;
-                else // if (img[i]>0)
+            int *img = dets[ii]->getPartialImage();
+            if (img) {
+                for (int i = 0; i < nn; i++)
                     image[i] += img[i];
-                // if (img[i])	  cout << "det " << ii << " pix " << i << " val
-                // " <<  img[i] << " " << image[i] << endl;
             }
+            dets[ii]->releasePartialImage();
         }
         return image;
     }
 
     virtual void clearImage() {
-
+        // counts not taken yet are dropped
+        for (int ii = 0; ii < nThreads; ii++)
+            dets[ii]->requestPartialImage();
         for (int ii = 0; ii < nThreads; ii++) {
+            dets[ii]->getPartialImage();
+            dets[ii]->releasePartialImage();
             dets[ii]->clearImage();
         }
+        if (image)
+            memset(image, 0, imageSize * sizeof(int));
     }
 
     virtual void *writeImage(const char *imgname, double t = 1) {
@@ -404,7 +553,7 @@ class multiThreadedAnalogDetector {
         getImage(nnx, nny, ns, nsy);
         // int nnx, nny, ns;
         int nn = dets[0]->getImageSize(nnx, nny, ns, nsy);
-        float *gm = new float[nn];
+        float *gm = newFloatImage(nn);
         if (gm) {
             for (int ix = 0; ix < nn; ix++) {
                 if (t) {
@@ -419,8 +568,7 @@ class multiThreadedAnalogDetector {
                 // ix%nnx << " " << image[ix]<< " " << gm[ix] << endl;
             }
             // cout << "image " << nnx << " " << nny << endl;
-            WriteToTiff(gm, imgname, nnx, nny);
-            delete[] gm;
+            writeFloatImage(gm, imgname, nnx, nny);
         } else
             cout << "Could not allocate float image " << endl;
         return NULL;
@@ -454,6 +602,10 @@ class multiThreadedAnalogDetector {
         return dets[ithread]->popFree(ptr);
     }
 
+    virtual bool pushBorrowedData(char *ptr) {
+        return dets[ithread]->pushBorrowedData(ptr);
+    }
+
     virtual int nextThread() {
         ithread++;
         if (ithread == nThreads)
@@ -464,10 +616,11 @@ class multiThreadedAnalogDetector {
     virtual double *getPedestal() {
         int nx, ny;
         dets[0]->getDetectorSize(nx, ny);
-        if (ped)
-            delete[] ped;
-        ped = new double[nx * ny];
-        double *p0 = new double[nx * ny];
+        if (ped == NULL)
+            ped = new double[nx * ny];
+        if (pedPart == NULL)
+            pedPart = new double[nx * ny];
+        double *p0 = pedPart;
 
         for (int i = 0; i < nThreads; i++) {
             // inte=(slsInterpolation*)dets[i]->getInterpolation(nb,emi,ema);
@@ -488,7 +641,6 @@ class multiThreadedAnalogDetector {
                 }
             }
         }
-        delete[] p0;
         return ped;
     };
 
@@ -496,8 +648,11 @@ class multiThreadedAnalogDetector {
         int nx, ny;
         dets[0]->getDetectorSize(nx, ny);
         // if (ped) delete [] ped;
-        double *rms = new double[nx * ny];
-        double *p0 = new double[nx * ny];
+        if (rms == NULL)
+            rms = new double[nx * ny];
+        if (pedPart == NULL)
+            pedPart = new double[nx * ny];
+        double *p0 = pedPart;
 
         for (int i = 0; i < nThreads; i++) {
             // inte=(slsInterpolation*)dets[i]->getInterpolation(nb,emi,ema);
@@ -518,7 +673,6 @@ class multiThreadedAnalogDetector {
                 }
             }
         }
-        delete[] p0;
 
         /* for (int ib=0; ib<nx*ny; ib++) { */
         /*   if (rms[ib]>0) */
@@ -550,13 +704,12 @@ class multiThreadedAnalogDetector {
         dets[0]->getDetectorSize(nx, ny);
 
         getPedestal();
-        float *gm = new float[nx * ny];
+        float *gm = newFloatImage(nx * ny);
         if (gm) {
             for (int ix = 0; ix < nx * ny; ix++) {
                 gm[ix] = ped[ix];
             }
-            WriteToTiff(gm, imgname, nx, ny);
-            delete[] gm;
+            writeFloatImage(gm, imgname, nx, ny);
         } else
             cout << "Could not allocate float image " << endl;
 
@@ -568,15 +721,13 @@ class multiThreadedAnalogDetector {
         int nx, ny;
         dets[0]->getDetectorSize(nx, ny);
 
-        double *rms = getPedestalRMS();
-        float *gm = new float[nx * ny];
+        getPedestalRMS();
+        float *gm = newFloatImage(nx * ny);
         if (gm) {
             for (int ix = 0; ix < nx * ny; ix++) {
                 gm[ix] = rms[ix];
             }
-            WriteToTiff(gm, imgname, nx, ny);
-            delete[] gm;
-            delete[] rms;
+            writeFloatImage(gm, imgname, nx, ny);
         } else
             cout << "Could not allocate float image " << endl;
 
@@ -624,15 +775,50 @@ class multiThreadedAnalogDetector {
     */
     virtual FILE *getFilePointer() { return dets[0]->getFilePointer(); };
 
+    /** sets the writer for images, pedestals and rms, which are then queued
+       and written in the background instead of waiting for the disk. The
+       writer is not owned and must outlive the detector (NULL to write
+       synchronously)
+        \param w image writer
+        \returns current image writer
+    */
+    virtual ImageWriter *setImageWriter(ImageWriter *w) {
+        writer = w;
+        return writer;
+    };
+
   protected:
+    /** float image of n pixels, from the writer pool if there is a writer */
+    float *newFloatImage(int n) {
+        if (writer)
+            return writer->GetBuffer(n);
+        return new float[n];
+    };
+
+    /** writes (or queues) an image from newFloatImage and releases it */
+    void writeFloatImage(float *gm, const char *imgname, int nrow, int ncol) {
+        if (writer) {
+            writer->WriteTiff(gm, imgname, nrow, ncol);
+        } else {
+            WriteToTiff(gm, imgname, nrow, ncol);
+            delete[] gm;
+        }
+    };
+
+
     bool stop;
     const int nThreads;
     threadedAnalogDetector *dets[MAXTHREADS];
     analogDetector<uint16_t> *dd[MAXTHREADS];
     int ithread;
-    int *image;
+    int *image;     /**< total image, grown by getImage */
+    int imageSize;
+    int partialTotal; /**< image is the total of the partial images */
     int *ff;
     double *ped;
+    double *rms;
+    double *pedPart; /**< pedestal of one thread while merging */
+    ImageWriter *writer;
     pthread_mutex_t fmutex;
 };
 
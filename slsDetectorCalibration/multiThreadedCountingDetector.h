@@ -33,6 +33,13 @@ class multiThreadedCountingDetector : public multiThreadedAnalogDetector {
         for (int i = 0; i < nThreads; i++)
             (dets[i])->setEnergyRange(emi, ema);
     };
+    /** all threads write their clusters to the same file */
+    virtual clusterFile *setClusterFile(clusterFile *cf) {
+        clusterFile *ret = (dets[0])->setClusterFile(cf);
+        for (int i = 1; i < nThreads; i++)
+            (dets[i])->setClusterFile(cf);
+        return ret;
+    };
 };
 
 #endif
@@ -74,15 +74,16 @@ class multiThreadedInterpolatingDetector
         // int nnx, nny, ns;
         // int nnx, nny, ns;
         int nn = dets[0]->getImageSize(nnx, nny, nsx, nsy);
-        if (image) {
-            delete image;
-            image = NULL;
+        if (imageSize != nn) {
+            delete[] image;
+            image = new int[nn];
+            imageSize = nn;
         }
-        image = new int[nn];
         img = dets[0]->getImage();
         for (int i = 0; i < nn; i++) {
             image[i] = img[i];
         }
+        partialTotal = 0;
         return image;
     };
 };
@@ -0,0 +1,481 @@
+// SPDX-License-Identifier: LGPL-3.0-or-other
+// Copyright (C) 2021 Contributors to the SLS Detector Package
+#ifndef SCURVEFITTER_H
+#define SCURVEFITTER_H
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+/**
+   Levenberg-Marquardt fit of the s-curves of many channels, without ROOT.
+
+   The function and the parameters are the ones of
+   energyCalibrationFunctions::scurve (erf with charge sharing slope):
+     par[0] is the  pedestal
+     par[1] is the  slope of the pedestal
+     par[2] is the inflection point
+     par[3] is the RMS
+     par[4] is the amplitude
+     par[5] is the angual coefficient of the charge sharing slope
+   and the fit minimizes the same chi2 as energyCalibration::fitSCurve
+   (errors sqrt(counts), empty points skipped), so the parameters and their
+   errors can be used in place of the ROOT ones.
+
+   The counts are given as one image per scan point (as acquired during a
+   threshold scan). Channels are fitted LANES at a time in lockstep, with the
+   data of a point for all the lanes contiguous, and the groups of channels are
+   shared among threads.
+*/
+class sCurveFitter {
+
+  public:
+    static const int NPAR = 6;
+    static const int LANES = 8;
+
+    /**
+       Constructor
+       \param s scan sign, as in energyCalibrationFunctions
+       \param nt number of threads, 0 is the number of cores
+    */
+    sCurveFitter(int s = -1, int nt = 0)
+        : sign(s), nThreads(nt), fit_min(-1), fit_max(-1), cs_flag(1),
+          maxIterations(200) {
+        for (int ip = 0; ip < NPAR; ip++)
+            startPar[ip] = -1;
+        if (nThreads <= 0)
+            nThreads = std::max(1u, std::thread::hardware_concurrency());
+    };
+
+    /** sets scan sign
+        \param s can be 1 (energy and x-axis have the same direction) or -1
+       (energy and x-axis have opposite directions) otherwise gets \returns
+       current scan sign
+    */
+    int setScanSign(int s = 0) {
+        if (s == 1 || s == -1)
+            sign = s;
+        return sign;
+    };
+
+    /** sets the s-curve fit range
+        \param mi  minimum of the fit range (-1 is first scan point)
+        \param ma  maximum of the fit range (-1 is last scan point)
+    */
+    void setFitRange(double mi, double ma) {
+        fit_min = mi;
+        fit_max = ma;
+    };
+
+    /** set start parameters for the s-curve function, same for all channels
+        \param par parameters, -1 sets to auto-calculation from the data of
+        every channel
+    */
+    void setStartParameters(double *par) {
+        for (int ip = 0; ip < NPAR; ip++)
+            startPar[ip] = par[ip];
+    };
+
+    /** 0 fixes the charge sharing slope to 0, >0 fits it
+        \returns current charge sharing flag
+    */
+    int setChargeSharing(int p = -1) {
+        if (p >= 0)
+            cs_flag = p;
+        return cs_flag;
+    };
+
+    int setMaxIterations(int n) {
+        if (n > 0)
+            maxIterations = n;
+        return maxIterations;
+    };
+
+    /** the s-curve, as energyCalibrationFunctions::scurve */
+    static double scurve(double x, const double *par, int s) {
+        double arg = 0;
+        if (par[3] != 0)
+            arg = (par[2] - x) / par[3];
+        double e = par[4] / 2. * (1 + std::erf(s * arg / std::sqrt(2.)));
+        return e * (1 + par[5] * (par[2] - x)) + par[0] - par[1] * x * s;
+    };
+
+    /**
+       fits the s-curves of many channels
+       \param npoints number of scan points
+       \param x scan values (npoints long, increasing)
+       \param counts counts of all channels at every scan point,
+       counts[ipoint * nch + ich]
+       \param nch number of channels
+       \param par fitted parameters, par[ich * NPAR + ip]
+       \param epar errors on the parameters (same layout), can be NULL
+       \param chi2 chi2/ndf of every channel, can be NULL
+       \returns number of channels for which the fit converged
+    */
+    template <typename T>
+    int fitSCurves(int npoints, const double *x, const T *counts, int nch,
+                   double *par, double *epar = NULL, double *chi2 = NULL) {
+        std::vector<int> points;
+        double mi = fit_min == -1 ? x[0] : fit_min;
+        double ma = fit_max == -1 ? x[npoints - 1] : fit_max;
+        for (int ip = 0; ip < npoints; ip++)
+            if (x[ip] >= mi && x[ip] <= ma)
+                points.push_back(ip);
+
+        int ngroups = (nch + LANES - 1) / LANES;
+        int nt = std::min(nThreads, ngroups);
+        std::vector<int> nconv(nt, 0);
+        std::vector<std::thread> threads;
+        for (int it = 0; it < nt; it++) {
+            threads.emplace_back([&, it]() {
+                lmGroup group(*this, points, x);
+                for (int ig = it; ig < ngroups; ig += nt)
+                    nconv[it] += group.fit(counts, nch, ig * LANES,
+                                           std::min(LANES, nch - ig * LANES),
+                                           par, epar, chi2);
+            });
+        }
+        int ret = 0;
+        for (int it = 0; it < nt; it++) {
+            threads[it].join();
+            ret += nconv[it];
+        }
+        return ret;
+    };
+
+    /**
+       calculates gain and offset for the set of inflection points, as the
+       pol1 fit of energyCalibration::linearCalibration (effective variance
+       if the energies have errors)
+       \param nscan number of energy scans
+       \param en array of energies (nscan long)
+       \param een array of errors on energies (nscan long) - can be NULL!
+       \param fl array of inflection points (nscan long)
+       \param efl array of errors on the inflection points (nscan long)
+       \param gain reference to gain resulting from the fit
+       \param off reference to offset resulting from the fit
+       \param egain reference to error on the gain resulting from the fit
+       \param eoff reference to the error on the offset resulting from the fit
+    */
+    void linearCalibration(int nscan, const double *en, const double *een,
+                           const double *fl, const double *efl, double &gain,
+                           double &off, double &egain, double &eoff) const {
+        double b = 0;
+        for (int iter = 0; iter < (een ? 10 : 1); iter++) {
+            double sw = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+            for (int i = 0; i < nscan; i++) {
+                double v = efl ? efl[i] * efl[i] : 0;
+                if (een)
+                    v += b * b * een[i] * een[i];
+                double w = v > 0 ? 1. / v : 1.;
+                sw += w;
+                sx += w * en[i];
+                sy += w * fl[i];
+                sxx += w * en[i] * en[i];
+                sxy += w * en[i] * fl[i];
+            }
+            double d = sw * sxx - sx * sx;
+            if (d == 0)
+                break;
+            b = (sw * sxy - sx * sy) / d;
+            off = (sxx * sy - sx * sxy) / d;
+            egain = std::sqrt(sw / d);
+            eoff = std::sqrt(sxx / d);
+        }
+        gain = sign * b;
+    };
+
+  private:
+    /** state of LANES channels fitted together */
+    class lmGroup {
+      public:
+        lmGroup(const sCurveFitter &f, const std::vector<int> &p,
+                const double *xx)
+            : fitter(f), points(p), np(p.size()) {
+            x.resize(np);
+            for (int i = 0; i < np; i++)
+                x[i] = xx[points[i]];
+            y.resize(np * LANES);
+            w.resize(np * LANES);
+        };
+
+        template <typename T>
+        int fit(const T *counts, int nch, int ch0, int nl, double *par,
+                double *epar, double *chi2) {
+            // one row per point, lanes contiguous
+            for (int i = 0; i < np; i++) {
+                const T *c = counts + (size_t)points[i] * nch + ch0;
+                for (int l = 0; l < LANES; l++) {
+                    double v = l < nl ? (double)c[l] : 0;
+                    y[i * LANES + l] = v;
+                    w[i * LANES + l] = v > 0 ? 1. / v : 0;
+                }
+            }
+            startParameters(nl);
+            int nfree = NPAR - (fitter.cs_flag ? 0 : 1);
+            double ch[LANES], lambda[LANES];
+            int done[LANES];
+            chiSquare(p, ch);
+            for (int l = 0; l < LANES; l++) {
+                lambda[l] = 1e-3;
+                done[l] = l >= nl;
+            }
+
+            int iter = 0;
+            for (; iter < fitter.maxIterations; iter++) {
+                normalEquations();
+                double ptry[NPAR * LANES], chtry[LANES];
+                for (int l = 0; l < LANES; l++) {
+                    double delta[NPAR];
+                    if (done[l] || !solve(l, lambda[l], delta)) {
+                        for (int ip = 0; ip < NPAR; ip++)
+                            ptry[ip * LANES + l] = p[ip * LANES + l];
+                        continue;
+                    }
+                    for (int ip = 0; ip < NPAR; ip++)
+                        ptry[ip * LANES + l] = p[ip * LANES + l] + delta[ip];
+                }
+                chiSquare(ptry, chtry);
+                int ndone = 0;
+                for (int l = 0; l < LANES; l++) {
+                    if (!done[l]) {
+                        if (chtry[l] <= ch[l] &&
+                            ptry[3 * LANES + l] != 0) {
+                            double dc = ch[l] - chtry[l];
+                            for (int ip = 0; ip < NPAR; ip++)
+                                p[ip * LANES + l] = ptry[ip * LANES + l];
+                            ch[l] = chtry[l];
+                            lambda[l] = std::max(lambda[l] / 10, 1e-12);
+                            if (dc <= 1e-9 * (ch[l] + 1e-12))
+                                done[l] = 1;
+                        } else {
+                            lambda[l] *= 10;
+                            if (lambda[l] > 1e12)
+                                done[l] = 1;
+                        }
+                    }
+                    ndone += done[l];
+                }
+                if (ndone == LANES)
+                    break;
+            }
+
+            // errors from the covariance at the minimum
+            normalEquations();
+            int nconv = 0;
+            for (int l = 0; l < nl; l++) {
+                double *pp = par + (size_t)(ch0 + l) * NPAR;
+                for (int ip = 0; ip < NPAR; ip++)
+                    pp[ip] = p[ip * LANES + l];
+                double cov[NPAR];
+                int ok = covarianceDiagonal(l, cov);
+                if (epar) {
+                    for (int ip = 0; ip < NPAR; ip++)
+                        epar[(size_t)(ch0 + l) * NPAR + ip] =
+                            ok ? std::sqrt(cov[ip]) : 0;
+                }
+                int ndf = -nfree;
+                for (int i = 0; i < np; i++)
+                    ndf += w[i * LANES + l] > 0;
+                if (chi2)
+                    chi2[ch0 + l] = ndf > 0 ? ch[l] / ndf : 0;
+                nconv += ok && lambda[l] <= 1e12;
+            }
+            return nconv;
+        };
+
+      private:
+        /** as energyCalibration::initFitFunction, -1 estimated from data */
+        void startParameters(int nl) {
+            const double *sp = fitter.startPar;
+            int n10 = std::max(1, np / 10);
+            for (int l = 0; l < LANES; l++) {
+                double lo = 0, hi = 0;
+                for (int i = 0; i < n10; i++) {
+                    lo += y[i * LANES + l];
+                    hi += y[(np - 1 - i) * LANES + l];
+                }
+                lo /= n10;
+                hi /= n10;
+                // plateau at the low energy side of the scan
+                double ymin = std::min(lo, hi), ymax = std::max(lo, hi);
+                double half = 0.5 * (ymin + ymax);
+                double flex = np ? 0.5 * (x[0] + x[np - 1]) : 0;
+                double w16 = 0, w84 = 0;
+                for (int i = 1; i < np; i++) {
+                    double y0 = y[(i - 1) * LANES + l], y1 = y[i * LANES + l];
+                    double lev[3] = {half, ymin + 0.16 * (ymax - ymin),
+                                     ymin + 0.84 * (ymax - ymin)};
+                    double *res[3] = {&flex, &w16, &w84};
+                    for (int k = 0; k < 3; k++) {
+                        if ((y0 - lev[k]) * (y1 - lev[k]) <= 0 && y0 != y1 &&
+                            *res[k] == (k ? 0 : 0.5 * (x[0] + x[np - 1])))
+                            *res[k] = x[i - 1] + (lev[k] - y0) / (y1 - y0) *
+                                                     (x[i] - x[i - 1]);
+                    }
+                }
+                double noise = 0.5 * std::fabs(w84 - w16);
+                if (noise == 0 && np > 1)
+                    noise = std::fabs(x[1] - x[0]);
+                double start[NPAR] = {ymin, 0, flex, noise, ymax - ymin, 0};
+                for (int ip = 0; ip < NPAR; ip++) {
+                    if (sp[ip] != -1)
+                        start[ip] = sp[ip];
+                    p[ip * LANES + l] = l < nl ? start[ip] : 0;
+                }
+                if (!fitter.cs_flag)
+                    p[5 * LANES + l] = 0;
+                if (p[3 * LANES + l] == 0)
+                    p[3 * LANES + l] = 1;
+            }
+        };
+
+        /** model and derivatives of point i for all lanes */
+        void evaluate(const double *pp, int i, double *f, double *d) const {
+            const double s = fitter.sign;
+            const double xi = x[i];
+            for (int l = 0; l < LANES; l++) {
+                double p0 = pp[l], p1 = pp[LANES + l], p2 = pp[2 * LANES + l],
+                       p3 = pp[3 * LANES + l], p4 = pp[4 * LANES + l],
+                       p5 = pp[5 * LANES + l];
+                double u = p3 != 0 ? s * (p2 - xi) / p3 : 0;
+                double h = 0.5 * (1 + std::erf(u * M_SQRT1_2));
+                double g = p4 * 0.3989422804014327 * std::exp(-0.5 * u * u);
+                double c = 1 + p5 * (p2 - xi);
+                double e = p4 * h;
+                f[l] = e * c + p0 - p1 * xi * s;
+                if (d) {
+                    d[l] = 1;
+                    d[LANES + l] = -xi * s;
+                    d[2 * LANES + l] =
+                        (p3 != 0 ? g * s / p3 : 0) * c + e * p5;
+                    d[3 * LANES + l] = p3 != 0 ? -g * u / p3 * c : 0;
+                    d[4 * LANES + l] = h * c;
+                    d[5 * LANES + l] = fitter.cs_flag ? e * (p2 - xi) : 0;
+                }
+            }
+        };
+
+        void chiSquare(const double *pp, double *ch) const {
+            double f[LANES];
+            std::fill(ch, ch + LANES, 0.);
+            for (int i = 0; i < np; i++) {
+                evaluate(pp, i, f, NULL);
+                for (int l = 0; l < LANES; l++) {
+                    double r = y[i * LANES + l] - f[l];
+                    ch[l] += w[i * LANES + l] * r * r;
+                }
+            }
+        };
+
+        /** alpha = J^T W J, beta = J^T W r for all lanes */
+        void normalEquations() {
+            std::fill(alpha, alpha + NPAR * NPAR * LANES, 0.);
+            std::fill(beta, beta + NPAR * LANES, 0.);
+            double f[LANES], d[NPAR * LANES];
+            for (int i = 0; i < np; i++) {
+                evaluate(p, i, f, d);
+                const double *yi = &y[i * LANES], *wi = &w[i * LANES];
+                for (int a = 0; a < NPAR; a++) {
+                    for (int l = 0; l < LANES; l++)
+                        beta[a * LANES + l] +=
+                            wi[l] * d[a * LANES + l] * (yi[l] - f[l]);
+                    for (int b = 0; b <= a; b++)
+                        for (int l = 0; l < LANES; l++)
+                            alpha[(a * NPAR + b) * LANES + l] +=
+                                wi[l] * d[a * LANES + l] * d[b * LANES + l];
+                }
+            }
+        };
+
+        /** Cholesky decomposition of the (damped) matrix of a lane, fixed
+         * parameters removed */
+        int decompose(int l, double lambda, double m[NPAR][NPAR], int &n,
+                      int *idx) const {
+            n = 0;
+            for (int a = 0; a < NPAR; a++)
+                if (alpha[(a * NPAR + a) * LANES + l] > 0)
+                    idx[n++] = a;
+            for (int i = 0; i < n; i++)
+                for (int j = 0; j <= i; j++) {
+                    double v = alpha[(idx[i] * NPAR + idx[j]) * LANES + l];
+                    if (i == j)
+                        v *= 1 + lambda;
+                    for (int k = 0; k < j; k++)
+                        v -= m[i][k] * m[j][k];
+                    if (i == j) {
+                        if (v <= 0)
+                            return 0;
+                        m[i][i] = std::sqrt(v);
+                    } else
+                        m[i][j] = v / m[j][j];
+                }
+            return 1;
+        };
+
+        int solve(int l, double lambda, double *delta) const {
+            double m[NPAR][NPAR], z[NPAR];
+            int idx[NPAR], n;
+            std::fill(delta, delta + NPAR, 0.);
+            if (!decompose(l, lambda, m, n, idx))
+                return 0;
+            for (int i = 0; i < n; i++) {
+                z[i] = beta[idx[i] * LANES + l];
+                for (int k = 0; k < i; k++)
+                    z[i] -= m[i][k] * z[k];
+                z[i] /= m[i][i];
+            }
+            for (int i = n - 1; i >= 0; i--) {
+                for (int k = i + 1; k < n; k++)
+                    z[i] -= m[k][i] * z[k];
+                z[i] /= m[i][i];
+                delta[idx[i]] = z[i];
+            }
+            return 1;
+        };
+
+        /** diagonal of the inverse of J^T W J */
+        int covarianceDiagonal(int l, double *cov) const {
+            double m[NPAR][NPAR];
+            int idx[NPAR], n;
+            std::fill(cov, cov + NPAR, 0.);
+            if (!decompose(l, 0, m, n, idx))
+                return 0;
+            // inverse of L, then sum of squares of its columns
+            double inv[NPAR][NPAR] = {};
+            for (int i = 0; i < n; i++) {
+                inv[i][i] = 1 / m[i][i];
+                for (int j = 0; j < i; j++) {
+                    double v = 0;
+                    for (int k = j; k < i; k++)
+                        v -= m[i][k] * inv[k][j];
+                    inv[i][j] = v / m[i][i];
+                }
+            }
+            for (int j = 0; j < n; j++)
+                for (int i = j; i < n; i++)
+                    cov[idx[j]] += inv[i][j] * inv[i][j];
+            return 1;
+        };
+
+        const sCurveFitter &fitter;
+        const std::vector<int> &points;
+        const int np;
+        std::vector<double> x;
+        std::vector<double> y; /**< counts, [point][lane] */
+        std::vector<double> w; /**< 1/counts, 0 for empty points */
+        double p[NPAR * LANES];
+        double alpha[NPAR * NPAR * LANES];
+        double beta[NPAR * LANES];
+    };
+
+    int sign;
+    int nThreads;
+    double fit_min, fit_max;
+    double startPar[NPAR];
+    int cs_flag;
+    int maxIterations;
+};
+
+#endif
@@ -60,7 +60,7 @@ class singlePhotonDetector : public analogDetector<uint16_t> {
         : analogDetector<uint16_t>(d, sign, cm, nped, nnx, nny, gm, gs),
           nDark(nd), eventMask(NULL), nSigma(nsigma), eMin(-1), eMax(-1),
           clusterSize(csize), clusterSizeY(csize), c2(1), c3(1), clusters(NULL),
-          quad(UNDEFINED_QUADRANT), tot(0), quadTot(0) {
+          quad(UNDEFINED_QUADRANT), tot(0), quadTot(0), clusterOut(NULL) {
 
         fm = new pthread_mutex_t;
 
@@ -130,6 +130,7 @@ class singlePhotonDetector : public analogDetector<uint16_t> {
 
         setClusterSize(clusterSize);
         fm = orig->fm;
+        clusterOut = orig->clusterOut;
 
         quad = UNDEFINED_QUADRANT;
         tot = 0;
@@ -648,7 +649,10 @@ class singlePhotonDetector : public analogDetector<uint16_t> {
         //(clusters+i)->write(f);
     };
     void writeClusters(int fn) {
-        if (myFile) {
+        if (clusterOut) {
+            // locks its own mutex
+            clusterOut->writeFrame(fn, clusters, nphFrame);
+        } else if (myFile) {
             // cout << "++" << endl;
             pthread_mutex_lock(fm);
             //   cout <<"**********************************"<< fn << " " <<
@@ -696,6 +700,17 @@ class singlePhotonDetector : public analogDetector<uint16_t> {
 
     void setMutex(pthread_mutex_t *m) { fm = m; };
 
+    /** sets the columnar cluster file to write the clusters to (shared by
+        all threads), used instead of the file pointer if not NULL
+        \param cf cluster file opened for writing
+        \returns previous cluster file
+    */
+    virtual clusterFile *setClusterFile(clusterFile *cf) {
+        clusterFile *ret = clusterOut;
+        clusterOut = cf;
+        return ret;
+    };
+
   protected:
     int nDark; /**< number of frames to be used at the beginning of the dataset
                   to calculate pedestal without applying photon discrimination
@@ -717,6 +732,7 @@ class singlePhotonDetector : public analogDetector<uint16_t> {
 
     //    double **val;
     pthread_mutex_t *fm;
+    clusterFile *clusterOut; /**< columnar cluster file, if any */
 };
 
 #endif
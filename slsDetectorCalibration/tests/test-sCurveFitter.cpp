@@ -0,0 +1,151 @@
+// SPDX-License-Identifier: LGPL-3.0-or-other
+// Copyright (C) 2021 Contributors to the SLS Detector Package
+#include "catch.hpp"
+#include "sCurveFitter.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+
+// energyCalibrationFunctions::erfFunctionChargeSharing, without ROOT
+double erfFunctionChargeSharing(double x, const double *par, int sign) {
+    double arg = 0;
+    if (par[3] != 0)
+        arg = (par[2] - x) / par[3];
+    double erfFunction = par[4] / 2. * (1 + std::erf(sign * arg / std::sqrt(2.)));
+    return erfFunction * (1 + par[5] * (par[2] - x)) + par[0] -
+           par[1] * x * sign;
+}
+
+struct SCurves {
+    std::vector<double> x;
+    std::vector<double> counts; // counts[ipoint * nch + ich]
+    std::vector<double> par;    // par[ich * NPAR + ip]
+};
+
+// nch channels of a threshold scan with parameters spread around a
+// typical pixel, with poisson noise if gen is not NULL
+SCurves makeSCurves(int nch, int sign, std::mt19937 *gen) {
+    const int npoints = 101;
+    SCurves s;
+    for (int i = 0; i < npoints; ++i)
+        s.x.push_back(2. * i);
+    for (int ich = 0; ich < nch; ++ich) {
+        double p[sCurveFitter::NPAR] = {50. + ich, 0.1, 90. + 0.7 * ich,
+                                        8. + 0.1 * ich, 2000. + 20. * ich,
+                                        0.002};
+        s.par.insert(s.par.end(), p, p + sCurveFitter::NPAR);
+    }
+    s.counts.resize(npoints * nch);
+    for (int i = 0; i < npoints; ++i) {
+        for (int ich = 0; ich < nch; ++ich) {
+            double mu = erfFunctionChargeSharing(
+                s.x[i], &s.par[ich * sCurveFitter::NPAR], sign);
+            if (gen) {
+                std::poisson_distribution<int> poisson(mu);
+                mu = poisson(*gen);
+            }
+            s.counts[i * nch + ich] = mu;
+        }
+    }
+    return s;
+}
+
+} // namespace
+
+TEST_CASE("sCurveFitter curve is erfFunctionChargeSharing") {
+    const double par[sCurveFitter::NPAR] = {50, 0.1, 90, 8, 2000, 0.002};
+    for (int sign : {-1, 1}) {
+        for (double x : {0., 60., 90., 97.5, 150.}) {
+            CHECK(sCurveFitter::scurve(x, par, sign) ==
+                  Approx(erfFunctionChargeSharing(x, par, sign)));
+        }
+    }
+}
+
+TEST_CASE("sCurveFitter recovers the parameters of exact s-curves") {
+    const int nch = 20; // more than two groups of lanes
+    for (int sign : {-1, 1}) {
+        SCurves s = makeSCurves(nch, sign, nullptr);
+        sCurveFitter fitter(sign, 2);
+        std::vector<double> par(nch * sCurveFitter::NPAR);
+        std::vector<double> chi2(nch);
+        CHECK(fitter.fitSCurves(static_cast<int>(s.x.size()), &s.x[0],
+                                &s.counts[0], nch, &par[0], nullptr,
+                                &chi2[0]) == nch);
+        for (int ich = 0; ich < nch; ++ich) {
+            for (int ip = 0; ip < sCurveFitter::NPAR; ++ip) {
+                const int i = ich * sCurveFitter::NPAR + ip;
+                CHECK(par[i] == Approx(s.par[i]).epsilon(1e-4).margin(1e-6));
+            }
+            CHECK(chi2[ich] < 1e-6);
+        }
+    }
+}
+
+TEST_CASE("sCurveFitter parameters of noisy s-curves within their errors") {
+    const int nch = 16;
+    const int sign = -1;
+    std::mt19937 gen(42);
+    SCurves s = makeSCurves(nch, sign, &gen);
+    sCurveFitter fitter(sign, 2);
+    std::vector<double> par(nch * sCurveFitter::NPAR);
+    std::vector<double> epar(nch * sCurveFitter::NPAR);
+    std::vector<double> chi2(nch);
+    CHECK(fitter.fitSCurves(static_cast<int>(s.x.size()), &s.x[0],
+                            &s.counts[0], nch, &par[0], &epar[0],
+                            &chi2[0]) == nch);
+    for (int ich = 0; ich < nch; ++ich) {
+        // inflection point, noise and amplitude
+        for (int ip : {2, 3, 4}) {
+            const int i = ich * sCurveFitter::NPAR + ip;
+            CHECK(epar[i] > 0);
+            CHECK(std::fabs(par[i] - s.par[i]) < 5 * epar[i]);
+        }
+        CHECK(par[ich * sCurveFitter::NPAR + 2] ==
+              Approx(s.par[ich * sCurveFitter::NPAR + 2]).margin(1.));
+        CHECK(chi2[ich] > 0.5);
+        CHECK(chi2[ich] < 2);
+    }
+}
+
+TEST_CASE("sCurveFitter fixes the charge sharing slope") {
+    const int nch = 4;
+    const int sign = -1;
+    SCurves s = makeSCurves(nch, sign, nullptr);
+    for (int ich = 0; ich < nch; ++ich)
+        s.par[ich * sCurveFitter::NPAR + 5] = 0;
+    for (size_t i = 0; i != s.x.size(); ++i)
+        for (int ich = 0; ich < nch; ++ich)
+            s.counts[i * nch + ich] = erfFunctionChargeSharing(
+                s.x[i], &s.par[ich * sCurveFitter::NPAR], sign);
+    sCurveFitter fitter(sign, 1);
+    fitter.setChargeSharing(0);
+    std::vector<double> par(nch * sCurveFitter::NPAR);
+    CHECK(fitter.fitSCurves(static_cast<int>(s.x.size()), &s.x[0],
+                            &s.counts[0], nch, &par[0]) == nch);
+    for (int ich = 0; ich < nch; ++ich) {
+        CHECK(par[ich * sCurveFitter::NPAR + 5] == 0);
+        CHECK(par[ich * sCurveFitter::NPAR + 2] ==
+              Approx(s.par[ich * sCurveFitter::NPAR + 2]).epsilon(1e-4));
+    }
+}
+
+TEST_CASE("sCurveFitter linear calibration of the inflection points") {
+    const double en[] = {5, 8, 13, 17.5};
+    const double gain = 4.5, off = 12;
+    double fl[4], efl[4];
+    for (int i = 0; i < 4; ++i) {
+        fl[i] = off - gain * en[i]; // scan sign -1
+        efl[i] = 0.5;
+    }
+    sCurveFitter fitter(-1);
+    double g, o, eg, eo;
+    fitter.linearCalibration(4, en, nullptr, fl, efl, g, o, eg, eo);
+    CHECK(g == Approx(gain));
+    CHECK(o == Approx(off));
+    CHECK(eg > 0);
+    CHECK(eo > 0);
+}
@@ -0,0 +1,95 @@
+// SPDX-License-Identifier: LGPL-3.0-or-other
+// Copyright (C) 2021 Contributors to the SLS Detector Package
+#pragma once
+#include "sls/tiffIO.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//Float32 images of nrow x ncol written back to back in one raw file, with
+//a json sidecar (fname.json) describing the stack. Every image gets its own
+//slot from Reserve(), so images can be written from several threads.
+//Throws std::runtime_error if the file cannot be created
+class RawFloatStack {
+  public:
+    RawFloatStack(const std::string &filename, int rows, int cols);
+    //Writes the sidecar and closes the file
+    ~RawFloatStack();
+    RawFloatStack(const RawFloatStack &) = delete;
+    RawFloatStack &operator=(const RawFloatStack &) = delete;
+
+    //Slot for the next image
+    size_t Reserve();
+    //Writes nrow * ncol floats to the slot, thread safe
+    //Returns false and prints message on failure
+    bool Write(size_t index, const float *imgData);
+    //Writes the sidecar, the stack can still grow afterwards
+    void WriteSidecar() const;
+
+    size_t Size() const { return nimages; }
+    int Rows() const { return nrow; }
+    int Cols() const { return ncol; }
+
+  private:
+    const std::string fname;
+    const int nrow;
+    const int ncol;
+    int fd{-1};
+    std::atomic<size_t> nimages{0};
+};
+
+//Writes images in the background so that processing does not wait for the
+//disk. The images are filled into buffers taken from a fixed pool and
+//queued, the writer threads give the buffers back once they are written.
+//GetBuffer blocks while all buffers are queued, which bounds both the
+//memory and the backlog.
+class ImageWriter {
+  public:
+    explicit ImageWriter(int nthreads = 2, int nbuffers = 8,
+                         const TiffOptions &tiffOptions = TiffOptions());
+    //Writes everything queued before returning
+    ~ImageWriter();
+    ImageWriter(const ImageWriter &) = delete;
+    ImageWriter &operator=(const ImageWriter &) = delete;
+
+    //Free buffer of at least size floats, blocks until one is available
+    float *GetBuffer(size_t size);
+    //Queues the buffer to be written to a tiff file and returns immediately
+    void WriteTiff(float *buffer, const std::string &fname, int nrow,
+                   int ncol);
+    //Queues the buffer as the next image of the stack, which has to outlive
+    //the write (call Flush before destroying it)
+    void WriteRaw(float *buffer, RawFloatStack &stack);
+    //Blocks until everything queued is written
+    void Flush();
+
+  private:
+    struct Job {
+        int ibuffer;
+        std::string fname;
+        int nrow;
+        int ncol;
+        RawFloatStack *stack;
+        size_t index;
+    };
+    int bufferIndex(const float *buffer) const;
+    void push(const float *buffer, Job job);
+    void run();
+
+    const TiffOptions options;
+    std::vector<std::vector<float>> buffers;
+    std::vector<int> freeBuffers;
+    std::deque<Job> jobs;
+    int writing{0};
+    bool stop{false};
+    std::mutex mutex;
+    std::condition_variable jobAvailable;
+    std::condition_variable bufferAvailable;
+    std::condition_variable idle;
+    std::vector<std::thread> threads;
+};
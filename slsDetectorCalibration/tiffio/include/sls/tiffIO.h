@@ -3,12 +3,32 @@
 #pragma once
 #include <cstdint>
 
+//Compression of written tiff files. Deflate and zstd at a low level are
+//the fast ones, zstd needs a libtiff built with it
+enum class TiffCompression { None, LZW, Deflate, Zstd };
+
+//Layout and compression of written tiff files. Compressed files use the
+//floating point predictor, which makes float images compress much better
+struct TiffOptions {
+    TiffCompression compression{TiffCompression::None};
+    int level{1};        // 1-9 for deflate, 1-19 for zstd
+    int rowsPerStrip{0}; // 0 for the default of ncol rows
+    int tileSize{0};     // tiles of tileSize x tileSize if > 0, multiple of 16
+};
+
 //Write 32bit float data to tiff file
 //Always returns nullptr, prints message on failure
 void *WriteToTiff(float *imgData, const char *imgname, int nrow, int ncol);
 
+//Write 32bit float data to tiff file with the given layout and compression
+//Falls back to no compression if libtiff lacks the codec
+//Always returns nullptr, prints message on failure
+void *WriteToTiff(const float *imgData, const char *imgname, int nrow,
+                  int ncol, const TiffOptions &options);
+
 //Read 32bit float data from tiff file, returns pointer to data and sets
 //image dimensions in the out parameters nrow, ncol. 
+//Stripped, tiled and compressed files are read alike
 //Returns nullptr on failure
 //The caller is responsible to deallocate the memory that the returned
 //pointer points to. 
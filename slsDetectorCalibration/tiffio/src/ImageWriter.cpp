@@ -0,0 +1,156 @@
+// SPDX-License-Identifier: LGPL-3.0-or-other
+// Copyright (C) 2021 Contributors to the SLS Detector Package
+
+#include "sls/ImageWriter.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <unistd.h>
+
+RawFloatStack::RawFloatStack(const std::string &filename, int rows, int cols)
+    : fname(filename), nrow(rows), ncol(cols) {
+    fd = open(fname.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        throw std::runtime_error("could not open file " + fname +
+                                 " for writing");
+}
+
+RawFloatStack::~RawFloatStack() {
+    WriteSidecar();
+    close(fd);
+}
+
+size_t RawFloatStack::Reserve() { return nimages++; }
+
+bool RawFloatStack::Write(size_t index, const float *imgData) {
+    const size_t size = sizeof(float) * nrow * ncol;
+    const char *src = reinterpret_cast<const char *>(imgData);
+    off_t offset = static_cast<off_t>(index * size);
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = pwrite(fd, src + done, size - done, offset + done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0) {
+            std::cout << "could not write image " << index << " to file "
+                      << fname << ": " << strerror(errno) << '\n';
+            return false;
+        }
+        done += n;
+    }
+    return true;
+}
+
+void RawFloatStack::WriteSidecar() const {
+    const uint16_t one = 1;
+    const bool little = *reinterpret_cast<const uint8_t *>(&one) == 1;
+    std::ofstream json(fname + ".json");
+    if (!json) {
+        std::cout << "could not open file " << fname << ".json for writing\n";
+        return;
+    }
+    // file name relative to the sidecar, which sits next to it
+    std::string base = fname.substr(fname.find_last_of('/') + 1);
+    json << "{\n"
+         << "    \"file\": \"" << base << "\",\n"
+         << "    \"dtype\": \"float32\",\n"
+         << "    \"byteOrder\": \"" << (little ? "little" : "big") << "\",\n"
+         << "    \"nrow\": " << nrow << ",\n"
+         << "    \"ncol\": " << ncol << ",\n"
+         << "    \"nimages\": " << nimages.load() << "\n"
+         << "}\n";
+}
+
+ImageWriter::ImageWriter(int nthreads, int nbuffers,
+                         const TiffOptions &tiffOptions)
+    : options(tiffOptions), buffers(std::max(nbuffers, 1)) {
+    for (int i = static_cast<int>(buffers.size()) - 1; i >= 0; --i)
+        freeBuffers.push_back(i);
+    for (int i = 0; i < std::max(nthreads, 1); ++i)
+        threads.emplace_back(&ImageWriter::run, this);
+}
+
+ImageWriter::~ImageWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    jobAvailable.notify_all();
+    for (auto &t : threads)
+        t.join();
+}
+
+float *ImageWriter::GetBuffer(size_t size) {
+    std::unique_lock<std::mutex> lock(mutex);
+    bufferAvailable.wait(lock, [this] { return !freeBuffers.empty(); });
+    int i = freeBuffers.back();
+    freeBuffers.pop_back();
+    // grows once to the largest image, then is reused as is
+    if (buffers[i].size() < size)
+        buffers[i].resize(size);
+    return buffers[i].data();
+}
+
+void ImageWriter::WriteTiff(float *buffer, const std::string &fname,
+                            int nrow, int ncol) {
+    push(buffer, Job{-1, fname, nrow, ncol, nullptr, 0});
+}
+
+void ImageWriter::WriteRaw(float *buffer, RawFloatStack &stack) {
+    // the slot is taken now, so the images keep the order they are queued in
+    push(buffer, Job{-1, std::string(), stack.Rows(), stack.Cols(), &stack,
+                     stack.Reserve()});
+}
+
+void ImageWriter::Flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return jobs.empty() && writing == 0; });
+}
+
+int ImageWriter::bufferIndex(const float *buffer) const {
+    for (size_t i = 0; i < buffers.size(); ++i) {
+        if (buffers[i].data() == buffer)
+            return static_cast<int>(i);
+    }
+    throw std::runtime_error("buffer was not taken from the image writer");
+}
+
+void ImageWriter::push(const float *buffer, Job job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job.ibuffer = bufferIndex(buffer);
+        jobs.push_back(std::move(job));
+    }
+    jobAvailable.notify_one();
+}
+
+void ImageWriter::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        jobAvailable.wait(lock, [this] { return stop || !jobs.empty(); });
+        if (jobs.empty())
+            return;
+        Job job = std::move(jobs.front());
+        jobs.pop_front();
+        ++writing;
+        lock.unlock();
+
+        const float *data = buffers[job.ibuffer].data();
+        if (job.stack)
+            job.stack->Write(job.index, data);
+        else
+            WriteToTiff(data, job.fname.c_str(), job.nrow, job.ncol,
+                        options);
+
+        lock.lock();
+        --writing;
+        freeBuffers.push_back(job.ibuffer);
+        bufferAvailable.notify_one();
+        if (jobs.empty() && writing == 0)
+            idle.notify_all();
+    }
+}
@@ -2,10 +2,109 @@
 // Copyright (C) 2021 Contributors to the SLS Detector Package
 
 #include "sls/tiffIO.h"
+#include <algorithm>
 #include <iostream>
 #include <tiffio.h>
+#include <vector>
+
+namespace {
+
+// libtiff codec for the requested compression, none if it is not available
+uint16_t codec(const TiffOptions &options) {
+    uint16_t c = COMPRESSION_NONE;
+    switch (options.compression) {
+    case TiffCompression::LZW:
+        c = COMPRESSION_LZW;
+        break;
+    case TiffCompression::Deflate:
+        c = COMPRESSION_ADOBE_DEFLATE;
+        break;
+    case TiffCompression::Zstd:
+#ifdef COMPRESSION_ZSTD
+        c = COMPRESSION_ZSTD;
+#endif
+        break;
+    case TiffCompression::None:
+        break;
+    }
+    if (options.compression != TiffCompression::None &&
+        (c == COMPRESSION_NONE || !TIFFIsCODECConfigured(c))) {
+        std::cout << "tiff compression not available, writing uncompressed\n";
+        return COMPRESSION_NONE;
+    }
+    return c;
+}
+
+bool writeStrips(TIFF *tif, const float *imgData, uint32_t nrow,
+                 uint32_t ncol, uint32_t rowsPerStrip, bool compressed) {
+    TIFFSetField(tif, TIFFTAG_ROWSPERSTRIP, rowsPerStrip);
+    // the predictor works in place, so compressed strips are copied first
+    std::vector<float> strip(compressed ? rowsPerStrip * ncol : 0);
+    for (uint32_t row = 0, s = 0; row < nrow; row += rowsPerStrip, ++s) {
+        uint32_t n = std::min(rowsPerStrip, nrow - row);
+        const float *src = imgData + static_cast<size_t>(row) * ncol;
+        void *buf = const_cast<float *>(src);
+        if (compressed) {
+            std::copy(src, src + n * ncol, strip.begin());
+            buf = strip.data();
+        }
+        if (TIFFWriteEncodedStrip(tif, s, buf, n * ncol * sizeof(float)) < 0)
+            return false;
+    }
+    return true;
+}
+
+bool writeTiles(TIFF *tif, const float *imgData, uint32_t nrow,
+                uint32_t ncol, uint32_t tileSize) {
+    TIFFSetField(tif, TIFFTAG_TILEWIDTH, tileSize);
+    TIFFSetField(tif, TIFFTAG_TILELENGTH, tileSize);
+    // tiles at the edges are padded with zeros
+    std::vector<float> tile(tileSize * tileSize);
+    for (uint32_t y = 0; y < nrow; y += tileSize) {
+        for (uint32_t x = 0; x < ncol; x += tileSize) {
+            std::fill(tile.begin(), tile.end(), 0);
+            uint32_t nx = std::min(tileSize, ncol - x);
+            uint32_t ny = std::min(tileSize, nrow - y);
+            for (uint32_t iy = 0; iy < ny; ++iy) {
+                const float *src =
+                    imgData + static_cast<size_t>(y + iy) * ncol + x;
+                std::copy(src, src + nx, tile.begin() + iy * tileSize);
+            }
+            if (TIFFWriteTile(tif, tile.data(), x, y, 0, 0) < 0)
+                return false;
+        }
+    }
+    return true;
+}
+
+bool readTiles(TIFF *tif, float *imgData, uint32_t nrow, uint32_t ncol) {
+    uint32_t tw = 0, th = 0;
+    TIFFGetField(tif, TIFFTAG_TILEWIDTH, &tw);
+    TIFFGetField(tif, TIFFTAG_TILELENGTH, &th);
+    std::vector<float> tile(static_cast<size_t>(tw) * th);
+    for (uint32_t y = 0; y < nrow; y += th) {
+        for (uint32_t x = 0; x < ncol; x += tw) {
+            if (TIFFReadTile(tif, tile.data(), x, y, 0, 0) < 0)
+                return false;
+            uint32_t nx = std::min(tw, ncol - x);
+            uint32_t ny = std::min(th, nrow - y);
+            for (uint32_t iy = 0; iy < ny; ++iy) {
+                std::copy(tile.begin() + iy * tw, tile.begin() + iy * tw + nx,
+                          imgData + static_cast<size_t>(y + iy) * ncol + x);
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace
 
 void *WriteToTiff(float *imgData, const char *imgname, int nrow, int ncol) {
+    return WriteToTiff(imgData, imgname, nrow, ncol, TiffOptions());
+}
+
+void *WriteToTiff(const float *imgData, const char *imgname, int nrow,
+                  int ncol, const TiffOptions &options) {
     constexpr uint32_t sampleperpixel = 1;
     TIFF *tif = TIFFOpen(imgname, "w");
     if (tif) {
@@ -17,12 +116,34 @@ void *WriteToTiff(float *imgData, const char *imgname, int nrow, int ncol) {
         TIFFSetField(tif, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
         TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_MINISBLACK);
         TIFFSetField(tif, TIFFTAG_SAMPLEFORMAT, SAMPLEFORMAT_IEEEFP);
-        TIFFSetField(tif, TIFFTAG_ROWSPERSTRIP,
-                     TIFFDefaultStripSize(tif, ncol * sampleperpixel));
 
-        for (int irow = 0; irow < nrow; irow++) {
-            TIFFWriteScanline(tif, &imgData[irow * ncol], irow, 0);
+        uint16_t compression = codec(options);
+        TIFFSetField(tif, TIFFTAG_COMPRESSION, compression);
+        if (compression != COMPRESSION_NONE) {
+            TIFFSetField(tif, TIFFTAG_PREDICTOR, PREDICTOR_FLOATINGPOINT);
+            if (compression == COMPRESSION_ADOBE_DEFLATE)
+                TIFFSetField(tif, TIFFTAG_ZIPQUALITY, options.level);
+#ifdef TIFFTAG_ZSTD_LEVEL
+            if (compression == COMPRESSION_ZSTD)
+                TIFFSetField(tif, TIFFTAG_ZSTD_LEVEL, options.level);
+#endif
+        }
+
+        bool ok;
+        if (options.tileSize > 0) {
+            // tiff tiles are multiples of 16
+            ok = writeTiles(tif, imgData, nrow, ncol,
+                            (options.tileSize + 15) / 16 * 16);
+        } else {
+            uint32_t rowsPerStrip =
+                options.rowsPerStrip > 0
+                    ? options.rowsPerStrip
+                    : TIFFDefaultStripSize(tif, ncol * sampleperpixel);
+            ok = writeStrips(tif, imgData, nrow, ncol, rowsPerStrip,
+                             compression != COMPRESSION_NONE);
         }
+        if (!ok)
+            std::cout << "could not write data to file " << imgname << '\n';
         TIFFClose(tif);
     } else {
         std::cout << "could not open file " << imgname << " for writing\n";
@@ -36,8 +157,14 @@ float *ReadFromTiff(const char *imgname, uint32_t &nrow, uint32_t &ncol) {
         TIFFGetField(tif, TIFFTAG_IMAGEWIDTH, &ncol);
         TIFFGetField(tif, TIFFTAG_IMAGELENGTH, &nrow);
         float *imgData = new float[ncol * nrow];
-        for (uint32_t irow = 0; irow < nrow; ++irow) {
-            TIFFReadScanline(tif, &imgData[irow * ncol], irow);
+        if (TIFFIsTiled(tif)) {
+            if (!readTiles(tif, imgData, nrow, ncol))
+                std::cout << "could not read tiles of file " << imgname
+                          << '\n';
+        } else {
+            for (uint32_t irow = 0; irow < nrow; ++irow) {
+                TIFFReadScanline(tif, &imgData[irow * ncol], irow);
+            }
         }
         TIFFClose(tif);
         return imgData;
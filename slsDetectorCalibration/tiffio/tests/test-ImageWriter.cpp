@@ -0,0 +1,126 @@
+// SPDX-License-Identifier: LGPL-3.0-or-other
+// Copyright (C) 2021 Contributors to the SLS Detector Package
+
+#include "catch.hpp"
+#include "sls/ImageWriter.h"
+#include "sls/tiffIO.h"
+#include <cstdio>
+#include <fstream>
+#include <ftw.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static int remove_callback(const char *pathname,
+                           __attribute__((unused)) const struct stat *sbuf,
+                           __attribute__((unused)) int type,
+                           __attribute__((unused)) struct FTW *ftwb) {
+    return remove(pathname);
+}
+
+static void remove_dir(const char *dirname) {
+    nftw(dirname, remove_callback, FOPEN_MAX,
+         FTW_DEPTH | FTW_MOUNT | FTW_PHYS);
+}
+
+static std::vector<float> test_image(int nrow, int ncol, float offset) {
+    std::vector<float> data(nrow * ncol);
+    for (size_t i = 0; i != data.size(); ++i)
+        data[i] = offset + 0.25f * i;
+    return data;
+}
+
+static bool read_back(const std::string &fname, int nrow, int ncol,
+                      const std::vector<float> &data) {
+    uint32_t r = 0, c = 0;
+    float *ptr = ReadFromTiff(fname.c_str(), r, c);
+    bool same = ptr != nullptr && r == static_cast<uint32_t>(nrow) &&
+                c == static_cast<uint32_t>(ncol) &&
+                std::equal(data.begin(), data.end(), ptr);
+    delete[] ptr;
+    return same;
+}
+
+TEST_CASE("Compressed, stripped and tiled tiff files read back the same") {
+    char tmp[] = "/tmp/tmpdir.XXXXXX";
+    char *tmp_dirname = mkdtemp(tmp);
+    REQUIRE(tmp_dirname != nullptr);
+    const std::string dir(tmp_dirname);
+
+    // not a multiple of the strip or tile size
+    const int nrow = 37, ncol = 53;
+    auto data = test_image(nrow, ncol, -3);
+
+    std::vector<TiffOptions> layouts(5);
+    layouts[1].rowsPerStrip = 4;
+    layouts[2].compression = TiffCompression::Deflate;
+    layouts[3].compression = TiffCompression::LZW;
+    layouts[3].rowsPerStrip = 7;
+    layouts[4].compression = TiffCompression::Deflate;
+    layouts[4].tileSize = 16;
+    for (size_t i = 0; i != layouts.size(); ++i) {
+        std::string fname = dir + "/test" + std::to_string(i) + ".tif";
+        WriteToTiff(data.data(), fname.c_str(), nrow, ncol, layouts[i]);
+        CHECK(read_back(fname, nrow, ncol, data));
+    }
+    remove_dir(tmp_dirname);
+}
+
+TEST_CASE("Queued images are written as tiff and as a raw stack") {
+    char tmp[] = "/tmp/tmpdir.XXXXXX";
+    char *tmp_dirname = mkdtemp(tmp);
+    REQUIRE(tmp_dirname != nullptr);
+    const std::string dir(tmp_dirname);
+
+    const int nrow = 20, ncol = 30, nimages = 10;
+    std::vector<std::vector<float>> images;
+    for (int i = 0; i != nimages; ++i)
+        images.push_back(test_image(nrow, ncol, 100 * i));
+
+    {
+        RawFloatStack stack(dir + "/stack.raw", nrow, ncol);
+        // fewer buffers than images, GetBuffer has to wait for the writers
+        ImageWriter writer(3, 2);
+        for (int i = 0; i != nimages; ++i) {
+            float *buf = writer.GetBuffer(nrow * ncol);
+            std::copy(images[i].begin(), images[i].end(), buf);
+            writer.WriteTiff(buf, dir + "/img" + std::to_string(i) + ".tif",
+                             nrow, ncol);
+            buf = writer.GetBuffer(nrow * ncol);
+            std::copy(images[i].begin(), images[i].end(), buf);
+            writer.WriteRaw(buf, stack);
+        }
+        writer.Flush();
+        CHECK(stack.Size() == nimages);
+    }
+
+    for (int i = 0; i != nimages; ++i) {
+        CHECK(read_back(dir + "/img" + std::to_string(i) + ".tif", nrow,
+                        ncol, images[i]));
+    }
+
+    std::ifstream raw(dir + "/stack.raw", std::ios::binary);
+    std::vector<float> frame(nrow * ncol);
+    for (int i = 0; i != nimages; ++i) {
+        raw.read(reinterpret_cast<char *>(frame.data()),
+                 frame.size() * sizeof(float));
+        CHECK(frame == images[i]);
+    }
+    raw.read(reinterpret_cast<char *>(frame.data()), 1);
+    CHECK(raw.eof());
+
+    std::ifstream json(dir + "/stack.raw.json");
+    std::stringstream sidecar;
+    sidecar << json.rdbuf();
+    CHECK(sidecar.str().find("\"dtype\": \"float32\"") != std::string::npos);
+    CHECK(sidecar.str().find("\"nrow\": 20,") != std::string::npos);
+    CHECK(sidecar.str().find("\"ncol\": 30,") != std::string::npos);
+    CHECK(sidecar.str().find("\"nimages\": 10") != std::string::npos);
+    remove_dir(tmp_dirname);
+}
+
+TEST_CASE("Buffers not taken from the image writer are rejected") {
+    ImageWriter writer(1, 1);
+    std::vector<float> data(4);
+    REQUIRE_THROWS(writer.WriteTiff(data.data(), "/tmp/never.tif", 2, 2));
+}
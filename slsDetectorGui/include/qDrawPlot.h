@@ -4,7 +4,12 @@
 #include "qDefs.h"
 #include "sls/Detector.h"
 #include "ui_form_plot.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <mutex>
+#include <thread>
+#include <vector>
 
 class SlsQt1DPlot;
 class SlsQtH1D;
@@ -16,6 +21,21 @@ class QResizeEvent;
 class qDrawPlot : public QWidget, private Ui::PlotObject {
     Q_OBJECT
 
+    /** copy of a frame from the data call back waiting to be processed */
+    struct PendingFrame {
+        std::vector<char> data;
+        int nx{0};
+        int ny{0};
+        int databytes{0};
+        int dynamicRange{0};
+        double progress{0};
+        std::string fileName;
+        uint64_t fileIndex{0};
+        bool completeImage{false};
+        uint64_t frameIndex{0};
+        uint32_t subFrameIndex{0};
+    };
+
   public:
     qDrawPlot(QWidget *parent, sls::Detector *detector);
     ~qDrawPlot();
@@ -83,16 +103,26 @@ class qDrawPlot : public QWidget, private Ui::PlotObject {
     void AcquisitionFinished(double currentProgress, int detectorStatus);
     void GetData(detectorData *data, uint64_t frameIndex,
                  uint32_t subFrameIndex);
-    void toDoublePixelData(double *dest, char *source, int size, int databytes,
-                           int dr, double *gaindest = NULL);
-    void Get1dData(double *rawData);
-    void Get2dData(double *rawData);
+    void ProcessThread();
+    void WaitForProcessing();
+    void StopProcessThread();
+    void ProcessFrame(const PendingFrame &frame);
+    void toFloatPixelData(float *dest, const char *source, int size,
+                          int databytes, int dr, float *gaindest = nullptr);
+    void CalculatePixels(double *dest, const double *previous, int size,
+                         bool pedestal, bool accumulate, bool binary,
+                         double binaryMin, double binaryMax);
+    void ReallocatePlotData(int nx, int ny);
+    void AllocateBackData();
+    void Swap1dData();
     void Update1dPlot();
     void Update2dPlot();
     void Update1dXYRange();
     void Update2dXYRange();
 
     static const int NUM_PEDESTAL_FRAMES = 20;
+    /** frames queued before the data call back waits for the processing */
+    static const size_t MAX_PENDING_FRAMES = 2;
     sls::Detector *det;
     slsDetectorDefs::detectorType detType;
 
@@ -129,6 +159,25 @@ class qDrawPlot : public QWidget, private Ui::PlotObject {
     double *gainDatay1d{nullptr};
     double *data2d{nullptr};
     double *gainData{nullptr};
+    // written by the processing thread, swapped with the plotted arrays
+    double *datay1dBack{nullptr};
+    double *gainDatay1dBack{nullptr};
+    double *data2dBack{nullptr};
+    double *gainDataBack{nullptr};
+    unsigned int nBackPixelsX{0};
+    unsigned int nBackPixelsY{0};
+    std::vector<float> rawData;
+    std::vector<float> rawGainData;
+
+    // processing thread
+    std::thread processThread;
+    std::mutex mFrames;
+    std::condition_variable cvFrames;
+    std::deque<PendingFrame> pendingFrames;
+    std::vector<PendingFrame> freeFrames;
+    bool stopProcessing{false};
+    bool isProcessing{false};
+    std::atomic<bool> updatePending{false};
 
     // options
     bool isPlot{true};
@@ -140,7 +189,7 @@ class qDrawPlot : public QWidget, private Ui::PlotObject {
     bool isLines{true};
     bool isMarkers{false};
     bool isPedestal{false};
-    double *pedestalVals{nullptr};
+    float *pedestalVals{nullptr};
     double *tempPedestalVals{nullptr};
     int pedestalCount{0};
     bool resetPedestal{false};
@@ -14,14 +14,18 @@
 #include <QResizeEvent>
 #include <QtConcurrentRun>
 
+#include <algorithm>
+
 qDrawPlot::qDrawPlot(QWidget *parent, sls::Detector *detector)
     : QWidget(parent), det(detector) {
     setupUi(this);
     SetupWidgetWindow();
+    processThread = std::thread(&qDrawPlot::ProcessThread, this);
     LOG(logINFO) << "Plots ready";
 }
 
 qDrawPlot::~qDrawPlot() {
+    StopProcessThread();
     DetachHists();
     for (QVector<SlsQtH1D *>::iterator h = hists1d.begin(); h != hists1d.end();
          ++h) {
@@ -36,6 +40,10 @@ qDrawPlot::~qDrawPlot() {
     delete[] gainDatay1d;
     delete[] data2d;
     delete[] gainData;
+    delete[] datay1dBack;
+    delete[] gainDatay1dBack;
+    delete[] data2dBack;
+    delete[] gainDataBack;
     delete plot1d;
     delete gainhist1d;
     delete gainplot1d;
@@ -367,6 +375,7 @@ void qDrawPlot::SetDataCallBack(bool enable) {
 void qDrawPlot::SetBinary(bool enable, int from, int to) {
     LOG(logINFO) << (enable ? "Enabling" : "Disabling")
                  << " Binary output from " << from << " to " << to;
+    std::lock_guard<std::mutex> lock(mPlots);
     binaryFrom = from;
     binaryTo = to;
     isBinary = enable;
@@ -718,12 +727,13 @@ void qDrawPlot::AcquisitionFinished(double currentProgress,
         LOG(logINFO) << "Acquisition finished [ Status:" << status
                      << ", Progress: " << currentProgress << "% ]";
     }
+    // plot the frames still queued before signalling the end
+    WaitForProcessing();
     emit AcquireFinishedSignal();
 }
 
 void qDrawPlot::GetData(detectorData *data, uint64_t frameIndex,
                         uint32_t subFrameIndex) {
-    std::lock_guard<std::mutex> lock(mPlots);
     LOG(logDEBUG) << "* GetData Callback *" << std::endl
                   << "  frame index: " << frameIndex << std::endl
                   << "  sub frame index: "
@@ -740,15 +750,209 @@ void qDrawPlot::GetData(detectorData *data, uint64_t frameIndex,
                   << "  \t complete image: " << data->completeImage << std::endl
                   << "  ]";
 
-    progress = data->progressIndex;
-    currentAcqIndex = data->fileIndex;
-    currentFrame = frameIndex;
-    LOG(logDEBUG) << "[ Progress:" << progress << "%, Frame:" << currentFrame
-                  << " ]";
+    // wait for a free slot, the data is only valid during the call back
+    std::unique_lock<std::mutex> lock(mFrames);
+    cvFrames.wait(lock, [this] {
+        return stopProcessing || pendingFrames.size() < MAX_PENDING_FRAMES;
+    });
+    if (stopProcessing) {
+        return;
+    }
+    PendingFrame frame;
+    if (!freeFrames.empty()) {
+        frame = std::move(freeFrames.back());
+        freeFrames.pop_back();
+    }
+    lock.unlock();
+
+    // recycled buffers keep their capacity
+    frame.data.assign(data->data, data->data + data->databytes);
+    frame.nx = data->nx;
+    frame.ny = data->ny;
+    frame.databytes = data->databytes;
+    frame.dynamicRange = data->dynamicRange;
+    frame.progress = data->progressIndex;
+    frame.fileName = data->fileName;
+    frame.fileIndex = data->fileIndex;
+    frame.completeImage = data->completeImage;
+    frame.frameIndex = frameIndex;
+    frame.subFrameIndex = subFrameIndex;
+
+    lock.lock();
+    pendingFrames.push_back(std::move(frame));
+    cvFrames.notify_all();
+    LOG(logDEBUG) << "End of Get Data";
+}
+
+void qDrawPlot::ProcessThread() {
+    LOG(logDEBUG) << "Processing Thread started";
+    std::unique_lock<std::mutex> lock(mFrames);
+    while (true) {
+        cvFrames.wait(lock, [this] {
+            return stopProcessing || !pendingFrames.empty();
+        });
+        if (stopProcessing) {
+            break;
+        }
+        PendingFrame frame = std::move(pendingFrames.front());
+        pendingFrames.pop_front();
+        isProcessing = true;
+        lock.unlock();
+
+        ProcessFrame(frame);
+
+        lock.lock();
+        isProcessing = false;
+        freeFrames.push_back(std::move(frame));
+        cvFrames.notify_all();
+    }
+    LOG(logDEBUG) << "Processing Thread stopped";
+}
+
+void qDrawPlot::WaitForProcessing() {
+    std::unique_lock<std::mutex> lock(mFrames);
+    cvFrames.wait(lock, [this] {
+        return stopProcessing || (pendingFrames.empty() && !isProcessing);
+    });
+}
+
+void qDrawPlot::StopProcessThread() {
+    {
+        std::lock_guard<std::mutex> lock(mFrames);
+        stopProcessing = true;
+        cvFrames.notify_all();
+    }
+    if (processThread.joinable()) {
+        processThread.join();
+    }
+}
+
+void qDrawPlot::ProcessFrame(const PendingFrame &frame) {
+    LOG(logDEBUG) << "Processing frame " << frame.frameIndex;
+
+    // snapshot of the options, the plotted arrays are only read from here on
+    bool use1d = false, gain = false, pedestal = false, accumulate = false,
+         binary = false;
+    double binaryMin = 0, binaryMax = 0;
+    unsigned int nPixels = 0;
+    {
+        std::lock_guard<std::mutex> lock(mPlots);
+        ReallocatePlotData(frame.nx, frame.ny);
+        use1d = is1d;
+        nPixels = nPixelsX * (is1d ? 1 : nPixelsY);
+        gain = hasGainData;
+        pedestal = isPedestal;
+        binary = isBinary;
+        binaryMin = binaryFrom;
+        binaryMax = binaryTo;
+        accumulate = isAccumulate && !resetAccumulate;
+        resetAccumulate = false;
+
+        // reset pedestal
+        if (resetPedestal) {
+            pedestalCount = 0;
+
+            delete[] pedestalVals;
+            pedestalVals = new float[nPixels];
+            std::fill(pedestalVals, pedestalVals + nPixels, 0);
+
+            delete[] tempPedestalVals;
+            tempPedestalVals = new double[nPixels];
+            std::fill(tempPedestalVals, tempPedestalVals + nPixels, 0);
+            resetPedestal = false;
+        }
+    }
+
+    // convert data to float
+    rawData.resize(nPixels);
+    float *gaindest = nullptr;
+    if (gain) {
+        rawGainData.resize(nPixels);
+        gaindest = rawGainData.data();
+    }
+    toFloatPixelData(rawData.data(), frame.data.data(), nPixels,
+                     frame.databytes, frame.dynamicRange, gaindest);
+
+    if (pedestal && pedestalCount <= NUM_PEDESTAL_FRAMES) {
+        const float *raw = rawData.data();
+        // add pedestals frames
+        if (pedestalCount < NUM_PEDESTAL_FRAMES) {
+            for (unsigned int px = 0; px < nPixels; ++px)
+                tempPedestalVals[px] += raw[px];
+            pedestalCount++;
+        }
+        // calculate the pedestal value
+        if (pedestalCount == NUM_PEDESTAL_FRAMES) {
+            LOG(logINFO) << "Pedestal Calculated after " << NUM_PEDESTAL_FRAMES
+                         << " frames";
+            for (unsigned int px = 0; px < nPixels; ++px)
+                pedestalVals[px] =
+                    tempPedestalVals[px] / (double)NUM_PEDESTAL_FRAMES;
+            pedestalCount++;
+        }
+    }
+
+    // only the processing thread writes the back arrays or swaps them
+    if (use1d) {
+        CalculatePixels(datay1dBack, datay1d[0], nPixels, pedestal, accumulate,
+                        binary, binaryMin, binaryMax);
+    } else {
+        CalculatePixels(data2dBack, data2d, nPixels, pedestal, accumulate,
+                        binary, binaryMin, binaryMax);
+    }
+    if (gain) {
+        double *dest = use1d ? gainDatay1dBack : gainDataBack;
+        const float *src = rawGainData.data();
+        for (unsigned int px = 0; px < nPixels; ++px)
+            dest[px] = src[px];
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mPlots);
+        progress = frame.progress;
+        currentAcqIndex = frame.fileIndex;
+        currentFrame = frame.frameIndex;
+        LOG(logDEBUG) << "[ Progress:" << progress
+                      << "%, Frame:" << currentFrame << " ]";
+
+        // title and frame index titles
+        plotTitle = plotTitlePrefix +
+                    QString(frame.fileName.c_str()).section('/', -1);
+        indexTitle = QString("%1").arg(frame.frameIndex);
+        if ((int)frame.subFrameIndex != -1) {
+            indexTitle = QString("%1 %2")
+                             .arg(frame.frameIndex)
+                             .arg(frame.subFrameIndex);
+        }
+        completeImage = frame.completeImage;
+
+        // plot switched in between, drop the frame
+        if (use1d == is1d) {
+            if (use1d) {
+                Swap1dData();
+                if (gain) {
+                    std::swap(gainDatay1d, gainDatay1dBack);
+                }
+            } else {
+                std::swap(data2d, data2dBack);
+                if (gain) {
+                    std::swap(gainData, gainDataBack);
+                }
+            }
+            isGainDataExtracted = gain;
+        }
+    }
+
+    // a redraw already queued will plot this frame as well
+    if (!updatePending.exchange(true)) {
+        emit UpdateSignal();
+    }
+}
 
+void qDrawPlot::ReallocatePlotData(int nx, int ny) {
     // 1d check if npixelX has changed (m3 for different counters enabled)
-    if (is1d && static_cast<int>(nPixelsX) != data->nx) {
-        nPixelsX = data->nx;
+    if (is1d && static_cast<int>(nPixelsX) != nx) {
+        nPixelsX = nx;
         LOG(logINFO) << "Change in Detector Shape:\n\tnPixelsX:" << nPixelsX;
 
         delete[] datax1d;
@@ -768,6 +972,7 @@ void qDrawPlot::GetData(detectorData *data, uint64_t frameIndex,
             datay1d[0][px] = 0;
         }
         currentPersistency = 0;
+        nHists = 1;
         if (gainDatay1d) {
             delete[] gainDatay1d;
             gainDatay1d = new double[nPixelsX];
@@ -777,10 +982,10 @@ void qDrawPlot::GetData(detectorData *data, uint64_t frameIndex,
 
     // 2d (only image, not gain data, not pedestalvals),
     // check if npixelsX and npixelsY is the same (quad is different)
-    if (!is1d && (static_cast<int>(nPixelsX) != data->nx ||
-                  static_cast<int>(nPixelsY) != data->ny)) {
-        nPixelsX = data->nx;
-        nPixelsY = data->ny;
+    if (!is1d && (static_cast<int>(nPixelsX) != nx ||
+                  static_cast<int>(nPixelsY) != ny)) {
+        nPixelsX = nx;
+        nPixelsY = ny;
         LOG(logINFO) << "Change in Detector Shape:\n\tnPixelsX:" << nPixelsX
                      << " nPixelsY:" << nPixelsY;
 
@@ -793,150 +998,60 @@ void qDrawPlot::GetData(detectorData *data, uint64_t frameIndex,
             std::fill(gainData, gainData + nPixelsX * nPixelsY, 0);
         }
     }
+    AllocateBackData();
+}
 
-    // convert data to double
-    unsigned int nPixels = nPixelsX * (is1d ? 1 : nPixelsY);
-    double *rawData = new double[nPixels];
-    if (hasGainData) {
-        toDoublePixelData(rawData, data->data, nPixels, data->databytes,
-                          data->dynamicRange, is1d ? gainDatay1d : gainData);
-        isGainDataExtracted = true;
-    } else {
-        toDoublePixelData(rawData, data->data, nPixels, data->databytes,
-                          data->dynamicRange);
-        isGainDataExtracted = false;
-    }
-
-    // title and frame index titles
-    plotTitle =
-        plotTitlePrefix + QString(data->fileName.c_str()).section('/', -1);
-    indexTitle = QString("%1").arg(frameIndex);
-    if ((int)subFrameIndex != -1) {
-        indexTitle = QString("%1 %2").arg(frameIndex).arg(subFrameIndex);
-    }
-    completeImage = data->completeImage;
-
-    // reset pedestal
-    if (resetPedestal) {
-        pedestalCount = 0;
-
-        delete[] pedestalVals;
-        pedestalVals = new double[nPixels];
-        std::fill(pedestalVals, pedestalVals + nPixels, 0);
-
-        delete[] tempPedestalVals;
-        tempPedestalVals = new double[nPixels];
-        std::fill(tempPedestalVals, tempPedestalVals + nPixels, 0);
-        resetPedestal = false;
-    }
-
-    if (isPedestal && pedestalCount <= NUM_PEDESTAL_FRAMES) {
-        // add pedestals frames
-        if (pedestalCount < NUM_PEDESTAL_FRAMES) {
-            for (unsigned int px = 0; px < nPixels; ++px)
-                tempPedestalVals[px] += rawData[px];
-            pedestalCount++;
-        }
-        // calculate the pedestal value
-        if (pedestalCount == NUM_PEDESTAL_FRAMES) {
-            LOG(logINFO) << "Pedestal Calculated after " << NUM_PEDESTAL_FRAMES
-                         << " frames";
-            for (unsigned int px = 0; px < nPixels; ++px)
-                tempPedestalVals[px] =
-                    tempPedestalVals[px] / (double)NUM_PEDESTAL_FRAMES;
-            memcpy(pedestalVals, tempPedestalVals, nPixels * sizeof(double));
-            pedestalCount++;
-        }
-    }
-
-    if (is1d) {
-        Get1dData(rawData);
-    } else {
-        Get2dData(rawData);
+void qDrawPlot::AllocateBackData() {
+    if (nBackPixelsX == nPixelsX && nBackPixelsY == nPixelsY) {
+        return;
     }
-    delete[] rawData;
-
-    LOG(logDEBUG) << "End of Get Data";
-    emit UpdateSignal();
+    nBackPixelsX = nPixelsX;
+    nBackPixelsY = nPixelsY;
+    delete[] datay1dBack;
+    delete[] gainDatay1dBack;
+    delete[] data2dBack;
+    delete[] gainDataBack;
+    datay1dBack = new double[nPixelsX];
+    gainDatay1dBack = new double[nPixelsX];
+    data2dBack = new double[nPixelsY * nPixelsX];
+    gainDataBack = new double[nPixelsY * nPixelsX];
 }
 
-void qDrawPlot::Get1dData(double *rawData) {
-
+void qDrawPlot::Swap1dData() {
     // persistency
     if (currentPersistency < persistency)
         currentPersistency++;
     else
         currentPersistency = persistency; // when reducing persistency
     nHists = currentPersistency + 1;
-    if (currentPersistency) {
-        // allocate
-        for (int i = datay1d.size(); i <= persistency; ++i) {
-            datay1d.push_back(new double[nPixelsX]);
-        }
-        // copy previous data
-        for (int i = currentPersistency; i > 0; --i)
-            memcpy(datay1d[i], datay1d[i - 1], nPixelsX * sizeof(double));
-    }
-    // pedestal
-    if (isPedestal) {
-        for (unsigned int px = 0; px < nPixelsX; ++px) {
-            rawData[px] -= (pedestalVals[px]);
-        }
-    }
-    // accumulate
-    if (resetAccumulate) {
-        std::fill(datay1d[0], datay1d[0] + nPixelsX, 0);
-        resetAccumulate = false;
-    }
-    if (isAccumulate) {
-        for (unsigned int px = 0; px < nPixelsX; ++px) {
-            rawData[px] += datay1d[0][px];
-        }
-    }
-    // binary
-    if (isBinary) {
-        int lBinaryFrom = binaryFrom;
-        int lBinaryTo = binaryTo;
-        for (unsigned int px = 0; px < nPixelsX; ++px) {
-            if ((rawData[px] >= lBinaryFrom) && (rawData[px] <= lBinaryTo))
-                rawData[px] = 1;
-            else
-                rawData[px] = 0;
-        }
+    // allocate
+    for (int i = datay1d.size(); i <= currentPersistency; ++i) {
+        datay1d.push_back(new double[nPixelsX]);
     }
-    memcpy(datay1d[0], rawData, nPixelsX * sizeof(double));
+    // shift the previous data, the oldest array is reused for the next frame
+    double *oldest = datay1d[currentPersistency];
+    for (int i = currentPersistency; i > 0; --i)
+        datay1d[i] = datay1d[i - 1];
+    datay1d[0] = datay1dBack;
+    datay1dBack = oldest;
 }
 
-void qDrawPlot::Get2dData(double *rawData) {
-    unsigned int nPixels = nPixelsX * nPixelsY;
-    // pedestal
-    if (isPedestal) {
-        for (unsigned int px = 0; px < nPixels; ++px) {
-            rawData[px] -= (pedestalVals[px]);
-        }
-    }
-    // accumulate
-    if (resetAccumulate) {
-        std::fill(data2d, data2d + nPixels, 0);
-        resetAccumulate = false;
-    }
-    if (isAccumulate) {
-        for (unsigned int px = 0; px < nPixels; ++px) {
-            rawData[px] += data2d[px];
-        }
+void qDrawPlot::CalculatePixels(double *dest, const double *previous, int size,
+                                bool pedestal, bool accumulate, bool binary,
+                                double binaryMin, double binaryMax) {
+    // options are loop invariant, the compiler unswitches and vectorizes
+    const float *raw = rawData.data();
+    const float *ped = pedestalVals;
+    for (int px = 0; px < size; ++px) {
+        double val = raw[px];
+        if (pedestal)
+            val -= ped[px];
+        if (accumulate)
+            val += previous[px];
+        if (binary)
+            val = ((val >= binaryMin) && (val <= binaryMax)) ? 1 : 0;
+        dest[px] = val;
     }
-    // binary
-    if (isBinary) {
-        int lBinaryFrom = binaryFrom;
-        int lBinaryTo = binaryTo;
-        for (unsigned int px = 0; px < nPixels; ++px) {
-            if ((rawData[px] >= lBinaryFrom) && (rawData[px] <= lBinaryTo))
-                rawData[px] = 1;
-            else
-                rawData[px] = 0;
-        }
-    }
-    memcpy(data2d, rawData, nPixels * sizeof(double));
 }
 
 void qDrawPlot::Update1dPlot() {
@@ -1054,85 +1169,97 @@ void qDrawPlot::Update2dXYRange() {
     plot2d->Update();
 }
 
-void qDrawPlot::toDoublePixelData(double *dest, char *source, int size,
-                                  int databytes, int dr, double *gaindest) {
-    int ichan = 0;
-    int ibyte = 0;
-    int halfbyte = 0;
-    char cbyte = '\0';
-
+void qDrawPlot::toFloatPixelData(float *dest, const char *source, int size,
+                                 int databytes, int dr, float *gaindest) {
+    // local copies, so that the loops do not reload members and vectorize
     // mythen3 / gotthard2 debugging
-    int discardBits = numDiscardBits;
+    const int discardBits = numDiscardBits;
+    const uint32_t lPixelMask = pixelMask;
+    const uint32_t lGainMask = gainMask;
+    const int lGainOffset = gainOffset;
+    const uint8_t *src8 = reinterpret_cast<const uint8_t *>(source);
+    bool gainExtracted = false;
 
     switch (dr) {
 
-    case 4:
-        for (ibyte = 0; ibyte < databytes; ++ibyte) {
-            cbyte = source[ibyte];
-            for (halfbyte = 1; halfbyte >= 0; --halfbyte) {
-                dest[ichan] = (cbyte >> (halfbyte * 4)) & 0xf;
-                ++ichan;
-            }
+    case 4: {
+        // eiger: 2 pixels per byte, high nibble first
+        int nbytes = std::min(databytes, size / 2);
+        for (int ibyte = 0; ibyte < nbytes; ++ibyte) {
+            uint8_t cbyte = src8[ibyte];
+            dest[2 * ibyte] = cbyte >> 4;
+            dest[2 * ibyte + 1] = cbyte & 0xf;
         }
-        break;
+    } break;
 
-    case 8:
-        for (ichan = 0; ichan < databytes; ++ichan) {
-            dest[ichan] = *((u_int8_t *)source);
-            ++source;
+    case 8: {
+        int nchan = std::min(databytes, size);
+        for (int ichan = 0; ichan < nchan; ++ichan) {
+            dest[ichan] = src8[ichan];
         }
-        break;
+    } break;
+
+    case 12: {
+        // 2 pixels packed in 3 bytes
+        int npairs = std::min(databytes / 3, size / 2);
+        for (int ipair = 0; ipair < npairs; ++ipair) {
+            uint32_t b0 = src8[3 * ipair];
+            uint32_t b1 = src8[3 * ipair + 1];
+            uint32_t b2 = src8[3 * ipair + 2];
+            dest[2 * ipair] = b0 | ((b1 & 0xf) << 8);
+            dest[2 * ipair + 1] = (b1 >> 4) | (b2 << 4);
+        }
+    } break;
 
-    case 16:
+    case 16: {
+        const uint16_t *src16 = reinterpret_cast<const uint16_t *>(source);
+        int nchan = std::min(databytes / 2, size);
         if (detType == slsDetectorDefs::JUNGFRAU ||
             detType == slsDetectorDefs::GOTTHARD2) {
 
             // show gain plot
             if (gaindest != nullptr) {
-                for (ichan = 0; ichan < size; ++ichan) {
-                    uint16_t temp = (*((u_int16_t *)source));
-                    gaindest[ichan] = ((temp & gainMask) >> gainOffset);
-                    dest[ichan] = (temp & pixelMask);
-                    source += 2;
+                for (int ichan = 0; ichan < nchan; ++ichan) {
+                    uint32_t temp = src16[ichan];
+                    gaindest[ichan] = ((temp & lGainMask) >> lGainOffset);
+                    dest[ichan] = (temp & lPixelMask);
                 }
+                gainExtracted = true;
             }
 
             // only data plot
             else {
-                for (ichan = 0; ichan < size; ++ichan) {
-                    dest[ichan] = ((*((u_int16_t *)source)) & pixelMask);
-                    source += 2;
+                for (int ichan = 0; ichan < nchan; ++ichan) {
+                    dest[ichan] = (src16[ichan] & lPixelMask);
                 }
             }
             break;
         }
 
         // other detectors
-        for (ichan = 0; ichan < size; ++ichan) {
-            dest[ichan] = *((u_int16_t *)source);
-            source += 2;
+        for (int ichan = 0; ichan < nchan; ++ichan) {
+            dest[ichan] = src16[ichan];
         }
-        break;
+    } break;
 
-    default:
-        if (discardBits > 0) {
-            for (ichan = 0; ichan < size; ++ichan) {
-                dest[ichan] = ((*((u_int32_t *)source)) >> discardBits);
-                source += 4;
-            }
-        } else {
-            for (ichan = 0; ichan < size; ++ichan) {
-                dest[ichan] = (*((u_int32_t *)source));
-                source += 4;
-            }
+    default: {
+        const uint32_t *src32 = reinterpret_cast<const uint32_t *>(source);
+        int nchan = std::min(databytes / 4, size);
+        for (int ichan = 0; ichan < nchan; ++ichan) {
+            dest[ichan] = (src32[ichan] >> discardBits);
         }
-        break;
+    } break;
+    }
+
+    if (gaindest != nullptr && !gainExtracted) {
+        std::fill(gaindest, gaindest + size, 0);
     }
 }
 
 void qDrawPlot::UpdatePlot() {
     std::lock_guard<std::mutex> lock(mPlots);
     LOG(logDEBUG) << "Update Plot";
+    updatePending = false;
 
     boxPlot->setTitle(plotTitle);
 
@@ -25,6 +25,9 @@
 // Global variable from slsDetectorServer_funcs
 extern int debugflag;
 extern int updateFlag;
+#ifdef VIRTUAL
+extern int highRateFlag;
+#endif
 extern udpStruct udpDetails[MAX_UDP_DESTINATION];
 extern int numUdpDestinations;
 extern const enum detectorType myDetectorType;
@@ -2512,7 +2515,88 @@ void *start_timer(void *arg) {
     }
 
     // Send data
-    {
+    if (highRateFlag) {
+        // packets of each interface built once, only the headers change
+        const int startval = (maxPacketsPerFrame / 2) - (packetsPerFrame / 2);
+        const int endval = startval + packetsPerFrame - 1;
+        const int packetsPerInterface = maxPacketsPerFrame / numInterfaces;
+        udpPacketTemplate tmpl[2];
+        memset(tmpl, 0, sizeof(tmpl));
+        int ret = OK;
+        for (int iface = 0; iface != numInterfaces && ret == OK; ++iface) {
+            const int first = iface * packetsPerInterface;
+            const int last = first + packetsPerInterface - 1;
+            const int begin = first > startval ? first : startval;
+            const int end = last < endval ? last : endval;
+            ret = createUDPPacketTemplate(
+                &tmpl[iface], end >= begin ? end - begin + 1 : 0, packetsize);
+            for (int i = begin; ret == OK && i <= end; ++i) {
+                char *packetData =
+                    getUDPTemplatePacket(&tmpl[iface], i - begin);
+                sls_detector_header *header =
+                    (sls_detector_header *)(packetData);
+                header->detType = (uint16_t)myDetectorType;
+                header->version = SLS_DETECTOR_HEADER_VERSION - 1;
+                header->packetNumber = i - first;
+                header->modId = 0;
+                header->row = detPos[2 * iface];
+                header->column = detPos[2 * iface + 1];
+                memcpy(packetData + sizeof(sls_detector_header),
+                       imageData + iface * (DATA_BYTES / 2) +
+                           (i - first) * dataSize,
+                       dataSize);
+            }
+        }
+
+        uint64_t frameNr = 0;
+        getNextFrameNumber(&frameNr);
+        int iRxEntry = firstDest;
+        int iframes = 0;
+        // exposure is part of the period, the transmission delay precedes
+        // every frame as in the loop below
+        int64_t framePeriodNs = expUs * 1000;
+        if (periodNs > framePeriodNs) {
+            framePeriodNs = periodNs;
+        }
+        framePeriodNs += (int64_t)transmissionDelayUs * 1000;
+        usleep(transmissionDelayUs);
+        udpPacer pacer;
+        startUDPPacer(&pacer, framePeriodNs);
+        for (; ret == OK && iframes != numFrames; ++iframes) {
+            // check if manual stop
+            if (sharedMemory_getStop() == 1) {
+                break;
+            }
+            int64_t timeNs = waitUDPPacer(&pacer);
+            for (int iface = 0; iface != numInterfaces; ++iface) {
+                setUDPTemplateFrame(&tmpl[iface], frameNr + iframes,
+                                    timeNs / 100);
+                sendUDPPackets(iRxEntry, iface, &tmpl[iface]);
+            }
+            LOG(logDEBUG1, ("Sent frame %d [#%ld] to E%d\n", iframes,
+                            frameNr + iframes, iRxEntry));
+            ++iRxEntry;
+            if (iRxEntry == numUdpDestinations) {
+                iRxEntry = 0;
+            }
+        }
+        LOG(logINFO, ("Sent %d frames [#%ld] at high rate\n", iframes,
+                      frameNr));
+        setNextFrameNumber(frameNr + iframes);
+        for (int iface = 0; iface != numInterfaces; ++iface) {
+            freeUDPPacketTemplate(&tmpl[iface]);
+        }
+        if (ret != OK) {
+            LOG(logERROR, ("Could not build udp packets for high rate data "
+                           "generation\n"));
+            closeUDPSocket(0);
+            if (numInterfaces == 2) {
+                closeUDPSocket(1);
+            }
+            sharedMemory_setStatus(ERROR);
+            return NULL;
+        }
+    } else {
         uint64_t frameNr = 0;
         getNextFrameNumber(&frameNr);
         int iRxEntry = firstDest;
@@ -2667,6 +2751,10 @@ enum runStatus getRunStatus() {
         LOG(logINFOBLUE, ("Status: RUNNING\n"));
         return RUNNING;
     }
+    if (sharedMemory_getStatus() == ERROR) {
+        LOG(logINFORED, ("Status: Error\n"));
+        return ERROR;
+    }
     LOG(logINFOBLUE, ("Status: IDLE\n"));
     return IDLE;
 #endif
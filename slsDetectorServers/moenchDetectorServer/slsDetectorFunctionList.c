@@ -25,6 +25,9 @@
 // Global variable from slsDetectorServer_funcs
 extern int debugflag;
 extern int updateFlag;
+#ifdef VIRTUAL
+extern int highRateFlag;
+#endif
 extern udpStruct udpDetails[MAX_UDP_DESTINATION];
 extern const enum detectorType myDetectorType;
 
@@ -687,6 +690,8 @@ void resetCore() {
     LOG(logINFO, ("Resetting Core\n"));
     bus_w(CONTROL_REG, bus_r(CONTROL_REG) | CONTROL_CRE_RST_MSK);
     bus_w(CONTROL_REG, bus_r(CONTROL_REG) & ~CONTROL_CRE_RST_MSK);
+    // pattern memory is written again on next load
+    invalidatePatternWords();
 }
 
 void resetPeripheral() {
@@ -1684,54 +1689,109 @@ void *start_timer(void *arg) {
     // Send data
     uint64_t frameNr = 0;
     getNextFrameNumber(&frameNr);
-    // loop over number of frames
-    for (int iframes = 0; iframes != numFrames; ++iframes) {
-
-        // check if manual stop
-        if (sharedMemory_getStop() == 1) {
-            setNextFrameNumber(frameNr + iframes + 1);
-            break;
-        }
-
-        // sleep for exposure time
-        struct timespec begin, end;
-        clock_gettime(CLOCK_REALTIME, &begin);
-        usleep(expNs / 1000);
-
-        int srcOffset = 0;
-        // loop packet
-        for (int i = 0; i != packetsPerFrame; ++i) {
-            // set header
-            char packetData[packetSize];
-            memset(packetData, 0, packetSize);
+    if (highRateFlag) {
+        // packets built once, only the headers change
+        udpPacketTemplate tmpl;
+        int ret = createUDPPacketTemplate(&tmpl, packetsPerFrame, packetSize);
+        for (int i = 0; ret == OK && i != packetsPerFrame; ++i) {
+            char *packetData = getUDPTemplatePacket(&tmpl, i);
             sls_detector_header *header = (sls_detector_header *)(packetData);
             header->detType = (uint16_t)myDetectorType;
             header->version = SLS_DETECTOR_HEADER_VERSION - 1;
-            header->frameNumber = frameNr + iframes;
             header->packetNumber = i;
             header->modId = 0;
             header->row = detPos[X];
             header->column = detPos[Y];
-
-            // fill data
+            // last packet only partly filled
+            const int srcOffset = i * dataSize;
             memcpy(packetData + sizeof(sls_detector_header),
-                   imageData + srcOffset, dataSize);
-            srcOffset += dataSize;
+                   imageData + srcOffset,
+                   imageSize - srcOffset < dataSize ? imageSize - srcOffset
+                                                    : dataSize);
+        }
 
-            sendUDPPacket(0, 0, packetData, packetSize);
+        // exposure is part of the period
+        int64_t framePeriodNs = expNs;
+        if (periodNs > framePeriodNs) {
+            framePeriodNs = periodNs;
         }
-        LOG(logINFO, ("Sent frame: %d [%lld]\n", iframes, frameNr + iframes));
-        clock_gettime(CLOCK_REALTIME, &end);
-        int64_t timeNs =
-            ((end.tv_sec - begin.tv_sec) * 1E9 + (end.tv_nsec - begin.tv_nsec));
-
-        // sleep for (period - exptime)
-        if (iframes < numFrames) { // if there is a next frame
-            if (periodNs > timeNs) {
-                usleep((periodNs - timeNs) / 1000);
+        udpPacer pacer;
+        startUDPPacer(&pacer, framePeriodNs);
+        int iframes = 0;
+        for (; ret == OK && iframes != numFrames; ++iframes) {
+            // check if manual stop
+            if (sharedMemory_getStop() == 1) {
+                break;
             }
+            int64_t timeNs = waitUDPPacer(&pacer);
+            setUDPTemplateFrame(&tmpl, frameNr + iframes, timeNs / 100);
+            sendUDPPackets(0, 0, &tmpl);
+            LOG(logDEBUG1,
+                ("Sent frame: %d [%lld]\n", iframes, frameNr + iframes));
+        }
+        LOG(logINFO, ("Sent %d frames [%lld] at high rate\n", iframes,
+                      frameNr));
+        setNextFrameNumber(frameNr + iframes);
+        freeUDPPacketTemplate(&tmpl);
+        if (ret != OK) {
+            LOG(logERROR, ("Could not build udp packets for high rate data "
+                           "generation\n"));
+            closeUDPSocket(0);
+            sharedMemory_setStatus(ERROR);
+            return NULL;
+        }
+    } else {
+        // loop over number of frames
+        for (int iframes = 0; iframes != numFrames; ++iframes) {
+
+            // check if manual stop
+            if (sharedMemory_getStop() == 1) {
+                setNextFrameNumber(frameNr + iframes + 1);
+                break;
+            }
+
+            // sleep for exposure time
+            struct timespec begin, end;
+            clock_gettime(CLOCK_REALTIME, &begin);
+            usleep(expNs / 1000);
+
+            int srcOffset = 0;
+            // loop packet
+            for (int i = 0; i != packetsPerFrame; ++i) {
+                // set header
+                char packetData[packetSize];
+                memset(packetData, 0, packetSize);
+                sls_detector_header *header =
+                    (sls_detector_header *)(packetData);
+                header->detType = (uint16_t)myDetectorType;
+                header->version = SLS_DETECTOR_HEADER_VERSION - 1;
+                header->frameNumber = frameNr + iframes;
+                header->packetNumber = i;
+                header->modId = 0;
+                header->row = detPos[X];
+                header->column = detPos[Y];
+
+                // fill data
+                memcpy(packetData + sizeof(sls_detector_header),
+                       imageData + srcOffset, dataSize);
+                srcOffset += dataSize;
+
+                sendUDPPacket(0, 0, packetData, packetSize);
+            }
+            LOG(logINFO,
+                ("Sent frame: %d [%lld]\n", iframes, frameNr + iframes));
+            clock_gettime(CLOCK_REALTIME, &end);
+            int64_t timeNs = ((end.tv_sec - begin.tv_sec) * 1E9 +
+                              (end.tv_nsec - begin.tv_nsec));
+
+            // sleep for (period - exptime)
+            if (iframes < numFrames) { // if there is a next frame
+                if (periodNs > timeNs) {
+                    usleep((periodNs - timeNs) / 1000);
+                }
+            }
+            setNextFrameNumber(frameNr + numFrames);
         }
-        setNextFrameNumber(frameNr + numFrames);
     }
 
     closeUDPSocket(0);
@@ -1783,6 +1843,10 @@ enum runStatus getRunStatus() {
         LOG(logINFOBLUE, ("Status: RUNNING\n"));
         return RUNNING;
     }
+    if (sharedMemory_getStatus() == ERROR) {
+        LOG(logINFORED, ("Status: Error\n"));
+        return ERROR;
+    }
     LOG(logINFOBLUE, ("Status: IDLE\n"));
     return IDLE;
 #endif
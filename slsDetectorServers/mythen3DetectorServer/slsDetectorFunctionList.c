@@ -27,6 +27,9 @@
 extern int debugflag;
 extern int updateFlag;
 extern int checkModuleFlag;
+#ifdef VIRTUAL
+extern int highRateFlag;
+#endif
 extern udpStruct udpDetails[MAX_UDP_DESTINATION];
 extern const enum detectorType myDetectorType;
 
@@ -716,6 +719,8 @@ void resetCore() {
 #endif
     LOG(logINFO, ("Resetting Core\n"));
     bus_w(CONTROL_REG, bus_r(CONTROL_REG) | CONTROL_CRE_RST_MSK);
+    // pattern memory is written again on next load
+    invalidatePatternWords();
 }
 
 void resetPeripheral() {
@@ -2258,55 +2263,106 @@ void *start_timer(void *arg) {
     }
 
     // Send data
-    // loop over number of frames
-    for (int frameNr = 0; frameNr != numFrames; ++frameNr) {
-
-        // check if manual stop
-        if (sharedMemory_getStop() == 1) {
-            break;
-        }
-
-        // sleep for exposure time
-        struct timespec begin, end;
-        clock_gettime(CLOCK_REALTIME, &begin);
-        usleep(expUs);
-
-        int srcOffset = 0;
-        // loop packet
-        for (int i = 0; i != packetsPerFrame; ++i) {
-            char packetData[packetSize];
-            memset(packetData, 0, packetSize);
-
-            // set header
+    if (highRateFlag) {
+        // packets built once, only the headers change
+        udpPacketTemplate tmpl;
+        int ret = createUDPPacketTemplate(&tmpl, packetsPerFrame, packetSize);
+        for (int i = 0; ret == OK && i != packetsPerFrame; ++i) {
+            char *packetData = getUDPTemplatePacket(&tmpl, i);
             sls_detector_header *header = (sls_detector_header *)(packetData);
             header->detType = (uint16_t)myDetectorType;
             header->version = SLS_DETECTOR_HEADER_VERSION - 1;
-            header->frameNumber = virtual_currentFrameNumber;
             header->packetNumber = i;
             header->modId = virtual_moduleid;
             header->row = detPos[X];
             header->column = detPos[Y];
-
-            // fill data
             memcpy(packetData + sizeof(sls_detector_header),
-                   imageData + srcOffset, dataSize);
-            srcOffset += dataSize;
+                   imageData + i * dataSize, dataSize);
+        }
 
-            sendUDPPacket(0, 0, packetData, packetSize);
+        // gate period is part of the period
+        int64_t framePeriodNs = expUs * 1000;
+        if (periodNs > framePeriodNs) {
+            framePeriodNs = periodNs;
         }
-        LOG(logINFO, ("Sent frame: %d [%lld]\n", frameNr,
-                      (long long unsigned int)virtual_currentFrameNumber));
-        clock_gettime(CLOCK_REALTIME, &end);
-        int64_t timeNs =
-            ((end.tv_sec - begin.tv_sec) * 1E9 + (end.tv_nsec - begin.tv_nsec));
-
-        // sleep for (period - exptime)
-        if (frameNr < numFrames) { // if there is a next frame
-            if (periodNs > timeNs) {
-                usleep((periodNs - timeNs) / 1000);
+        udpPacer pacer;
+        startUDPPacer(&pacer, framePeriodNs);
+        int frameNr = 0;
+        for (; ret == OK && frameNr != numFrames; ++frameNr) {
+            // check if manual stop
+            if (sharedMemory_getStop() == 1) {
+                break;
             }
+            int64_t timeNs = waitUDPPacer(&pacer);
+            setUDPTemplateFrame(&tmpl, virtual_currentFrameNumber,
+                                timeNs / 100);
+            sendUDPPackets(0, 0, &tmpl);
+            LOG(logDEBUG1,
+                ("Sent frame: %d [%lld]\n", frameNr,
+                 (long long unsigned int)virtual_currentFrameNumber));
+            ++virtual_currentFrameNumber;
+        }
+        LOG(logINFO, ("Sent %d frames at high rate\n", frameNr));
+        freeUDPPacketTemplate(&tmpl);
+        if (ret != OK) {
+            LOG(logERROR, ("Could not build udp packets for high rate data "
+                           "generation\n"));
+            closeUDPSocket(0);
+            sharedMemory_setStatus(ERROR);
+            return NULL;
+        }
+    } else {
+        // loop over number of frames
+        for (int frameNr = 0; frameNr != numFrames; ++frameNr) {
+
+            // check if manual stop
+            if (sharedMemory_getStop() == 1) {
+                break;
+            }
+
+            // sleep for exposure time
+            struct timespec begin, end;
+            clock_gettime(CLOCK_REALTIME, &begin);
+            usleep(expUs);
+
+            int srcOffset = 0;
+            // loop packet
+            for (int i = 0; i != packetsPerFrame; ++i) {
+                char packetData[packetSize];
+                memset(packetData, 0, packetSize);
+
+                // set header
+                sls_detector_header *header =
+                    (sls_detector_header *)(packetData);
+                header->detType = (uint16_t)myDetectorType;
+                header->version = SLS_DETECTOR_HEADER_VERSION - 1;
+                header->frameNumber = virtual_currentFrameNumber;
+                header->packetNumber = i;
+                header->modId = virtual_moduleid;
+                header->row = detPos[X];
+                header->column = detPos[Y];
+
+                // fill data
+                memcpy(packetData + sizeof(sls_detector_header),
+                       imageData + srcOffset, dataSize);
+                srcOffset += dataSize;
+
+                sendUDPPacket(0, 0, packetData, packetSize);
+            }
+            LOG(logINFO, ("Sent frame: %d [%lld]\n", frameNr,
+                          (long long unsigned int)virtual_currentFrameNumber));
+            clock_gettime(CLOCK_REALTIME, &end);
+            int64_t timeNs = ((end.tv_sec - begin.tv_sec) * 1E9 +
+                              (end.tv_nsec - begin.tv_nsec));
+
+            // sleep for (period - exptime)
+            if (frameNr < numFrames) { // if there is a next frame
+                if (periodNs > timeNs) {
+                    usleep((periodNs - timeNs) / 1000);
+                }
+            }
+            ++virtual_currentFrameNumber;
         }
-        ++virtual_currentFrameNumber;
     }
 
     closeUDPSocket(0);
@@ -2382,6 +2438,10 @@ enum runStatus getRunStatus() {
         LOG(logINFOBLUE, ("Status: RUNNING\n"));
         return RUNNING;
     }
+    if (sharedMemory_getStatus() == ERROR) {
+        LOG(logINFORED, ("Status: Error\n"));
+        return ERROR;
+    }
     LOG(logINFOBLUE, ("Status: IDLE\n"));
     return IDLE;
 #endif
@@ -36,7 +36,8 @@ void Server_LockedError();
 
 /**
  * Server verifies if it is unlocked,
- * sets and prints appropriate message if it is locked and different clients
+ * sets and prints appropriate message if it is locked and different clients.
+ * Called before every set, so it also increments configEpoch
  * @returns success of operaton
  */
 int Server_VerifyLock();
@@ -2,6 +2,8 @@
 // Copyright (C) 2021 Contributors to the SLS Detector Package
 #pragma once
 
+#include <inttypes.h>
+
 void setupUDPCommParameters();
 
 int getUdPSocketDescriptor(int iRxEntry, int index);
@@ -15,3 +17,53 @@ int createUDPSocket(int index);
 int sendUDPPacket(int iRxEntry, int index, const char *buf, int length);
 
 void closeUDPSocket(int index);
+
+#ifdef VIRTUAL
+/** packets handed to the kernel in one sendmmsg call */
+#define UDP_SEND_BATCH (64)
+/** frames the pacer may send back to back to catch up */
+#define UDP_PACER_BURST (4)
+/** the pacer sleeps until this long before the deadline, then spins */
+#define UDP_PACER_SPIN_NS (200 * 1000)
+
+/** packets of one frame and interface, built once, patched per frame */
+typedef struct {
+    char *buffer;
+    int packetSize;
+    int numPackets;
+} udpPacketTemplate;
+
+/** token bucket of one frame per period */
+typedef struct {
+    int64_t periodNs;
+    int64_t startNs;
+    int64_t nextNs;
+} udpPacer;
+
+/** zero initialized packets, headers and data filled by the caller */
+int createUDPPacketTemplate(udpPacketTemplate *tmpl, int numPackets,
+                            int packetSize);
+char *getUDPTemplatePacket(udpPacketTemplate *tmpl, int ipacket);
+/**
+ * Patches the sls_detector_header of every packet, packet numbers and the
+ * rest stay as built
+ * @param timestamp 10 MHz clock
+ */
+void setUDPTemplateFrame(udpPacketTemplate *tmpl, uint64_t frameNumber,
+                         uint64_t timestamp);
+void freeUDPPacketTemplate(udpPacketTemplate *tmpl);
+
+/**
+ * Sends all packets of a template in batches of UDP_SEND_BATCH
+ * @returns number of packets sent
+ */
+int sendUDPPackets(int iRxEntry, int index, udpPacketTemplate *tmpl);
+
+/** @param periodNs 0 does not wait */
+void startUDPPacer(udpPacer *pacer, int64_t periodNs);
+/**
+ * Busy waits for the next token
+ * @returns ns from the start of the pacer to the token
+ */
+int64_t waitUDPPacer(udpPacer *pacer);
+#endif
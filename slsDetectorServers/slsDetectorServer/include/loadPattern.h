@@ -5,6 +5,12 @@
 #include "Pattern.h"
 #include "clogger.h"
 
+/** after a reset of the pattern memory, all words are written on next load */
+void invalidatePatternWords();
+uint64_t getPatternHash(patternParameters *pat);
+/** 0 if the pattern changed since the last loadPattern */
+uint64_t getLoadedPatternHash();
+
 #if defined(CHIPTESTBOARDD) || defined(MOENCHD)
 #ifdef VIRTUAL
 void initializePatternWord();
@@ -289,4 +289,5 @@ void receive_program_default(int file_des, enum PROGRAM_INDEX index,
                              char *functionType, uint64_t filesize,
                              char *checksum, char *serverName);
 int get_update_mode(int);
-int set_update_mode(int);
\ No newline at end of file
+int set_update_mode(int);
+int get_config_epoch(int);
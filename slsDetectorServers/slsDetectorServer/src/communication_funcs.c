@@ -31,6 +31,8 @@ int isControlServer = 1;
 int ret = FAIL;
 int fnum = 0;
 char mess[MAX_STR_LENGTH];
+// incremented for every set allowed, lets clients know their cache is stale
+uint64_t configEpoch = 0;
 
 // Local variables
 uint32_t dummyClientIP = 0u;
@@ -511,6 +513,8 @@ void Server_LockedError() {
 int Server_VerifyLock() {
     if (differentClients && lockStatus)
         Server_LockedError();
+    if (ret == OK)
+        ++configEpoch;
     return ret;
 }
 
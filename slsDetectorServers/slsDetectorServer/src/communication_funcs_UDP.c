@@ -1,5 +1,8 @@
 // SPDX-License-Identifier: LGPL-3.0-or-other
 // Copyright (C) 2021 Contributors to the SLS Detector Package
+#ifdef VIRTUAL
+#define _GNU_SOURCE // sendmmsg
+#endif
 #include "communication_funcs_UDP.h"
 #include "clogger.h"
 #include "sls/sls_detector_defs.h"
@@ -13,6 +16,9 @@
 #include <string.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#ifdef VIRTUAL
+#include <time.h>
+#endif
 #include <unistd.h>
 
 int udpSockfd[MAX_UDP_DESTINATION][2] = {};
@@ -158,3 +164,117 @@ void closeUDPSocket(int index) {
         }
     }
 }
+
+#ifdef VIRTUAL
+int createUDPPacketTemplate(udpPacketTemplate *tmpl, int numPackets,
+                            int packetSize) {
+    tmpl->packetSize = packetSize;
+    tmpl->numPackets = numPackets;
+    tmpl->buffer = calloc(numPackets > 0 ? numPackets : 1, packetSize);
+    if (tmpl->buffer == NULL) {
+        LOG(logERROR, ("Could not allocate udp packet template of %d packets "
+                       "of %d bytes\n",
+                       numPackets, packetSize));
+        tmpl->numPackets = 0;
+        return FAIL;
+    }
+    return OK;
+}
+
+char *getUDPTemplatePacket(udpPacketTemplate *tmpl, int ipacket) {
+    return tmpl->buffer + (size_t)ipacket * tmpl->packetSize;
+}
+
+void setUDPTemplateFrame(udpPacketTemplate *tmpl, uint64_t frameNumber,
+                         uint64_t timestamp) {
+    for (int i = 0; i != tmpl->numPackets; ++i) {
+        sls_detector_header *header =
+            (sls_detector_header *)getUDPTemplatePacket(tmpl, i);
+        header->frameNumber = frameNumber;
+        header->timestamp = timestamp;
+    }
+}
+
+void freeUDPPacketTemplate(udpPacketTemplate *tmpl) {
+    free(tmpl->buffer);
+    tmpl->buffer = NULL;
+    tmpl->numPackets = 0;
+}
+
+int sendUDPPackets(int iRxEntry, int index, udpPacketTemplate *tmpl) {
+    struct mmsghdr msgs[UDP_SEND_BATCH];
+    struct iovec iovecs[UDP_SEND_BATCH];
+    memset(msgs, 0, sizeof(msgs));
+    for (int i = 0; i != UDP_SEND_BATCH; ++i) {
+        iovecs[i].iov_len = tmpl->packetSize;
+        msgs[i].msg_hdr.msg_iov = &iovecs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_name = udpServerAddrInfo[iRxEntry][index]->ai_addr;
+        msgs[i].msg_hdr.msg_namelen =
+            udpServerAddrInfo[iRxEntry][index]->ai_addrlen;
+    }
+
+    int sent = 0;
+    while (sent < tmpl->numPackets) {
+        int batch = tmpl->numPackets - sent;
+        if (batch > UDP_SEND_BATCH) {
+            batch = UDP_SEND_BATCH;
+        }
+        for (int i = 0; i != batch; ++i) {
+            iovecs[i].iov_base = getUDPTemplatePacket(tmpl, sent + i);
+        }
+        int n = sendmmsg(udpSockfd[iRxEntry][index], msgs, batch, 0);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG(logERROR, ("Could not send udp packets for socket %d "
+                           "[entry:%d]. (Error code:%d, %s)\n",
+                           index, iRxEntry, errno, strerror(errno)));
+            break;
+        }
+        sent += n;
+    }
+    LOG(logDEBUG2, ("%d packets sent\n", sent));
+    return sent;
+}
+
+static int64_t getUDPPacerTimeNs() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+void startUDPPacer(udpPacer *pacer, int64_t periodNs) {
+    pacer->periodNs = periodNs;
+    pacer->startNs = getUDPPacerTimeNs();
+    pacer->nextNs = pacer->startNs;
+}
+
+int64_t waitUDPPacer(udpPacer *pacer) {
+    int64_t now = getUDPPacerTimeNs();
+    if (pacer->periodNs <= 0) {
+        return now - pacer->startNs;
+    }
+    // sleep the bulk of the wait, spin the rest to hit the period
+    if (pacer->nextNs - now > UDP_PACER_SPIN_NS) {
+        int64_t wake = pacer->nextNs - UDP_PACER_SPIN_NS;
+        struct timespec ts;
+        ts.tv_sec = wake / 1000000000LL;
+        ts.tv_nsec = wake % 1000000000LL;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) ==
+               EINTR)
+            ;
+    }
+    while ((now = getUDPPacerTimeNs()) < pacer->nextNs)
+        ;
+    int64_t token = pacer->nextNs;
+    // at most UDP_PACER_BURST frames are caught up after a late frame
+    int64_t earliest = now - (UDP_PACER_BURST - 1) * pacer->periodNs;
+    if (token < earliest) {
+        token = earliest;
+    }
+    pacer->nextNs = token + pacer->periodNs;
+    return token - pacer->startNs;
+}
+#endif
@@ -19,11 +19,35 @@ uint64_t virtual_pattern[MAX_PATTERN_LENGTH];
 #endif
 #endif
 
+// words last written, only changed words are written when loading a pattern
+uint64_t patternWordShadow[MAX_PATTERN_LENGTH] = {};
+char patternWordKnown[MAX_PATTERN_LENGTH] = {};
+// hash of the pattern structure last loaded, 0 once anything changed since
+uint64_t loadedPatternHash = 0;
+
 extern void bus_w(u_int32_t offset, u_int32_t data);
 extern u_int32_t bus_r(u_int32_t offset);
 extern int64_t get64BitReg(int aLSB, int aMSB);
 extern int64_t set64BitReg(int64_t value, int aLSB, int aMSB);
 
+void invalidatePatternWords() {
+    memset(patternWordKnown, 0, sizeof(patternWordKnown));
+    loadedPatternHash = 0;
+}
+
+uint64_t getPatternHash(patternParameters *pat) {
+    // FNV-1a over the structure as sent by the client
+    const unsigned char *byte = (const unsigned char *)pat;
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < sizeof(patternParameters); ++i) {
+        hash ^= byte[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+uint64_t getLoadedPatternHash() { return loadedPatternHash; }
+
 #if defined(CHIPTESTBOARDD) || defined(MOENCHD)
 #ifdef VIRTUAL
 void initializePatternWord() {
@@ -48,6 +72,7 @@ int validate_writePatternIOControl(char *message, uint64_t arg) {
 }
 
 void writePatternIOControl(uint64_t word) {
+    loadedPatternHash = 0;
     LOG(logINFO,
         ("Setting Pattern I/O Control: 0x%llx\n", (long long int)word));
     set64BitReg(word, PATTERN_IO_CNTRL_LSB_REG, PATTERN_IO_CNTRL_MSB_REG);
@@ -121,6 +146,9 @@ int validate_writePatternWord(char *message, int addr, uint64_t word) {
     memset(mode, 0, sizeof(mode));
     sprintf(mode, "set pattern word for addr 0x%x", addr);
     validate64(&ret, message, word, retval, "set pattern word", HEX);
+    if (ret == FAIL) {
+        patternWordKnown[addr] = 0;
+    }
 #endif
     return ret;
 }
@@ -128,6 +156,9 @@ int validate_writePatternWord(char *message, int addr, uint64_t word) {
 void writePatternWord(int addr, uint64_t word) {
     LOG(logDEBUG1, ("Setting Pattern Word (addr:0x%x, word:0x%llx)\n", addr,
                     (long long int)word));
+    loadedPatternHash = 0;
+    patternWordShadow[addr] = word;
+    patternWordKnown[addr] = 1;
 
 #ifndef MYTHEN3D
     uint32_t reg = PATTERN_CNTRL_REG;
@@ -215,6 +246,7 @@ int validate_setPatternWaitAddresses(char *message, int level, int addr) {
 }
 
 void setPatternWaitAddress(int level, int addr) {
+    loadedPatternHash = 0;
 #ifdef MYTHEN3D
     LOG(trimmingPrint,
 #else
@@ -291,6 +323,7 @@ int validate_setPatternWaitTime(char *message, int level, uint64_t waittime) {
 }
 
 void setPatternWaitTime(int level, uint64_t t) {
+    loadedPatternHash = 0;
 #ifdef MYTHEN3D
     LOG(trimmingPrint,
 #else
@@ -369,6 +402,7 @@ int validate_setPatternLoopCycles(char *message, int level, int numLoops) {
 }
 
 void setPatternLoopCycles(int level, int nLoop) {
+    loadedPatternHash = 0;
 #ifdef MYTHEN3D
     LOG(trimmingPrint,
 #else
@@ -428,6 +462,7 @@ int validate_setPatternLoopLimits(char *message, int startAddr, int stopAddr) {
 }
 
 void setPatternLoopLimits(int startAddr, int stopAddr) {
+    loadedPatternHash = 0;
 #ifdef MYTHEN3D
     LOG(trimmingPrint,
 #else
@@ -529,6 +564,7 @@ int validate_setPatternLoopAddresses(char *message, int level, int startAddr,
 }
 
 void setPatternLoopAddresses(int level, int startAddr, int stopAddr) {
+    loadedPatternHash = 0;
 #ifdef MYTHEN3D
     LOG(trimmingPrint,
 #else
@@ -602,7 +638,12 @@ int loadPattern(char *message, enum TLogLevel printLevel,
     trimmingPrint = printLevel;
 #endif
     // words
+    int numUnchanged = 0;
     for (int i = 0; i < MAX_PATTERN_LENGTH; ++i) {
+        if (patternWordKnown[i] && patternWordShadow[i] == pat->word[i]) {
+            ++numUnchanged;
+            continue;
+        }
         if ((i % 10 == 0) && pat->word[i] != 0) {
             LOG(logDEBUG5, ("Setting Pattern Word (addr:0x%x, word:0x%llx)\n",
                             i, (long long int)pat->word[i]));
@@ -652,6 +693,11 @@ int loadPattern(char *message, enum TLogLevel printLevel,
             }
         }
     }
+    LOG(printLevel, ("\t%d of %d pattern words unchanged\n", numUnchanged,
+                     MAX_PATTERN_LENGTH));
+    if (ret == OK) {
+        loadedPatternHash = getPatternHash(pat);
+    }
 #ifdef MYTHEN3D
     trimmingPrint = logINFO;
 #endif
@@ -26,6 +26,7 @@ extern int sockfd;
 extern int debugflag;
 extern int updateFlag;
 extern int checkModuleFlag;
+extern int highRateFlag;
 
 // Global variables from slsDetectorFunctionList
 #ifdef GOTTHARDD
@@ -47,6 +48,7 @@ int main(int argc, char *argv[]) {
     debugflag = 0;
     updateFlag = 0;
     checkModuleFlag = 1;
+    highRateFlag = 0;
     int version = 0;
 
     // help message
@@ -64,6 +66,9 @@ int main(int argc, char *argv[]) {
         "\t-d, --devel              : Developer mode. Skips firmware checks. \n"
         "\t-u, --update             : Update mode. Skips firmware checks and "
         "initial detector setup. \n"
+        "\t-r, --highrate           : [Virtual][Jungfrau][Mythen3][Ctb]"
+        "[Moench] High rate data generation. Prebuilt packets sent in "
+        "batches, paced to the period with a busy wait. \n"
         "\t-s, --stopserver         : Stop server. Do not use as it is created "
         "by "
         "control server \n\n",
@@ -80,6 +85,7 @@ int main(int argc, char *argv[]) {
         {"nomodule", no_argument, NULL, 'g'}, // generic
         {"devel", no_argument, NULL, 'd'},
         {"update", no_argument, NULL, 'u'},
+        {"highrate", no_argument, NULL, 'r'},
         {"stopserver", no_argument, NULL, 's'},
         {NULL, 0, NULL, 0}};
 
@@ -89,7 +95,7 @@ int main(int argc, char *argv[]) {
     int c = 0;
 
     while (c != -1) {
-        c = getopt_long(argc, argv, "hvp:f:gdus", long_options, &option_index);
+        c = getopt_long(argc, argv, "hvp:f:gdurs", long_options, &option_index);
 
         // Detect the end of the options
         if (c == -1)
@@ -155,6 +161,18 @@ int main(int argc, char *argv[]) {
             updateFlag = 1;
             break;
 
+        case 'r':
+#if !defined(VIRTUAL) || !(defined(JUNGFRAUD) || defined(MYTHEN3D) ||         \
+                           defined(CHIPTESTBOARDD) || defined(MOENCHD))
+            LOG(logERROR,
+                ("High rate argument not implemented for this detector\n"));
+            exit(EXIT_FAILURE);
+#else
+            LOG(logINFO, ("Detected high rate data generation\n"));
+            highRateFlag = 1;
+#endif
+            break;
+
         case 's':
             LOG(logINFO, ("Detected stop server\n"));
             isControlServer = 0;
@@ -16,6 +16,7 @@
 #include <pthread.h>
 #include <string.h>
 #include <sys/sysinfo.h>
+#include <time.h>
 #include <unistd.h>
 
 // defined in the detector specific Makefile
@@ -46,12 +47,14 @@ extern int isControlServer;
 extern int ret;
 extern int fnum;
 extern char mess[MAX_STR_LENGTH];
+extern uint64_t configEpoch;
 
 // Variables that will be exported
 int sockfd = 0;
 int debugflag = 0;
 int updateFlag = 0;
 int checkModuleFlag = 1;
+int highRateFlag = 0;
 
 udpStruct udpDetails[MAX_UDP_DESTINATION];
 int numUdpDestinations = 1;
@@ -129,6 +132,8 @@ void init_detector() {
     udpDetails[0].dstport2 = DEFAULT_UDP_DST_PORTNO + 1;
 #endif
     lockStatus = 0;
+    // differs after a restart of the server
+    configEpoch = (uint64_t)time(NULL) << 32;
     if (isControlServer) {
         basictests();
         initControlServer();
@@ -461,6 +466,7 @@ void function_table() {
     flist[F_UPDATE_DETECTOR_SERVER] = &update_detector_server;
     flist[F_GET_UPDATE_MODE] = &get_update_mode;
     flist[F_SET_UPDATE_MODE] = &set_update_mode;
+    flist[F_GET_CONFIG_EPOCH] = &get_config_epoch;
 
     // check
     if (NUM_DET_FUNCTIONS >= RECEIVER_ENUM_START) {
@@ -7513,14 +7519,24 @@ int set_pattern(int file_des) {
 
     patternParameters *pat = malloc(sizeof(patternParameters));
     memset(pat, 0, sizeof(patternParameters));
+    uint64_t hash = 0;
     // ignoring endianness for eiger
-    if (receiveData(file_des, pat, sizeof(patternParameters), INT32) < 0) {
+    if (receiveData(file_des, pat, sizeof(patternParameters), INT32) < 0 ||
+        receiveData(file_des, &hash, sizeof(hash), INT64) < 0) {
         if (pat != NULL)
             free(pat);
         return printSocketReadError();
     }
 
     if (Server_VerifyLock() == OK) {
+        if (hash != getPatternHash(pat)) {
+            LOG(logWARNING, ("Pattern hash does not match the pattern, "
+                             "loading it\n"));
+        } else if (hash == getLoadedPatternHash()) {
+            LOG(logINFO, ("Pattern already loaded, skipping\n"));
+            free(pat);
+            return Server_SendResult(file_des, INT32, NULL, 0);
+        }
         LOG(logINFO, ("Setting Pattern from structure\n"));
         ret = loadPattern(mess, logINFO, pat);
     }
@@ -9663,4 +9679,12 @@ int set_update_mode(int file_des) {
     }
 
     return Server_SendResult(file_des, INT32, NULL, 0);
-}
\ No newline at end of file
+}
+
+int get_config_epoch(int file_des) {
+    ret = OK;
+    memset(mess, 0, sizeof(mess));
+    uint64_t retval = configEpoch;
+    LOG(logDEBUG1, ("config epoch retval: 0x%llx\n", (long long int)retval));
+    return Server_SendResult(file_des, INT64, &retval, sizeof(retval));
+}
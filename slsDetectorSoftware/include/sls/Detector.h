@@ -55,10 +55,21 @@ class Detector {
     normally */
     void loadConfig(const std::string &fname);
 
-    /** Shared memory not freed prior. Set up per measurement. */
-    void loadParameters(const std::string &fname);
-
-    void loadParameters(const std::vector<std::string> &parameters);
+    /** Shared memory not freed prior. Set up per measurement. \n
+     * Lines are set in file order.\n
+     * [skipUnchanged] reads back every value and skips the ones already
+     * set\n
+     * [concurrentModules] sets consecutive lines for single modules
+     * [id:command] of different modules concurrently. Setup and detector
+     * wide commands (hostname, exptime, zmqport...) still run alone, in
+     * file order
+     */
+    void loadParameters(const std::string &fname, bool skipUnchanged = false,
+                        bool concurrentModules = false);
+
+    void loadParameters(const std::vector<std::string> &parameters,
+                        bool skipUnchanged = false,
+                        bool concurrentModules = false);
 
     Result<std::string> getHostname(Positions pos = {}) const;
 
@@ -72,6 +83,16 @@ class Detector {
     /** Gets shared memory ID */
     int getShmId() const;
 
+    Result<bool> getConfigCache(Positions pos = {}) const;
+
+    /** Caches frames, triggers, exptime, period, delay, dynamic range and
+     * timing mode in shared memory, so that getting them does not contact the
+     * detector. Sets of this client clear the cache. Sets of other clients
+     * are seen from a counter of the detector server, checked at most every
+     * 100 ms. Status, temperatures etc. are never cached. Default is false.
+     */
+    void setConfigCache(bool value, Positions pos = {});
+
     /** package git branch */
     std::string getPackageVersion() const;
 
@@ -33,6 +33,8 @@ class Pattern {
     patternParameters *data();
     patternParameters *data() const;
     size_t size() const noexcept { return sizeof(patternParameters); }
+    /** FNV-1a of the structure, same as the detector server computes */
+    uint64_t hash() const noexcept;
     void validate() const;
     void load(const std::string &fname);
     void save(const std::string &fname);
@@ -784,6 +784,7 @@ class CmdProxy {
         {"trimen", &CmdProxy::TrimEnergies},
         {"gappixels", &CmdProxy::GapPixels},
         {"fliprows", &CmdProxy::fliprows},
+        {"configcache", &CmdProxy::configcache},
 
         /* acquisition parameters */
         {"acquire", &CmdProxy::Acquire},
@@ -1280,6 +1281,13 @@ class CmdProxy {
         "interfaces must be set to 2. slsReceiver and slsDetectorGui "
         "does not handle.");
 
+    INTEGER_COMMAND_VEC_ID(
+        configcache, getConfigCache, setConfigCache, StringTo<int>,
+        "[0, 1]\n\tCaches frames, triggers, exptime, period, delay, dr and "
+        "timing in shared memory, so that getting them does not contact the "
+        "detector. Sets from other clients are detected within 100 ms. "
+        "Default is 0.");
+
     /* acquisition parameters */
 
     INTEGER_COMMAND_SET_NOID_GET_ID(
@@ -0,0 +1,269 @@
+// SPDX-License-Identifier: LGPL-3.0-or-other
+// Copyright (C) 2021 Contributors to the SLS Detector Package
+#include "ConfigLoader.h"
+#include "CmdParser.h"
+#include "sls/ToString.h"
+#include "sls/logger.h"
+#include "sls/sls_detector_exceptions.h"
+
+#include <algorithm>
+#include <exception>
+#include <future>
+#include <set>
+#include <sstream>
+
+namespace sls {
+
+namespace {
+// trailing units the getters take as well
+const std::set<std::string> units{"mv", "mV", "deg"};
+
+// arguments for the renamed command, deprecated dac names are dac arguments
+std::vector<std::string> ResolvedArguments(const ConfigLoader::Line &line) {
+    auto args = line.arguments;
+    if (line.name == "dac" && line.command != "dac") {
+        args.insert(args.begin(), line.command);
+    }
+    return args;
+}
+} // namespace
+
+ConfigLoader::ConfigLoader(Detector *ptr, bool skip, bool concurrent)
+    : det(ptr), skipUnchanged(skip), concurrentModules(concurrent) {}
+
+bool ConfigLoader::IsSetupCommand(const std::string &command) {
+    // needed by (almost) every other command, never read back
+    static const std::set<std::string> setup{"initialchecks", "detsize",
+                                             "hostname", "virtual"};
+    return setup.count(command) != 0;
+}
+
+bool ConfigLoader::IsSerialCommand(const std::string &command) {
+    // change detector wide state or other modules, even for one module
+    static const std::set<std::string> serial{
+        "config",        "parameters", "free",       "acquire",
+        "exptime",       "subexptime", "dr",         "ratecorr",
+        "powerchip",     "scan",       "defaultdac", "udp_dstlist",
+        "numinterfaces", "vetostream", "zmqport",    "zmqip",
+        "rx_hostname",   "rx_zmqport", "rx_zmqip",   "rx_zmqstream"};
+    return IsSetupCommand(command) || serial.count(command) != 0;
+}
+
+std::vector<std::string> ConfigLoader::GetterArguments(const Line &line) {
+    // number of leading arguments selecting what is set
+    static const std::map<std::string, size_t> selectors{
+        {"dac", 1},    {"reg", 1},    {"clkfreq", 1}, {"clkphase", 1},
+        {"clkdiv", 1}, {"extsig", 1}, {"patword", 1}, {"rx_jsonpara", 1}};
+    auto args = ResolvedArguments(line);
+    auto it = selectors.find(line.name);
+    size_t n = it == selectors.end() ? 0 : it->second;
+    if (args.size() <= n) {
+        return args;
+    }
+    std::vector<std::string> keys(args.begin(), args.begin() + n);
+    if (args.size() > n + 1 && units.count(args.back()) != 0) {
+        keys.push_back(args.back());
+    }
+    return keys;
+}
+
+std::vector<ConfigLoader::Step>
+ConfigLoader::Plan(const std::vector<std::string> &lines, bool concurrent) {
+    CmdProxy proxy(nullptr);
+    auto commands = proxy.GetProxyCommands();
+    std::set<std::string> known(commands.begin(), commands.end());
+    auto depreciated = proxy.GetDepreciatedCommands();
+
+    std::vector<std::pair<Line, bool>> parsed; // line, per module
+    CmdParser parser;
+    for (const auto &text : lines) {
+        parser.Parse(text);
+        if (parser.command().empty()) {
+            continue;
+        }
+        Line line;
+        line.text = text;
+        line.command = parser.command();
+        line.arguments = parser.arguments();
+        line.detector_id = parser.detector_id();
+        line.receiver_id = parser.receiver_id();
+
+        line.name = line.command;
+        for (auto it = depreciated.find(line.name); it != depreciated.end();
+             it = depreciated.find(line.name)) {
+            line.name = it->second;
+        }
+        if (known.count(line.name) == 0) {
+            throw RuntimeError("Unknown command " + line.command +
+                               " in config line: " + text);
+        }
+        bool perModule = concurrent && line.detector_id >= 0 &&
+                         !IsSerialCommand(line.name);
+        parsed.emplace_back(line, perModule);
+    }
+
+    // file order, consecutive per module lines share a step, one group per
+    // module
+    std::vector<Step> plan;
+    bool batching = false;
+    for (const auto &it : parsed) {
+        const Line &line = it.first;
+        if (!it.second) {
+            plan.emplace_back();
+            plan.back().groups.push_back({line});
+            batching = false;
+            continue;
+        }
+        if (!batching) {
+            plan.emplace_back();
+            batching = true;
+        }
+        auto &groups = plan.back().groups;
+        auto group = std::find_if(groups.begin(), groups.end(),
+                                  [&line](const std::vector<Line> &g) {
+                                      return g.front().detector_id ==
+                                             line.detector_id;
+                                  });
+        if (group == groups.end()) {
+            groups.push_back({line});
+        } else {
+            group->push_back(line);
+        }
+    }
+    return plan;
+}
+
+void ConfigLoader::Load(const std::vector<std::string> &lines,
+                        std::ostream &os) {
+    auto plan = Plan(lines, concurrentModules);
+    auto merge = [this](const TimingMap &groupTimings) {
+        for (const auto &it : groupTimings) {
+            auto &timing = timings[it.first];
+            timing.count += it.second.count;
+            timing.skipped += it.second.skipped;
+            timing.time += it.second.time;
+        }
+    };
+
+    for (const auto &step : plan) {
+        if (!step.concurrent()) {
+            TimingMap groupTimings;
+            try {
+                RunGroup(step.groups.front(), os, groupTimings);
+            } catch (...) {
+                merge(groupTimings);
+                throw;
+            }
+            merge(groupTimings);
+            continue;
+        }
+
+        const size_t n = step.groups.size();
+        std::vector<std::ostringstream> outputs(n);
+        std::vector<TimingMap> groupTimings(n);
+        std::vector<std::future<void>> futures;
+        futures.reserve(n);
+        for (size_t i = 0; i != n; ++i) {
+            futures.push_back(std::async(std::launch::async, [&, i]() {
+                RunGroup(step.groups[i], outputs[i], groupTimings[i]);
+            }));
+        }
+        // output in module order, first error after all modules are done
+        std::exception_ptr error;
+        for (size_t i = 0; i != n; ++i) {
+            try {
+                futures[i].get();
+            } catch (...) {
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+            os << outputs[i].str();
+            merge(groupTimings[i]);
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+    LOG(logINFO) << TimingReport();
+}
+
+void ConfigLoader::RunGroup(const std::vector<Line> &group, std::ostream &os,
+                            TimingMap &groupTimings) const {
+    CmdProxy proxy(det);
+    for (const auto &line : group) {
+        auto begin = std::chrono::steady_clock::now();
+        auto &timing = groupTimings[line.command];
+        ++timing.count;
+        if (skipUnchanged && IsUnchanged(proxy, line)) {
+            ++timing.skipped;
+            LOG(logDEBUG1) << "Unchanged, skipping: " << line.text;
+        } else {
+            proxy.Call(line.command, line.arguments, line.detector_id,
+                       defs::PUT_ACTION, os, line.receiver_id);
+        }
+        timing.time += std::chrono::steady_clock::now() - begin;
+    }
+}
+
+bool ConfigLoader::IsUnchanged(CmdProxy &proxy, const Line &line) const {
+    if (line.arguments.empty() || IsSetupCommand(line.name)) {
+        return false;
+    }
+    auto args = ResolvedArguments(line);
+    auto keys = GetterArguments(line);
+    if (keys.size() == args.size()) {
+        // nothing to compare
+        return false;
+    }
+    std::ostringstream out;
+    try {
+        proxy.Call(line.name, keys, line.detector_id, defs::GET_ACTION, out,
+                   line.receiver_id);
+    } catch (const std::exception &) {
+        // cannot be read back, set it
+        return false;
+    }
+    std::istringstream iss(out.str());
+    std::vector<std::string> tokens;
+    for (std::string token; iss >> token;) {
+        tokens.push_back(token);
+    }
+    // first token is the command, some getters print the selecting
+    // arguments as well
+    auto matches = [&tokens](std::vector<std::string>::const_iterator first,
+                             std::vector<std::string>::const_iterator last) {
+        return tokens.size() == static_cast<size_t>(last - first) + 1 &&
+               std::equal(first, last, tokens.begin() + 1);
+    };
+    size_t numSelectors = keys.size();
+    if (numSelectors != 0 && units.count(keys.back()) != 0) {
+        --numSelectors;
+    }
+    return matches(args.begin(), args.end()) ||
+           matches(args.begin() + numSelectors, args.end());
+}
+
+std::string ConfigLoader::TimingReport() const {
+    std::vector<std::pair<std::string, Timing>> sorted(timings.begin(),
+                                                       timings.end());
+    std::sort(sorted.begin(), sorted.end(),
+              [](const std::pair<std::string, Timing> &a,
+                 const std::pair<std::string, Timing> &b) {
+                  return a.second.time > b.second.time;
+              });
+    std::chrono::nanoseconds total{0};
+    std::ostringstream os;
+    for (const auto &it : sorted) {
+        total += it.second.time;
+        os << "\n\t" << it.first << " x" << it.second.count;
+        if (it.second.skipped != 0) {
+            os << " (" << it.second.skipped << " unchanged)";
+        }
+        os << ": " << ToString(it.second.time);
+    }
+    return "Config commands took " + ToString(total) +
+           " (sum over modules)" + os.str();
+}
+
+} // namespace sls
@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: LGPL-3.0-or-other
+// Copyright (C) 2021 Contributors to the SLS Detector Package
+#pragma once
+/*
+
+Runs the lines of a config file (Detector::loadParameters). All lines are
+parsed and their commands checked before anything is set. Lines run in the
+order of the file.
+
+Optionally (concurrent), consecutive lines for single modules ([id]:command)
+run concurrently, one thread per module keeping the order of its lines.
+Setup commands (hostname, detsize...) and commands changing detector wide
+state or other modules (exptime, zmq ports, rx_hostname...) are barriers:
+they always run alone, after all the lines before them and before all the
+lines after them.
+
+Optionally (skip), every value is read back first and the set is skipped if
+the output already matches the line. The getter gets the arguments selecting
+what is set (dac name, register, clock index...) and units, not the values.
+Time spent per command is logged at the end.
+
+This class is fully internal to the project and NO guarantees are given
+on the stability of the interface or implementation.
+
+*/
+
+#include "CmdProxy.h"
+#include "sls/Detector.h"
+
+#include <chrono>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace sls {
+
+class ConfigLoader {
+  public:
+    struct Line {
+        std::string text;
+        std::string command;
+        /** command after deprecated renames */
+        std::string name;
+        std::vector<std::string> arguments;
+        int detector_id{-1};
+        int receiver_id{-1};
+    };
+
+    /** one group runs alone, several groups (one per module) concurrently */
+    struct Step {
+        std::vector<std::vector<Line>> groups;
+        bool concurrent() const { return groups.size() > 1; }
+    };
+
+    struct Timing {
+        int count{0};
+        int skipped{0};
+        std::chrono::nanoseconds time{0};
+    };
+
+    ConfigLoader(Detector *ptr, bool skip, bool concurrent = false);
+
+    /** parses all lines, throws on a bad line before anything is run */
+    static std::vector<Step> Plan(const std::vector<std::string> &lines,
+                                  bool concurrent = false);
+    void Load(const std::vector<std::string> &lines, std::ostream &os);
+    /** arguments of the line passed to the getter to read the value back */
+    static std::vector<std::string> GetterArguments(const Line &line);
+
+    const std::map<std::string, Timing> &getTimings() const noexcept {
+        return timings;
+    }
+    /** commands sorted by time spent */
+    std::string TimingReport() const;
+
+  private:
+    using TimingMap = std::map<std::string, Timing>;
+    static bool IsSetupCommand(const std::string &command);
+    static bool IsSerialCommand(const std::string &command);
+    /** runs in its own thread for concurrent steps */
+    void RunGroup(const std::vector<Line> &group, std::ostream &os,
+                  TimingMap &groupTimings) const;
+    bool IsUnchanged(CmdProxy &proxy, const Line &line) const;
+
+    Detector *det;
+    bool skipUnchanged;
+    bool concurrentModules;
+    TimingMap timings;
+};
+
+} // namespace sls
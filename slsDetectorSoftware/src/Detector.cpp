@@ -3,8 +3,8 @@
 #include "sls/Detector.h"
 #include "sls/detectorData.h"
 
-#include "CmdParser.h"
 #include "CmdProxy.h"
+#include "ConfigLoader.h"
 #include "DetectorImpl.h"
 #include "Module.h"
 #include "sls/Pattern.h"
@@ -64,7 +64,8 @@ void Detector::loadConfig(const std::string &fname) {
     loadParameters(fname);
 }
 
-void Detector::loadParameters(const std::string &fname) {
+void Detector::loadParameters(const std::string &fname, bool skipUnchanged,
+                              bool concurrentModules) {
     std::ifstream input_file(fname);
     if (!input_file) {
         throw RuntimeError("Could not open configuration file " + fname +
@@ -79,17 +80,13 @@ void Detector::loadParameters(const std::string &fname) {
             parameters.push_back(line);
         }
     }
-    loadParameters(parameters);
+    loadParameters(parameters, skipUnchanged, concurrentModules);
 }
 
-void Detector::loadParameters(const std::vector<std::string> &parameters) {
-    CmdProxy proxy(this);
-    CmdParser parser;
-    for (const auto &current_line : parameters) {
-        parser.Parse(current_line);
-        proxy.Call(parser.command(), parser.arguments(), parser.detector_id(),
-                   defs::PUT_ACTION, std::cout, parser.receiver_id());
-    }
+void Detector::loadParameters(const std::vector<std::string> &parameters,
+                              bool skipUnchanged, bool concurrentModules) {
+    ConfigLoader loader(this, skipUnchanged, concurrentModules);
+    loader.Load(parameters, std::cout);
 }
 
 Result<std::string> Detector::getHostname(Positions pos) const {
@@ -106,6 +103,14 @@ void Detector::setVirtualDetectorServers(int numServers, int startingPort) {
 
 int Detector::getShmId() const { return pimpl->getDetectorIndex(); }
 
+Result<bool> Detector::getConfigCache(Positions pos) const {
+    return pimpl->Parallel(&Module::getConfigCache, pos);
+}
+
+void Detector::setConfigCache(bool value, Positions pos) {
+    pimpl->Parallel(&Module::setConfigCache, pos, value);
+}
+
 std::string Detector::getPackageVersion() const { return GITBRANCH; }
 
 int64_t Detector::getClientVersion() const { return APILIB; }
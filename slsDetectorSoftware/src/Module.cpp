@@ -84,6 +84,14 @@ void Module::setHostname(const std::string &hostname,
     if (shm()->detType == EIGER) {
         setActivate(true);
     }
+    clearConfigCache();
+}
+
+bool Module::getConfigCache() const { return shm()->configCache.enable; }
+
+void Module::setConfigCache(bool value) {
+    clearConfigCache();
+    shm()->configCache.enable = value;
 }
 
 int64_t Module::getFirmwareVersion() const {
@@ -489,7 +497,9 @@ bool Module::isVirtualDetectorServer() const {
 }
 
 int64_t Module::getNumberOfFrames() const {
-    return sendToDetector<int64_t>(F_GET_NUM_FRAMES);
+    return getCached(sharedConfigCache::FRAMES, [this]() {
+        return sendToDetector<int64_t>(F_GET_NUM_FRAMES);
+    });
 }
 
 void Module::setNumberOfFrames(int64_t value) {
@@ -500,7 +510,9 @@ void Module::setNumberOfFrames(int64_t value) {
 }
 
 int64_t Module::getNumberOfTriggers() const {
-    return sendToDetector<int64_t>(F_GET_NUM_TRIGGERS);
+    return getCached(sharedConfigCache::TRIGGERS, [this]() {
+        return sendToDetector<int64_t>(F_GET_NUM_TRIGGERS);
+    });
 }
 
 void Module::setNumberOfTriggers(int64_t value) {
@@ -511,7 +523,12 @@ void Module::setNumberOfTriggers(int64_t value) {
 }
 
 int64_t Module::getExptime(int gateIndex) const {
-    return sendToDetector<int64_t>(F_GET_EXPTIME, gateIndex);
+    if (gateIndex != -1) {
+        return sendToDetector<int64_t>(F_GET_EXPTIME, gateIndex);
+    }
+    return getCached(sharedConfigCache::EXPTIME, [this]() {
+        return sendToDetector<int64_t>(F_GET_EXPTIME, -1);
+    });
 }
 
 void Module::setExptime(int gateIndex, int64_t value) {
@@ -530,7 +547,9 @@ void Module::setExptime(int gateIndex, int64_t value) {
 }
 
 int64_t Module::getPeriod() const {
-    return sendToDetector<int64_t>(F_GET_PERIOD);
+    return getCached(sharedConfigCache::PERIOD, [this]() {
+        return sendToDetector<int64_t>(F_GET_PERIOD);
+    });
 }
 
 void Module::setPeriod(int64_t value) {
@@ -541,7 +560,9 @@ void Module::setPeriod(int64_t value) {
 }
 
 int64_t Module::getDelayAfterTrigger() const {
-    return sendToDetector<int64_t>(F_GET_DELAY_AFTER_TRIGGER);
+    return getCached(sharedConfigCache::DELAY, [this]() {
+        return sendToDetector<int64_t>(F_GET_DELAY_AFTER_TRIGGER);
+    });
 }
 
 void Module::setDelayAfterTrigger(int64_t value) {
@@ -565,7 +586,10 @@ int64_t Module::getPeriodLeft() const {
 }
 
 int Module::getDynamicRange() const {
-    return sendToDetector<int>(F_SET_DYNAMIC_RANGE, GET_FLAG);
+    return static_cast<int>(
+        getCached(sharedConfigCache::DYNAMIC_RANGE, [this]() {
+            return sendToDetector<int>(F_SET_DYNAMIC_RANGE, GET_FLAG);
+        }));
 }
 
 void Module::setDynamicRange(int dr) {
@@ -598,7 +622,10 @@ void Module::setDynamicRange(int dr) {
 }
 
 slsDetectorDefs::timingMode Module::getTimingMode() const {
-    return sendToDetector<timingMode>(F_SET_TIMING_MODE, GET_FLAG);
+    return static_cast<timingMode>(
+        getCached(sharedConfigCache::TIMING_MODE, [this]() {
+            return sendToDetector<timingMode>(F_SET_TIMING_MODE, GET_FLAG);
+        }));
 }
 
 void Module::setTimingMode(timingMode value) {
@@ -2315,7 +2342,16 @@ void Module::setLEDEnable(bool enable) {
 // Pattern
 
 void Module::setPattern(const Pattern &pat) {
-    sendToDetector(F_SET_PATTERN, pat.data(), pat.size(), nullptr, 0);
+    // the server skips loading a pattern with the hash of the loaded one
+    const uint64_t hash = pat.hash();
+    auto client = DetectorSocket(shm()->hostname, shm()->controlPort);
+    client.Send(F_SET_PATTERN);
+    client.Send(pat.data(), pat.size());
+    client.Send(hash);
+    if (client.Receive<int>() == FAIL) {
+        throw DetectorError("Detector " + std::to_string(moduleIndex) +
+                            " returned error: " + client.readErrorMessage());
+    }
 }
 
 Pattern Module::getPattern() {
@@ -2748,6 +2784,7 @@ void Module::sendToDetector(int fnum, const void *args, size_t args_size,
                             void *retval, size_t retval_size) {
     static_cast<const Module &>(*this).sendToDetector(fnum, args, args_size,
                                                       retval, retval_size);
+    clearConfigCache();
 }
 
 template <typename Arg, typename Ret>
@@ -2765,6 +2802,7 @@ void Module::sendToDetector(int fnum, const Arg &args, Ret &retval) const {
 template <typename Arg, typename Ret>
 void Module::sendToDetector(int fnum, const Arg &args, Ret &retval) {
     static_cast<const Module &>(*this).sendToDetector(fnum, args, retval);
+    clearConfigCache();
 }
 
 template <typename Arg>
@@ -2780,6 +2818,7 @@ void Module::sendToDetector(int fnum, const Arg &args, std::nullptr_t) const {
 template <typename Arg>
 void Module::sendToDetector(int fnum, const Arg &args, std::nullptr_t) {
     static_cast<const Module &>(*this).sendToDetector(fnum, args, nullptr);
+    clearConfigCache();
 }
 
 template <typename Ret>
@@ -2796,6 +2835,7 @@ void Module::sendToDetector(int fnum, std::nullptr_t, Ret &retval) const {
 template <typename Ret>
 void Module::sendToDetector(int fnum, std::nullptr_t, Ret &retval) {
     static_cast<const Module &>(*this).sendToDetector(fnum, nullptr, retval);
+    clearConfigCache();
 }
 
 void Module::sendToDetector(int fnum) const {
@@ -2807,6 +2847,7 @@ void Module::sendToDetector(int fnum) const {
 
 void Module::sendToDetector(int fnum) {
     static_cast<const Module &>(*this).sendToDetector(fnum);
+    clearConfigCache();
 }
 
 template <typename Ret> Ret Module::sendToDetector(int fnum) const {
@@ -2822,7 +2863,9 @@ template <typename Ret> Ret Module::sendToDetector(int fnum) const {
 }
 
 template <typename Ret> Ret Module::sendToDetector(int fnum) {
-    return static_cast<const Module &>(*this).sendToDetector<Ret>(fnum);
+    auto retval = static_cast<const Module &>(*this).sendToDetector<Ret>(fnum);
+    clearConfigCache();
+    return retval;
 }
 
 template <typename Ret, typename Arg>
@@ -2841,7 +2884,10 @@ Ret Module::sendToDetector(int fnum, const Arg &args) const {
 
 template <typename Ret, typename Arg>
 Ret Module::sendToDetector(int fnum, const Arg &args) {
-    return static_cast<const Module &>(*this).sendToDetector<Ret>(fnum, args);
+    auto retval =
+        static_cast<const Module &>(*this).sendToDetector<Ret>(fnum, args);
+    clearConfigCache();
+    return retval;
 }
 
 //---------------------------------------------------------- sendToDetectorStop
@@ -3135,6 +3181,7 @@ void Module::initializeModuleStructure(detectorType type) {
     shm()->zmqip = IpAddr{};
     shm()->numUDPInterfaces = 1;
     shm()->stoppedFlag = false;
+    shm()->configCache = sharedConfigCache{};
 
     // get the Module parameters based on type
     detParameters parameters{type};
@@ -3267,6 +3314,44 @@ void Module::updateRateCorrection() {
     sendToDetector(F_UPDATE_RATE_CORRECTION);
 }
 
+template <typename Getter>
+int64_t Module::getCached(sharedConfigCache::parameter index,
+                          Getter get) const {
+    auto &cache = shm()->configCache;
+    if (!cache.enable) {
+        return get();
+    }
+    checkConfigCache();
+    if (!cache.valid[index]) {
+        cache.value[index] = get();
+        cache.valid[index] = true;
+    }
+    return cache.value[index];
+}
+
+void Module::checkConfigCache() const {
+    auto &cache = shm()->configCache;
+    int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now().time_since_epoch())
+                      .count();
+    if (now - cache.checked < CONFIG_CACHE_CHECK_INTERVAL_NS) {
+        return;
+    }
+    auto epoch = sendToDetector<uint64_t>(F_GET_CONFIG_EPOCH);
+    if (epoch != cache.epoch) {
+        std::fill(std::begin(cache.valid), std::end(cache.valid), false);
+        cache.epoch = epoch;
+    }
+    cache.checked = now;
+}
+
+void Module::clearConfigCache() {
+    auto &cache = shm()->configCache;
+    std::fill(std::begin(cache.valid), std::end(cache.valid), false);
+    // sets increment the epoch, check it again
+    cache.checked = 0;
+}
+
 sls_detector_module Module::interpolateTrim(sls_detector_module *a,
                                             sls_detector_module *b,
                                             const int energy, const int e1,
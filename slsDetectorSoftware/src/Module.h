@@ -17,10 +17,31 @@
 class ServerInterface;
 
 #define MODULE_SHMAPIVERSION 0x190726
-#define MODULE_SHMVERSION    0x200402
+#define MODULE_SHMVERSION    0x261019
 
 namespace sls {
 
+/** static configuration read from the module, see Detector::setConfigCache */
+struct sharedConfigCache {
+    enum parameter {
+        FRAMES,
+        TRIGGERS,
+        EXPTIME,
+        PERIOD,
+        DELAY,
+        DYNAMIC_RANGE,
+        TIMING_MODE,
+        NUM_PARAMETERS
+    };
+    bool enable;
+    /** set counter of the detector server the values were read at */
+    uint64_t epoch;
+    /** steady clock of the last check of epoch [ns] */
+    int64_t checked;
+    bool valid[NUM_PARAMETERS];
+    int64_t value[NUM_PARAMETERS];
+};
+
 /**
  * @short structure allocated in shared memory to store Module settings for
  * IPC and cache
@@ -56,6 +77,7 @@ struct sharedModule {
     int numUDPInterfaces;
     /** to inform rxr when stopping rxr */
     bool stoppedFlag;
+    sharedConfigCache configCache;
 };
 
 class Module : public virtual slsDetectorDefs {
@@ -88,6 +110,8 @@ class Module : public virtual slsDetectorDefs {
     other server start up checks. Enabled by default. Disable only for advanced
     users! */
     void setHostname(const std::string &hostname, const bool initialChecks);
+    bool getConfigCache() const;
+    void setConfigCache(bool value);
 
     int64_t getFirmwareVersion() const;
     int64_t getDetectorServerVersion() const;
@@ -499,6 +523,7 @@ class Module : public virtual slsDetectorDefs {
      *    Pattern                                     *
      *                                                *
      * ************************************************/
+    /** skipped by the server if it already has this pattern loaded */
     void setPattern(const Pattern &pat);
     Pattern getPattern();
     void loadDefaultPattern();
@@ -582,6 +607,7 @@ class Module : public virtual slsDetectorDefs {
 
     /**
      * Send function parameters to detector (control server)
+     * The non const versions are used by sets and clear the config cache
      * @param fnum function enum
      * @param args argument pointer
      * @param args_size size of argument
@@ -721,6 +747,14 @@ class Module : public virtual slsDetectorDefs {
     void updateReceiverStreamingIP();
 
     void updateRateCorrection();
+
+    /** cached value if enabled and still valid, else get() */
+    template <typename Getter>
+    int64_t getCached(sharedConfigCache::parameter index, Getter get) const;
+    /** invalidates the cache if the detector server had sets since */
+    void checkConfigCache() const;
+    void clearConfigCache();
+
     /** Template function to do linear interpolation between two points (Eiger
      only) */
     template <typename E, typename V>
@@ -765,6 +799,7 @@ class Module : public virtual slsDetectorDefs {
     static const int NIOS_WRITE_TO_FLASH_TIME_FPGA = 45;
     static const int NIOS_ERASE_FLASH_TIME_KERNEL = 9;
     static const int NIOS_WRITE_TO_FLASH_TIME_KERNEL = 40;
+    static const int64_t CONFIG_CACHE_CHECK_INTERVAL_NS = 100000000;
 };
 
 } // namespace sls
\ No newline at end of file
@@ -56,6 +56,16 @@ bool Pattern::operator!=(const Pattern &other) const {
 patternParameters *Pattern::data() { return pat; }
 patternParameters *Pattern::data() const { return pat; }
 
+uint64_t Pattern::hash() const noexcept {
+    auto byte = reinterpret_cast<const unsigned char *>(pat);
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i != sizeof(patternParameters); ++i) {
+        h ^= byte[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
 void Pattern::validate() const {
     if (pat->limits[0] >= MAX_PATTERN_LENGTH ||
         pat->limits[1] >= MAX_PATTERN_LENGTH) {
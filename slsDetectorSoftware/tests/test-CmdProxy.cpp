@@ -570,6 +570,38 @@ TEST_CASE("fliprows", "[.cmd]") {
     }
 }
 
+TEST_CASE("configcache", "[.cmd]") {
+    Detector det;
+    CmdProxy proxy(&det);
+    auto prev_val = det.getConfigCache();
+    auto prev_frames = det.getNumberOfFrames().tsquash(
+        "inconsistent number of frames to test");
+    {
+        std::ostringstream oss;
+        proxy.Call("configcache", {"1"}, -1, PUT, oss);
+        REQUIRE(oss.str() == "configcache 1\n");
+    }
+    {
+        std::ostringstream oss;
+        proxy.Call("configcache", {}, -1, GET, oss);
+        REQUIRE(oss.str() == "configcache 1\n");
+    }
+    // sets clear the cache
+    det.setNumberOfFrames(3);
+    REQUIRE(det.getNumberOfFrames().squash() == 3);
+    det.setNumberOfFrames(4);
+    REQUIRE(det.getNumberOfFrames().squash() == 4);
+    {
+        std::ostringstream oss;
+        proxy.Call("configcache", {"0"}, -1, PUT, oss);
+        REQUIRE(oss.str() == "configcache 0\n");
+    }
+    det.setNumberOfFrames(prev_frames);
+    for (int i = 0; i != det.size(); ++i) {
+        det.setConfigCache(prev_val[i], {i});
+    }
+}
+
 /* acquisition parameters */
 
 // acquire: not testing
@@ -0,0 +1,86 @@
+// SPDX-License-Identifier: LGPL-3.0-or-other
+// Copyright (C) 2021 Contributors to the SLS Detector Package
+#include "ConfigLoader.h"
+#include "catch.hpp"
+#include "sls/sls_detector_exceptions.h"
+#include <string>
+#include <vector>
+
+using vs = std::vector<std::string>;
+using sls::ConfigLoader;
+
+namespace {
+vs Commands(const ConfigLoader::Step &step, size_t group = 0) {
+    vs commands;
+    for (const auto &line : step.groups.at(group)) {
+        commands.push_back(line.command);
+    }
+    return commands;
+}
+} // namespace
+
+TEST_CASE("Lines are planned in file order", "[detector]") {
+    auto plan = ConfigLoader::Plan(
+        {"frames 5", "hostname a+b+", "  ", "detsizechan 1024 512",
+         "0:udp_dstport 50001", "1:udp_dstport 50002"});
+    REQUIRE(plan.size() == 5);
+    CHECK(Commands(plan[0]) == vs{"frames"});
+    CHECK(Commands(plan[1]) == vs{"hostname"});
+    CHECK(Commands(plan[2]) == vs{"detsizechan"});
+    CHECK(Commands(plan[3]) == vs{"udp_dstport"});
+    CHECK(Commands(plan[4]) == vs{"udp_dstport"});
+    // modules only concurrent on request
+    for (const auto &step : plan) {
+        CHECK_FALSE(step.concurrent());
+    }
+    CHECK(plan[2].groups[0][0].arguments == vs{"1024", "512"});
+    CHECK(plan[3].groups[0][0].detector_id == 0);
+}
+
+TEST_CASE("Lines of different modules are planned concurrently",
+          "[detector]") {
+    auto plan = ConfigLoader::Plan(
+        {"0:udp_dstip 10.0.0.1", "1:udp_dstip 10.0.0.2", "0:udp_dstport 50001",
+         "1:udp_dstport 50002", "frames 5", "0:rx_tcpport 1954",
+         "0:exptime 1ms", "1:exptime 1ms", "0:hostname a", "1:dac 0 10"},
+        true);
+    REQUIRE(plan.size() == 7);
+    REQUIRE(plan[0].concurrent());
+    REQUIRE(plan[0].groups.size() == 2);
+    CHECK(Commands(plan[0], 0) == vs{"udp_dstip", "udp_dstport"});
+    CHECK(Commands(plan[0], 1) == vs{"udp_dstip", "udp_dstport"});
+    CHECK(plan[0].groups[1][1].arguments == vs{"50002"});
+    CHECK(Commands(plan[1]) == vs{"frames"});
+    // a single module does not need a thread
+    CHECK(Commands(plan[2]) == vs{"rx_tcpport"});
+    CHECK_FALSE(plan[2].concurrent());
+    // changes detector wide state, one at a time
+    CHECK(Commands(plan[3]) == vs{"exptime"});
+    CHECK(Commands(plan[4]) == vs{"exptime"});
+    // setup commands stay in place and are barriers
+    CHECK(Commands(plan[5]) == vs{"hostname"});
+    CHECK(Commands(plan[6]) == vs{"dac"});
+}
+
+TEST_CASE("Values are read back with the selecting arguments",
+          "[detector]") {
+    auto getter = [](const std::string &text) {
+        auto plan = ConfigLoader::Plan({text});
+        return ConfigLoader::GetterArguments(plan.at(0).groups[0][0]);
+    };
+    CHECK(getter("frames 5").empty());
+    CHECK(getter("roi 0 10").empty());
+    CHECK(getter("trimen 4500 5400 6400").empty());
+    CHECK(getter("exptime 5 ms").empty());
+    CHECK(getter("dac vb_comp 1200") == vs{"vb_comp"});
+    CHECK(getter("dac vb_comp 1200 mV") == vs{"vb_comp", "mV"});
+    CHECK(getter("vthreshold 1200 mV") == vs{"vthreshold", "mV"});
+    CHECK(getter("0:reg 0x5d 0x10") == vs{"0x5d"});
+    CHECK(getter("clkphase 1 20 deg") == vs{"1", "deg"});
+    CHECK(getter("rx_jsonpara emin 10") == vs{"emin"});
+}
+
+TEST_CASE("Unknown command fails before anything is run", "[detector]") {
+    REQUIRE_THROWS_AS(ConfigLoader::Plan({"frames 5", "framez 5"}),
+                      sls::RuntimeError);
+}
@@ -27,3 +27,15 @@ TEST_CASE("Compare patterns") {
     p1.data()->word[500] = 1;
     REQUIRE_FALSE(p == p1);
 }
+
+TEST_CASE("Hash of pattern follows its content") {
+    Pattern p;
+    Pattern p1;
+    REQUIRE(p.hash() == p1.hash());
+    REQUIRE(p.hash() != 0);
+
+    p1.data()->waittime[2] = 10;
+    REQUIRE(p.hash() != p1.hash());
+    p.data()->waittime[2] = 10;
+    REQUIRE(p.hash() == p1.hash());
+}
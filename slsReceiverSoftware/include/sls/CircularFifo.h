@@ -9,6 +9,8 @@
  * modified by the sls detector group
  * */
 
+#include <cerrno>
+#include <ctime>
 #include <iostream>
 #include <semaphore.h>
 #include <vector>
@@ -43,6 +45,7 @@ template <typename Element> class CircularFifo {
 
     bool push(Element *&item, bool no_block = false);
     bool pop(Element *&item, bool no_block = false);
+    bool popWithTimeout(Element *&item, int timeout_ms);
 
     bool isEmpty() const;
     bool isFull() const;
@@ -103,6 +106,32 @@ bool CircularFifo<Element>::pop(Element *&item, bool no_block) {
     return true;
 }
 
+/** Consumer only: Removes and returns item from the queue, waiting at most
+ * timeout_ms for an item to be pushed
+ *
+ * \param item return by reference the wanted item
+ * \param timeout_ms maximum time to wait in ms
+ * \return whether an item was popped */
+template <typename Element>
+bool CircularFifo<Element>::popWithTimeout(Element *&item, int timeout_ms) {
+    timespec deadline{};
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        ++deadline.tv_sec;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    while (sem_timedwait(&data_mutex, &deadline) == -1) {
+        if (errno != EINTR)
+            return false;
+    }
+    item = data[head];
+    head = increment(head);
+    sem_post(&free_mutex);
+    return true;
+}
+
 /** Useful for testing and Consumer check of status
  * Remember that the 'empty' status can change quickly
  * as the Producer adds more items.
@@ -3,8 +3,10 @@
 #pragma once
 #include "sls/sls_detector_defs.h"
 #include <memory>
+#include <vector>
 
 class ClientInterface;
+class MetricsServer;
 
 namespace sls {
 
@@ -30,8 +32,27 @@ class Receiver : private virtual slsDetectorDefs {
      */
     Receiver(int tcpip_port_no = 1954);
 
+    /**
+     * Constructor
+     * Starts up one Receiver server per module in the same process, on
+     * consecutive TCP ports. The fifos of all the modules share the fifo
+     * memory budget, if set. Only the memory is shared: every module keeps
+     * its own listener, processor, writer and streamer threads and writes
+     * its own files.
+     * throws an exception in case of failure
+     * @param tcpip_port_no TCP/IP port number of the first module
+     * @param numModules number of modules
+     * @param fifoBudget total memory of the fifos in bytes (0 for no limit).
+     * Every module reserves its fifo depth, the rest is borrowed by the
+     * modules running out of free fifo buffers
+     */
+    Receiver(int tcpip_port_no, int numModules, size_t fifoBudget = 0);
+
     ~Receiver();
 
+    /** number of modules hosted */
+    int getNumberOfModules() const;
+
     /**
      * get get Receiver Version
      \returns id
@@ -49,6 +70,7 @@ class Receiver : private virtual slsDetectorDefs {
      * return value is undefined at the moment
      * we write depending on file write enable
      * users get data to write depending on call backs registered
+     * The call backs are registered for all the modules hosted.
      */
     void registerCallBackStartAcquisition(int (*func)(std::string, std::string,
                                                       uint64_t, uint32_t,
@@ -88,7 +110,11 @@ class Receiver : private virtual slsDetectorDefs {
                                             void *arg);
 
   private:
-    std::unique_ptr<ClientInterface> tcpipInterface;
+    void CreateModules(int tcpip_port_no, int numModules, size_t fifoBudget);
+
+    /** one tcp interface per module */
+    std::vector<std::unique_ptr<ClientInterface>> tcpipInterface;
+    std::unique_ptr<MetricsServer> metricsServer;
 };
 
 } // namespace sls
\ No newline at end of file
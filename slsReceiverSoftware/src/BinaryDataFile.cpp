@@ -11,13 +11,19 @@ void BinaryDataFile::CloseFile() {
         fclose(fd_);
     }
     fd_ = nullptr;
+    try {
+        frameIndex_.Close();
+    } catch (const sls::RuntimeError &e) {
+        LOG(logERROR) << "[" << udpPortNumber_ << "]: " << e.what();
+    }
 }
 
 void BinaryDataFile::CreateFirstBinaryDataFile(
     const std::string filePath, const std::string fileNamePrefix,
     const uint64_t fileIndex, const bool overWriteEnable, const bool silentMode,
     const int modulePos, const int numUnitsPerReadout,
-    const uint32_t udpPortNumber, const uint32_t maxFramesPerFile) {
+    const uint32_t udpPortNumber, const uint32_t maxFramesPerFile,
+    const bool frameIndexEnable, const uint32_t packetsPerFrame) {
 
     subFileIndex_ = 0;
     numFramesInFile_ = 0;
@@ -31,12 +37,15 @@ void BinaryDataFile::CreateFirstBinaryDataFile(
     numUnitsPerReadout_ = numUnitsPerReadout;
     udpPortNumber_ = udpPortNumber;
     maxFramesPerFile_ = maxFramesPerFile;
+    frameIndexEnable_ = frameIndexEnable;
+    packetsPerFrame_ = packetsPerFrame;
 
     CreateFile();
 }
 
 void BinaryDataFile::CreateFile() {
     numFramesInFile_ = 0;
+    fileOffset_ = 0;
 
     std::ostringstream os;
     os << filePath_ << "/" << fileNamePrefix_ << "_d"
@@ -57,6 +66,11 @@ void BinaryDataFile::CreateFile() {
     // setting to no file buffering
     setvbuf(fd_, nullptr, _IONBF, 0);
 
+    if (frameIndexEnable_) {
+        frameIndex_.Open(sls::FrameIndexFileName(fileName_), packetsPerFrame_,
+                         overWriteEnable_);
+    }
+
     if (!silentMode_) {
         LOG(logINFO) << "[" << udpPortNumber_
                      << "]: Binary File created: " << fileName_;
@@ -107,4 +121,16 @@ void BinaryDataFile::WriteToFile(char *buffer, const int buffersize,
                                 " : Write to file failed for image number " +
                                 std::to_string(currentFrameNumber));
     }
+
+    if (frameIndex_.IsOpen()) {
+        auto header = reinterpret_cast<sls_detector_header *>(buffer);
+        sls::FrameIndexEntry entry{};
+        entry.frameNumber = header->frameNumber;
+        entry.offset = fileOffset_;
+        entry.timestamp = header->timestamp;
+        entry.packets = numPacketsCaught;
+        entry.size = static_cast<uint32_t>(buffersize);
+        frameIndex_.Add(entry);
+    }
+    fileOffset_ += buffersize;
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 #pragma once
 
 #include "File.h"
+#include "sls/RawFileIndex.h"
 
 class BinaryDataFile : private virtual slsDetectorDefs, public File {
 
@@ -18,7 +19,9 @@ class BinaryDataFile : private virtual slsDetectorDefs, public File {
                                    const bool silentMode, const int modulePos,
                                    const int numUnitsPerReadout,
                                    const uint32_t udpPortNumber,
-                                   const uint32_t maxFramesPerFile) override;
+                                   const uint32_t maxFramesPerFile,
+                                   const bool frameIndexEnable,
+                                   const uint32_t packetsPerFrame) override;
 
     void WriteToFile(char *buffer, const int buffersize,
                      const uint64_t currentFrameNumber,
@@ -42,4 +45,9 @@ class BinaryDataFile : private virtual slsDetectorDefs, public File {
     int numUnitsPerReadout_{0};
     uint32_t udpPortNumber_{0};
     uint32_t maxFramesPerFile_{0};
+    bool frameIndexEnable_{false};
+    uint32_t packetsPerFrame_{0};
+    /** index of the current file, see sls/RawFileIndex.h */
+    sls::FrameIndexWriter frameIndex_;
+    uint64_t fileOffset_{0};
 };
\ No newline at end of file
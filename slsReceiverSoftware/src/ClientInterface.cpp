@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: LGPL-3.0-or-other
 // Copyright (C) 2021 Contributors to the SLS Detector Package
 #include "ClientInterface.h"
+#include "ReceiverMetrics.h"
 #include "sls/ServerSocket.h"
 #include "sls/StaticVector.h"
 #include "sls/ToString.h"
@@ -77,6 +78,7 @@ void ClientInterface::registerCallBackRawDataModifyReady(
 
 void ClientInterface::startTCPServer() {
     tcpThreadId = syscall(SYS_gettid);
+    ThreadMetrics::SetReceiver(std::to_string(portNumber));
     LOG(logINFOBLUE) << "Created [ TCP server Tid: " << tcpThreadId << "]";
     LOG(logINFO) << "SLS Receiver starting TCP Server on port " << portNumber
                  << '\n';
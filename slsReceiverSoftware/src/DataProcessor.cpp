@@ -13,6 +13,7 @@
 #include "Fifo.h"
 #include "GeneralData.h"
 #include "MasterAttributes.h"
+#include "ReceiverMetrics.h"
 #ifdef HDF5C
 #include "HDF5DataFile.h"
 #include "HDF5MasterFile.h"
@@ -43,12 +44,26 @@ DataProcessor::DataProcessor(int index, detectorType detectorType, Fifo *fifo,
       ctbDbitList_(ctbDbitList), ctbDbitOffset_(ctbDbitOffset),
       ctbAnalogDataBytes_(ctbAnalogDataBytes), firstStreamerFrame_(false) {
 
+    metrics_ = std::make_shared<ThreadMetrics>("processor", index);
+    framesMetric_ = metrics_->AddCounter("slsreceiver_processor_frames_total",
+                                         "Frames processed");
+    callbackMetric_ =
+        metrics_->AddHistogram("slsreceiver_processor_callback_seconds",
+                               "Time spent in the raw data call back");
+    fileWriteMetric_ =
+        metrics_->AddHistogram("slsreceiver_processor_file_write_seconds",
+                               "Time spent writing a frame to file");
+    MetricsRegistry::Instance().Register(metrics_);
+
     LOG(logDEBUG) << "DataProcessor " << index << " created";
 
     memset((void *)&timerbegin_, 0, sizeof(timespec));
 }
 
-DataProcessor::~DataProcessor() { DeleteFiles(); }
+DataProcessor::~DataProcessor() {
+    MetricsRegistry::Instance().Unregister(metrics_);
+    DeleteFiles();
+}
 
 /** getters */
 
@@ -155,8 +170,9 @@ void DataProcessor::CreateFirstFiles(
     const std::string fileNamePrefix, const uint64_t fileIndex,
     const bool overWriteEnable, const bool silentMode, const int modulePos,
     const int numUnitsPerReadout, const uint32_t udpPortNumber,
-    const uint32_t maxFramesPerFile, const uint64_t numImages,
-    const uint32_t dynamicRange, const bool detectorDataStream) {
+    const uint32_t maxFramesPerFile, const bool frameIndexEnable,
+    const uint64_t numImages, const uint32_t dynamicRange,
+    const bool detectorDataStream) {
     if (dataFile_ == nullptr) {
         throw sls::RuntimeError("file object not contstructed");
     }
@@ -186,7 +202,8 @@ void DataProcessor::CreateFirstFiles(
     case BINARY:
         dataFile_->CreateFirstBinaryDataFile(
             filePath, fileNamePrefix, fileIndex, overWriteEnable, silentMode,
-            modulePos, numUnitsPerReadout, udpPortNumber, maxFramesPerFile);
+            modulePos, numUnitsPerReadout, udpPortNumber, maxFramesPerFile,
+            frameIndexEnable, generalData_->packetsPerFrame);
         break;
     default:
         throw sls::RuntimeError("Unknown file format (compile with hdf5 flags");
@@ -343,6 +360,7 @@ uint64_t DataProcessor::ProcessAnImage(char *buf) {
     uint64_t fnum = header.frameNumber;
     currentFrameIndex_ = fnum;
     numFramesCaught_++;
+    framesMetric_->Add();
     uint32_t nump = header.packetNumber;
     if (nump == generalData_->packetsPerFrame) {
         numCompleteFramesCaught_++;
@@ -375,19 +393,23 @@ uint64_t DataProcessor::ProcessAnImage(char *buf) {
     try {
         // normal call back
         if (rawDataReadyCallBack != nullptr) {
+            uint64_t start = MetricsClock();
             rawDataReadyCallBack((char *)rheader,
                                  buf + FIFO_HEADER_NUMBYTES +
                                      sizeof(sls_receiver_header),
                                  (uint32_t)(*((uint32_t *)buf)), pRawDataReady);
+            callbackMetric_->RecordSince(start);
         }
 
         // call back with modified size
         else if (rawDataModifyReadyCallBack != nullptr) {
             auto revsize = (uint32_t)(*((uint32_t *)buf));
+            uint64_t start = MetricsClock();
             rawDataModifyReadyCallBack((char *)rheader,
                                        buf + FIFO_HEADER_NUMBYTES +
                                            sizeof(sls_receiver_header),
                                        revsize, pRawDataReady);
+            callbackMetric_->RecordSince(start);
             (*((uint32_t *)buf)) = revsize;
         }
     } catch (const std::exception &e) {
@@ -397,6 +419,7 @@ uint64_t DataProcessor::ProcessAnImage(char *buf) {
 
     // write to file
     if (dataFile_) {
+        uint64_t start = MetricsClock();
         try {
             dataFile_->WriteToFile(
                 buf + FIFO_HEADER_NUMBYTES,
@@ -408,6 +431,7 @@ uint64_t DataProcessor::ProcessAnImage(char *buf) {
             ; // ignore write exception for now (TODO: send error message
               // via stopReceiver tcp)
         }
+        fileWriteMetric_->RecordSince(start);
     }
     return fnum;
 }
@@ -18,9 +18,13 @@ class GeneralData;
 class Fifo;
 class File;
 class DataStreamer;
+class ThreadMetrics;
+class MetricsCounter;
+class LatencyHistogram;
 struct MasterAttributes;
 
 #include <atomic>
+#include <memory>
 #include <mutex>
 #include <vector>
 
@@ -62,6 +66,7 @@ class DataProcessor : private virtual slsDetectorDefs, public ThreadObject {
                           const int numUnitsPerReadout,
                           const uint32_t udpPortNumber,
                           const uint32_t maxFramesPerFile,
+                          const bool frameIndexEnable,
                           const uint64_t numImages, const uint32_t dynamicRange,
                           const bool detectorDataStream);
 #ifdef HDF5C
@@ -215,4 +220,10 @@ class DataProcessor : private virtual slsDetectorDefs, public ThreadObject {
                                        void *) = nullptr;
 
     void *pRawDataReady{nullptr};
+
+    // metrics
+    std::shared_ptr<ThreadMetrics> metrics_;
+    MetricsCounter *framesMetric_{nullptr};
+    LatencyHistogram *callbackMetric_{nullptr};
+    LatencyHistogram *fileWriteMetric_{nullptr};
 };
@@ -8,6 +8,7 @@
 #include "DataStreamer.h"
 #include "Fifo.h"
 #include "GeneralData.h"
+#include "ReceiverMetrics.h"
 #include "sls/ZmqSocket.h"
 #include "sls/sls_detector_exceptions.h"
 
@@ -24,10 +25,19 @@ DataStreamer::DataStreamer(int ind, Fifo *f, uint32_t *dr, ROI *r, uint64_t *fi,
     numMods.x = nm.x;
     numMods.y = nm.y;
 
+    metrics = std::make_shared<ThreadMetrics>("streamer", ind);
+    framesMetric = metrics->AddCounter("slsreceiver_streamer_frames_total",
+                                       "Frames streamed");
+    sendMetric = metrics->AddHistogram(
+        "slsreceiver_streamer_zmq_send_seconds",
+        "Time spent sending the header and data of a frame over zmq");
+    MetricsRegistry::Instance().Register(metrics);
+
     LOG(logDEBUG) << "DataStreamer " << ind << " created";
 }
 
 DataStreamer::~DataStreamer() {
+    MetricsRegistry::Instance().Unregister(metrics);
     CloseZmqSocket();
     delete[] completeBuffer;
 }
@@ -157,6 +167,7 @@ void DataStreamer::ProcessAnImage(char *buf) {
     if (!startedFlag) {
         RecordFirstIndex(fnum, buf);
     }
+    uint64_t start = MetricsClock();
 
     // shortframe gotthard
     if (completeBuffer) {
@@ -200,6 +211,8 @@ void DataStreamer::ProcessAnImage(char *buf) {
                           << " and streamer " << index;
         }
     }
+    sendMetric->RecordSince(start);
+    framesMetric->Add();
 }
 
 int DataStreamer::SendHeader(sls_receiver_header *rheader, uint32_t size,
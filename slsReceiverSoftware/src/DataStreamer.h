@@ -16,8 +16,12 @@ class GeneralData;
 class Fifo;
 class DataStreamer;
 class ZmqSocket;
+class ThreadMetrics;
+class MetricsCounter;
+class LatencyHistogram;
 
 #include <map>
+#include <memory>
 #include <mutex>
 
 class DataStreamer : private virtual slsDetectorDefs, public ThreadObject {
@@ -203,4 +207,9 @@ class DataStreamer : private virtual slsDetectorDefs, public ThreadObject {
 
     /** Total number of frames */
     uint64_t *totalNumFrames;
+
+    // metrics
+    std::shared_ptr<ThreadMetrics> metrics;
+    MetricsCounter *framesMetric{nullptr};
+    LatencyHistogram *sendMetric{nullptr};
 };
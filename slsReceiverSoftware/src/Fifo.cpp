@@ -8,23 +8,37 @@
  ***********************************************/
 
 #include "Fifo.h"
+#include "FifoMemoryPool.h"
+#include "ReceiverMetrics.h"
+#include "receiver_defs.h"
 #include "sls/sls_detector_exceptions.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <unistd.h>
 
-Fifo::Fifo(int ind, uint32_t fifoItemSize, uint32_t depth)
-    : index(ind), memory(nullptr), fifoBound(nullptr), fifoFree(nullptr),
+Fifo::Fifo(int ind, uint32_t fifoItemSize, uint32_t depth, int lanes)
+    : index(ind), memory(nullptr), numLanes(std::max(lanes, 1)),
       fifoStream(nullptr), fifoDepth(depth), status_fifoBound(0),
       status_fifoFree(depth) {
     LOG(logDEBUG3) << __SHORT_AT__ << " called";
+    metrics = std::make_shared<ThreadMetrics>("fifo", ind);
+    residency = metrics->AddHistogram(
+        "slsreceiver_fifo_residency_seconds",
+        "Time between the listener pushing and the processor popping a frame");
+    boundLevel = metrics->AddGauge("slsreceiver_fifo_bound_level",
+                                   "Frames waiting to be processed");
+    freeLevel = metrics->AddGauge("slsreceiver_fifo_free_level",
+                                  "Free fifo slots");
     CreateFifos(fifoItemSize);
+    MetricsRegistry::Instance().Register(metrics);
 }
 
 Fifo::~Fifo() {
     LOG(logDEBUG3) << __SHORT_AT__ << " called";
+    MetricsRegistry::Instance().Unregister(metrics);
     DestroyFifos();
 }
 
@@ -34,17 +48,33 @@ void Fifo::CreateFifos(uint32_t fifoItemSize) {
     // destroy if not already
     DestroyFifos();
 
+    // own memory is the minimum of this fifo in the budget (throws)
+    size_t mem_len = (size_t)fifoItemSize * (size_t)fifoDepth * sizeof(char);
+    auto &pool = FifoMemoryPool::Instance();
+    pool.Reserve(mem_len);
+    maxBorrowed = pool.IsEnabled() ? MAX_BORROW_FACTOR * fifoDepth : 0;
+    numBorrowed = 0;
+
     // create fifos
-    fifoBound = new sls::CircularFifo<char>(fifoDepth);
-    fifoFree = new sls::CircularFifo<char>(fifoDepth);
-    fifoStream = new sls::CircularFifo<char>(fifoDepth);
+    int laneDepth = (fifoDepth + numLanes - 1) / numLanes;
+    for (int i = 0; i != numLanes; ++i) {
+        fifoBound.push_back(
+            new sls::CircularFifo<char>(laneDepth + maxBorrowed));
+        fifoFree.push_back(new sls::CircularFifo<char>(laneDepth));
+    }
+    laneHead.assign(numLanes, nullptr);
+    merging = false;
+    fifoStream = new sls::CircularFifo<char>(fifoDepth + maxBorrowed);
     // allocate memory
-    size_t mem_len = (size_t)fifoItemSize * (size_t)fifoDepth * sizeof(char);
     memory = (char *)malloc(mem_len);
     if (memory == nullptr) {
+        pool.Release(mem_len);
         throw sls::RuntimeError("Could not allocate memory for fifos");
     }
+    memoryLength = mem_len;
     memset(memory, 0, mem_len);
+    itemSize = fifoItemSize;
+    pushTime.assign(fifoDepth, 0);
     int pagesize = getpagesize();
     for (size_t i = 0; i < mem_len; i += pagesize) {
         strcpy(memory + i, "memory");
@@ -60,46 +90,216 @@ void Fifo::CreateFifos(uint32_t fifoItemSize) {
             buffer += fifoItemSize;
         }
     }
+    int numFree = 0;
+    for (auto f : fifoFree)
+        numFree += f->getDataValue();
     LOG(logINFO) << "Fifo " << index << " reconstructed Depth (rx_fifodepth): "
-                 << fifoFree->getDataValue();
+                 << numFree;
+    if (numLanes > 1) {
+        LOG(logINFO) << "Fifo " << index << " shared by " << numLanes
+                     << " listener lanes";
+    }
 }
 
 void Fifo::DestroyFifos() {
     LOG(logDEBUG3) << __SHORT_AT__ << " called";
 
+    ReturnBorrowedAddresses();
     if (memory) {
         free(memory);
         memory = nullptr;
+        FifoMemoryPool::Instance().Release(memoryLength);
+        memoryLength = 0;
     }
-    delete fifoBound;
-    fifoBound = nullptr;
-    delete fifoFree;
-    fifoFree = nullptr;
+    for (auto f : fifoBound)
+        delete f;
+    fifoBound.clear();
+    for (auto f : fifoFree)
+        delete f;
+    fifoFree.clear();
+    laneHead.clear();
     delete fifoStream;
     fifoStream = nullptr;
 }
 
-void Fifo::FreeAddress(char *&address) { fifoFree->push(address); }
+void Fifo::FreeAddress(char *&address) {
+    if (IsOwnAddress(address)) {
+        size_t i = static_cast<size_t>(address - memory) / itemSize;
+        fifoFree[i % numLanes]->push(address);
+    } else {
+        FifoMemoryPool::Instance().Return(address, itemSize);
+        --numBorrowed;
+    }
+}
 
-void Fifo::GetNewAddress(char *&address) {
-    int temp = fifoFree->getDataValue();
+void Fifo::GetNewAddress(char *&address, int lane) {
+    int temp = fifoFree[lane]->getDataValue();
     if (temp < status_fifoFree)
         status_fifoFree = temp;
-    fifoFree->pop(address);
+    freeLevel->Set(temp);
+    // borrow from the shared budget instead of waiting for a free address
+    if (temp == 0 && numBorrowed < maxBorrowed) {
+        char *borrowed = FifoMemoryPool::Instance().Borrow(itemSize);
+        if (borrowed != nullptr) {
+            ++numBorrowed;
+            address = borrowed;
+            return;
+        }
+    }
+    fifoFree[lane]->pop(address);
 }
 
-void Fifo::PushAddress(char *&address) {
-    int temp = fifoBound->getDataValue();
+void Fifo::PushAddress(char *&address, int lane) {
+    int temp = fifoBound[lane]->getDataValue();
     if (temp > status_fifoBound)
         status_fifoBound = temp;
-    while (!fifoBound->push(address))
+    boundLevel->Set(temp);
+    PushTime(address) = MetricsClock();
+    while (!fifoBound[lane]->push(address))
         ;
     /*temp = fifoBound->getDataValue();
     if (temp > status_fifoBound)
             status_fifoBound = temp;*/
 }
 
-void Fifo::PopAddress(char *&address) { fifoBound->pop(address); }
+void Fifo::PopAddress(char *&address) {
+    if (numLanes == 1) {
+        fifoBound[0]->pop(address);
+    } else {
+        PopMergedAddress(address);
+    }
+    residency->RecordSince(PushTime(address));
+}
+
+void Fifo::PopMergedAddress(char *&address) {
+    // the first frame of the acquisition: the smallest of the lanes
+    while (!merging) {
+        FillLaneHeads(MERGE_TIMEOUT_MS);
+        int next = SmallestLaneHead();
+        if (next != -1) {
+            nextFrame = FrameNumber(laneHead[next]);
+            merging = true;
+        } else if (std::all_of(laneHead.begin(), laneHead.end(),
+                               [](char *a) { return a != nullptr; })) {
+            break; // all the lanes ended without frames
+        }
+    }
+
+    while (merging) {
+        // every lane pushes its frames in order
+        int lane = static_cast<uint32_t>(nextFrame) % numLanes;
+        if (laneHead[lane] == nullptr)
+            fifoBound[lane]->popWithTimeout(laneHead[lane], MERGE_TIMEOUT_MS);
+        char *head = laneHead[lane];
+        if (head != nullptr && !IsDummy(head)) {
+            // a frame later than its time (after a skip) is not held back
+            if (FrameNumber(head) <= nextFrame) {
+                if (FrameNumber(head) == nextFrame)
+                    ++nextFrame;
+                address = head;
+                laneHead[lane] = nullptr;
+                return;
+            }
+            // next frame discarded by the listener
+            ++nextFrame;
+            continue;
+        }
+
+        // lane ended or no data in time: skip to the smallest of the lanes
+        FillLaneHeads(0);
+        int next = SmallestLaneHead();
+        if (next == -1) {
+            FillLaneHeads(MERGE_TIMEOUT_MS);
+            next = SmallestLaneHead();
+        }
+        if (next != -1) {
+            nextFrame = FrameNumber(laneHead[next]);
+        } else if (std::all_of(laneHead.begin(), laneHead.end(),
+                               [](char *a) { return a != nullptr; })) {
+            merging = false; // all the lanes ended
+        }
+    }
+
+    // one dummy for the processor
+    for (int i = 1; i != numLanes; ++i) {
+        FreeAddress(laneHead[i]);
+        laneHead[i] = nullptr;
+    }
+    address = laneHead[0];
+    laneHead[0] = nullptr;
+}
+
+void Fifo::FillLaneHeads(int timeout_ms) {
+    for (int i = 0; i != numLanes; ++i) {
+        if (laneHead[i] == nullptr) {
+            if (timeout_ms > 0) {
+                fifoBound[i]->popWithTimeout(laneHead[i], timeout_ms);
+            } else {
+                fifoBound[i]->pop(laneHead[i], true);
+            }
+        }
+    }
+}
+
+int Fifo::SmallestLaneHead() {
+    int next = -1;
+    for (int i = 0; i != numLanes; ++i) {
+        if (laneHead[i] != nullptr && !IsDummy(laneHead[i]) &&
+            (next == -1 ||
+             FrameNumber(laneHead[i]) < FrameNumber(laneHead[next]))) {
+            next = i;
+        }
+    }
+    return next;
+}
+
+bool Fifo::IsDummy(const char *address) {
+    return *reinterpret_cast<const uint32_t *>(address) == DUMMY_PACKET_VALUE;
+}
+
+uint64_t Fifo::FrameNumber(const char *address) {
+    return reinterpret_cast<const sls_receiver_header *>(address +
+                                                         FIFO_HEADER_NUMBYTES)
+        ->detHeader.frameNumber;
+}
+
+void Fifo::ReturnBorrowedAddresses() {
+    auto giveBack = [this](char *address) {
+        if (address != nullptr && !IsOwnAddress(address)) {
+            FifoMemoryPool::Instance().Return(address, itemSize);
+            --numBorrowed;
+        }
+    };
+    char *address = nullptr;
+    for (auto f : fifoBound) {
+        while (f->pop(address, true))
+            giveBack(address);
+    }
+    for (auto &head : laneHead) {
+        giveBack(head);
+        head = nullptr;
+    }
+    if (fifoStream) {
+        while (fifoStream->pop(address, true))
+            giveBack(address);
+    }
+    if (numBorrowed != 0) {
+        LOG(logWARNING) << "Fifo " << index << ": " << numBorrowed
+                        << " borrowed buffers not returned to the pool";
+        numBorrowed = 0;
+    }
+}
+
+bool Fifo::IsOwnAddress(const char *address) const {
+    return address >= memory && address < memory + memoryLength;
+}
+
+uint64_t &Fifo::PushTime(char *address) {
+    if (IsOwnAddress(address))
+        return pushTime[static_cast<size_t>(address - memory) / itemSize];
+    // borrowed buffers keep it in front of the buffer
+    return *reinterpret_cast<uint64_t *>(address - sizeof(uint64_t));
+}
 
 void Fifo::PushAddressToStream(char *&address) { fifoStream->push(address); }
 
@@ -16,6 +16,14 @@
 
 #include "sls/CircularFifo.h"
 
+#include <atomic>
+#include <memory>
+#include <vector>
+
+class ThreadMetrics;
+class MetricsCounter;
+class LatencyHistogram;
+
 class Fifo : private virtual slsDetectorDefs {
 
   public:
@@ -25,8 +33,12 @@ class Fifo : private virtual slsDetectorDefs {
      * @param ind self index
      * @param fifoItemSize size of each fifo item
      * @param depth fifo depth
+     * @param lanes number of listener lanes (fan out of a udp port), each
+     * getting its own share of the free addresses and pushing its frames in
+     * order. Frame n is in lane (n % lanes), the lanes are merged back in
+     * frame order when popping
      */
-    Fifo(int ind, uint32_t fifoItemSize, uint32_t depth);
+    Fifo(int ind, uint32_t fifoItemSize, uint32_t depth, int lanes = 1);
 
     /**
      * Destructor
@@ -35,21 +47,25 @@ class Fifo : private virtual slsDetectorDefs {
 
     /**
      * Frees the bound address by pushing into fifoFree
+     * or giving it back to the FifoMemoryPool if it was borrowed
      */
     void FreeAddress(char *&address);
 
     /**
-     * Pops free address from fifoFree
+     * Pops free address from fifoFree of the lane, borrows from the
+     * FifoMemoryPool if it is empty and a budget is set
      */
-    void GetNewAddress(char *&address);
+    void GetNewAddress(char *&address, int lane = 0);
 
     /**
-     * Pushes bound address into fifoBound
+     * Pushes bound address into fifoBound of the lane
      */
-    void PushAddress(char *&address);
+    void PushAddress(char *&address, int lane = 0);
 
     /**
      * Pops bound address from fifoBound to process data
+     * (the next frame of the merged lanes)
+     * and records the time it spent in fifoBound
      */
     void PopAddress(char *&address);
 
@@ -87,17 +103,93 @@ class Fifo : private virtual slsDetectorDefs {
      */
     void DestroyFifos();
 
+    /**
+     * Merges the lanes in frame order: waits for the next expected frame in
+     * its lane (frame % lanes). The expected frame is skipped if its lane
+     * goes on with a later frame (discarded frame). If its lane ended or has
+     * no data within MERGE_TIMEOUT_MS, the merge goes on with the smallest
+     * frame of the lanes. The end of acquisition (dummy) is popped once, when
+     * all the lanes have ended
+     */
+    void PopMergedAddress(char *&address);
+
+    /**
+     * Pops the lane heads still missing, waiting until the deadline at most
+     */
+    void FillLaneHeads(int timeout_ms);
+
+    /** lane holding the smallest frame of the lane heads, -1 if none */
+    int SmallestLaneHead();
+
+    /** true if the address is the end of acquisition */
+    static bool IsDummy(const char *address);
+
+    static uint64_t FrameNumber(const char *address);
+
+    /**
+     * Gives the borrowed buffers still in the bound and stream fifos back
+     * to the FifoMemoryPool
+     */
+    void ReturnBorrowedAddresses();
+
+    /** true if address is in the memory of this fifo (not borrowed) */
+    bool IsOwnAddress(const char *address) const;
+
+    /** Time stamp of the push into fifoBound of the item at address */
+    uint64_t &PushTime(char *address);
+
     /** Self Index */
     int index;
 
     /** Memory allocated, whose addresses are pushed into the fifos */
     char *memory;
 
-    /** Circular Fifo pointing to addresses of bound data in memory */
-    sls::CircularFifo<char> *fifoBound;
+    /** Size of each fifo item */
+    uint32_t itemSize{0};
+
+    /** Size of memory */
+    size_t memoryLength{0};
+
+    /** A fifo grows at most to this times its depth by borrowing */
+    static constexpr int MAX_BORROW_FACTOR = 4;
+
+    /** Maximum number of items borrowed from the FifoMemoryPool */
+    int maxBorrowed{0};
+
+    /** Number of items currently borrowed from the FifoMemoryPool */
+    std::atomic<int> numBorrowed{0};
+
+    /** Time (MetricsClock) each item was pushed into fifoBound */
+    std::vector<uint64_t> pushTime;
+
+    /** Metrics of the fifo, residency written by the popping thread */
+    std::shared_ptr<ThreadMetrics> metrics;
+    LatencyHistogram *residency{nullptr};
+    MetricsCounter *boundLevel{nullptr};
+    MetricsCounter *freeLevel{nullptr};
+
+    /** Number of listener lanes */
+    int numLanes{1};
+
+    /** Circular Fifos (one per lane) pointing to addresses of bound data in
+     * memory */
+    std::vector<sls::CircularFifo<char> *> fifoBound;
+
+    /** Circular Fifos (one per lane) pointing to addresses of freed data in
+     * memory. Own addresses belong to lane (index % lanes) */
+    std::vector<sls::CircularFifo<char> *> fifoFree;
+
+    /** Addresses popped from each lane, waiting to be merged */
+    std::vector<char *> laneHead;
+
+    /** Maximum wait for the next frame in its lane before skipping it */
+    static constexpr int MERGE_TIMEOUT_MS = 100;
+
+    /** Next frame number expected from the merged lanes */
+    uint64_t nextFrame{0};
 
-    /** Circular Fifo pointing to addresses of freed data in memory */
-    sls::CircularFifo<char> *fifoFree;
+    /** false until the first frame of an acquisition is merged */
+    bool merging{false};
 
     /** Circular Fifo pointing to addresses of to be streamed data in memory */
     sls::CircularFifo<char> *fifoStream;
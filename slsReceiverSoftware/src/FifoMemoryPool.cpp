@@ -0,0 +1,115 @@
+// SPDX-License-Identifier: LGPL-3.0-or-other
+// Copyright (C) 2021 Contributors to the SLS Detector Package
+/************************************************
+ * @file FifoMemoryPool.cpp
+ * @short process wide memory budget of the fifos
+ * of all the modules hosted by a receiver process
+ ***********************************************/
+
+#include "FifoMemoryPool.h"
+#include "sls/logger.h"
+#include "sls/sls_detector_exceptions.h"
+
+#include <cstdlib>
+#include <string>
+
+FifoMemoryPool &FifoMemoryPool::Instance() {
+    static FifoMemoryPool pool;
+    return pool;
+}
+
+FifoMemoryPool::~FifoMemoryPool() {
+    for (auto &it : idle) {
+        for (char *p : it.second)
+            free(p - PREFIX_BYTES);
+    }
+}
+
+void FifoMemoryPool::SetBudget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mtx);
+    budget = bytes;
+    LOG(logINFO) << "Fifo memory budget: "
+                 << (double)bytes / (double)(1024 * 1024) << " MB";
+}
+
+size_t FifoMemoryPool::GetBudget() {
+    std::lock_guard<std::mutex> lock(mtx);
+    return budget;
+}
+
+bool FifoMemoryPool::IsEnabled() {
+    std::lock_guard<std::mutex> lock(mtx);
+    return budget != 0;
+}
+
+void FifoMemoryPool::Reserve(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (budget == 0) {
+        reserved += bytes;
+        return;
+    }
+    TrimIdleBuffers(bytes);
+    if (reserved + allocated + bytes > budget) {
+        throw sls::RuntimeError(
+            "Fifo memory budget exceeded. Requested " +
+            std::to_string(bytes / (1024 * 1024)) + " MB, " +
+            std::to_string((budget - reserved - allocated) / (1024 * 1024)) +
+            " MB left");
+    }
+    reserved += bytes;
+}
+
+void FifoMemoryPool::Release(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mtx);
+    reserved -= bytes;
+}
+
+char *FifoMemoryPool::Borrow(uint32_t itemSize) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (budget == 0)
+        return nullptr;
+    auto it = idle.find(itemSize);
+    if (it != idle.end() && !it->second.empty()) {
+        char *p = it->second.back();
+        it->second.pop_back();
+        borrowed += itemSize;
+        return p;
+    }
+    TrimIdleBuffers(itemSize);
+    if (reserved + allocated + itemSize > budget)
+        return nullptr;
+    auto p = static_cast<char *>(malloc(itemSize + PREFIX_BYTES));
+    if (p == nullptr)
+        return nullptr;
+    allocated += itemSize;
+    borrowed += itemSize;
+    return p + PREFIX_BYTES;
+}
+
+void FifoMemoryPool::Return(char *address, uint32_t itemSize) {
+    std::lock_guard<std::mutex> lock(mtx);
+    borrowed -= itemSize;
+    idle[itemSize].push_back(address);
+}
+
+size_t FifoMemoryPool::GetReservedBytes() {
+    std::lock_guard<std::mutex> lock(mtx);
+    return reserved;
+}
+
+size_t FifoMemoryPool::GetBorrowedBytes() {
+    std::lock_guard<std::mutex> lock(mtx);
+    return borrowed;
+}
+
+void FifoMemoryPool::TrimIdleBuffers(size_t bytes) {
+    for (auto it = idle.begin();
+         it != idle.end() && reserved + allocated + bytes > budget; ++it) {
+        while (!it->second.empty() &&
+               reserved + allocated + bytes > budget) {
+            free(it->second.back() - PREFIX_BYTES);
+            it->second.pop_back();
+            allocated -= it->first;
+        }
+    }
+}
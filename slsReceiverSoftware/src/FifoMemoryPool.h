@@ -0,0 +1,89 @@
+// SPDX-License-Identifier: LGPL-3.0-or-other
+// Copyright (C) 2021 Contributors to the SLS Detector Package
+#pragma once
+/************************************************
+ * @file FifoMemoryPool.h
+ * @short process wide memory budget of the fifos
+ * of all the modules hosted by a receiver process
+ ***********************************************/
+/**
+ *@short Every fifo reserves its own depth (the minimum of its module) from
+ * the budget. The rest of the budget is shared: a fifo running out of free
+ * buffers borrows buffers from it, which are returned when freed.
+ * Without a budget (default) fifos are unlimited and never borrow.
+ * Only the memory is shared between the modules of a process: listener,
+ * processor and streamer threads stay per module, and there are no module
+ * merged files.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+class FifoMemoryPool {
+
+  public:
+    /** bytes usable by the fifo in front of every borrowed buffer */
+    static constexpr size_t PREFIX_BYTES = 64;
+
+    static FifoMemoryPool &Instance();
+
+    /**
+     * Set the total budget of all the fifos, 0 for no budget
+     * @param bytes budget in bytes
+     */
+    void SetBudget(size_t bytes);
+
+    size_t GetBudget();
+
+    /** true if a budget is set */
+    bool IsEnabled();
+
+    /**
+     * Reserve the own memory of a fifo (its minimum)
+     * throws if the budget would be exceeded
+     * @param bytes bytes allocated by the fifo
+     */
+    void Reserve(size_t bytes);
+
+    /** Release the memory reserved by a fifo */
+    void Release(size_t bytes);
+
+    /**
+     * Borrow a buffer from the shared part of the budget
+     * @param itemSize size of the buffer
+     * @returns buffer or nullptr if the budget is exhausted
+     */
+    char *Borrow(uint32_t itemSize);
+
+    /**
+     * Give back a borrowed buffer
+     * @param address buffer returned by Borrow
+     * @param itemSize size given to Borrow
+     */
+    void Return(char *address, uint32_t itemSize);
+
+    /** bytes reserved by the fifos */
+    size_t GetReservedBytes();
+
+    /** bytes of the buffers currently borrowed */
+    size_t GetBorrowedBytes();
+
+  private:
+    FifoMemoryPool() = default;
+    ~FifoMemoryPool();
+
+    /** frees idle shared buffers until bytes fit into the budget */
+    void TrimIdleBuffers(size_t bytes);
+
+    std::mutex mtx;
+    size_t budget{0};
+    size_t reserved{0};
+    /** bytes of the shared buffers, borrowed or idle */
+    size_t allocated{0};
+    size_t borrowed{0};
+    /** idle shared buffers by size */
+    std::map<uint32_t, std::vector<char *>> idle;
+};
@@ -98,7 +98,8 @@ class File : private virtual slsDetectorDefs {
         const uint64_t fileIndex, const bool overWriteEnable,
         const bool silentMode, const int modulePos,
         const int numUnitsPerReadout, const uint32_t udpPortNumber,
-        const uint32_t maxFramesPerFile) {
+        const uint32_t maxFramesPerFile, const bool frameIndexEnable,
+        const uint32_t packetsPerFrame) {
         LOG(logERROR) << "This is a generic function CreateFirstDataFile that "
                          "should be overloaded by a derived class";
     };
@@ -11,6 +11,7 @@
 #include "sls/ZmqSocket.h" //just for the zmq port define
 #include "sls/file_utils.h"
 
+#include <algorithm>
 #include <cerrno> //eperm
 #include <chrono>
 #include <cstdlib> //system
@@ -62,6 +63,15 @@ void Implementation::SetThreadPriorities() {
         it->SetThreadPriority(LISTENER_PRIORITY);
 }
 
+int Implementation::GetNumberOfLanes(int i) const {
+    // lanes are steered by the frame number of the standard header
+    if (udpFanout < 2 || packetRing || !generalData->standardheader ||
+        (detType == GOTTHARD2 && i != 0)) {
+        return 1;
+    }
+    return udpFanout;
+}
+
 void Implementation::SetupFifoStructure() {
     fifo.clear();
     for (int i = 0; i < numUDPInterfaces; ++i) {
@@ -74,13 +84,15 @@ void Implementation::SetupFifoStructure() {
         // create fifo structure
         try {
             fifo.push_back(sls::make_unique<Fifo>(
-                i, datasize + (generalData->fifoBufferHeaderSize), fifoDepth));
-        } catch (...) {
+                i, datasize + (generalData->fifoBufferHeaderSize), fifoDepth,
+                GetNumberOfLanes(i)));
+        } catch (const std::exception &e) {
             fifo.clear();
             fifoDepth = 0;
             throw sls::RuntimeError(
                 "Could not allocate memory for fifo structure " +
-                std::to_string(i) + ". FifoDepth is now 0.");
+                std::to_string(i) + " (" + e.what() +
+                "). FifoDepth is now 0.");
         }
         // set the listener & dataprocessor threads to point to the right fifo
         if (listener.size())
@@ -169,7 +181,8 @@ void Implementation::setDetectorType(const detectorType d) {
                 i, detType, fifo_ptr, &status, &udpPortNum[i], &eth[i],
                 &udpSocketBufferSize, &actualUDPSocketBufferSize,
                 &framesPerFile, &frameDiscardMode, &activated,
-                &detectorDataStream[i], &silentMode));
+                &detectorDataStream[i], &silentMode, &reorderWindow,
+                &reorderTimeoutMs, &packetRing, GetNumberOfLanes(i)));
             int ctbAnalogDataBytes = 0;
             if (detType == CHIPTESTBOARD) {
                 ctbAnalogDataBytes = generalData->GetNumberOfAnalogDatabytes();
@@ -287,6 +300,54 @@ void Implementation::setFrameDiscardPolicy(const frameDiscardPolicy i) {
     LOG(logINFO) << "Frame Discard Policy: " << sls::ToString(frameDiscardMode);
 }
 
+uint32_t Implementation::defaultReorderWindow = 1;
+uint32_t Implementation::defaultReorderTimeoutMs = DEFAULT_REORDER_TIMEOUT_MS;
+
+void Implementation::setDefaultReorderWindow(const uint32_t frames,
+                                             const uint32_t timeoutMs) {
+    defaultReorderWindow = frames;
+    defaultReorderTimeoutMs = timeoutMs;
+}
+
+int Implementation::defaultUdpFanout = 1;
+
+void Implementation::setDefaultUdpFanout(const int n) {
+    defaultUdpFanout = std::max(n, 1);
+}
+
+bool Implementation::defaultPacketRing = false;
+
+void Implementation::setDefaultPacketRing(const bool enable) {
+    defaultPacketRing = enable;
+}
+
+bool Implementation::getPacketRing() const { return packetRing; }
+
+void Implementation::setPacketRing(const bool enable) {
+    // the lanes were created with the threads
+    if (enable && udpFanout > 1) {
+        throw sls::RuntimeError("Packet ring cannot be used with udp fan out");
+    }
+    packetRing = enable;
+    LOG(logINFO) << "Packet ring capture: "
+                 << (packetRing ? "enabled" : "disabled");
+}
+
+uint32_t Implementation::getReorderWindow() const { return reorderWindow; }
+
+void Implementation::setReorderWindow(const uint32_t frames,
+                                      const uint32_t timeoutMs) {
+    if (frames == 0 || (fifoDepth != 0 && frames >= fifoDepth)) {
+        throw sls::RuntimeError(
+            "Reorder window must be between 1 and the fifo depth (" +
+            std::to_string(fifoDepth) + ")");
+    }
+    reorderWindow = frames;
+    reorderTimeoutMs = timeoutMs;
+    LOG(logINFO) << "Reorder Window: " << reorderWindow
+                 << " frames, timeout: " << reorderTimeoutMs << " ms";
+}
+
 bool Implementation::getFramePaddingEnable() const { return framePadding; }
 
 void Implementation::setFramePaddingEnable(const bool i) {
@@ -421,6 +482,19 @@ void Implementation::setFramesPerFile(const uint32_t i) {
     LOG(logINFO) << "Frames per file: " << framesPerFile;
 }
 
+bool Implementation::defaultFrameIndex = false;
+
+void Implementation::setDefaultFrameIndexEnable(const bool b) {
+    defaultFrameIndex = b;
+}
+
+bool Implementation::getFrameIndexEnable() const { return frameIndex; }
+
+void Implementation::setFrameIndexEnable(const bool b) {
+    frameIndex = b;
+    LOG(logINFO) << "Frame Index: " << (frameIndex ? "enabled" : "disabled");
+}
+
 /**************************************************
  *                                                 *
  *   Acquisition                                   *
@@ -701,6 +775,13 @@ void Implementation::restreamStop() {
 }
 
 void Implementation::ResetParametersforNewAcquisition() {
+    // every frame in flight (of every lane) holds a fifo buffer
+    uint32_t numLanes = GetNumberOfLanes(0);
+    if (reorderWindow > 1 && reorderWindow * numLanes >= fifoDepth) {
+        reorderWindow = std::max(fifoDepth / (2 * numLanes), 1u);
+        LOG(logWARNING) << "Reorder window reduced to " << reorderWindow
+                        << " frames for fifo depth " << fifoDepth;
+    }
     for (const auto &it : listener)
         it->ResetParametersforNewAcquisition();
     for (const auto &it : dataProcessor)
@@ -814,8 +895,8 @@ void Implementation::SetupWriter() {
             dataProcessor[i]->CreateFirstFiles(
                 masterAttributes.get(), filePath, fileName, fileIndex,
                 overwriteEnable, silentMode, modulePos, numUDPInterfaces,
-                udpPortNum[i], framesPerFile, numberOfTotalFrames, dynamicRange,
-                detectorDataStream[i]);
+                udpPortNum[i], framesPerFile, frameIndex, numberOfTotalFrames,
+                dynamicRange, detectorDataStream[i]);
         }
     } catch (const sls::RuntimeError &e) {
         shutDownUDPSockets();
@@ -889,7 +970,8 @@ void Implementation::setNumberofUDPInterfaces(const int n) {
                     i, detType, fifo_ptr, &status, &udpPortNum[i], &eth[i],
                     &udpSocketBufferSize, &actualUDPSocketBufferSize,
                     &framesPerFile, &frameDiscardMode, &activated,
-                    &detectorDataStream[i], &silentMode));
+                    &detectorDataStream[i], &silentMode, &reorderWindow,
+                    &reorderTimeoutMs, &packetRing, GetNumberOfLanes(i)));
                 listener[i]->SetGeneralData(generalData);
 
                 int ctbAnalogDataBytes = 0;
@@ -45,6 +45,39 @@ class Implementation : private virtual slsDetectorDefs {
     void setFifoDepth(const uint32_t i);
     frameDiscardPolicy getFrameDiscardPolicy() const;
     void setFrameDiscardPolicy(const frameDiscardPolicy i);
+    /**
+     * Default reorder window of the receivers created afterwards in this
+     * process
+     */
+    static void setDefaultReorderWindow(const uint32_t frames,
+                                        const uint32_t timeoutMs);
+    uint32_t getReorderWindow() const;
+    /**
+     * Number of frames the listener assembles concurrently, to tolerate
+     * packets arriving out of order (1 is in order). The oldest incomplete
+     * frame is released after timeoutMs if later frames have packets
+     */
+    void setReorderWindow(const uint32_t frames, const uint32_t timeoutMs);
+    /**
+     * Default number of listener lanes per udp port of the receivers created
+     * afterwards in this process. Every lane has its own SO_REUSEPORT socket
+     * and gets the frames steered to it by frame number, the fifo merges the
+     * lanes back in frame order. Only for detectors with the standard header
+     * and not with the packet ring
+     */
+    static void setDefaultUdpFanout(const int n);
+    /**
+     * Default capture backend of the receivers created afterwards in this
+     * process
+     */
+    static void setDefaultPacketRing(const bool enable);
+    bool getPacketRing() const;
+    /**
+     * Capture the packets from a memory mapped AF_PACKET ring bound to the
+     * udp interface instead of the udp socket (needs CAP_NET_RAW). Applies
+     * from the next udp socket creation
+     */
+    void setPacketRing(const bool enable);
     bool getFramePaddingEnable() const;
     void setFramePaddingEnable(const bool i);
     void setThreadIds(const pid_t parentTid, const pid_t tcpTid);
@@ -73,6 +106,17 @@ class Implementation : private virtual slsDetectorDefs {
     uint32_t getFramesPerFile() const;
     /* 0 means infinite */
     void setFramesPerFile(const uint32_t i);
+    /**
+     * Default of setFrameIndexEnable for the receivers created afterwards in
+     * this process
+     */
+    static void setDefaultFrameIndexEnable(const bool b);
+    bool getFrameIndexEnable() const;
+    /**
+     * Write a frame index (.idx, see sls/RawFileIndex.h) next to every binary
+     * data file. Applies from the next acquisition
+     */
+    void setFrameIndexEnable(const bool b);
 
     /**************************************************
      *                                                 *
@@ -265,6 +309,8 @@ class Implementation : private virtual slsDetectorDefs {
     void SetLocalNetworkParameters();
     void SetThreadPriorities();
     void SetupFifoStructure();
+    /** listener lanes of udp interface i */
+    int GetNumberOfLanes(int i) const;
 
     xy GetPortGeometry();
     void ResetParametersforNewAcquisition();
@@ -286,6 +332,14 @@ class Implementation : private virtual slsDetectorDefs {
     bool silentMode{false};
     uint32_t fifoDepth{0};
     frameDiscardPolicy frameDiscardMode{NO_DISCARD};
+    static uint32_t defaultReorderWindow;
+    static uint32_t defaultReorderTimeoutMs;
+    uint32_t reorderWindow{defaultReorderWindow};
+    uint32_t reorderTimeoutMs{defaultReorderTimeoutMs};
+    static bool defaultPacketRing;
+    bool packetRing{defaultPacketRing};
+    static int defaultUdpFanout;
+    int udpFanout{defaultUdpFanout};
     bool framePadding{true};
     pid_t parentThreadId;
     pid_t tcpThreadId;
@@ -299,6 +353,8 @@ class Implementation : private virtual slsDetectorDefs {
     bool masterFileWriteEnable{true};
     bool overwriteEnable{true};
     uint32_t framesPerFile{0};
+    static bool defaultFrameIndex;
+    bool frameIndex{defaultFrameIndex};
 
     // acquisition
     std::atomic<runStatus> status{IDLE};
@@ -10,60 +10,159 @@
 #include "Listener.h"
 #include "Fifo.h"
 #include "GeneralData.h"
+#include "ReceiverMetrics.h"
+#include "sls/PacketRingRxSocket.h"
 #include "sls/UdpRxSocket.h"
 #include "sls/container_utils.h" // For sls::make_unique<>
 #include "sls/network_utils.h"
 #include "sls/sls_detector_exceptions.h"
 
+#include <algorithm>
 #include <cerrno>
+#include <chrono>
 #include <cstring>
 #include <iostream>
+#include <limits>
+#include <thread>
 
 const std::string Listener::TypeName = "Listener";
 
 Listener::Listener(int ind, detectorType dtype, Fifo *f,
                    std::atomic<runStatus> *s, uint32_t *portno, std::string *e,
                    int *us, int *as, uint32_t *fpf, frameDiscardPolicy *fdp,
-                   bool *act, bool *detds, bool *sm)
+                   bool *act, bool *detds, bool *sm, uint32_t *rw,
+                   uint32_t *rt, bool *pr, int nl, int ln)
     : ThreadObject(ind, TypeName), fifo(f), myDetectorType(dtype), status(s),
       udpPortNumber(portno), eth(e), udpSocketBufferSize(us),
       actualUDPSocketBufferSize(as), framesPerFile(fpf), frameDiscardMode(fdp),
-      activated(act), detectorDataStream(detds), silentMode(sm) {
+      activated(act), detectorDataStream(detds), silentMode(sm),
+      reorderWindow(rw), reorderTimeoutMs(rt), packetRing(pr),
+      numLanes(std::max(nl, 1)), lane(ln) {
+    metrics = std::make_shared<ThreadMetrics>("listener", ind,
+                                              numLanes > 1 ? lane : -1);
+    packetsMetric = metrics->AddCounter("slsreceiver_listener_packets_total",
+                                        "Packets received");
+    framesMetric = metrics->AddCounter("slsreceiver_listener_frames_total",
+                                       "Frames pushed into the fifo");
+    discardedMetric =
+        metrics->AddCounter("slsreceiver_listener_discarded_frames_total",
+                            "Frames discarded by the frame discard policy");
+    syscallsMetric =
+        metrics->AddCounter("slsreceiver_listener_recv_syscalls_total",
+                            "System calls receiving packets (recvfrom "
+                            "or packet ring poll)");
+    frameCompletionMetric = metrics->AddHistogram(
+        "slsreceiver_listener_frame_completion_seconds",
+        "Time between the first packet of a frame and its completion");
+    reorderedPacketsMetric =
+        metrics->AddCounter("slsreceiver_listener_reordered_packets_total",
+                            "Packets arriving after packets of a later frame");
+    latePacketsMetric = metrics->AddCounter(
+        "slsreceiver_listener_late_packets_total",
+        "Packets of frames already released by the reassembly window");
+    duplicatePacketsMetric =
+        metrics->AddCounter("slsreceiver_listener_duplicate_packets_total",
+                            "Packets received twice in the reassembly window");
+    timedOutFramesMetric = metrics->AddCounter(
+        "slsreceiver_listener_timed_out_frames_total",
+        "Frames released incomplete after the reorder timeout");
+    reorderDepthMetric = metrics->AddGauge(
+        "slsreceiver_listener_reorder_depth_max",
+        "Maximum number of frames between the oldest frame in flight and a "
+        "received packet");
+    MetricsRegistry::Instance().Register(metrics);
+
+    // lane 0 owns the other lanes of the udp port
+    if (lane == 0) {
+        for (int i = 1; i < numLanes; ++i) {
+            lanes.push_back(sls::make_unique<Listener>(
+                ind, dtype, f, s, portno, e, us, as, fpf, fdp, act, detds, sm,
+                rw, rt, pr, numLanes, i));
+        }
+    }
     LOG(logDEBUG) << "Listener " << ind << " created";
 }
 
-Listener::~Listener() = default;
+Listener::~Listener() { MetricsRegistry::Instance().Unregister(metrics); }
 
-uint64_t Listener::GetPacketsCaught() const { return numPacketsCaught; }
+uint64_t Listener::GetPacketsCaught() const {
+    uint64_t n = numPacketsCaught;
+    for (const auto &it : lanes)
+        n += it->numPacketsCaught;
+    return n;
+}
 
 uint64_t Listener::GetLastFrameIndexCaught() const {
-    return lastCaughtFrameIndex;
+    uint64_t n = lastCaughtFrameIndex;
+    for (const auto &it : lanes)
+        n = std::max(n, it->lastCaughtFrameIndex.load());
+    return n;
+}
+
+uint64_t Listener::GetFirstIndex() const {
+    uint64_t n =
+        startedFlag ? firstIndex : std::numeric_limits<uint64_t>::max();
+    for (const auto &it : lanes) {
+        if (it->startedFlag)
+            n = std::min(n, it->firstIndex);
+    }
+    return n;
 }
 
 int64_t Listener::GetNumMissingPacket(bool stoppedFlag,
                                       uint64_t numPackets) const {
+    uint64_t caught = GetPacketsCaught();
     if (!stoppedFlag) {
-        return (numPackets - numPacketsCaught);
+        return (numPackets - caught);
     }
-    if (numPacketsCaught == 0) {
-        return numPacketsCaught;
+    if (caught == 0) {
+        return caught;
     }
-    return (lastCaughtFrameIndex - firstIndex + 1) *
+    return (GetLastFrameIndexCaught() - GetFirstIndex() + 1) *
                generalData->packetsPerFrame -
-           numPacketsCaught;
+           caught;
 }
 
-bool Listener::GetStartedFlag() { return startedFlag; }
+bool Listener::GetStartedFlag() {
+    bool started = startedFlag;
+    for (const auto &it : lanes)
+        started = started || it->startedFlag;
+    return started;
+}
 
-uint64_t Listener::GetCurrentFrameIndex() { return lastCaughtFrameIndex; }
+uint64_t Listener::GetCurrentFrameIndex() { return GetLastFrameIndexCaught(); }
 
 uint64_t Listener::GetListenedIndex() {
-    return lastCaughtFrameIndex - firstIndex;
+    return GetLastFrameIndexCaught() - GetFirstIndex();
+}
+
+void Listener::SetFifo(Fifo *f) {
+    fifo = f;
+    for (const auto &it : lanes)
+        it->SetFifo(f);
+}
+
+void Listener::StartRunning() {
+    ThreadObject::StartRunning();
+    for (const auto &it : lanes)
+        it->StartRunning();
 }
 
-void Listener::SetFifo(Fifo *f) { fifo = f; }
+void Listener::Continue() {
+    ThreadObject::Continue();
+    for (const auto &it : lanes)
+        it->Continue();
+}
+
+void Listener::SetThreadPriority(int priority) {
+    ThreadObject::SetThreadPriority(priority);
+    for (const auto &it : lanes)
+        it->SetThreadPriority(priority);
+}
 
 void Listener::ResetParametersforNewAcquisition() {
+    for (const auto &it : lanes)
+        it->ResetParametersforNewAcquisition();
     StopRunning();
     startedFlag = false;
     numPacketsCaught = 0;
@@ -82,6 +181,13 @@ void Listener::ResetParametersforNewAcquisition() {
 
     numPacketsStatistic = 0;
     numFramesStatistic = 0;
+
+    // reassembly window
+    window.assign(std::max(*reorderWindow, 1u), reassemblySlot());
+    numFramesInFlight = 0;
+    reorderDepthMax = 0;
+    reorderDepthMetric->Set(0);
+
     // reset fifo statistic
     fifo->GetMaxLevelForFifoBound();
     fifo->GetMinLevelForFifoFree();
@@ -96,13 +202,17 @@ void Listener::RecordFirstIndex(uint64_t fnum) {
     firstIndex = fnum;
 
     if (!(*silentMode)) {
-        if (!index) {
+        if (!index && !lane) {
             LOG(logINFOBLUE) << index << " First Index: " << firstIndex;
         }
     }
 }
 
-void Listener::SetGeneralData(GeneralData *g) { generalData = g; }
+void Listener::SetGeneralData(GeneralData *g) {
+    generalData = g;
+    for (const auto &it : lanes)
+        it->SetGeneralData(g);
+}
 
 void Listener::CreateUDPSockets() {
     if (!(*activated) || !(*detectorDataStream)) {
@@ -118,29 +228,62 @@ void Listener::CreateUDPSockets() {
     }
 
     ShutDownUDPSocket();
+    udpSocket.reset();
+    ringSocket.reset();
 
     uint32_t packetSize = generalData->packetSize;
     if (myDetectorType == GOTTHARD2 && index != 0) {
         packetSize = generalData->vetoPacketSize;
     }
 
+    if (*packetRing) {
+        try {
+            ringSocket = sls::make_unique<sls::PacketRingRxSocket>(
+                *udpPortNumber, packetSize, *eth, *udpSocketBufferSize);
+            LOG(logINFO) << index << ": Packet ring opened at port "
+                         << *udpPortNumber << " ("
+                         << ringSocket->getRingSize() / (1024 * 1024)
+                         << " MB)";
+        } catch (const std::exception &e) {
+            throw sls::RuntimeError("Could not create packet ring on port " +
+                                    std::to_string(*udpPortNumber) + ": " +
+                                    e.what());
+        }
+        udpSocketAlive = true;
+        numSyscallsCounted = 0;
+        // reported like the doubled udp socket buffer size
+        *actualUDPSocketBufferSize = static_cast<int>(
+            std::min<size_t>(ringSocket->getRingSize() * 2, INT32_MAX));
+        return;
+    }
+
     // InterfaceNameToIp(eth).str().c_str()
     try {
         udpSocket = sls::make_unique<sls::UdpRxSocket>(
             *udpPortNumber, packetSize,
             ((*eth).length() ? sls::InterfaceNameToIp(*eth).str().c_str()
                              : nullptr),
-            *udpSocketBufferSize);
-        LOG(logINFO) << index << ": UDP port opened at port " << *udpPortNumber;
+            *udpSocketBufferSize, numLanes > 1);
+        // frame n goes to lane (n % numLanes), in the order of creation
+        if (numLanes > 1 && lane == 0) {
+            udpSocket->setFrameNumberSteering(numLanes);
+        }
+        LOG(logINFO) << index << ": UDP port opened at port " << *udpPortNumber
+                     << (numLanes > 1 ? " (lane " + std::to_string(lane) + ")"
+                                      : std::string());
     } catch (...) {
         throw sls::RuntimeError("Could not create UDP socket on port " +
                                 std::to_string(*udpPortNumber));
     }
 
     udpSocketAlive = true;
+    numSyscallsCounted = 0;
 
     // doubled due to kernel bookkeeping (could also be less due to permissions)
     *actualUDPSocketBufferSize = udpSocket->getBufferSize();
+
+    for (const auto &it : lanes)
+        it->CreateUDPSockets();
 }
 
 void Listener::ShutDownUDPSocket() {
@@ -149,6 +292,15 @@ void Listener::ShutDownUDPSocket() {
         udpSocket->Shutdown();
         LOG(logINFO) << "Shut down of UDP port " << *udpPortNumber;
     }
+    if (ringSocket) {
+        udpSocketAlive = false;
+        ringSocket->Shutdown();
+        LOG(logINFO) << "Shut down of packet ring at port " << *udpPortNumber
+                     << " (dropped by kernel: "
+                     << ringSocket->getNumberOfDropped() << ")";
+    }
+    for (const auto &it : lanes)
+        it->ShutDownUDPSocket();
 }
 
 void Listener::CreateDummySocketForUDPSocketBufferSize(int s) {
@@ -199,13 +351,20 @@ void Listener::CreateDummySocketForUDPSocketBufferSize(int s) {
 void Listener::SetHardCodedPosition(uint16_t r, uint16_t c) {
     row = r;
     column = c;
+    for (const auto &it : lanes)
+        it->SetHardCodedPosition(r, c);
 }
 
 void Listener::ThreadExecution() {
+    if (*reorderWindow > 1 && *activated && *detectorDataStream) {
+        ListenWithReassemblyWindow();
+        return;
+    }
+
     char *buffer;
     int rc = 0;
 
-    fifo->GetNewAddress(buffer);
+    fifo->GetNewAddress(buffer, lane);
     LOG(logDEBUG5) << "Listener " << index
                    << ", "
                       "pop 0x"
@@ -228,6 +387,8 @@ void Listener::ThreadExecution() {
         rc = ListenToAnImage(buffer);
     }
 
+    CountSyscalls();
+
     // error check, (should not be here) if not transmitting yet (previous if)
     // rc should be > 0
     if (rc == 0) {
@@ -241,14 +402,23 @@ void Listener::ThreadExecution() {
 
     // discarding image
     else if (rc < 0) {
+        discardedMetric->Add();
         fifo->FreeAddress(buffer);
         return;
     }
 
-    (*((uint32_t *)buffer)) = rc;
+    PushImage(buffer, rc, imageStartTime);
+}
+
+void Listener::PushImage(char *buffer, uint32_t size, uint64_t startTime) {
+    (*((uint32_t *)buffer)) = size;
 
     // push into fifo
-    fifo->PushAddress(buffer);
+    fifo->PushAddress(buffer, lane);
+    framesMetric->Add();
+    if (startTime != 0) {
+        frameCompletionMetric->RecordSince(startTime);
+    }
 
     // Statistics
     if (!(*silentMode)) {
@@ -261,9 +431,35 @@ void Listener::ThreadExecution() {
     }
 }
 
+ssize_t Listener::ReceivePacket(char *dst) {
+    if (ringSocket) {
+        return ringSocket->ReceiveDataOnly(dst);
+    }
+    return udpSocket->ReceiveDataOnly(dst);
+}
+
+void Listener::CountSyscalls() {
+    uint64_t n = 0;
+    if (ringSocket) {
+        n = ringSocket->getNumberOfSyscalls();
+    } else if (udpSocket) {
+        n = udpSocket->getNumberOfSyscalls();
+    } else {
+        return;
+    }
+    syscallsMetric->Add(n - numSyscallsCounted);
+    numSyscallsCounted = n;
+}
+
 void Listener::StopListening(char *buf) {
     (*((uint32_t *)buf)) = DUMMY_PACKET_VALUE;
-    fifo->PushAddress(buf);
+    fifo->PushAddress(buf, lane);
+    // lane 0 stops last, so that it tells when the udp port is done
+    for (const auto &it : lanes) {
+        while (it->IsRunning()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
     StopRunning();
     LOG(logDEBUG1) << index << ": Listening Packets (" << *udpPortNumber
                    << ") : " << numPacketsCaught;
@@ -278,28 +474,24 @@ uint32_t Listener::ListenToAnImage(char *buf) {
     uint32_t pnum = 0;
     uint64_t bnum = 0;
     uint32_t numpackets = 0;
-    uint32_t dsize = generalData->dataSize;
     uint32_t imageSize = generalData->imageSize;
     uint32_t packetSize = generalData->packetSize;
-    uint32_t hsize = generalData->headerSizeinPacket;
     uint32_t fifohsize = generalData->fifoBufferHeaderSize;
     bool standardheader = generalData->standardheader;
     if (myDetectorType == GOTTHARD2 && index != 0) {
-        dsize = generalData->vetoDataSize;
         imageSize = generalData->vetoImageSize;
         packetSize = generalData->vetoPacketSize;
-        hsize = generalData->vetoHsize;
         standardheader = false;
     }
     uint32_t pperFrame = generalData->packetsPerFrame;
     bool isHeaderEmpty = true;
     sls_detector_header *old_header = nullptr;
     sls_receiver_header *new_header = nullptr;
-    uint32_t corrected_dsize = dsize - ((pperFrame * dsize) - imageSize);
 
     // reset to -1
     memset(buf, 0, fifohsize);
     new_header = (sls_receiver_header *)(buf + FIFO_HEADER_NUMBYTES);
+    imageStartTime = carryOverFlag ? carryOverTime : 0;
 
     // deactivated port (eiger)
     if (!(*detectorDataStream)) {
@@ -359,36 +551,12 @@ uint32_t Listener::ListenToAnImage(char *buf) {
                 new_header->detHeader.column = column;
             }
             new_header->detHeader.frameNumber = currentFrameIndex;
-            ++currentFrameIndex;
+            currentFrameIndex += numLanes;
             return imageSize;
         }
 
         // copy packet
-        switch (myDetectorType) {
-        // for gotthard, 1st packet: 4 bytes fnum, CACA
-        // + CACA, 639*2 bytes data 				2nd packet: 4
-        // bytes fnum, previous 1*2 bytes data  + 640*2 bytes data !!
-        case GOTTHARD:
-            if (!pnum)
-                memcpy(buf + fifohsize, &carryOverPacket[hsize + 4], dsize - 2);
-            else
-                memcpy(buf + fifohsize + dsize - 2, &carryOverPacket[hsize],
-                       dsize + 2);
-            break;
-        case CHIPTESTBOARD:
-        case MOENCH:
-            if (pnum == (pperFrame - 1))
-                memcpy(buf + fifohsize + (pnum * dsize),
-                       &carryOverPacket[hsize], corrected_dsize);
-            else
-                memcpy(buf + fifohsize + (pnum * dsize),
-                       &carryOverPacket[hsize], dsize);
-            break;
-        default:
-            memcpy(buf + fifohsize + (pnum * dsize), &carryOverPacket[hsize],
-                   dsize);
-            break;
-        }
+        CopyPacket(buf, &carryOverPacket[0], pnum);
 
         carryOverFlag = false;
         ++numpackets; // number of packets in this image (each time its copied
@@ -398,25 +566,7 @@ uint32_t Listener::ListenToAnImage(char *buf) {
 
         // writer header
         if (isHeaderEmpty) {
-            // -------------------------- new header
-            // ----------------------------------------------------------------------
-            if (standardheader) {
-                memcpy((char *)new_header, (char *)old_header,
-                       sizeof(sls_detector_header));
-            }
-            // -------------------old header
-            // ------------------------------------------------------------------------------
-            else {
-                new_header->detHeader.frameNumber = fnum;
-                new_header->detHeader.bunchId = bnum;
-                new_header->detHeader.row = row;
-                new_header->detHeader.column = column;
-                new_header->detHeader.detType =
-                    (uint8_t)generalData->myDetectorType;
-                new_header->detHeader.version =
-                    (uint8_t)SLS_DETECTOR_HEADER_VERSION;
-            }
-            //------------------------------------------------------------------------------------------------------------
+            WriteImageHeader(new_header, old_header, fnum, bnum);
             isHeaderEmpty = false;
         }
     }
@@ -427,7 +577,7 @@ uint32_t Listener::ListenToAnImage(char *buf) {
         // listen to new packet
         rc = 0;
         if (udpSocketAlive) {
-            rc = udpSocket->ReceiveDataOnly(&listeningPacket[0]);
+            rc = ReceivePacket(&listeningPacket[0]);
         }
         // end of acquisition
         if (rc <= 0) {
@@ -464,6 +614,10 @@ uint32_t Listener::ListenToAnImage(char *buf) {
         numPacketsCaught++; // record immediately to get more time before socket
                             // shutdown
         numPacketsStatistic++;
+        packetsMetric->Add();
+        if (imageStartTime == 0) {
+            imageStartTime = MetricsClock();
+        }
 
         // -------------------------- new header
         // ----------------------------------------------------------------------
@@ -518,6 +672,7 @@ uint32_t Listener::ListenToAnImage(char *buf) {
         // detectors)
         if (fnum != currentFrameIndex) {
             carryOverFlag = true;
+            carryOverTime = MetricsClock();
             memcpy(carryOverPacket.get(), &listeningPacket[0], packetSize);
 
             switch (*frameDiscardMode) {
@@ -544,62 +699,19 @@ uint32_t Listener::ListenToAnImage(char *buf) {
                 new_header->detHeader.column = column;
             }
             new_header->detHeader.frameNumber = currentFrameIndex;
-            ++currentFrameIndex;
+            currentFrameIndex += numLanes;
             return imageSize;
         }
 
         // copy packet
-        switch (myDetectorType) {
-        // for gotthard, 1st packet: 4 bytes fnum, CACA
-        // + CACA, 639*2 bytes data 				2nd packet: 4
-        // bytes fnum, previous 1*2 bytes data  + 640*2 bytes data !!
-        case GOTTHARD:
-            if (!pnum)
-                memcpy(buf + fifohsize + (pnum * dsize),
-                       &listeningPacket[hsize + 4], dsize - 2);
-            else
-                memcpy(buf + fifohsize + (pnum * dsize) - 2,
-                       &listeningPacket[hsize], dsize + 2);
-            break;
-        case CHIPTESTBOARD:
-        case MOENCH:
-            if (pnum == (pperFrame - 1))
-                memcpy(buf + fifohsize + (pnum * dsize),
-                       &listeningPacket[hsize], corrected_dsize);
-            else
-                memcpy(buf + fifohsize + (pnum * dsize),
-                       &listeningPacket[hsize], dsize);
-            break;
-        default:
-            memcpy(buf + fifohsize + (pnum * dsize), &listeningPacket[hsize],
-                   dsize);
-            break;
-        }
+        CopyPacket(buf, &listeningPacket[0], pnum);
         ++numpackets; // number of packets in this image (each time its copied
                       // to buf)
         new_header->packetsMask[(
             (pnum < MAX_NUM_PACKETS) ? pnum : MAX_NUM_PACKETS - 1)] = 1;
 
         if (isHeaderEmpty) {
-            // -------------------------- new header
-            // ----------------------------------------------------------------------
-            if (standardheader) {
-                memcpy((char *)new_header, (char *)old_header,
-                       sizeof(sls_detector_header));
-            }
-            // -------------------old header
-            // ------------------------------------------------------------------------------
-            else {
-                new_header->detHeader.frameNumber = fnum;
-                new_header->detHeader.bunchId = bnum;
-                new_header->detHeader.row = row;
-                new_header->detHeader.column = column;
-                new_header->detHeader.detType =
-                    (uint8_t)generalData->myDetectorType;
-                new_header->detHeader.version =
-                    (uint8_t)SLS_DETECTOR_HEADER_VERSION;
-            }
-            //------------------------------------------------------------------------------------------------------------
+            WriteImageHeader(new_header, old_header, fnum, bnum);
             isHeaderEmpty = false;
         }
     }
@@ -607,10 +719,281 @@ uint32_t Listener::ListenToAnImage(char *buf) {
     // complete image
     new_header->detHeader.packetNumber = numpackets; // number of packets caught
     new_header->detHeader.frameNumber = currentFrameIndex;
-    ++currentFrameIndex;
+    currentFrameIndex += numLanes;
     return imageSize;
 }
 
+void Listener::CopyPacket(char *buf, const char *packet, uint32_t pnum) {
+    uint32_t dsize = generalData->dataSize;
+    uint32_t imageSize = generalData->imageSize;
+    uint32_t hsize = generalData->headerSizeinPacket;
+    if (myDetectorType == GOTTHARD2 && index != 0) {
+        dsize = generalData->vetoDataSize;
+        imageSize = generalData->vetoImageSize;
+        hsize = generalData->vetoHsize;
+    }
+    uint32_t fifohsize = generalData->fifoBufferHeaderSize;
+    uint32_t pperFrame = generalData->packetsPerFrame;
+    uint32_t corrected_dsize = dsize - ((pperFrame * dsize) - imageSize);
+
+    switch (myDetectorType) {
+    // for gotthard, 1st packet: 4 bytes fnum, CACA
+    // + CACA, 639*2 bytes data 				2nd packet: 4
+    // bytes fnum, previous 1*2 bytes data  + 640*2 bytes data !!
+    case GOTTHARD:
+        if (!pnum)
+            memcpy(buf + fifohsize + (pnum * dsize), &packet[hsize + 4],
+                   dsize - 2);
+        else
+            memcpy(buf + fifohsize + (pnum * dsize) - 2, &packet[hsize],
+                   dsize + 2);
+        break;
+    case CHIPTESTBOARD:
+    case MOENCH:
+        if (pnum == (pperFrame - 1))
+            memcpy(buf + fifohsize + (pnum * dsize), &packet[hsize],
+                   corrected_dsize);
+        else
+            memcpy(buf + fifohsize + (pnum * dsize), &packet[hsize], dsize);
+        break;
+    default:
+        memcpy(buf + fifohsize + (pnum * dsize), &packet[hsize], dsize);
+        break;
+    }
+}
+
+void Listener::WriteImageHeader(sls_receiver_header *new_header,
+                                const sls_detector_header *old_header,
+                                uint64_t fnum, uint64_t bnum) {
+    // -------------------------- new header
+    // ----------------------------------------------------------------------
+    if (old_header != nullptr) {
+        memcpy((char *)new_header, (const char *)old_header,
+               sizeof(sls_detector_header));
+    }
+    // -------------------old header
+    // ------------------------------------------------------------------------------
+    else {
+        new_header->detHeader.frameNumber = fnum;
+        new_header->detHeader.bunchId = bnum;
+        new_header->detHeader.row = row;
+        new_header->detHeader.column = column;
+        new_header->detHeader.detType = (uint8_t)generalData->myDetectorType;
+        new_header->detHeader.version = (uint8_t)SLS_DETECTOR_HEADER_VERSION;
+    }
+}
+
+void Listener::ListenWithReassemblyWindow() {
+    // end of acquisition, release the frames in flight and stop
+    if (!udpSocketAlive) {
+        ReleaseWindow();
+        char *buffer = nullptr;
+        fifo->GetNewAddress(buffer, lane);
+        (*((uint32_t *)buffer)) = 0;
+        StopListening(buffer);
+        return;
+    }
+    if (*status == TRANSMITTING) {
+        return;
+    }
+
+    int rc = ReceivePacket(&listeningPacket[0]);
+    CountSyscalls();
+    if (rc <= 0) {
+        ReleaseWindow();
+        return;
+    }
+
+    numPacketsCaught++;
+    numPacketsStatistic++;
+    packetsMetric->Add();
+
+    uint64_t fnum = 0;
+    uint32_t pnum = 0;
+    uint64_t bnum = 0;
+    sls_detector_header *old_header = nullptr;
+    bool standardheader = generalData->standardheader;
+    if (myDetectorType == GOTTHARD2 && index != 0) {
+        standardheader = false;
+    }
+    if (standardheader) {
+        old_header = (sls_detector_header *)(&listeningPacket[0]);
+        fnum = old_header->frameNumber;
+        pnum = old_header->packetNumber;
+    } else {
+        if (myDetectorType == GOTTHARD && !startedFlag) {
+            oddStartingPacket =
+                generalData->SetOddStartingPacket(index, &listeningPacket[0]);
+        }
+        generalData->GetHeaderInfo(index, &listeningPacket[0],
+                                   oddStartingPacket, fnum, pnum, bnum);
+    }
+
+    // Eiger Firmware in a weird state
+    if (myDetectorType == EIGER && fnum == 0) {
+        LOG(logERROR) << "[" << *udpPortNumber
+                      << "]: Got Frame Number "
+                         "Zero from Firmware. Discarding Packet";
+        numPacketsCaught--;
+        return;
+    }
+
+    uint32_t pperFrame = generalData->packetsPerFrame;
+    if (pnum >= pperFrame) {
+        LOG(logERROR) << "Bad packet " << pnum << "(fnum: " << fnum
+                      << "), throwing away.";
+        return;
+    }
+
+    if (!startedFlag) {
+        RecordFirstIndex(fnum);
+        headSince = MetricsClock();
+    }
+
+    // frame already released (timed out or pushed out of the window)
+    if (fnum < currentFrameIndex) {
+        latePacketsMetric->Add();
+        LOG(logDEBUG1) << index << " late packet " << pnum
+                       << " of released fnum:" << fnum;
+        return;
+    }
+    if (fnum > lastCaughtFrameIndex) {
+        lastCaughtFrameIndex = fnum;
+    } else if (fnum < lastCaughtFrameIndex) {
+        reorderedPacketsMetric->Add();
+    }
+    uint64_t depth = fnum - currentFrameIndex;
+    if (depth > reorderDepthMax) {
+        reorderDepthMax = depth;
+        reorderDepthMetric->Set(depth);
+    }
+
+    // frames falling out of the window are released incomplete
+    while ((fnum - currentFrameIndex) / numLanes >= window.size()) {
+        if (numFramesInFlight == 0 && *frameDiscardMode != NO_DISCARD) {
+            // only empty frames in between, nothing to push
+            currentFrameIndex = fnum - (window.size() - 1) * numLanes;
+            break;
+        }
+        ReleaseFrame();
+    }
+
+    // place packet
+    reassemblySlot &slot = Slot(fnum);
+    if (slot.buffer == nullptr) {
+        fifo->GetNewAddress(slot.buffer, lane);
+        memset(slot.buffer, 0, generalData->fifoBufferHeaderSize);
+        slot.frameNumber = fnum;
+        slot.numPackets = 0;
+        slot.startTime = MetricsClock();
+        ++numFramesInFlight;
+    }
+    auto *new_header =
+        (sls_receiver_header *)(slot.buffer + FIFO_HEADER_NUMBYTES);
+    uint32_t maskIndex = (pnum < MAX_NUM_PACKETS) ? pnum : MAX_NUM_PACKETS - 1;
+    if (new_header->packetsMask[maskIndex]) {
+        duplicatePacketsMetric->Add();
+        return;
+    }
+    CopyPacket(slot.buffer, &listeningPacket[0], pnum);
+    new_header->packetsMask[maskIndex] = 1;
+    if (slot.numPackets == 0) {
+        WriteImageHeader(new_header, old_header, fnum, bnum);
+    }
+    ++slot.numPackets;
+
+    // release in order what is complete or has timed out
+    while (true) {
+        reassemblySlot &head = Slot(currentFrameIndex);
+        bool complete = head.buffer != nullptr &&
+                        head.frameNumber == currentFrameIndex &&
+                        head.numPackets == pperFrame;
+        if (!complete) {
+            // only frames with later frames behind them can time out
+            if (currentFrameIndex >= lastCaughtFrameIndex ||
+                MetricsClock() - headSince < *reorderTimeoutMs * 1000000ULL) {
+                break;
+            }
+            timedOutFramesMetric->Add();
+        }
+        ReleaseFrame();
+    }
+}
+
+void Listener::ReleaseFrame() {
+    uint32_t imageSize = generalData->imageSize;
+    if (myDetectorType == GOTTHARD2 && index != 0) {
+        imageSize = generalData->vetoImageSize;
+    }
+    uint32_t pperFrame = generalData->packetsPerFrame;
+
+    reassemblySlot &slot = Slot(currentFrameIndex);
+    char *buffer = nullptr;
+    uint32_t numpackets = 0;
+    uint64_t startTime = 0;
+    if (slot.buffer != nullptr && slot.frameNumber == currentFrameIndex) {
+        buffer = slot.buffer;
+        numpackets = slot.numPackets;
+        startTime = slot.startTime;
+        slot.buffer = nullptr;
+        --numFramesInFlight;
+    }
+
+    bool discard = false;
+    switch (*frameDiscardMode) {
+    case DISCARD_EMPTY_FRAMES:
+        discard = (numpackets == 0);
+        break;
+    case DISCARD_PARTIAL_FRAMES:
+        discard = (numpackets < pperFrame);
+        break;
+    default:
+        break;
+    }
+
+    if (discard) {
+        if (buffer != nullptr) {
+            LOG(logDEBUG) << index << " discarding fnum:" << currentFrameIndex;
+            discardedMetric->Add();
+            fifo->FreeAddress(buffer);
+        }
+    } else {
+        // no packet of this frame at all
+        if (buffer == nullptr) {
+            fifo->GetNewAddress(buffer, lane);
+            memset(buffer, 0, generalData->fifoBufferHeaderSize);
+        }
+        auto *new_header =
+            (sls_receiver_header *)(buffer + FIFO_HEADER_NUMBYTES);
+        new_header->detHeader.packetNumber = numpackets;
+        if (numpackets == 0) {
+            new_header->detHeader.row = row;
+            new_header->detHeader.column = column;
+        }
+        new_header->detHeader.frameNumber = currentFrameIndex;
+        PushImage(buffer, imageSize, startTime);
+    }
+    currentFrameIndex += numLanes;
+    headSince = MetricsClock();
+}
+
+Listener::reassemblySlot &Listener::Slot(uint64_t fnum) {
+    // a lane only gets every numLanes-th frame
+    return window[(fnum / numLanes) % window.size()];
+}
+
+void Listener::ReleaseWindow() {
+    if (!startedFlag) {
+        return;
+    }
+    while (numFramesInFlight != 0 ||
+           (currentFrameIndex <= lastCaughtFrameIndex &&
+            *frameDiscardMode == NO_DISCARD)) {
+        ReleaseFrame();
+    }
+    currentFrameIndex = lastCaughtFrameIndex + numLanes;
+}
+
 void Listener::PrintFifoStatistics() {
     LOG(logDEBUG1) << "numFramesStatistic:" << numFramesStatistic
                    << " numPacketsStatistic:" << numPacketsStatistic
@@ -631,4 +1014,10 @@ void Listener::PrintFifoStatistics() {
                << "  Used_Fifo_Max_Level:" << fifo->GetMaxLevelForFifoBound()
                << " \tFree_Slots_Min_Level:" << fifo->GetMinLevelForFifoFree()
                << " \tCurrent_Frame#:" << currentFrameIndex;
+    if (*reorderWindow > 1) {
+        LOG(logINFO) << "[" << *udpPortNumber
+                     << "]:  Reorder_Depth_Max:" << reorderDepthMax
+                     << " \tReorder_Window:" << *reorderWindow;
+        reorderDepthMax = 0;
+    }
 }
@@ -12,12 +12,17 @@
  */
 
 #include "ThreadObject.h"
+#include "sls/PacketRingRxSocket.h"
 #include "sls/UdpRxSocket.h"
 #include <atomic>
 #include <memory>
+#include <vector>
 
 class GeneralData;
 class Fifo;
+class ThreadMetrics;
+class MetricsCounter;
+class LatencyHistogram;
 
 class Listener : private virtual slsDetectorDefs, public ThreadObject {
 
@@ -40,10 +45,18 @@ class Listener : private virtual slsDetectorDefs, public ThreadObject {
      * @param act pointer to activated
      * @param detds pointer to detector data stream
      * @param sm pointer to silent mode
+     * @param rw pointer to reorder window (frames in flight, 1 for in order)
+     * @param rt pointer to reorder timeout in ms
+     * @param pr pointer to packet ring capture enable
+     * @param nl number of lanes listening to the udp port (SO_REUSEPORT fan
+     * out, frames steered by frame number). Lane 0 creates and drives the
+     * others
+     * @param ln lane index
      */
     Listener(int ind, detectorType dtype, Fifo *f, std::atomic<runStatus> *s,
              uint32_t *portno, std::string *e, int *us, int *as, uint32_t *fpf,
-             frameDiscardPolicy *fdp, bool *act, bool *detds, bool *sm);
+             frameDiscardPolicy *fdp, bool *act, bool *detds, bool *sm,
+             uint32_t *rw, uint32_t *rt, bool *pr, int nl = 1, int ln = 0);
 
     /**
      * Destructor
@@ -51,8 +64,13 @@ class Listener : private virtual slsDetectorDefs, public ThreadObject {
      */
     ~Listener();
 
+    /** also starts the other lanes */
+    void StartRunning() override;
+    void Continue() override;
+    void SetThreadPriority(int priority) override;
+
     /**
-     * Get Packets caught
+     * Get Packets caught (by all the lanes)
      * @return Packets caught
      */
     uint64_t GetPacketsCaught() const;
@@ -122,6 +140,9 @@ class Listener : private virtual slsDetectorDefs, public ThreadObject {
      */
     void RecordFirstIndex(uint64_t fnum);
 
+    /** first frame index caught by any lane */
+    uint64_t GetFirstIndex() const;
+
     /**
      * Thread Execution for Listener Class
      * Pop free addresses, listen to udp socket,
@@ -137,6 +158,16 @@ class Listener : private virtual slsDetectorDefs, public ThreadObject {
      */
     void StopListening(char *buf);
 
+    /**
+     * Receive one packet from the udp socket or the packet ring
+     * @param dst packet buffer
+     * @returns packet size, 0 or -1 after shut down
+     */
+    ssize_t ReceivePacket(char *dst);
+
+    /** add the system calls of the socket since the last call to metrics */
+    void CountSyscalls();
+
     /**
      * Listen to the UDP Socket for an image,
      * place them in the right order
@@ -146,6 +177,46 @@ class Listener : private virtual slsDetectorDefs, public ThreadObject {
      */
     uint32_t ListenToAnImage(char *buf);
 
+    /**
+     * Pushes a complete (or to be padded) image into the fifo
+     * @param buffer address of buffer
+     * @param size image size
+     * @param startTime time of the first packet (MetricsClock), 0 if unknown
+     */
+    void PushImage(char *buffer, uint32_t size, uint64_t startTime);
+
+    /** Copy the data of packet pnum to its place in the image buffer */
+    void CopyPacket(char *buf, const char *packet, uint32_t pnum);
+
+    /**
+     * Write the image header from the first packet of the image
+     * @param new_header header in the fifo buffer
+     * @param old_header header of the packet, nullptr if not standard header
+     * @param fnum frame number (not standard header)
+     * @param bnum bunch id (not standard header)
+     */
+    void WriteImageHeader(sls_receiver_header *new_header,
+                          const sls_detector_header *old_header,
+                          uint64_t fnum, uint64_t bnum);
+
+    /**
+     * Listen to one packet and place it into the frame of the reassembly
+     * window it belongs to. Frames are released in order when complete,
+     * when timed out or when pushed out of the window by later frames
+     */
+    void ListenWithReassemblyWindow();
+
+    struct reassemblySlot;
+
+    /** Slot of frame fnum in the reassembly window */
+    reassemblySlot &Slot(uint64_t fnum);
+
+    /** Release the oldest frame of the reassembly window */
+    void ReleaseFrame();
+
+    /** Release all the frames in the reassembly window (end of acquisition) */
+    void ReleaseWindow();
+
     /**
      * Print Fifo Statistics
      */
@@ -170,6 +241,9 @@ class Listener : private virtual slsDetectorDefs, public ThreadObject {
     /** UDP Socket - Detector to Receiver */
     std::unique_ptr<sls::UdpRxSocket> udpSocket{nullptr};
 
+    /** Packet ring replacing the UDP socket if packet ring capture enabled */
+    std::unique_ptr<sls::PacketRingRxSocket> ringSocket{nullptr};
+
     /** UDP Port Number */
     uint32_t *udpPortNumber;
 
@@ -197,6 +271,25 @@ class Listener : private virtual slsDetectorDefs, public ThreadObject {
     /** Silent Mode */
     bool *silentMode;
 
+    /** Reorder window in frames */
+    uint32_t *reorderWindow;
+
+    /** Time the oldest frame in the reorder window waits for packets */
+    uint32_t *reorderTimeoutMs;
+
+    /** Capture from a packet ring instead of the UDP socket */
+    bool *packetRing;
+
+    /** Number of lanes sharing the UDP port, each gets every numLanes-th
+     * frame */
+    const int numLanes;
+
+    /** Lane index of this listener */
+    const int lane;
+
+    /** Other lanes of the UDP port (owned by lane 0) */
+    std::vector<std::unique_ptr<Listener>> lanes;
+
     /** row hardcoded as 1D or 2d,
      * if detector does not send them yet or
      * missing packets/deactivated (eiger/jungfrau sends 2d pos) **/
@@ -251,4 +344,47 @@ class Listener : private virtual slsDetectorDefs, public ThreadObject {
      * to get first packet number as 0
      * (pecific to gotthard, can vary between modules, hence defined here) */
     bool oddStartingPacket{true};
+
+    // reassembly window
+    /** frame being assembled in a fifo buffer */
+    struct reassemblySlot {
+        char *buffer{nullptr};
+        uint64_t frameNumber{0};
+        uint32_t numPackets{0};
+        uint64_t startTime{0};
+    };
+
+    /** frames in flight, indexed by frame number modulo the window size */
+    std::vector<reassemblySlot> window;
+
+    /** number of slots holding a buffer */
+    uint32_t numFramesInFlight{0};
+
+    /** time currentFrameIndex became the oldest frame in flight */
+    uint64_t headSince{0};
+
+    /** maximum reorder depth for statistic */
+    uint64_t reorderDepthMax{0};
+
+    // metrics
+    std::shared_ptr<ThreadMetrics> metrics;
+    MetricsCounter *packetsMetric{nullptr};
+    MetricsCounter *framesMetric{nullptr};
+    MetricsCounter *discardedMetric{nullptr};
+    MetricsCounter *syscallsMetric{nullptr};
+    LatencyHistogram *frameCompletionMetric{nullptr};
+    MetricsCounter *reorderedPacketsMetric{nullptr};
+    MetricsCounter *latePacketsMetric{nullptr};
+    MetricsCounter *duplicatePacketsMetric{nullptr};
+    MetricsCounter *timedOutFramesMetric{nullptr};
+    MetricsCounter *reorderDepthMetric{nullptr};
+
+    /** recvfrom calls of the current socket already counted */
+    uint64_t numSyscallsCounted{0};
+
+    /** time the first packet of the image being listened was received */
+    uint64_t imageStartTime{0};
+
+    /** time the carry over packet was received */
+    uint64_t carryOverTime{0};
 };
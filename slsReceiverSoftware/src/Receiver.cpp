@@ -2,6 +2,10 @@
 // Copyright (C) 2021 Contributors to the SLS Detector Package
 #include "sls/Receiver.h"
 #include "ClientInterface.h"
+#include "FifoMemoryPool.h"
+#include "Implementation.h"
+#include "ReceiverMetrics.h"
+#include "sls/AsyncLogger.h"
 #include "sls/container_utils.h"
 #include "sls/logger.h"
 #include "sls/sls_detector_exceptions.h"
@@ -21,11 +25,16 @@ namespace sls {
 
 Receiver::~Receiver() = default;
 
-Receiver::Receiver(int argc, char *argv[]) : tcpipInterface(nullptr) {
+Receiver::Receiver(int argc, char *argv[]) {
 
     // options
     int tcpip_port_no = 1954;
     uid_t userid = -1;
+    std::string metricsEndpoint;
+    int numModules = 1;
+    size_t fifoBudget = 0;
+    bool packetRing = false;
+    int udpFanout = 1;
 
     // parse command line for config
     static struct option long_options[] = {
@@ -35,6 +44,14 @@ Receiver::Receiver(int argc, char *argv[]) : tcpipInterface(nullptr) {
         {"rx_tcpport", required_argument, nullptr,
          't'}, // TODO change or backward compatible to "port, p"?
         {"uid", required_argument, nullptr, 'u'},
+        {"metrics", required_argument, nullptr, 'm'},
+        {"async_log", no_argument, nullptr, 'a'},
+        {"num_modules", required_argument, nullptr, 'n'},
+        {"fifo_budget", required_argument, nullptr, 'b'},
+        {"reorder_window", required_argument, nullptr, 'r'},
+        {"packet_ring", no_argument, nullptr, 'p'},
+        {"udp_fanout", required_argument, nullptr, 'o'},
+        {"frame_index", no_argument, nullptr, 'i'},
         {"version", no_argument, nullptr, 'v'},
         {"help", no_argument, nullptr, 'h'},
         {nullptr, 0, nullptr, 0}};
@@ -47,7 +64,8 @@ Receiver::Receiver(int argc, char *argv[]) : tcpipInterface(nullptr) {
     int c = 0;
 
     while (c != -1) {
-        c = getopt_long(argc, argv, "hvf:t:u:", long_options, &option_index);
+        c = getopt_long(argc, argv, "hvapif:t:u:m:n:b:r:o:", long_options,
+                        &option_index);
 
         // Detect the end of the options.
         if (c == -1)
@@ -65,6 +83,54 @@ Receiver::Receiver(int argc, char *argv[]) : tcpipInterface(nullptr) {
             }
             break;
 
+        case 'm':
+            metricsEndpoint = optarg;
+            break;
+
+        case 'a':
+            sls::AsyncLogger::Start();
+            break;
+
+        case 'n':
+            if (sscanf(optarg, "%d", &numModules) != 1 || numModules < 1) {
+                throw sls::RuntimeError("Could not scan number of modules");
+            }
+            break;
+
+        case 'b': {
+            unsigned long mb = 0;
+            if (sscanf(optarg, "%lu", &mb) != 1) {
+                throw sls::RuntimeError("Could not scan fifo budget");
+            }
+            fifoBudget = static_cast<size_t>(mb) * 1024 * 1024;
+        } break;
+
+        case 'r': {
+            uint32_t frames = 1;
+            uint32_t timeoutMs = DEFAULT_REORDER_TIMEOUT_MS;
+            if (sscanf(optarg, "%u:%u", &frames, &timeoutMs) < 1 ||
+                frames == 0) {
+                throw sls::RuntimeError("Could not scan reorder window");
+            }
+            Implementation::setDefaultReorderWindow(frames, timeoutMs);
+        } break;
+
+        case 'p':
+            Implementation::setDefaultPacketRing(true);
+            packetRing = true;
+            break;
+
+        case 'o':
+            if (sscanf(optarg, "%d", &udpFanout) != 1 || udpFanout < 1) {
+                throw sls::RuntimeError("Could not scan udp fan out");
+            }
+            Implementation::setDefaultUdpFanout(udpFanout);
+            break;
+
+        case 'i':
+            Implementation::setDefaultFrameIndexEnable(true);
+            break;
+
         case 'v':
             std::cout << "SLS Receiver Version: " << GITBRANCH << " (0x"
                       << std::hex << APIRECEIVER << ")" << std::endl;
@@ -83,13 +149,57 @@ Receiver::Receiver(int argc, char *argv[]) : tcpipInterface(nullptr) {
                 "client. \n" +
                 "\t-u, --uid <user id>     : Set effective user id if receiver "
                 "\n" +
-                "\t                          started with privileges. \n\n";
+                "\t                          started with privileges. \n" +
+                "\t-m, --metrics <port>    : Serve performance metrics in "
+                "Prometheus \n" +
+                "\t                          format on localhost:<port>, "
+                "<ip>:<port> \n" +
+                "\t                          or a unix socket path. \n" +
+                "\t-a, --async_log         : Log from a background thread, "
+                "rate \n" +
+                "\t                          limiting repeated messages. \n" +
+                "\t-n, --num_modules <n>   : Number of modules hosted by this "
+                "process \n" +
+                "\t                          on consecutive TCP ports. "
+                "Default 1. \n" +
+                "\t-b, --fifo_budget <MB>  : Memory budget of the fifos of "
+                "all the \n" +
+                "\t                          modules. Every module reserves "
+                "its \n" +
+                "\t                          rx_fifodepth, the rest is "
+                "shared. \n" +
+                "\t                          Threads and files stay per "
+                "module. \n" +
+                "\t-r, --reorder_window <frames>[:<timeout ms>] : Frames "
+                "assembled \n" +
+                "\t                          concurrently to tolerate "
+                "packets out of \n" +
+                "\t                          order. Default 1 (in order), "
+                "timeout 100 ms. \n" +
+                "\t-p, --packet_ring       : Capture packets from a memory "
+                "mapped \n" +
+                "\t                          AF_PACKET ring instead of the "
+                "udp socket. \n" +
+                "\t                          Needs CAP_NET_RAW. \n" +
+                "\t-o, --udp_fanout <n>    : Listener threads per udp port "
+                "(SO_REUSEPORT), \n" +
+                "\t                          frames steered by frame number "
+                "and merged \n" +
+                "\t                          by frame number. Default 1. \n" +
+                "\t-i, --frame_index       : Write a frame index (.idx) next "
+                "to every \n" +
+                "\t                          binary file for random access "
+                "reading. \n\n";
 
             // std::cout << help_message << std::endl;
             throw sls::RuntimeError(help_message);
         }
     }
 
+    if (packetRing && udpFanout > 1) {
+        LOG(logWARNING) << "Udp fan out is not used with the packet ring";
+    }
+
     // set effective id if provided
     if (userid != static_cast<uid_t>(-1)) {
         if (geteuid() == userid) {
@@ -112,39 +222,76 @@ Receiver::Receiver(int argc, char *argv[]) : tcpipInterface(nullptr) {
     }
 
     // might throw an exception
-    tcpipInterface = sls::make_unique<ClientInterface>(tcpip_port_no);
+    CreateModules(tcpip_port_no, numModules, fifoBudget);
+
+    if (!metricsEndpoint.empty()) {
+        metricsServer = sls::make_unique<MetricsServer>(metricsEndpoint);
+    }
 }
 
 Receiver::Receiver(int tcpip_port_no) {
     // might throw an exception
-    tcpipInterface = sls::make_unique<ClientInterface>(tcpip_port_no);
+    CreateModules(tcpip_port_no, 1, 0);
+}
+
+Receiver::Receiver(int tcpip_port_no, int numModules, size_t fifoBudget) {
+    // might throw an exception
+    CreateModules(tcpip_port_no, numModules, fifoBudget);
+}
+
+void Receiver::CreateModules(int tcpip_port_no, int numModules,
+                             size_t fifoBudget) {
+    if (numModules < 1) {
+        throw sls::RuntimeError("Invalid number of modules " +
+                                std::to_string(numModules));
+    }
+    if (fifoBudget != 0) {
+        FifoMemoryPool::Instance().SetBudget(fifoBudget);
+    }
+    for (int i = 0; i < numModules; ++i) {
+        tcpipInterface.push_back(
+            sls::make_unique<ClientInterface>(tcpip_port_no + i));
+    }
+    if (numModules > 1) {
+        LOG(logINFO) << "Hosting " << numModules << " modules on TCP ports "
+                     << tcpip_port_no << " to "
+                     << tcpip_port_no + numModules - 1;
+    }
+}
+
+int Receiver::getNumberOfModules() const {
+    return static_cast<int>(tcpipInterface.size());
 }
 
 int64_t Receiver::getReceiverVersion() {
-    return tcpipInterface->getReceiverVersion();
+    return tcpipInterface[0]->getReceiverVersion();
 }
 
 void Receiver::registerCallBackStartAcquisition(
     int (*func)(std::string, std::string, uint64_t, uint32_t, void *),
     void *arg) {
-    tcpipInterface->registerCallBackStartAcquisition(func, arg);
+    for (auto &it : tcpipInterface)
+        it->registerCallBackStartAcquisition(func, arg);
 }
 
 void Receiver::registerCallBackAcquisitionFinished(void (*func)(uint64_t,
                                                                 void *),
                                                    void *arg) {
-    tcpipInterface->registerCallBackAcquisitionFinished(func, arg);
+    for (auto &it : tcpipInterface)
+        it->registerCallBackAcquisitionFinished(func, arg);
 }
 
 void Receiver::registerCallBackRawDataReady(void (*func)(char *, char *,
                                                          uint32_t, void *),
                                             void *arg) {
-    tcpipInterface->registerCallBackRawDataReady(func, arg);
+    for (auto &it : tcpipInterface)
+        it->registerCallBackRawDataReady(func, arg);
 }
 
 void Receiver::registerCallBackRawDataModifyReady(
     void (*func)(char *, char *, uint32_t &, void *), void *arg) {
-    tcpipInterface->registerCallBackRawDataModifyReady(func, arg);
+    for (auto &it : tcpipInterface)
+        it->registerCallBackRawDataModifyReady(func, arg);
 }
 
 } // namespace sls
\ No newline at end of file
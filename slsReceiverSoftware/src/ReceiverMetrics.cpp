@@ -0,0 +1,346 @@
+// SPDX-License-Identifier: LGPL-3.0-or-other
+// Copyright (C) 2021 Contributors to the SLS Detector Package
+/************************************************
+ * @file ReceiverMetrics.cpp
+ * @short counters and latency histograms of the
+ * receiver threads, exported in Prometheus text
+ * format over a local http or unix socket endpoint
+ ***********************************************/
+
+#include "ReceiverMetrics.h"
+#include "sls/logger.h"
+#include "sls/sls_detector_exceptions.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// ---------------------------------------------------------------------------
+// LatencyHistogram
+
+int LatencyHistogram::BucketIndex(uint64_t value) {
+    if (value < SUB_BUCKETS)
+        return static_cast<int>(value);
+    int power = 63 - __builtin_clzll(value);
+    int sub = static_cast<int>(value >> (power - SUB_BUCKET_BITS)) &
+              (SUB_BUCKETS - 1);
+    return ((power - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS) + sub;
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(int i) {
+    if (i < SUB_BUCKETS)
+        return static_cast<uint64_t>(i);
+    int shift = (i >> SUB_BUCKET_BITS) - 1;
+    uint64_t sub = static_cast<uint64_t>(i & (SUB_BUCKETS - 1));
+    uint64_t lower = (SUB_BUCKETS + sub) << shift;
+    return lower + ((uint64_t(1) << shift) - 1);
+}
+
+uint64_t LatencyHistogram::GetCumulativeCount(uint64_t value) const {
+    uint64_t n = 0;
+    for (int i = 0; i < NUM_BUCKETS && BucketUpperBound(i) <= value; ++i)
+        n += GetBucketCount(i);
+    return n;
+}
+
+uint64_t LatencyHistogram::GetQuantile(double q) const {
+    uint64_t total = 0;
+    for (int i = 0; i < NUM_BUCKETS; ++i)
+        total += GetBucketCount(i);
+    if (total == 0)
+        return 0;
+    auto target = static_cast<uint64_t>(std::ceil(q * total));
+    if (target == 0)
+        target = 1;
+    uint64_t n = 0;
+    for (int i = 0; i < NUM_BUCKETS; ++i) {
+        n += GetBucketCount(i);
+        if (n >= target)
+            return std::min(BucketUpperBound(i), GetMax());
+    }
+    return GetMax();
+}
+
+// ---------------------------------------------------------------------------
+// ThreadMetrics
+
+namespace {
+thread_local std::string receiverLabel;
+} // namespace
+
+void ThreadMetrics::SetReceiver(const std::string &receiver) {
+    receiverLabel = receiver;
+}
+
+ThreadMetrics::ThreadMetrics(const std::string &type, int index, int lane)
+    : labels("thread=\"" + type + "\",index=\"" + std::to_string(index) +
+             "\"") {
+    if (lane >= 0)
+        labels += ",lane=\"" + std::to_string(lane) + "\"";
+    if (!receiverLabel.empty())
+        labels = "receiver=\"" + receiverLabel + "\"," + labels;
+}
+
+MetricsCounter *ThreadMetrics::AddCounter(const std::string &name,
+                                          const std::string &help) {
+    counters.emplace_back();
+    metrics.push_back({name, help, COUNTER, &counters.back(), nullptr});
+    return &counters.back();
+}
+
+MetricsCounter *ThreadMetrics::AddGauge(const std::string &name,
+                                        const std::string &help) {
+    counters.emplace_back();
+    metrics.push_back({name, help, GAUGE, &counters.back(), nullptr});
+    return &counters.back();
+}
+
+LatencyHistogram *ThreadMetrics::AddHistogram(const std::string &name,
+                                              const std::string &help) {
+    histograms.emplace_back();
+    metrics.push_back({name, help, HISTOGRAM, nullptr, &histograms.back()});
+    return &histograms.back();
+}
+
+// ---------------------------------------------------------------------------
+// MetricsRegistry
+
+MetricsRegistry &MetricsRegistry::Instance() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+void MetricsRegistry::Register(std::shared_ptr<ThreadMetrics> m) {
+    std::lock_guard<std::mutex> lock(mtx);
+    threads.push_back(std::move(m));
+}
+
+void MetricsRegistry::Unregister(const std::shared_ptr<ThreadMetrics> &m) {
+    std::lock_guard<std::mutex> lock(mtx);
+    threads.erase(std::remove(threads.begin(), threads.end(), m),
+                  threads.end());
+}
+
+namespace {
+/** histogram buckets exported: powers of 2 from 256 ns to 68 s */
+constexpr int EXPORT_MIN_POWER = 8;
+constexpr int EXPORT_MAX_POWER = 36;
+const double EXPORT_QUANTILES[] = {0.5, 0.9, 0.99, 0.999};
+
+std::string Seconds(uint64_t ns) {
+    std::ostringstream oss;
+    oss.precision(9);
+    oss << static_cast<double>(ns) * 1e-9;
+    return oss.str();
+}
+} // namespace
+
+std::string MetricsRegistry::GetPrometheusText() {
+    std::lock_guard<std::mutex> lock(mtx);
+
+    // all samples of a metric family have to be written together
+    std::map<std::string, std::vector<std::pair<const ThreadMetrics *,
+                                                const ThreadMetrics::metric *>>>
+        families;
+    for (const auto &t : threads) {
+        for (const auto &m : t->metrics) {
+            families[m.name].push_back(std::make_pair(t.get(), &m));
+        }
+    }
+
+    std::ostringstream oss;
+    for (const auto &it : families) {
+        const std::string &name = it.first;
+        const ThreadMetrics::metric *first = it.second.front().second;
+        oss << "# HELP " << name << ' ' << first->help << '\n';
+        switch (first->type) {
+        case ThreadMetrics::COUNTER:
+            oss << "# TYPE " << name << " counter\n";
+            break;
+        case ThreadMetrics::GAUGE:
+            oss << "# TYPE " << name << " gauge\n";
+            break;
+        case ThreadMetrics::HISTOGRAM:
+            oss << "# TYPE " << name << " histogram\n";
+            break;
+        }
+
+        for (const auto &sample : it.second) {
+            const std::string &labels = sample.first->labels;
+            const ThreadMetrics::metric *m = sample.second;
+            if (m->type != ThreadMetrics::HISTOGRAM) {
+                oss << name << '{' << labels << "} " << m->counter->Get()
+                    << '\n';
+                continue;
+            }
+            const LatencyHistogram *h = m->histogram;
+            for (int p = EXPORT_MIN_POWER; p <= EXPORT_MAX_POWER; ++p) {
+                uint64_t le = uint64_t(1) << p;
+                oss << name << "_bucket{" << labels << ",le=\"" << Seconds(le)
+                    << "\"} " << h->GetCumulativeCount(le - 1) << '\n';
+            }
+            oss << name << "_bucket{" << labels << ",le=\"+Inf\"} "
+                << h->GetCount() << '\n';
+            oss << name << "_sum{" << labels << "} " << Seconds(h->GetSum())
+                << '\n';
+            oss << name << "_count{" << labels << "} " << h->GetCount()
+                << '\n';
+        }
+
+        // full resolution quantiles and maximum of the histograms
+        if (first->type == ThreadMetrics::HISTOGRAM) {
+            oss << "# HELP " << name << "_quantile " << first->help
+                << " (quantiles)\n";
+            oss << "# TYPE " << name << "_quantile gauge\n";
+            for (const auto &sample : it.second) {
+                for (double q : EXPORT_QUANTILES) {
+                    oss << name << "_quantile{" << sample.first->labels
+                        << ",quantile=\"" << q << "\"} "
+                        << Seconds(sample.second->histogram->GetQuantile(q))
+                        << '\n';
+                }
+            }
+            oss << "# HELP " << name << "_max " << first->help
+                << " (maximum)\n";
+            oss << "# TYPE " << name << "_max gauge\n";
+            for (const auto &sample : it.second) {
+                oss << name << "_max{" << sample.first->labels << "} "
+                    << Seconds(sample.second->histogram->GetMax()) << '\n';
+            }
+        }
+    }
+    return oss.str();
+}
+
+// ---------------------------------------------------------------------------
+// MetricsServer
+
+MetricsServer::MetricsServer(const std::string &endpoint) {
+    bool isPort = !endpoint.empty() &&
+                  endpoint.find_first_not_of("0123456789.:") ==
+                      std::string::npos &&
+                  endpoint.find('/') == std::string::npos;
+    if (isPort) {
+        // [ip:]port, localhost by default
+        std::string ip = "127.0.0.1";
+        std::string port = endpoint;
+        auto pos = endpoint.rfind(':');
+        if (pos != std::string::npos) {
+            ip = endpoint.substr(0, pos);
+            port = endpoint.substr(pos + 1);
+        }
+        struct sockaddr_in addr {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(std::stoi(port)));
+        if (inet_pton(AF_INET, ip.c_str(), &addr.sin_addr) != 1) {
+            throw sls::RuntimeError("Invalid metrics endpoint " + endpoint);
+        }
+        sockfd = socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (sockfd < 0 ||
+            bind(sockfd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+            if (sockfd >= 0)
+                close(sockfd);
+            throw sls::RuntimeError("Could not bind metrics endpoint " +
+                                    endpoint + ": " + strerror(errno));
+        }
+    } else {
+        struct sockaddr_un addr {};
+        addr.sun_family = AF_UNIX;
+        if (endpoint.size() >= sizeof(addr.sun_path)) {
+            throw sls::RuntimeError("Metrics socket path too long: " +
+                                    endpoint);
+        }
+        strcpy(addr.sun_path, endpoint.c_str());
+        unlink(endpoint.c_str());
+        sockfd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (sockfd < 0 ||
+            bind(sockfd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+            if (sockfd >= 0)
+                close(sockfd);
+            throw sls::RuntimeError("Could not bind metrics socket " +
+                                    endpoint + ": " + strerror(errno));
+        }
+        socketPath = endpoint;
+    }
+    if (listen(sockfd, 8) != 0) {
+        close(sockfd);
+        throw sls::RuntimeError("Could not listen on metrics endpoint " +
+                                endpoint);
+    }
+    serverThread = std::thread(&MetricsServer::ServerThread, this);
+    LOG(logINFO) << "Metrics endpoint: " << endpoint;
+}
+
+MetricsServer::~MetricsServer() {
+    killThread = true;
+    if (serverThread.joinable())
+        serverThread.join();
+    close(sockfd);
+    if (!socketPath.empty())
+        unlink(socketPath.c_str());
+}
+
+void MetricsServer::ServerThread() {
+    while (!killThread) {
+        // poll with timeout to notice the destruction
+        struct pollfd pfd {};
+        pfd.fd = sockfd;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, 200) <= 0)
+            continue;
+        int fd = accept(sockfd, nullptr, nullptr);
+        if (fd < 0)
+            continue;
+        HandleConnection(fd);
+        close(fd);
+    }
+}
+
+void MetricsServer::HandleConnection(int fd) {
+    struct timeval tv {};
+    tv.tv_sec = 1;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    // read the request header, its content does not matter
+    char request[4096];
+    size_t len = 0;
+    while (len < sizeof(request) - 1) {
+        ssize_t rc = recv(fd, request + len, sizeof(request) - 1 - len, 0);
+        if (rc <= 0)
+            break;
+        len += rc;
+        request[len] = '\0';
+        if (strstr(request, "\r\n\r\n") || strstr(request, "\n\n"))
+            break;
+    }
+
+    std::string body = MetricsRegistry::Instance().GetPrometheusText();
+    std::ostringstream oss;
+    oss << "HTTP/1.1 200 OK\r\n"
+        << "Content-Type: text/plain; version=0.0.4\r\n"
+        << "Content-Length: " << body.size() << "\r\n"
+        << "Connection: close\r\n\r\n"
+        << body;
+    std::string response = oss.str();
+    const char *ptr = response.c_str();
+    size_t remaining = response.size();
+    while (remaining > 0) {
+        ssize_t rc = send(fd, ptr, remaining, MSG_NOSIGNAL);
+        if (rc <= 0)
+            break;
+        ptr += rc;
+        remaining -= rc;
+    }
+}
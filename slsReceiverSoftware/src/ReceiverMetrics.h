@@ -0,0 +1,174 @@
+// SPDX-License-Identifier: LGPL-3.0-or-other
+// Copyright (C) 2021 Contributors to the SLS Detector Package
+#pragma once
+/************************************************
+ * @file ReceiverMetrics.h
+ * @short counters and latency histograms of the
+ * receiver threads, exported in Prometheus text
+ * format over a local http or unix socket endpoint
+ ***********************************************/
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/** monotonic time stamp in ns for the latency measurements */
+inline uint64_t MetricsClock() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+/**
+ * Counter written by a single thread and read by the metrics endpoint.
+ * Relaxed load and store, no atomic read-modify-write in the hot loops.
+ */
+class MetricsCounter {
+    std::atomic<uint64_t> value{0};
+
+  public:
+    void Add(uint64_t n = 1) {
+        value.store(value.load(std::memory_order_relaxed) + n,
+                    std::memory_order_relaxed);
+    }
+    void Set(uint64_t n) { value.store(n, std::memory_order_relaxed); }
+    uint64_t Get() const { return value.load(std::memory_order_relaxed); }
+};
+
+/**
+ * HDR style latency histogram of values in ns with a single writer.
+ * Values below 2^SUB_BUCKET_BITS are exact, above every power of two is
+ * split in 2^SUB_BUCKET_BITS linear sub buckets (relative error < 12.5%),
+ * so that the whole uint64_t range is covered by a fixed array.
+ */
+class LatencyHistogram {
+  public:
+    static constexpr int SUB_BUCKET_BITS = 3;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr int NUM_BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    void Record(uint64_t ns) {
+        Increment(buckets[BucketIndex(ns)], 1);
+        Increment(count, 1);
+        Increment(sum, ns);
+        if (ns > max.load(std::memory_order_relaxed))
+            max.store(ns, std::memory_order_relaxed);
+    }
+
+    /** records the time elapsed since start (MetricsClock) */
+    void RecordSince(uint64_t start) { Record(MetricsClock() - start); }
+
+    uint64_t GetCount() const { return count.load(std::memory_order_relaxed); }
+    uint64_t GetSum() const { return sum.load(std::memory_order_relaxed); }
+    uint64_t GetMax() const { return max.load(std::memory_order_relaxed); }
+    uint64_t GetBucketCount(int i) const {
+        return buckets[i].load(std::memory_order_relaxed);
+    }
+
+    /** number of values smaller or equal to value (bucket resolution) */
+    uint64_t GetCumulativeCount(uint64_t value) const;
+
+    /** upper bound of the bucket holding the quantile q (0 to 1) */
+    uint64_t GetQuantile(double q) const;
+
+    static int BucketIndex(uint64_t value);
+
+    /** largest value (inclusive) of bucket i */
+    static uint64_t BucketUpperBound(int i);
+
+  private:
+    static void Increment(std::atomic<uint64_t> &a, uint64_t n) {
+        a.store(a.load(std::memory_order_relaxed) + n,
+                std::memory_order_relaxed);
+    }
+
+    std::array<std::atomic<uint64_t>, NUM_BUCKETS> buckets{};
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> max{0};
+};
+
+/**
+ * Metrics of one receiver thread (or fifo). All the metrics are added
+ * before registering, afterwards only the owning thread writes them.
+ */
+class ThreadMetrics {
+  public:
+    /** lane labels the listener lanes of a udp port (-1 for none) */
+    ThreadMetrics(const std::string &type, int index, int lane = -1);
+
+    /**
+     * Adds a receiver label (e.g. tcp port) to the metrics created by the
+     * calling thread, to tell apart modules hosted by the same process
+     */
+    static void SetReceiver(const std::string &receiver);
+
+    MetricsCounter *AddCounter(const std::string &name,
+                               const std::string &help);
+    /** value that goes up and down, e.g. fifo levels */
+    MetricsCounter *AddGauge(const std::string &name, const std::string &help);
+    LatencyHistogram *AddHistogram(const std::string &name,
+                                   const std::string &help);
+
+  private:
+    friend class MetricsRegistry;
+
+    enum metricType { COUNTER, GAUGE, HISTOGRAM };
+    struct metric {
+        std::string name;
+        std::string help;
+        metricType type;
+        MetricsCounter *counter;
+        LatencyHistogram *histogram;
+    };
+
+    std::string labels;
+    std::vector<metric> metrics;
+    // deques keep the addresses of the elements
+    std::deque<MetricsCounter> counters;
+    std::deque<LatencyHistogram> histograms;
+};
+
+/** process wide list of the metrics of all the receiver threads */
+class MetricsRegistry {
+  public:
+    static MetricsRegistry &Instance();
+
+    void Register(std::shared_ptr<ThreadMetrics> m);
+    void Unregister(const std::shared_ptr<ThreadMetrics> &m);
+
+    /** all metrics in Prometheus text exposition format */
+    std::string GetPrometheusText();
+
+  private:
+    MetricsRegistry() = default;
+    std::mutex mtx;
+    std::vector<std::shared_ptr<ThreadMetrics>> threads;
+};
+
+/**
+ * Serves the metrics registry over http (GET on any path).
+ * The endpoint is either a tcp port bound to localhost or the path of a
+ * unix socket (curl --unix-socket <path> http://localhost/metrics)
+ */
+class MetricsServer {
+  public:
+    explicit MetricsServer(const std::string &endpoint);
+    ~MetricsServer();
+
+  private:
+    void ServerThread();
+    void HandleConnection(int fd);
+
+    std::string socketPath;
+    int sockfd{-1};
+    std::atomic<bool> killThread{false};
+    std::thread serverThread;
+};
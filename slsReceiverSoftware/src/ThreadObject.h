@@ -34,10 +34,10 @@ class ThreadObject : private virtual slsDetectorDefs {
     virtual ~ThreadObject();
     pid_t GetThreadId() const;
     bool IsRunning() const;
-    void StartRunning();
+    virtual void StartRunning();
     void StopRunning();
-    void Continue();
-    void SetThreadPriority(int priority);
+    virtual void Continue();
+    virtual void SetThreadPriority(int priority);
 
   private:
     virtual void ThreadExecution() = 0;
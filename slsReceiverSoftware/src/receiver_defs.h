@@ -51,6 +51,9 @@
 
 #define DUMMY_PACKET_VALUE (0xFFFFFFFF)
 
+// time the oldest frame in the reorder window waits for missing packets
+#define DEFAULT_REORDER_TIMEOUT_MS (100)
+
 #define LISTENER_PRIORITY  (90)
 #define PROCESSOR_PRIORITY (70)
 #define STREAMER_PRIORITY  (10)
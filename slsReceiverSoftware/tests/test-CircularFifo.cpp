@@ -50,4 +50,18 @@ TEST_CASE("Push pop") {
 
     CHECK(fifo.isEmpty() == true);
     CHECK(fifo.isFull() == false);
-}
\ No newline at end of file
+}
+TEST_CASE("Pop with timeout") {
+    CircularFifo<int> fifo(2);
+    int value = 5;
+    int *p = nullptr;
+
+    CHECK(fifo.popWithTimeout(p, 10) == false);
+    CHECK(p == nullptr);
+
+    int *q = &value;
+    fifo.push(q);
+    CHECK(fifo.popWithTimeout(p, 10) == true);
+    CHECK(p == &value);
+    CHECK(fifo.isEmpty() == true);
+}
@@ -0,0 +1,138 @@
+// SPDX-License-Identifier: LGPL-3.0-or-other
+// Copyright (C) 2021 Contributors to the SLS Detector Package
+#include "Fifo.h"
+#include "catch.hpp"
+#include "receiver_defs.h"
+
+#include <chrono>
+#include <future>
+#include <vector>
+
+namespace {
+void SetFrame(char *address, uint64_t fnum) {
+    *reinterpret_cast<uint32_t *>(address) = 1;
+    reinterpret_cast<slsDetectorDefs::sls_receiver_header *>(
+        address + FIFO_HEADER_NUMBYTES)
+        ->detHeader.frameNumber = fnum;
+}
+
+uint64_t GetFrame(char *address) {
+    return reinterpret_cast<slsDetectorDefs::sls_receiver_header *>(
+               address + FIFO_HEADER_NUMBYTES)
+        ->detHeader.frameNumber;
+}
+} // namespace
+
+TEST_CASE("Fifo merges the lanes in frame order") {
+    constexpr uint32_t itemSize =
+        FIFO_HEADER_NUMBYTES + sizeof(slsDetectorDefs::sls_receiver_header);
+    Fifo fifo(0, itemSize, 8, 2);
+
+    // lane 0 gets even, lane 1 odd frames, lane 1 is ahead
+    char *p = nullptr;
+    for (uint64_t fnum : {1, 3, 5}) {
+        fifo.GetNewAddress(p, 1);
+        SetFrame(p, fnum);
+        fifo.PushAddress(p, 1);
+    }
+    for (uint64_t fnum : {0, 2, 6}) {
+        fifo.GetNewAddress(p, 0);
+        SetFrame(p, fnum);
+        fifo.PushAddress(p, 0);
+    }
+    // end of acquisition in both lanes
+    for (int lane : {0, 1}) {
+        fifo.GetNewAddress(p, lane);
+        *reinterpret_cast<uint32_t *>(p) = DUMMY_PACKET_VALUE;
+        fifo.PushAddress(p, lane);
+    }
+
+    std::vector<uint64_t> frames;
+    while (true) {
+        fifo.PopAddress(p);
+        if (*reinterpret_cast<uint32_t *>(p) == DUMMY_PACKET_VALUE) {
+            fifo.FreeAddress(p);
+            break;
+        }
+        frames.push_back(GetFrame(p));
+        fifo.FreeAddress(p);
+    }
+    CHECK(frames == std::vector<uint64_t>{0, 1, 2, 3, 5, 6});
+
+    // all the addresses went back to their lanes
+    for (int lane : {0, 1}) {
+        std::vector<char *> addresses(4);
+        for (auto &a : addresses)
+            fifo.GetNewAddress(a, lane);
+        for (auto &a : addresses)
+            fifo.FreeAddress(a);
+    }
+}
+
+TEST_CASE("Fifo merges frames pushed to the lanes out of order") {
+    constexpr uint32_t itemSize =
+        FIFO_HEADER_NUMBYTES + sizeof(slsDetectorDefs::sls_receiver_header);
+    Fifo fifo(0, itemSize, 8, 2);
+
+    auto push = [&fifo](int lane, uint64_t fnum) {
+        char *p = nullptr;
+        fifo.GetNewAddress(p, lane);
+        SetFrame(p, fnum);
+        fifo.PushAddress(p, lane);
+    };
+    auto pushDummy = [&fifo](int lane) {
+        char *p = nullptr;
+        fifo.GetNewAddress(p, lane);
+        *reinterpret_cast<uint32_t *>(p) = DUMMY_PACKET_VALUE;
+        fifo.PushAddress(p, lane);
+    };
+    auto pop = [&fifo]() {
+        char *p = nullptr;
+        fifo.PopAddress(p);
+        uint64_t fnum = *reinterpret_cast<uint32_t *>(p) == DUMMY_PACKET_VALUE
+                            ? -1
+                            : GetFrame(p);
+        fifo.FreeAddress(p);
+        return fnum;
+    };
+
+    // lane 0 is ahead, the merge waits for the frames of lane 1
+    push(0, 0);
+    push(0, 2);
+    push(0, 4);
+    CHECK(pop() == 0);
+    auto popped = std::async(std::launch::async, [&pop]() { return pop(); });
+    CHECK(popped.wait_for(std::chrono::milliseconds(20)) ==
+          std::future_status::timeout);
+    push(1, 1);
+    push(1, 3);
+    CHECK(popped.get() == 1);
+    CHECK(pop() == 2);
+    CHECK(pop() == 3);
+    CHECK(pop() == 4);
+
+    // frame 5 discarded: lane 1 goes on with 7
+    push(1, 7);
+    push(0, 6);
+    CHECK(pop() == 6);
+    CHECK(pop() == 7);
+
+    // frame 9 lost: skipped after the timeout
+    push(0, 8);
+    push(0, 10);
+    CHECK(pop() == 8);
+    CHECK(pop() == 10);
+
+    // the dummy comes once both lanes ended
+    pushDummy(0);
+    push(1, 11);
+    CHECK(pop() == 11);
+    pushDummy(1);
+    CHECK(pop() == static_cast<uint64_t>(-1));
+
+    // the next acquisition starts again from its first frame
+    push(1, 1);
+    push(0, 0);
+    CHECK(pop() == 0);
+    CHECK(pop() == 1);
+}
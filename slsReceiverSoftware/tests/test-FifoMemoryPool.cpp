@@ -0,0 +1,65 @@
+// SPDX-License-Identifier: LGPL-3.0-or-other
+// Copyright (C) 2021 Contributors to the SLS Detector Package
+#include "Fifo.h"
+#include "FifoMemoryPool.h"
+#include "catch.hpp"
+#include "sls/sls_detector_exceptions.h"
+
+TEST_CASE("Fifo memory budget with borrowing") {
+    auto &pool = FifoMemoryPool::Instance();
+    pool.SetBudget(10 * 1024);
+
+    {
+        // each fifo reserves its own depth as minimum
+        Fifo a(0, 1024, 4);
+        Fifo b(1, 1024, 4);
+        CHECK(pool.GetReservedBytes() == 8 * 1024);
+        REQUIRE_THROWS_AS(Fifo(2, 1024, 4), sls::RuntimeError);
+        CHECK(pool.GetReservedBytes() == 8 * 1024);
+
+        // a busy fifo borrows the rest of the budget
+        std::vector<char *> addresses(6);
+        for (auto &p : addresses)
+            a.GetNewAddress(p);
+        CHECK(pool.GetBorrowedBytes() == 2 * 1024);
+        for (auto &p : addresses) {
+            a.PushAddress(p);
+        }
+        for (auto &p : addresses) {
+            a.PopAddress(p);
+            a.FreeAddress(p);
+        }
+        CHECK(pool.GetBorrowedBytes() == 0);
+
+        // and gives it back for others
+        char *p = nullptr;
+        b.GetNewAddress(p);
+        b.FreeAddress(p);
+    }
+    CHECK(pool.GetReservedBytes() == 0);
+
+    // idle shared buffers are freed for new reservations
+    Fifo c(0, 1024, 10);
+    CHECK(pool.GetReservedBytes() == 10 * 1024);
+    pool.SetBudget(0);
+}
+
+TEST_CASE("Borrowed fifo buffers in flight are returned on destruction") {
+    auto &pool = FifoMemoryPool::Instance();
+    pool.SetBudget(8 * 1024);
+    {
+        Fifo a(0, 1024, 2, 2);
+        // one own buffer per lane, then borrowed ones
+        std::vector<char *> addresses(5);
+        for (size_t i = 0; i != addresses.size(); ++i)
+            a.GetNewAddress(addresses[i], i % 2);
+        CHECK(pool.GetBorrowedBytes() == 3 * 1024);
+        // left in the bound and stream fifos
+        for (size_t i = 0; i != 4; ++i)
+            a.PushAddress(addresses[i], i % 2);
+        a.PushAddressToStream(addresses[4]);
+    }
+    CHECK(pool.GetBorrowedBytes() == 0);
+    CHECK(pool.GetReservedBytes() == 0);
+    pool.SetBudget(0);
+}
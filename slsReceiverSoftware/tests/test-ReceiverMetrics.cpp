@@ -0,0 +1,66 @@
+// SPDX-License-Identifier: LGPL-3.0-or-other
+// Copyright (C) 2021 Contributors to the SLS Detector Package
+#include "ReceiverMetrics.h"
+#include "catch.hpp"
+
+#include <memory>
+#include <string>
+
+TEST_CASE("Latency histogram buckets cover the range without gaps") {
+    for (int i = 0; i < 8; ++i) {
+        CHECK(LatencyHistogram::BucketIndex(i) == i);
+        CHECK(LatencyHistogram::BucketUpperBound(i) == uint64_t(i));
+    }
+    for (int i = 1; i < LatencyHistogram::NUM_BUCKETS - 1; ++i) {
+        uint64_t bound = LatencyHistogram::BucketUpperBound(i);
+        REQUIRE(LatencyHistogram::BucketIndex(bound) == i);
+        REQUIRE(LatencyHistogram::BucketIndex(bound + 1) == i + 1);
+    }
+    CHECK(LatencyHistogram::BucketIndex(UINT64_MAX) ==
+          LatencyHistogram::NUM_BUCKETS - 1);
+}
+
+TEST_CASE("Latency histogram count, sum, max and quantiles") {
+    LatencyHistogram h;
+    CHECK(h.GetQuantile(0.5) == 0);
+    for (uint64_t i = 1; i <= 1000; ++i) {
+        h.Record(i * 1000);
+    }
+    CHECK(h.GetCount() == 1000);
+    CHECK(h.GetSum() == 500500000);
+    CHECK(h.GetMax() == 1000000);
+    CHECK(h.GetCumulativeCount(UINT64_MAX) == 1000);
+
+    // relative error of the bucket upper bound is below 12.5%
+    auto median = h.GetQuantile(0.5);
+    CHECK(median >= 500000);
+    CHECK(median < 500000 * 1.125);
+    auto p99 = h.GetQuantile(0.99);
+    CHECK(p99 >= 990000);
+    CHECK(p99 <= 1000000);
+    CHECK(h.GetQuantile(1) == 1000000);
+}
+
+TEST_CASE("Prometheus text of registered thread metrics") {
+    auto m = std::make_shared<ThreadMetrics>("listener", 3);
+    auto counter = m->AddCounter("test_frames_total", "Frames");
+    auto histogram = m->AddHistogram("test_latency_seconds", "Latency");
+    counter->Add(5);
+    histogram->Record(1000);
+    MetricsRegistry::Instance().Register(m);
+
+    std::string text = MetricsRegistry::Instance().GetPrometheusText();
+    CHECK(text.find("# TYPE test_frames_total counter") != std::string::npos);
+    CHECK(text.find("test_frames_total{thread=\"listener\",index=\"3\"} 5") !=
+          std::string::npos);
+    CHECK(text.find("# TYPE test_latency_seconds histogram") !=
+          std::string::npos);
+    CHECK(text.find("test_latency_seconds_bucket{thread=\"listener\",index="
+                    "\"3\",le=\"+Inf\"} 1") != std::string::npos);
+    CHECK(text.find("test_latency_seconds_count{thread=\"listener\",index="
+                    "\"3\"} 1") != std::string::npos);
+
+    MetricsRegistry::Instance().Unregister(m);
+    text = MetricsRegistry::Instance().GetPrometheusText();
+    CHECK(text.find("test_frames_total") == std::string::npos);
+}
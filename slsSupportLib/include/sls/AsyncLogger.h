@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: LGPL-3.0-or-other
+// Copyright (C) 2021 Contributors to the SLS Detector Package
+#pragma once
+/*
+Asynchronous backend for sls::Logger. Once started, LOG(level) copies the
+formatted message into a lock free ring buffer of the calling thread and a
+background thread writes the messages of all threads to std::clog. A thread
+logging never blocks on the console: if its ring is full the message is
+dropped and counted. Identical messages repeated more than maxRepeats times
+within rateWindow by the same thread are suppressed and counted.
+*/
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace sls {
+
+struct AsyncLogConfig {
+    /** messages buffered per thread, rounded up to a power of two */
+    size_t recordsPerThread{1024};
+    /** how often the background thread writes the buffered messages */
+    std::chrono::milliseconds flushInterval{20};
+    /** rate limiting of repeated messages, 0 to disable */
+    std::chrono::milliseconds rateWindow{1000};
+    int maxRepeats{10};
+};
+
+class AsyncLogger {
+  public:
+    /** redirects LOG to the background thread, flushed again at exit */
+    static void Start(const AsyncLogConfig &config = AsyncLogConfig());
+
+    /** writes the remaining messages and returns to synchronous logging */
+    static void Stop();
+
+    /** blocks until the messages logged so far are written */
+    static void Flush();
+
+    static bool IsRunning();
+
+    /** messages lost because the ring of the thread was full */
+    static uint64_t GetNumberOfDropped();
+
+    /** repeated messages suppressed by the rate limiting */
+    static uint64_t GetNumberOfSuppressed();
+};
+
+} // namespace sls
@@ -0,0 +1,90 @@
+// SPDX-License-Identifier: LGPL-3.0-or-other
+// Copyright (C) 2021 Contributors to the SLS Detector Package
+
+#pragma once
+/*
+Alternative to UdpRxSocket receiving the UDP packets of one port from a
+memory mapped AF_PACKET (TPACKET_V3) ring bound to a network interface.
+The kernel fills whole blocks of packets, which are read without a system
+call per packet. A BPF program in the kernel keeps only the IPv4 UDP packets
+to the port, fragmented packets are dropped (use jumbo frames). A UDP
+socket dropping everything holds the port meanwhile.
+Needs CAP_NET_RAW. Same interface as UdpRxSocket, used RAII style.
+*/
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <sys/types.h> //ssize_t
+
+namespace sls {
+
+class PacketRingRxSocket {
+    const ssize_t packet_size_;
+    int sockfd_{-1};
+    /** eventfd waking a reader blocked in poll on Shutdown */
+    int wakefd_{-1};
+    /** udp socket holding the port, so that the kernel does not answer
+     * every packet with port unreachable. Never read, drops everything */
+    int portfd_{-1};
+    char *ring_{nullptr};
+    size_t block_size_{0};
+    size_t num_blocks_{0};
+    size_t ring_size_{0};
+    /** block being read and packet in it */
+    size_t block_index_{0};
+    char *packet_{nullptr};
+    uint32_t packets_left_{0};
+    uint64_t num_syscalls_{0};
+    uint64_t num_dropped_{0};
+    std::atomic<bool> shutdown_{false};
+
+  public:
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 1 << 22;
+    static constexpr size_t MIN_NUM_BLOCKS = 8;
+    /** a partly filled block is handed over after this time */
+    static constexpr unsigned BLOCK_TIMEOUT_MS = 8;
+    /** poll interval, a shutdown wakes the reader at once */
+    static constexpr int POLL_TIMEOUT_MS = 100;
+
+    /**
+     * @param port udp port
+     * @param packet_size size of the udp payload
+     * @param interface network interface, empty for all interfaces
+     * @param ring_size memory of the ring in bytes, rounded to whole blocks
+     */
+    PacketRingRxSocket(int port, ssize_t packet_size,
+                       const std::string &interface = std::string(),
+                       size_t ring_size = 0);
+    ~PacketRingRxSocket();
+    PacketRingRxSocket(const PacketRingRxSocket &) = delete;
+    PacketRingRxSocket &operator=(const PacketRingRxSocket &) = delete;
+
+    bool ReceivePacket(char *dst) noexcept;
+    /** memory of the ring (no kernel bookkeeping doubling) */
+    size_t getRingSize() const noexcept;
+    ssize_t getPacketSize() const noexcept;
+    /** number of poll calls, to be read from the receiving thread */
+    uint64_t getNumberOfSyscalls() const noexcept;
+    /** packets dropped by the kernel since the ring was created */
+    uint64_t getNumberOfDropped();
+    /**
+     * Makes the reading thread return -1 at once. The socket is only closed
+     * by the destructor, once the reading thread is done with it
+     */
+    void Shutdown();
+
+    /**
+     * Copies the payload of the next packet to dst (at most the packet
+     * size), same handling of Eiger small packets as UdpRxSocket
+     * @returns payload size, 0 or -1 after shutdown
+     */
+    ssize_t ReceiveDataOnly(char *dst) noexcept;
+
+  private:
+    /** next packet payload in the ring, nullptr after shutdown */
+    const char *NextPacket(ssize_t &size) noexcept;
+    void ReleaseBlock() noexcept;
+};
+
+} // namespace sls
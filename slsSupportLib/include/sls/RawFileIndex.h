@@ -0,0 +1,129 @@
+// SPDX-License-Identifier: LGPL-3.0-or-other
+// Copyright (C) 2021 Contributors to the SLS Detector Package
+
+#pragma once
+/*
+Frame index of the binary raw files written by the receiver. Next to every
+raw file (run_d0_f0_0.raw) the receiver can write run_d0_f0_0.idx, a
+FrameIndexHeader followed by one FrameIndexEntry per frame record of the raw
+file, in file order. The reader uses it to find frames without scanning the
+raw files.
+*/
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace sls {
+
+constexpr char FRAME_INDEX_MAGIC[8] = "SLSFIDX";
+constexpr uint32_t FRAME_INDEX_VERSION = 1;
+
+struct FrameIndexHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t entrySize;
+    uint32_t packetsPerFrame;
+    uint32_t reserved;
+    uint64_t reserved2;
+};
+
+struct FrameIndexEntry {
+    uint64_t frameNumber; /**< from the detector header */
+    uint64_t offset;      /**< of the record in the raw file */
+    uint64_t timestamp;   /**< from the detector header */
+    uint32_t packets;     /**< packets caught */
+    uint32_t size;        /**< of the record, receiver header included */
+};
+
+static_assert(sizeof(FrameIndexHeader) == 32, "Frame index header changed");
+static_assert(sizeof(FrameIndexEntry) == 32, "Frame index entry changed");
+
+/** index file name of a raw file, the extension replaced by .idx */
+std::string FrameIndexFileName(const std::string &rawFileName);
+
+/**
+ * Writes the index of one raw file. The entries are buffered and written
+ * in batches, so the index of a file still being written lags behind by
+ * up to a batch. Throws sls::RuntimeError on failure
+ */
+class FrameIndexWriter {
+  public:
+    FrameIndexWriter() = default;
+    ~FrameIndexWriter();
+    FrameIndexWriter(const FrameIndexWriter &) = delete;
+    FrameIndexWriter &operator=(const FrameIndexWriter &) = delete;
+
+    void Open(const std::string &fname, uint32_t packetsPerFrame,
+              bool overWriteEnable);
+    void Add(const FrameIndexEntry &entry);
+    /** writes the pending entries and closes the file */
+    void Close();
+    bool IsOpen() const { return fd_ != nullptr; }
+
+  private:
+    void Flush();
+    static constexpr size_t BATCH_SIZE = 1024;
+    FILE *fd_{nullptr};
+    std::string fname_;
+    std::vector<FrameIndexEntry> batch_;
+};
+
+/**
+ * Random access to the frames in the raw files of one port through their
+ * frame indices: the _f0, _f1... sub files of an acquisition are seen as
+ * one sequence of frames. Reading uses pread only, so it is thread safe.
+ * Throws sls::RuntimeError if a file or its index cannot be read
+ */
+class RawFileReader {
+  public:
+    /** sub files in order, each with its index file */
+    explicit RawFileReader(const std::vector<std::string> &rawFiles);
+    ~RawFileReader();
+    RawFileReader(const RawFileReader &) = delete;
+    RawFileReader &operator=(const RawFileReader &) = delete;
+
+    size_t NumFrames() const { return entries_.size(); }
+    uint32_t PacketsPerFrame() const { return packetsPerFrame_; }
+    /** largest record, receiver header included */
+    uint32_t MaxFrameSize() const { return maxFrameSize_; }
+    const FrameIndexEntry &Entry(size_t i) const { return entries_.at(i); }
+    bool IsComplete(size_t i) const;
+    /** positions of the frames with all their packets */
+    std::vector<size_t> CompleteFrames() const;
+
+    /**
+     * position of the frame, -1 if it is not in the files. Arithmetic for
+     * consecutive frame numbers, a hash lookup otherwise
+     */
+    int64_t Find(uint64_t frameNumber) const;
+
+    /** reads the record (receiver header and data) of frame i */
+    void Read(size_t i, char *buffer) const;
+    /**
+     * reads frames [first, first + count) to buffer, stride bytes apart,
+     * splitting them over nthreads threads (0 for one per core)
+     */
+    void ReadRange(size_t first, size_t count, char *buffer, size_t stride,
+                   int nthreads = 0) const;
+    /** reads the frames at the given positions, stride bytes apart */
+    void ReadFrames(const std::vector<size_t> &positions, char *buffer,
+                    size_t stride, int nthreads = 0) const;
+
+  private:
+    void LoadIndex(const std::string &rawFile, uint16_t file);
+    template <typename F>
+    void ParallelFor(size_t count, int nthreads, F &&f) const;
+
+    std::vector<int> fds_;
+    std::vector<FrameIndexEntry> entries_;
+    std::vector<uint16_t> fileOf_;
+    std::unordered_map<uint64_t, size_t> positions_;
+    uint32_t packetsPerFrame_{0};
+    uint32_t maxFrameSize_{0};
+    bool consecutive_{true};
+};
+
+} // namespace sls
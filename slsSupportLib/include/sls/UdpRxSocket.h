@@ -7,21 +7,36 @@ UDP socket class to receive data. The intended use is in the
 receiver listener loop. Should be used RAII style...
 */
 
+#include <cstdint>
 #include <sys/types.h> //ssize_t
 namespace sls {
 
 class UdpRxSocket {
     const ssize_t packet_size_;
     int sockfd_{-1};
+    uint64_t num_syscalls_{0};
 
   public:
+    /**
+     * @param reuse_port bind with SO_REUSEPORT to share the port with other
+     * sockets of this process (fan out)
+     */
     UdpRxSocket(int port, ssize_t packet_size, const char *hostname = nullptr,
-                int kernel_buffer_size = 0);
+                int kernel_buffer_size = 0, bool reuse_port = false);
     ~UdpRxSocket();
     bool ReceivePacket(char *dst) noexcept;
+    /**
+     * Steer the packets of the sockets sharing the port (SO_REUSEPORT) by
+     * the frame number of the sls_detector_header: frame n goes to the
+     * (n % num_sockets)th socket bound to the port. Set on the first socket,
+     * applies to the whole group
+     */
+    void setFrameNumberSteering(int num_sockets);
     int getBufferSize() const;
     void setBufferSize(int size);
     ssize_t getPacketSize() const noexcept;
+    /** number of recvfrom calls, to be read from the receiving thread */
+    uint64_t getNumberOfSyscalls() const noexcept;
     void Shutdown();
 
     // Only for backwards compatibility, this drops the EIGER small pkt, may be
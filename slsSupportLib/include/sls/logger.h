@@ -4,8 +4,12 @@
 /*Utility to log to console*/
 
 #include "sls/ansi.h" //Colors
+#include <atomic>
+#include <cstdio>
+#include <ctime>
 #include <iostream>
 #include <sstream>
+#include <string>
 #include <sys/time.h>
 
 enum TLogLevel {
@@ -38,9 +42,69 @@ enum TLogLevel {
         std::string(__func__) + std::string("(): ")
 
 namespace sls {
+
+/**
+ * Fixed size stream buffer of a log message. Only messages longer than
+ * the inline buffer allocate (the remainder goes to a std::string).
+ */
+class LogStreamBuf : public std::streambuf {
+  public:
+    static constexpr size_t INLINE_SIZE = 512;
+
+    LogStreamBuf() { setp(buffer, buffer + INLINE_SIZE); }
+    LogStreamBuf(const LogStreamBuf &) = delete;
+    LogStreamBuf &operator=(const LogStreamBuf &) = delete;
+
+    /** message, valid after sync_long() if longer than the inline buffer */
+    const char *data() const {
+        return overflowed ? longMessage.data() : buffer;
+    }
+    size_t size() const {
+        return overflowed ? longMessage.size() + (pptr() - pbase())
+                          : static_cast<size_t>(pptr() - pbase());
+    }
+    /** moves the rest of a long message from the buffer to the string */
+    void sync_long() {
+        if (overflowed) {
+            longMessage.append(pbase(), pptr() - pbase());
+            setp(buffer, buffer + INLINE_SIZE);
+        }
+    }
+
+  protected:
+    int_type overflow(int_type ch) override {
+        if (!overflowed) {
+            overflowed = true;
+            longMessage.reserve(2 * INLINE_SIZE);
+        }
+        longMessage.append(pbase(), pptr() - pbase());
+        setp(buffer, buffer + INLINE_SIZE);
+        if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(ch);
+            pbump(1);
+        }
+        return traits_type::not_eof(ch);
+    }
+
+  private:
+    char buffer[INLINE_SIZE];
+    bool overflowed{false};
+    std::string longMessage;
+};
+
+/**
+ * Receives the formatted messages instead of std::clog when set, e.g. by
+ * AsyncLogger. header is the length of the color, time stamp and level
+ * prefix. Returns false if the message should be written synchronously.
+ */
+using LogSink = bool (*)(TLogLevel level, const char *msg, size_t size,
+                         size_t header);
+
 class Logger {
-    std::ostringstream os;
+    LogStreamBuf buf;
+    std::ostream os{&buf};
     TLogLevel level = LOG_MAX_REPORTING_LEVEL;
+    size_t header{0};
 
   public:
     Logger() = default;
@@ -48,7 +112,12 @@ class Logger {
     ~Logger() {
         // output in the destructor to allow for << syntax
         os << RESET << '\n';
-        std::clog << os.str() << std::flush; // Single write
+        buf.sync_long();
+        LogSink sink = Sink().load(std::memory_order_acquire);
+        if (sink == nullptr || !sink(level, buf.data(), buf.size(), header)) {
+            std::clog.write(buf.data(), buf.size()); // Single write
+            std::clog.flush();
+        }
     }
 
     static TLogLevel &ReportingLevel() { // singelton eeh
@@ -56,6 +125,12 @@ class Logger {
         return reportingLevel;
     }
 
+    /** asynchronous backend, nullptr for synchronous output to std::clog */
+    static std::atomic<LogSink> &Sink() {
+        static std::atomic<LogSink> sink{nullptr};
+        return sink;
+    }
+
     // Danger this buffer need as many elements as TLogLevel
     static const char *Color(TLogLevel level) noexcept {
         static const char *const colors[] = {
@@ -64,35 +139,51 @@ class Logger {
         return colors[level];
     }
 
+    static std::string ToString(TLogLevel level) { return LevelName(level); }
+
     // Danger this buffer need as many elements as TLogLevel
-    static std::string ToString(TLogLevel level) {
+    static const char *LevelName(TLogLevel level) noexcept {
         static const char *const buffer[] = {
             "ERROR", "WARNING", "INFO",   "INFO",   "INFO",   "INFO",
             "DEBUG", "DEBUG1",  "DEBUG2", "DEBUG3", "DEBUG4", "DEBUG5"};
         return buffer[level];
     }
 
-    std::ostringstream &Get() {
-        os << Color(level) << "- " << Timestamp() << " " << ToString(level)
-           << ": ";
+    std::ostream &Get() {
+        char ts[TIMESTAMP_LEN];
+        Timestamp(ts);
+        os << Color(level) << "- " << ts << " " << LevelName(level) << ": ";
+        header = buf.size();
         return os;
     }
 
-    static std::string Timestamp() {
-        constexpr size_t buffer_len = 12;
-        char buffer[buffer_len];
-        time_t t;
-        ::time(&t);
-        tm r;
-        strftime(buffer, buffer_len, "%X", localtime_r(&t, &r));
-        buffer[buffer_len - 1] = '\0';
+    static constexpr size_t TIMESTAMP_LEN = 32;
+
+    /**
+     * Writes HH:MM:SS.mmm to result. The local time of the second is cached
+     * per thread, so that localtime_r is called at most once a second.
+     */
+    static void Timestamp(char (&result)[TIMESTAMP_LEN]) {
         struct timeval tv;
         gettimeofday(&tv, nullptr);
-        constexpr size_t result_len = 100;
-        char result[result_len];
-        snprintf(result, result_len, "%s.%03ld", buffer,
+        static thread_local time_t cachedSecond = -1;
+        static thread_local char cachedTime[12];
+        if (tv.tv_sec != cachedSecond) {
+            time_t t = tv.tv_sec;
+            tm r;
+            if (strftime(cachedTime, sizeof(cachedTime), "%X",
+                         localtime_r(&t, &r)) == 0) {
+                cachedTime[0] = '\0';
+            }
+            cachedSecond = tv.tv_sec;
+        }
+        snprintf(result, TIMESTAMP_LEN, "%s.%03ld", cachedTime,
                  (long)tv.tv_usec / 1000);
-        result[result_len - 1] = '\0';
+    }
+
+    static std::string Timestamp() {
+        char result[TIMESTAMP_LEN];
+        Timestamp(result);
         return result;
     }
 };
@@ -2,14 +2,14 @@
 // Copyright (C) 2021 Contributors to the SLS Detector Package
 /** API versions */
 #define GITBRANCH "developer"
-#define APILIB 0x211125
 #define APIRECEIVER 0x211124
 #define APIGUI 0x211124
 
-#define APICTB 0x220203
-#define APIGOTTHARD 0x220203
-#define APIGOTTHARD2 0x220203
-#define APIJUNGFRAU 0x220203
-#define APIMYTHEN3 0x220203
-#define APIMOENCH 0x220202
-#define APIEIGER 0x220203
+#define APILIB 0x261019
+#define APICTB 0x261019
+#define APIMOENCH 0x261019
+#define APIMYTHEN3 0x261019
+#define APIJUNGFRAU 0x261019
+#define APIEIGER 0x261019
+#define APIGOTTHARD 0x261019
+#define APIGOTTHARD2 0x261019
@@ -0,0 +1,365 @@
+// SPDX-License-Identifier: LGPL-3.0-or-other
+// Copyright (C) 2021 Contributors to the SLS Detector Package
+#include "sls/AsyncLogger.h"
+#include "sls/logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <time.h>
+#include <vector>
+
+namespace sls {
+
+namespace {
+
+/** longer messages are copied to the heap */
+constexpr size_t RECORD_TEXT_SIZE = 256;
+constexpr size_t RATE_TABLE_SIZE = 64;
+constexpr size_t BATCH_SIZE = 64 * 1024;
+
+struct LogRecord {
+    uint64_t time; // CLOCK_MONOTONIC in ns, to merge the threads in order
+    uint32_t size;
+    char text[RECORD_TEXT_SIZE];
+    std::string longText; // messages longer than RECORD_TEXT_SIZE
+
+    const char *Text() const {
+        return size > RECORD_TEXT_SIZE ? longText.data() : text;
+    }
+};
+
+uint64_t MonotonicNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+/** FNV-1a of the message without its time stamp */
+uint64_t MessageHash(const char *msg, size_t size) {
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; ++i) {
+        h ^= static_cast<unsigned char>(msg[i]);
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+/** single producer (the logging thread), single consumer (the flusher) */
+class LogRing {
+  public:
+    LogRing(size_t n, uint64_t gen) : generation(gen) {
+        size_t capacity = 1;
+        while (capacity < n)
+            capacity <<= 1;
+        records.resize(capacity);
+        mask = capacity - 1;
+    }
+
+    bool Push(const char *msg, size_t size, uint64_t time) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) > mask)
+            return false;
+        LogRecord &r = records[h & mask];
+        r.time = time;
+        if (size <= RECORD_TEXT_SIZE)
+            memcpy(r.text, msg, size);
+        else
+            r.longText.assign(msg, size);
+        r.size = size;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** oldest record or nullptr if empty */
+    const LogRecord *Front() const {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire))
+            return nullptr;
+        return &records[t & mask];
+    }
+
+    size_t Capacity() const { return mask + 1; }
+
+    void PopFront() {
+        size_t t = tail.load(std::memory_order_relaxed);
+        // the slot belongs to the consumer until the tail moves
+        std::string().swap(records[t & mask].longText);
+        tail.store(t + 1, std::memory_order_release);
+    }
+
+    const uint64_t generation;
+    /** set when the thread exits, removed by the flusher once empty */
+    std::atomic<bool> orphaned{false};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> suppressed{0};
+
+    // rate limiting, only used by the producer
+    struct rateEntry {
+        uint64_t hash{0};
+        uint64_t windowStart{0};
+        int count{0};
+    };
+    rateEntry rates[RATE_TABLE_SIZE];
+
+  private:
+    std::vector<LogRecord> records;
+    size_t mask{0};
+    alignas(64) std::atomic<size_t> head{0};
+    alignas(64) std::atomic<size_t> tail{0};
+};
+
+struct Backend {
+    std::mutex mtx; // rings and flush requests
+    std::condition_variable cv;
+    std::condition_variable flushed;
+    std::vector<std::shared_ptr<LogRing>> rings;
+    std::thread flusher;
+    AsyncLogConfig config;
+    std::atomic<bool> running{false};
+    /** cleared first on Stop, later messages are written synchronously */
+    std::atomic<bool> accepting{false};
+    /** threads inside AsyncSink, Stop waits for them before the last drain */
+    std::atomic<int> writers{0};
+    std::atomic<uint64_t> generation{0};
+    uint64_t flushRequests{0};
+    uint64_t flushesDone{0};
+    std::atomic<uint64_t> totalDropped{0};
+    std::atomic<uint64_t> totalSuppressed{0};
+    std::string batch;
+};
+
+Backend &GetBackend() {
+    static Backend backend;
+    return backend;
+}
+
+/** ring of the calling thread, marked orphaned at thread exit */
+struct ThreadRing {
+    std::shared_ptr<LogRing> ring;
+    ~ThreadRing() {
+        if (ring)
+            ring->orphaned = true;
+    }
+};
+
+LogRing *GetThreadRing(Backend &b) {
+    static thread_local ThreadRing tr;
+    uint64_t gen = b.generation.load(std::memory_order_acquire);
+    if (!tr.ring || tr.ring->generation != gen) {
+        if (tr.ring)
+            tr.ring->orphaned = true;
+        tr.ring =
+            std::make_shared<LogRing>(b.config.recordsPerThread, gen);
+        std::lock_guard<std::mutex> lock(b.mtx);
+        b.rings.push_back(tr.ring);
+    }
+    return tr.ring.get();
+}
+
+/** true if the message is a repetition beyond the allowed rate */
+bool RateLimited(const Backend &b, LogRing &ring, const char *body,
+                 size_t size, uint64_t now) {
+    if (b.config.rateWindow.count() == 0)
+        return false;
+    uint64_t window =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            b.config.rateWindow)
+            .count();
+    uint64_t hash = MessageHash(body, size);
+    auto &e = ring.rates[hash % RATE_TABLE_SIZE];
+    if (e.hash != hash || now - e.windowStart >= window) {
+        e.hash = hash;
+        e.windowStart = now;
+        e.count = 1;
+        return false;
+    }
+    if (++e.count <= b.config.maxRepeats)
+        return false;
+    ring.suppressed.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool AsyncSink(TLogLevel level, const char *msg, size_t size,
+               size_t header) {
+    Backend &b = GetBackend();
+    b.writers.fetch_add(1);
+    if (!b.accepting.load()) {
+        b.writers.fetch_sub(1);
+        return false;
+    }
+    LogRing *ring = GetThreadRing(b);
+    uint64_t now = MonotonicNs();
+    if (!RateLimited(b, *ring, msg + header, size - header, now)) {
+        if (!ring->Push(msg, size, now))
+            ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        else if (level == logERROR)
+            b.cv.notify_one();
+    }
+    b.writers.fetch_sub(1);
+    return true;
+}
+
+void AppendNotice(std::string &batch, uint64_t n, const char *what) {
+    char ts[Logger::TIMESTAMP_LEN];
+    Logger::Timestamp(ts);
+    batch += Logger::Color(logWARNING);
+    batch += "- ";
+    batch += ts;
+    batch += " WARNING: ";
+    batch += std::to_string(n);
+    batch += what;
+    batch += RESET "\n";
+}
+
+/** writes the buffered records of all the threads in time order */
+void Drain(Backend &b) {
+    std::vector<std::shared_ptr<LogRing>> rings;
+    {
+        std::lock_guard<std::mutex> lock(b.mtx);
+        rings = b.rings;
+    }
+    // records logged meanwhile wait for the next cycle
+    size_t budget = 0;
+    for (auto &r : rings)
+        budget += r->Capacity();
+    b.batch.clear();
+    for (; budget != 0; --budget) {
+        LogRing *oldest = nullptr;
+        const LogRecord *record = nullptr;
+        for (auto &r : rings) {
+            const LogRecord *f = r->Front();
+            if (f != nullptr && (record == nullptr || f->time < record->time)) {
+                oldest = r.get();
+                record = f;
+            }
+        }
+        if (record == nullptr)
+            break;
+        b.batch.append(record->Text(), record->size);
+        oldest->PopFront();
+        if (b.batch.size() > BATCH_SIZE) {
+            std::clog.write(b.batch.data(), b.batch.size());
+            b.batch.clear();
+        }
+    }
+
+    uint64_t dropped = 0, suppressed = 0;
+    for (auto &r : rings) {
+        dropped += r->dropped.exchange(0, std::memory_order_relaxed);
+        suppressed += r->suppressed.exchange(0, std::memory_order_relaxed);
+    }
+    if (dropped != 0) {
+        b.totalDropped += dropped;
+        AppendNotice(b.batch, dropped,
+                     " log messages dropped (log buffer full)");
+    }
+    if (suppressed != 0) {
+        b.totalSuppressed += suppressed;
+        AppendNotice(b.batch, suppressed, " repeated log messages suppressed");
+    }
+    if (!b.batch.empty()) {
+        std::clog.write(b.batch.data(), b.batch.size());
+        std::clog.flush();
+    }
+
+    // rings of finished threads
+    std::lock_guard<std::mutex> lock(b.mtx);
+    b.rings.erase(std::remove_if(b.rings.begin(), b.rings.end(),
+                                 [](const std::shared_ptr<LogRing> &r) {
+                                     return r->orphaned && !r->Front();
+                                 }),
+                  b.rings.end());
+}
+
+void FlusherThread() {
+    Backend &b = GetBackend();
+    while (true) {
+        uint64_t requests = 0;
+        bool stop = false;
+        {
+            std::unique_lock<std::mutex> lock(b.mtx);
+            b.cv.wait_for(lock, b.config.flushInterval, [&b] {
+                return b.flushRequests != b.flushesDone ||
+                       !b.running.load();
+            });
+            requests = b.flushRequests;
+            stop = !b.running.load();
+        }
+        Drain(b);
+        {
+            std::lock_guard<std::mutex> lock(b.mtx);
+            b.flushesDone = requests;
+        }
+        b.flushed.notify_all();
+        if (stop)
+            break;
+    }
+}
+
+} // namespace
+
+void AsyncLogger::Start(const AsyncLogConfig &config) {
+    Backend &b = GetBackend();
+    if (b.running)
+        return;
+    static std::once_flag atExit;
+    std::call_once(atExit, [] { std::atexit(AsyncLogger::Stop); });
+    b.config = config;
+    if (b.config.recordsPerThread == 0)
+        b.config.recordsPerThread = 1;
+    b.generation++;
+    b.running = true;
+    b.accepting = true;
+    b.flusher = std::thread(FlusherThread);
+    Logger::Sink().store(AsyncSink, std::memory_order_release);
+}
+
+void AsyncLogger::Stop() {
+    Backend &b = GetBackend();
+    if (!b.running)
+        return;
+    Logger::Sink().store(nullptr, std::memory_order_release);
+    // messages already in the sink are buffered before the last drain
+    b.accepting = false;
+    while (b.writers.load() != 0)
+        std::this_thread::yield();
+    {
+        std::lock_guard<std::mutex> lock(b.mtx);
+        b.running = false;
+    }
+    b.cv.notify_one();
+    b.flusher.join();
+    std::lock_guard<std::mutex> lock(b.mtx);
+    b.rings.clear();
+}
+
+void AsyncLogger::Flush() {
+    Backend &b = GetBackend();
+    std::unique_lock<std::mutex> lock(b.mtx);
+    if (!b.running)
+        return;
+    uint64_t request = ++b.flushRequests;
+    b.cv.notify_one();
+    b.flushed.wait(lock, [&b, request] {
+        return b.flushesDone >= request || !b.running;
+    });
+}
+
+bool AsyncLogger::IsRunning() { return GetBackend().running; }
+
+uint64_t AsyncLogger::GetNumberOfDropped() {
+    return GetBackend().totalDropped;
+}
+
+uint64_t AsyncLogger::GetNumberOfSuppressed() {
+    return GetBackend().totalSuppressed;
+}
+
+} // namespace sls
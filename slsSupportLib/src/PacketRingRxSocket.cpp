@@ -0,0 +1,297 @@
+// SPDX-License-Identifier: LGPL-3.0-or-other
+// Copyright (C) 2021 Contributors to the SLS Detector Package
+#include "sls/PacketRingRxSocket.h"
+#include "sls/logger.h"
+#include "sls/sls_detector_exceptions.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <linux/filter.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+namespace sls {
+
+namespace {
+/**
+ * IPv4, not fragmented, UDP to port, not sent by this host (loopback shows
+ * packets twice). Offsets from the IP header (SOCK_DGRAM)
+ */
+std::vector<sock_filter> UdpPortFilter(uint16_t port) {
+    return {
+        {BPF_LD | BPF_W | BPF_ABS, 0, 0,
+         static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_PKTTYPE)},
+        {BPF_JMP | BPF_JEQ | BPF_K, 11, 0, PACKET_OUTGOING},
+        {BPF_LD | BPF_B | BPF_ABS, 0, 0, 0},
+        {BPF_ALU | BPF_AND | BPF_K, 0, 0, 0xf0},
+        {BPF_JMP | BPF_JEQ | BPF_K, 0, 8, 0x40},
+        {BPF_LD | BPF_B | BPF_ABS, 0, 0, 9},
+        {BPF_JMP | BPF_JEQ | BPF_K, 0, 6, IPPROTO_UDP},
+        {BPF_LD | BPF_H | BPF_ABS, 0, 0, 6},
+        {BPF_JMP | BPF_JSET | BPF_K, 4, 0, 0x3fff},
+        {BPF_LDX | BPF_B | BPF_MSH, 0, 0, 0},
+        {BPF_LD | BPF_H | BPF_IND, 0, 0, 2},
+        {BPF_JMP | BPF_JEQ | BPF_K, 0, 1, port},
+        {BPF_RET | BPF_K, 0, 0, 0x40000},
+        {BPF_RET | BPF_K, 0, 0, 0},
+    };
+}
+
+/**
+ * UDP socket bound to the port, the packets are taken by the ring. A
+ * filter dropping everything keeps them out of its buffer
+ * @returns socket or -1 if the port could not be bound
+ */
+int HoldUdpPort(uint16_t port) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd == -1) {
+        return -1;
+    }
+    sock_filter drop{BPF_RET | BPF_K, 0, 0, 0};
+    sock_fprog prog{};
+    prog.len = 1;
+    prog.filter = &drop;
+    int size = 0;
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) ==
+            -1 ||
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size)) == -1 ||
+        bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == -1) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    return fd;
+}
+} // namespace
+
+constexpr size_t PacketRingRxSocket::DEFAULT_BLOCK_SIZE;
+constexpr size_t PacketRingRxSocket::MIN_NUM_BLOCKS;
+
+PacketRingRxSocket::PacketRingRxSocket(int port, ssize_t packet_size,
+                                       const std::string &interface,
+                                       size_t ring_size)
+    : packet_size_(packet_size) {
+    int ifindex = 0;
+    if (!interface.empty()) {
+        ifindex = if_nametoindex(interface.c_str());
+        if (ifindex == 0) {
+            throw RuntimeError("Unknown network interface " + interface);
+        }
+    }
+
+    // no protocol yet: nothing is captured before the filter is attached
+    sockfd_ = socket(AF_PACKET, SOCK_DGRAM, 0);
+    if (sockfd_ == -1) {
+        throw RuntimeError("Failed to create packet socket (needs "
+                           "CAP_NET_RAW): " +
+                           std::string(strerror(errno)));
+    }
+    try {
+        wakefd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (wakefd_ == -1) {
+            throw RuntimeError("Failed to create eventfd for packet ring");
+        }
+
+        int version = TPACKET_V3;
+        if (setsockopt(sockfd_, SOL_PACKET, PACKET_VERSION, &version,
+                       sizeof(version)) == -1) {
+            throw RuntimeError("Failed to set TPACKET_V3");
+        }
+
+        auto filter = UdpPortFilter(static_cast<uint16_t>(port));
+        sock_fprog prog{};
+        prog.len = static_cast<unsigned short>(filter.size());
+        prog.filter = filter.data();
+        if (setsockopt(sockfd_, SOL_SOCKET, SO_ATTACH_FILTER, &prog,
+                       sizeof(prog)) == -1) {
+            throw RuntimeError("Failed to attach udp port filter");
+        }
+
+        block_size_ = DEFAULT_BLOCK_SIZE;
+        num_blocks_ = std::max(MIN_NUM_BLOCKS,
+                               (ring_size + block_size_ - 1) / block_size_);
+        ring_size_ = block_size_ * num_blocks_;
+        tpacket_req3 req{};
+        req.tp_block_size = block_size_;
+        req.tp_block_nr = num_blocks_;
+        req.tp_frame_size = block_size_;
+        req.tp_frame_nr = num_blocks_;
+        req.tp_retire_blk_tov = BLOCK_TIMEOUT_MS;
+        if (setsockopt(sockfd_, SOL_PACKET, PACKET_RX_RING, &req,
+                       sizeof(req)) == -1) {
+            throw RuntimeError("Failed to create packet ring of " +
+                               std::to_string(ring_size_) + " bytes");
+        }
+
+        void *p = mmap(nullptr, ring_size_, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, sockfd_, 0);
+        if (p == MAP_FAILED) {
+            throw RuntimeError("Failed to map packet ring");
+        }
+        ring_ = static_cast<char *>(p);
+
+        sockaddr_ll addr{};
+        addr.sll_family = AF_PACKET;
+        addr.sll_protocol = htons(ETH_P_IP);
+        addr.sll_ifindex = ifindex;
+        if (bind(sockfd_, reinterpret_cast<sockaddr *>(&addr),
+                 sizeof(addr)) == -1) {
+            throw RuntimeError("Failed to bind packet socket");
+        }
+
+        portfd_ = HoldUdpPort(static_cast<uint16_t>(port));
+        if (portfd_ == -1) {
+            LOG(logWARNING) << "Could not bind udp port " << port
+                            << " next to the packet ring: "
+                            << strerror(errno)
+                            << ". Unless an other socket holds it, every "
+                               "packet is answered with port unreachable";
+        }
+    } catch (...) {
+        if (ring_ != nullptr) {
+            munmap(ring_, ring_size_);
+        }
+        if (wakefd_ != -1) {
+            close(wakefd_);
+        }
+        close(sockfd_);
+        throw;
+    }
+}
+
+PacketRingRxSocket::~PacketRingRxSocket() {
+    Shutdown();
+    if (ring_ != nullptr) {
+        munmap(ring_, ring_size_);
+    }
+    if (portfd_ != -1) {
+        close(portfd_);
+    }
+    close(sockfd_);
+    close(wakefd_);
+}
+
+size_t PacketRingRxSocket::getRingSize() const noexcept { return ring_size_; }
+
+ssize_t PacketRingRxSocket::getPacketSize() const noexcept {
+    return packet_size_;
+}
+
+uint64_t PacketRingRxSocket::getNumberOfSyscalls() const noexcept {
+    return num_syscalls_;
+}
+
+uint64_t PacketRingRxSocket::getNumberOfDropped() {
+    // reading the statistics resets them
+    tpacket_stats_v3 stats{};
+    socklen_t len = sizeof(stats);
+    if (getsockopt(sockfd_, SOL_PACKET, PACKET_STATISTICS, &stats, &len) ==
+        0) {
+        num_dropped_ += stats.tp_drops;
+    }
+    return num_dropped_;
+}
+
+void PacketRingRxSocket::ReleaseBlock() noexcept {
+    auto *block = reinterpret_cast<tpacket_block_desc *>(
+        ring_ + block_index_ * block_size_);
+    __atomic_store_n(&block->hdr.bh1.block_status, TP_STATUS_KERNEL,
+                     __ATOMIC_RELEASE);
+    block_index_ = (block_index_ + 1) % num_blocks_;
+    packet_ = nullptr;
+}
+
+const char *PacketRingRxSocket::NextPacket(ssize_t &size) noexcept {
+    if (packet_ != nullptr && packets_left_ == 0) {
+        ReleaseBlock();
+    }
+    while (packet_ == nullptr) {
+        if (shutdown_) {
+            return nullptr;
+        }
+        auto *block = reinterpret_cast<tpacket_block_desc *>(
+            ring_ + block_index_ * block_size_);
+        if ((__atomic_load_n(&block->hdr.bh1.block_status,
+                             __ATOMIC_ACQUIRE) &
+             TP_STATUS_USER) == 0) {
+            pollfd pfd[2]{{sockfd_, POLLIN | POLLERR, 0},
+                          {wakefd_, POLLIN, 0}};
+            ++num_syscalls_;
+            poll(pfd, 2, POLL_TIMEOUT_MS);
+            continue;
+        }
+        packets_left_ = block->hdr.bh1.num_pkts;
+        packet_ = reinterpret_cast<char *>(block) +
+                  block->hdr.bh1.offset_to_first_pkt;
+        if (packets_left_ == 0) {
+            ReleaseBlock();
+        }
+    }
+
+    auto *hdr = reinterpret_cast<tpacket3_hdr *>(packet_);
+    const char *ip = packet_ + hdr->tp_net;
+    const uint32_t ihl = (ip[0] & 0xf) * 4;
+    uint16_t udp_len = 0;
+    memcpy(&udp_len, ip + ihl + 4, sizeof(udp_len));
+    size = static_cast<ssize_t>(ntohs(udp_len)) - 8;
+    // truncated by the ring
+    size = std::min(size, static_cast<ssize_t>(hdr->tp_snaplen) -
+                              static_cast<ssize_t>(ihl) - 8);
+    size = std::max(size, ssize_t(0));
+
+    --packets_left_;
+    packet_ += hdr->tp_next_offset;
+    return ip + ihl + 8;
+}
+
+bool PacketRingRxSocket::ReceivePacket(char *dst) noexcept {
+    return ReceiveDataOnly(dst) == packet_size_;
+}
+
+ssize_t PacketRingRxSocket::ReceiveDataOnly(char *dst) noexcept {
+    ssize_t size = 0;
+    const char *data = NextPacket(size);
+    constexpr ssize_t eiger_header_packet = 40; // only detector that has this
+    if (data != nullptr && size == eiger_header_packet) {
+        LOG(logWARNING) << "Got header pkg";
+        data = NextPacket(size);
+    }
+    // temporary workaround for Eiger firmware (stop sends bad packets of size 8
+    // bytes)
+    if (data != nullptr && size == 8) {
+        LOG(logWARNING) << "Ignoring bad packet of size 8 bytes";
+        data = NextPacket(size);
+    }
+    if (data == nullptr) {
+        return -1;
+    }
+    size = std::min(size, packet_size_);
+    memcpy(dst, data, size);
+    return size;
+}
+
+void PacketRingRxSocket::Shutdown() {
+    if (!shutdown_.exchange(true)) {
+        uint64_t one = 1;
+        if (write(wakefd_, &one, sizeof(one)) != sizeof(one)) {
+            LOG(logWARNING) << "Could not wake up the packet ring reader";
+        }
+    }
+}
+
+} // namespace sls
@@ -0,0 +1,268 @@
+// SPDX-License-Identifier: LGPL-3.0-or-other
+// Copyright (C) 2021 Contributors to the SLS Detector Package
+#include "sls/RawFileIndex.h"
+#include "sls/sls_detector_exceptions.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <fcntl.h>
+#include <thread>
+#include <unistd.h>
+
+namespace sls {
+
+std::string FrameIndexFileName(const std::string &rawFileName) {
+    auto dot = rawFileName.find_last_of('.');
+    auto slash = rawFileName.find_last_of('/');
+    if (dot == std::string::npos ||
+        (slash != std::string::npos && dot < slash)) {
+        return rawFileName + ".idx";
+    }
+    return rawFileName.substr(0, dot) + ".idx";
+}
+
+FrameIndexWriter::~FrameIndexWriter() {
+    try {
+        Close();
+    } catch (const RuntimeError &) {
+        // nothing to do with the error in a destructor
+    }
+}
+
+void FrameIndexWriter::Open(const std::string &fname,
+                            uint32_t packetsPerFrame, bool overWriteEnable) {
+    Close();
+    fname_ = fname;
+    fd_ = fopen(fname.c_str(), overWriteEnable ? "w" : "wx");
+    if (fd_ == nullptr) {
+        throw RuntimeError("Could not create frame index file " + fname);
+    }
+    FrameIndexHeader header{};
+    memcpy(header.magic, FRAME_INDEX_MAGIC, sizeof(header.magic));
+    header.version = FRAME_INDEX_VERSION;
+    header.entrySize = sizeof(FrameIndexEntry);
+    header.packetsPerFrame = packetsPerFrame;
+    if (fwrite(&header, sizeof(header), 1, fd_) != 1) {
+        throw RuntimeError("Could not write frame index file " + fname);
+    }
+    batch_.reserve(BATCH_SIZE);
+}
+
+void FrameIndexWriter::Add(const FrameIndexEntry &entry) {
+    batch_.push_back(entry);
+    if (batch_.size() == BATCH_SIZE) {
+        Flush();
+    }
+}
+
+void FrameIndexWriter::Flush() {
+    if (fd_ && !batch_.empty()) {
+        bool ok = fwrite(batch_.data(), sizeof(FrameIndexEntry),
+                         batch_.size(), fd_) == batch_.size();
+        batch_.clear();
+        if (!ok || fflush(fd_) != 0) {
+            throw RuntimeError("Could not write frame index file " + fname_);
+        }
+    }
+}
+
+void FrameIndexWriter::Close() {
+    if (fd_) {
+        try {
+            Flush();
+        } catch (const RuntimeError &) {
+            fclose(fd_);
+            fd_ = nullptr;
+            throw;
+        }
+        fclose(fd_);
+        fd_ = nullptr;
+    }
+}
+
+RawFileReader::RawFileReader(const std::vector<std::string> &rawFiles) {
+    if (rawFiles.size() > UINT16_MAX) {
+        throw RuntimeError("Too many raw files");
+    }
+    try {
+        for (size_t i = 0; i < rawFiles.size(); ++i) {
+            int fd = open(rawFiles[i].c_str(), O_RDONLY);
+            if (fd < 0) {
+                throw RuntimeError("Could not open raw file " + rawFiles[i]);
+            }
+            fds_.push_back(fd);
+            LoadIndex(rawFiles[i], static_cast<uint16_t>(i));
+        }
+    } catch (...) {
+        for (auto fd : fds_) {
+            close(fd);
+        }
+        throw;
+    }
+    for (size_t i = 1; i < entries_.size() && consecutive_; ++i) {
+        consecutive_ =
+            entries_[i].frameNumber == entries_[0].frameNumber + i;
+    }
+    if (!consecutive_) {
+        positions_.reserve(entries_.size());
+        for (size_t i = 0; i < entries_.size(); ++i) {
+            // the first record of a frame number wins
+            positions_.emplace(entries_[i].frameNumber, i);
+        }
+    }
+}
+
+RawFileReader::~RawFileReader() {
+    for (auto fd : fds_) {
+        close(fd);
+    }
+}
+
+void RawFileReader::LoadIndex(const std::string &rawFile, uint16_t file) {
+    std::string fname = FrameIndexFileName(rawFile);
+    FILE *fd = fopen(fname.c_str(), "r");
+    if (fd == nullptr) {
+        throw RuntimeError("Could not open frame index file " + fname);
+    }
+    FrameIndexHeader header{};
+    if (fread(&header, sizeof(header), 1, fd) != 1 ||
+        memcmp(header.magic, FRAME_INDEX_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != FRAME_INDEX_VERSION ||
+        header.entrySize != sizeof(FrameIndexEntry)) {
+        fclose(fd);
+        throw RuntimeError("Not a frame index file " + fname);
+    }
+    if (file == 0) {
+        packetsPerFrame_ = header.packetsPerFrame;
+    } else if (header.packetsPerFrame != packetsPerFrame_) {
+        fclose(fd);
+        throw RuntimeError("Packets per frame differ in " + fname);
+    }
+    FrameIndexEntry batch[1024];
+    size_t n = 0;
+    while ((n = fread(batch, sizeof(FrameIndexEntry), 1024, fd)) > 0) {
+        for (size_t i = 0; i < n; ++i) {
+            entries_.push_back(batch[i]);
+            fileOf_.push_back(file);
+            maxFrameSize_ = std::max(maxFrameSize_, batch[i].size);
+        }
+    }
+    fclose(fd);
+}
+
+bool RawFileReader::IsComplete(size_t i) const {
+    return entries_.at(i).packets == packetsPerFrame_;
+}
+
+std::vector<size_t> RawFileReader::CompleteFrames() const {
+    std::vector<size_t> result;
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        if (entries_[i].packets == packetsPerFrame_) {
+            result.push_back(i);
+        }
+    }
+    return result;
+}
+
+int64_t RawFileReader::Find(uint64_t frameNumber) const {
+    if (entries_.empty()) {
+        return -1;
+    }
+    if (consecutive_) {
+        uint64_t first = entries_.front().frameNumber;
+        if (frameNumber < first || frameNumber - first >= entries_.size()) {
+            return -1;
+        }
+        return static_cast<int64_t>(frameNumber - first);
+    }
+    auto it = positions_.find(frameNumber);
+    return it == positions_.end() ? -1 : static_cast<int64_t>(it->second);
+}
+
+void RawFileReader::Read(size_t i, char *buffer) const {
+    const FrameIndexEntry &entry = entries_.at(i);
+    int fd = fds_[fileOf_[i]];
+    size_t done = 0;
+    while (done < entry.size) {
+        ssize_t n = pread(fd, buffer + done, entry.size - done,
+                          static_cast<off_t>(entry.offset + done));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            throw RuntimeError("Could not read frame " +
+                               std::to_string(entry.frameNumber) +
+                               " from raw file");
+        }
+        done += static_cast<size_t>(n);
+    }
+}
+
+template <typename F>
+void RawFileReader::ParallelFor(size_t count, int nthreads, F &&f) const {
+    if (count == 0) {
+        return;
+    }
+    if (nthreads <= 0) {
+        nthreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    nthreads = static_cast<int>(std::min(count, static_cast<size_t>(nthreads)));
+    // contiguous ranges, so that each thread reads forward
+    std::vector<std::thread> threads;
+    std::vector<std::exception_ptr> errors(nthreads);
+    const size_t step = count / nthreads;
+    const size_t rest = count % nthreads;
+    size_t begin = 0;
+    for (int t = 0; t < nthreads; ++t) {
+        size_t end = begin + step + (static_cast<size_t>(t) < rest ? 1 : 0);
+        threads.emplace_back([&f, &errors, t, begin, end] {
+            try {
+                for (size_t k = begin; k < end; ++k) {
+                    f(k);
+                }
+            } catch (...) {
+                errors[t] = std::current_exception();
+            }
+        });
+        begin = end;
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    for (auto &e : errors) {
+        if (e) {
+            std::rethrow_exception(e);
+        }
+    }
+}
+
+void RawFileReader::ReadRange(size_t first, size_t count, char *buffer,
+                              size_t stride, int nthreads) const {
+    if (first + count > entries_.size() || first + count < first) {
+        throw RuntimeError("Frame range out of the files");
+    }
+    if (stride < maxFrameSize_) {
+        throw RuntimeError("Stride smaller than the frame size");
+    }
+    ParallelFor(count, nthreads,
+                [&](size_t k) { Read(first + k, buffer + k * stride); });
+}
+
+void RawFileReader::ReadFrames(const std::vector<size_t> &positions,
+                               char *buffer, size_t stride,
+                               int nthreads) const {
+    for (auto i : positions) {
+        if (i >= entries_.size()) {
+            throw RuntimeError("Frame position out of the files");
+        }
+    }
+    if (stride < maxFrameSize_) {
+        throw RuntimeError("Stride smaller than the frame size");
+    }
+    ParallelFor(positions.size(), nthreads,
+                [&](size_t k) { Read(positions[k], buffer + k * stride); });
+}
+
+} // namespace sls
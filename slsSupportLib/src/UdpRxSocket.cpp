@@ -7,6 +7,7 @@
 #include <cstdint>
 #include <errno.h>
 #include <iostream>
+#include <linux/filter.h>
 #include <netdb.h>
 #include <netinet/in.h>
 #include <string.h>
@@ -16,7 +17,7 @@
 namespace sls {
 
 UdpRxSocket::UdpRxSocket(int port, ssize_t packet_size, const char *hostname,
-                         int kernel_buffer_size)
+                         int kernel_buffer_size, bool reuse_port)
     : packet_size_(packet_size) {
     struct addrinfo hints;
     memset(&hints, 0, sizeof(hints));
@@ -35,6 +36,13 @@ UdpRxSocket::UdpRxSocket(int port, ssize_t packet_size, const char *hostname,
     if (sockfd_ == -1) {
         throw RuntimeError("Failed to create UDP RX socket");
     }
+    if (reuse_port) {
+        int enable = 1;
+        if (setsockopt(sockfd_, SOL_SOCKET, SO_REUSEPORT, &enable,
+                       sizeof(enable)) == -1) {
+            throw RuntimeError("Failed to set SO_REUSEPORT on UDP RX socket");
+        }
+    }
     if (bind(sockfd_, res->ai_addr, res->ai_addrlen) == -1) {
         throw RuntimeError("Failed to bind UDP RX socket");
     }
@@ -59,28 +67,67 @@ UdpRxSocket::UdpRxSocket(int port, ssize_t packet_size, const char *hostname,
 UdpRxSocket::~UdpRxSocket() { Shutdown(); }
 ssize_t UdpRxSocket::getPacketSize() const noexcept { return packet_size_; }
 
+uint64_t UdpRxSocket::getNumberOfSyscalls() const noexcept {
+    return num_syscalls_;
+}
+
 bool UdpRxSocket::ReceivePacket(char *dst) noexcept {
+    ++num_syscalls_;
     auto bytes_received =
         recvfrom(sockfd_, dst, packet_size_, 0, nullptr, nullptr);
     return bytes_received == packet_size_;
 }
 
 ssize_t UdpRxSocket::ReceiveDataOnly(char *dst) noexcept {
+    ++num_syscalls_;
     auto r = recvfrom(sockfd_, dst, packet_size_, 0, nullptr, nullptr);
     constexpr ssize_t eiger_header_packet = 40; // only detector that has this
     if (r == eiger_header_packet) {
         LOG(logWARNING) << "Got header pkg";
+        ++num_syscalls_;
         r = recvfrom(sockfd_, dst, packet_size_, 0, nullptr, nullptr);
     }
     // temporary workaround for Eiger firmware (stop sends bad packets of size 8
     // bytes)
     if (r == 8) {
         LOG(logWARNING) << "Ignoring bad packet of size 8 bytes";
+        ++num_syscalls_;
         r = recvfrom(sockfd_, dst, packet_size_, 0, nullptr, nullptr);
     }
     return r;
 }
 
+void UdpRxSocket::setFrameNumberSteering(int num_sockets) {
+    // offsets from the udp payload, frame number is the first (little
+    // endian) field of the sls_detector_header, its low 32 bits are used
+    sock_filter code[] = {
+        {BPF_LD | BPF_B | BPF_ABS, 0, 0, 3},
+        {BPF_ALU | BPF_LSH | BPF_K, 0, 0, 8},
+        {BPF_MISC | BPF_TAX, 0, 0, 0},
+        {BPF_LD | BPF_B | BPF_ABS, 0, 0, 2},
+        {BPF_ALU | BPF_OR | BPF_X, 0, 0, 0},
+        {BPF_ALU | BPF_LSH | BPF_K, 0, 0, 8},
+        {BPF_MISC | BPF_TAX, 0, 0, 0},
+        {BPF_LD | BPF_B | BPF_ABS, 0, 0, 1},
+        {BPF_ALU | BPF_OR | BPF_X, 0, 0, 0},
+        {BPF_ALU | BPF_LSH | BPF_K, 0, 0, 8},
+        {BPF_MISC | BPF_TAX, 0, 0, 0},
+        {BPF_LD | BPF_B | BPF_ABS, 0, 0, 0},
+        {BPF_ALU | BPF_OR | BPF_X, 0, 0, 0},
+        {BPF_ALU | BPF_MOD | BPF_K, 0, 0,
+         static_cast<uint32_t>(num_sockets)},
+        {BPF_RET | BPF_A, 0, 0, 0},
+    };
+    sock_fprog prog{};
+    prog.len = sizeof(code) / sizeof(code[0]);
+    prog.filter = code;
+    if (setsockopt(sockfd_, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog,
+                   sizeof(prog)) == -1) {
+        throw RuntimeError("Could not attach frame number steering to UDP RX "
+                           "socket");
+    }
+}
+
 int UdpRxSocket::getBufferSize() const {
     int ret = 0;
     socklen_t optlen = sizeof(ret);
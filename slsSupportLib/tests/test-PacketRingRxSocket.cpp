@@ -0,0 +1,127 @@
+// SPDX-License-Identifier: LGPL-3.0-or-other
+// Copyright (C) 2021 Contributors to the SLS Detector Package
+#include "catch.hpp"
+#include "sls/PacketRingRxSocket.h"
+#include "sls/sls_detector_exceptions.h"
+#include <arpa/inet.h>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+constexpr int ring_port = 50002;
+
+// needs CAP_NET_RAW, nullptr otherwise
+std::unique_ptr<sls::PacketRingRxSocket> open_ring(ssize_t packet_size) {
+    try {
+        return std::unique_ptr<sls::PacketRingRxSocket>(
+            new sls::PacketRingRxSocket(ring_port, packet_size, "lo"));
+    } catch (const sls::RuntimeError &e) {
+        WARN("Skipping packet ring test: " << e.what());
+        return nullptr;
+    }
+}
+
+void send_to_ring(const void *data, size_t size, int port = ring_port) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    sendto(fd, data, size, 0, reinterpret_cast<sockaddr *>(&addr),
+           sizeof(addr));
+    close(fd);
+}
+
+bool can_bind_port(int port) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    bool ret =
+        bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0;
+    close(fd);
+    return ret;
+}
+
+} // namespace
+
+TEST_CASE("Receive packets of a port from the packet ring") {
+    std::vector<int> data_to_send{4, 5, 3, 2, 5, 7, 2, 3};
+    ssize_t packet_size = sizeof(int) * data_to_send.size();
+    auto s = open_ring(packet_size);
+    if (!s)
+        return;
+    CHECK(s->getPacketSize() == packet_size);
+    CHECK(s->getRingSize() >= sls::PacketRingRxSocket::MIN_NUM_BLOCKS *
+                                  sls::PacketRingRxSocket::DEFAULT_BLOCK_SIZE);
+
+    // other ports are filtered out in the kernel
+    int other = 1;
+    send_to_ring(&other, sizeof(other), ring_port + 1);
+    for (int i = 0; i != 3; ++i) {
+        data_to_send[0] = i;
+        send_to_ring(data_to_send.data(), packet_size);
+    }
+    std::vector<int> data_received(data_to_send.size());
+    for (int i = 0; i != 3; ++i) {
+        CHECK(s->ReceivePacket(reinterpret_cast<char *>(data_received.data())));
+        data_to_send[0] = i;
+        CHECK(data_received == data_to_send);
+    }
+}
+
+TEST_CASE("Too small packet from the packet ring") {
+    auto s = open_ring(2 * sizeof(uint32_t));
+    if (!s)
+        return;
+    uint32_t val = 10;
+    send_to_ring(&val, sizeof(val));
+    uint32_t buff[2];
+    CHECK(s->ReceivePacket(reinterpret_cast<char *>(&buff)) == false);
+    CHECK(buff[0] == val);
+}
+
+TEST_CASE("Shutdown packet ring without hanging when waiting for data") {
+    constexpr ssize_t packet_size = 8000;
+    auto s = open_ring(packet_size);
+    if (!s)
+        return;
+    std::vector<char> buff(packet_size);
+    std::future<bool> ret =
+        std::async(std::launch::async, &sls::PacketRingRxSocket::ReceivePacket,
+                   s.get(), buff.data());
+    // let the reader block in poll, the shutdown wakes it before the timeout
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    auto t0 = std::chrono::steady_clock::now();
+    s->Shutdown();
+    CHECK(ret.get() == false);
+    CHECK(std::chrono::steady_clock::now() - t0 <
+          std::chrono::milliseconds(
+              sls::PacketRingRxSocket::POLL_TIMEOUT_MS / 2));
+    // the socket stays open until destruction
+    CHECK(s->getNumberOfDropped() == 0);
+}
+
+TEST_CASE("Packet ring holds the udp port while it is open") {
+    auto s = open_ring(8000);
+    if (!s)
+        return;
+    // no port unreachable for the packets taken by the ring
+    CHECK_FALSE(can_bind_port(ring_port));
+    // the holding socket drops the packets, the ring gets them
+    int val = 3;
+    int buff[2]{};
+    send_to_ring(&val, sizeof(val));
+    CHECK(s->ReceivePacket(reinterpret_cast<char *>(&buff)) == false);
+    CHECK(buff[0] == val);
+    s.reset();
+    CHECK(can_bind_port(ring_port));
+}
@@ -0,0 +1,146 @@
+// SPDX-License-Identifier: LGPL-3.0-or-other
+// Copyright (C) 2021 Contributors to the SLS Detector Package
+#include "catch.hpp"
+#include "sls/RawFileIndex.h"
+#include "sls/sls_detector_exceptions.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace sls {
+
+namespace {
+
+constexpr uint32_t RECORD_SIZE = 200;
+constexpr uint32_t PACKETS = 4;
+
+// record of frame fnum, every byte set from the frame number
+void writeFrame(FILE *raw, FrameIndexWriter &index, uint64_t fnum,
+                uint32_t packets) {
+    FrameIndexEntry entry{};
+    entry.frameNumber = fnum;
+    entry.offset = static_cast<uint64_t>(ftell(raw));
+    entry.timestamp = fnum * 10;
+    entry.packets = packets;
+    entry.size = RECORD_SIZE;
+    std::vector<char> record(RECORD_SIZE, static_cast<char>(fnum));
+    fwrite(record.data(), 1, record.size(), raw);
+    index.Add(entry);
+}
+
+std::string tempName(const std::string &suffix) {
+    char fname[] = "/tmp/rawindex_XXXXXX";
+    int fd = mkstemp(fname);
+    close(fd);
+    unlink(fname);
+    return std::string(fname) + suffix;
+}
+
+// frames 1..n over two sub files, every frame in incomplete has 3 packets
+std::vector<std::string>
+writeFiles(const std::vector<uint64_t> &frames,
+           const std::vector<uint64_t> &incomplete) {
+    std::vector<std::string> files{tempName("_f0_0.raw"),
+                                   tempName("_f1_0.raw")};
+    size_t half = frames.size() / 2;
+    for (size_t f = 0; f < files.size(); ++f) {
+        FILE *raw = fopen(files[f].c_str(), "w");
+        FrameIndexWriter index;
+        index.Open(FrameIndexFileName(files[f]), PACKETS, true);
+        size_t begin = f == 0 ? 0 : half;
+        size_t end = f == 0 ? half : frames.size();
+        for (size_t i = begin; i < end; ++i) {
+            bool missing = std::find(incomplete.begin(), incomplete.end(),
+                                     frames[i]) != incomplete.end();
+            writeFrame(raw, index, frames[i], missing ? 3 : PACKETS);
+        }
+        index.Close();
+        fclose(raw);
+    }
+    return files;
+}
+
+void removeFiles(const std::vector<std::string> &files) {
+    for (const auto &f : files) {
+        unlink(f.c_str());
+        unlink(FrameIndexFileName(f).c_str());
+    }
+}
+
+} // namespace
+
+TEST_CASE("Frame index file name replaces the extension") {
+    REQUIRE(FrameIndexFileName("/data/run_d0_f0_0.raw") ==
+            "/data/run_d0_f0_0.idx");
+    REQUIRE(FrameIndexFileName("/data.dir/run") == "/data.dir/run.idx");
+}
+
+TEST_CASE("Find and read frames through the index") {
+    std::vector<uint64_t> frames;
+    for (uint64_t i = 1; i <= 3000; ++i) {
+        frames.push_back(i);
+    }
+    auto files = writeFiles(frames, {7, 2500});
+    RawFileReader reader(files);
+
+    REQUIRE(reader.NumFrames() == 3000);
+    REQUIRE(reader.PacketsPerFrame() == PACKETS);
+    REQUIRE(reader.MaxFrameSize() == RECORD_SIZE);
+    REQUIRE(reader.Find(1) == 0);
+    REQUIRE(reader.Find(2500) == 2499);
+    REQUIRE(reader.Find(0) == -1);
+    REQUIRE(reader.Find(3001) == -1);
+    REQUIRE(reader.Entry(2499).timestamp == 25000);
+
+    auto complete = reader.CompleteFrames();
+    REQUIRE(complete.size() == 2998);
+    REQUIRE_FALSE(reader.IsComplete(6));
+    REQUIRE(std::find(complete.begin(), complete.end(), 2499u) ==
+            complete.end());
+
+    // the range crosses from the first to the second file
+    std::vector<char> buffer(1000 * RECORD_SIZE);
+    reader.ReadRange(1000, 1000, buffer.data(), RECORD_SIZE, 4);
+    for (size_t k = 0; k < 1000; ++k) {
+        CHECK(buffer[k * RECORD_SIZE] == static_cast<char>(1001 + k));
+        CHECK(buffer[k * RECORD_SIZE + RECORD_SIZE - 1] ==
+              static_cast<char>(1001 + k));
+    }
+    REQUIRE_THROWS_AS(
+        reader.ReadRange(2500, 1000, buffer.data(), RECORD_SIZE),
+        RuntimeError);
+    REQUIRE_THROWS_AS(reader.ReadRange(0, 10, buffer.data(), 10),
+                      RuntimeError);
+    removeFiles(files);
+}
+
+TEST_CASE("Find frames with gaps in the frame numbers") {
+    std::vector<uint64_t> frames{5, 6, 9, 10, 20, 21};
+    auto files = writeFiles(frames, {});
+    RawFileReader reader(files);
+    REQUIRE(reader.Find(9) == 2);
+    REQUIRE(reader.Find(21) == 5);
+    REQUIRE(reader.Find(7) == -1);
+
+    std::vector<char> buffer(2 * RECORD_SIZE);
+    std::vector<size_t> positions{static_cast<size_t>(reader.Find(20)),
+                                  static_cast<size_t>(reader.Find(6))};
+    reader.ReadFrames(positions, buffer.data(), RECORD_SIZE);
+    REQUIRE(buffer[0] == 20);
+    REQUIRE(buffer[RECORD_SIZE] == 6);
+    removeFiles(files);
+}
+
+TEST_CASE("Raw file without index throws") {
+    auto fname = tempName(".raw");
+    FILE *raw = fopen(fname.c_str(), "w");
+    fclose(raw);
+    REQUIRE_THROWS_AS(RawFileReader({fname}), RuntimeError);
+    unlink(fname.c_str());
+}
+
+} // namespace sls
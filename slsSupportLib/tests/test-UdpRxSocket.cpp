@@ -108,3 +108,25 @@ TEST_CASE("Receive an int to an external buffer") {
     CHECK(s.ReceivePacket(reinterpret_cast<char *>(&received)));
     CHECK(received == to_send);
 }
+
+TEST_CASE("Steer packets of a shared port by frame number") {
+    constexpr int port = 50003;
+    constexpr ssize_t packet_size = sizeof(uint64_t) * 2;
+    sls::UdpRxSocket s0(port, packet_size, nullptr, 0, true);
+    s0.setFrameNumberSteering(2);
+    sls::UdpRxSocket s1(port, packet_size, nullptr, 0, true);
+
+    auto fd = open_socket(port);
+    for (uint64_t fnum = 0; fnum != 6; ++fnum) {
+        uint64_t packet[2]{fnum, 0};
+        write(fd, packet, packet_size);
+    }
+    close(fd);
+    uint64_t received[2]{};
+    for (uint64_t fnum = 0; fnum != 6; fnum += 2) {
+        CHECK(s0.ReceivePacket(reinterpret_cast<char *>(received)));
+        CHECK(received[0] == fnum);
+        CHECK(s1.ReceivePacket(reinterpret_cast<char *>(received)));
+        CHECK(received[0] == fnum + 1);
+    }
+}
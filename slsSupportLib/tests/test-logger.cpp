@@ -1,10 +1,16 @@
 // SPDX-License-Identifier: LGPL-3.0-or-other
 // Copyright (C) 2021 Contributors to the SLS Detector Package
 #include "catch.hpp"
+#include "sls/AsyncLogger.h"
 #include "sls/logger.h"
+#include <atomic>
 #include <chrono>
 #include <fstream>
 #include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
 
 using sls::Logger;
 
@@ -48,4 +54,120 @@ TEST_CASE("Test output") {
     auto r = local.str();
     auto pos = r.find("This should be printed");
     CHECK(pos != std::string::npos);
-}
\ No newline at end of file
+}
+TEST_CASE("Timestamp is cached per second but keeps milliseconds") {
+    char ts[Logger::TIMESTAMP_LEN];
+    Logger::Timestamp(ts);
+    CHECK(std::string(ts).size() == 12);
+    CHECK(ts[8] == '.');
+}
+
+TEST_CASE("Long messages are written in full") {
+    std::ostringstream local;
+    auto clog_buff = std::clog.rdbuf();
+    std::clog.rdbuf(local.rdbuf());
+    std::string msg(2000, 'x');
+    LOG(logERROR) << msg << "end";
+    std::clog.rdbuf(clog_buff);
+    CHECK(local.str().find(msg + "end") != std::string::npos);
+}
+
+TEST_CASE("Asynchronous logging with rate limiting") {
+    std::ostringstream local;
+    auto clog_buff = std::clog.rdbuf();
+    std::clog.rdbuf(local.rdbuf());
+
+    sls::AsyncLogConfig config;
+    config.maxRepeats = 5;
+    sls::AsyncLogger::Start(config);
+    CHECK(sls::AsyncLogger::IsRunning());
+    LOG(logERROR) << "Async message";
+    for (int i = 0; i != 20; ++i) {
+        LOG(logWARNING) << "Repeated message";
+    }
+    std::thread t([] { LOG(logERROR) << "Message from another thread"; });
+    t.join();
+    sls::AsyncLogger::Flush();
+    sls::AsyncLogger::Stop();
+    CHECK(sls::AsyncLogger::IsRunning() == false);
+    std::clog.rdbuf(clog_buff);
+
+    auto r = local.str();
+    CHECK(r.find("Async message") != std::string::npos);
+    CHECK(r.find("Message from another thread") != std::string::npos);
+    CHECK(r.find("15 repeated log messages suppressed") != std::string::npos);
+    size_t n = 0;
+    for (auto pos = r.find("Repeated message"); pos != std::string::npos;
+         pos = r.find("Repeated message", pos + 1)) {
+        ++n;
+    }
+    CHECK(n == 5);
+    CHECK(sls::AsyncLogger::GetNumberOfSuppressed() >= 15);
+}
+
+TEST_CASE("Long messages are written in full asynchronously") {
+    std::ostringstream local;
+    auto clog_buff = std::clog.rdbuf();
+    std::clog.rdbuf(local.rdbuf());
+    sls::AsyncLogger::Start();
+    std::string msg(2000, 'y');
+    LOG(logERROR) << msg << "end";
+    LOG(logERROR) << "Short message after";
+    sls::AsyncLogger::Stop();
+    std::clog.rdbuf(clog_buff);
+    auto r = local.str();
+    auto pos = r.find(msg + "end");
+    CHECK(pos != std::string::npos);
+    CHECK(r.find("Short message after") > pos);
+}
+
+namespace {
+/** messages during Stop are written by several threads at once */
+class LockedStringBuf : public std::stringbuf {
+  protected:
+    std::streamsize xsputn(const char *s, std::streamsize n) override {
+        std::lock_guard<std::recursive_mutex> lock(mtx);
+        return std::stringbuf::xsputn(s, n);
+    }
+    int_type overflow(int_type c) override {
+        std::lock_guard<std::recursive_mutex> lock(mtx);
+        return std::stringbuf::overflow(c);
+    }
+
+  private:
+    std::recursive_mutex mtx;
+};
+} // namespace
+
+TEST_CASE("Messages logged while stopping are not lost") {
+    LockedStringBuf local;
+    auto clog_buff = std::clog.rdbuf();
+    std::clog.rdbuf(&local);
+    sls::AsyncLogConfig config;
+    config.rateWindow = std::chrono::milliseconds(0);
+    config.recordsPerThread = 1 << 16;
+    sls::AsyncLogger::Start(config);
+    std::atomic<bool> go{false};
+    std::vector<std::thread> threads;
+    for (int t = 0; t != 4; ++t) {
+        threads.emplace_back([&go, t] {
+            while (!go)
+                std::this_thread::yield();
+            for (int i = 0; i != 2000; ++i)
+                LOG(logINFO) << "Stop message " << t << " " << i << ";";
+        });
+    }
+    go = true;
+    sls::AsyncLogger::Stop();
+    for (auto &t : threads)
+        t.join();
+    std::clog.rdbuf(clog_buff);
+    auto r = local.str();
+    size_t n = 0;
+    for (auto pos = r.find("Stop message"); pos != std::string::npos;
+         pos = r.find("Stop message", pos + 1)) {
+        ++n;
+    }
+    CHECK(n == 8000);
+    CHECK(sls::AsyncLogger::GetNumberOfDropped() == 0);
+}